@@ -1,8 +1,16 @@
 #include "qmqttclient.h"
 #include "qmqttclient_p.h"
+#include "qmqttsubscription.h"
 #include "qmqttnetworkrequest.h"
 #include "qmqttcontrolpacket_p.h"
 #include "qmqttwill.h"
+#include "qmqttsessionstore_p.h"
+#include "qmqttstatistics_p.h"
+#include <QPointer>
+#include <QThread>
+#include <QVarLengthArray>
+#include <QMetaMethod>
+#include <memory>
 #include "logging_p.h"
 
 LoggingModule("QMqttClient");
@@ -12,7 +20,7 @@ LoggingModule("QMqttClient");
 
    \inmodule QtMqtt
 
-    \brief Implements a client for the MQTT protocol over WebSockets.
+    \brief Implements a client for the MQTT protocol over WebSockets or TCP.
 
     MQTT stands for Message Queue Telemetry Transport, and is a web technology providing full-duplex
     communications channels over a single TCP connection.
@@ -22,17 +30,27 @@ LoggingModule("QMqttClient");
    Limitations:
    ============
    \list 1
-   \li The QMqttClient class currently does not support sessions and hence does not redeliver
-   packets.
+   \li By default, the QMqttClient uses clean sessions and hence does not redeliver packets.
+   Persistent sessions can be enabled with setSessionFile().
 
    From the MQTT specification (4.4 Message delivery retry):
    "Historically retransmission of Control Packets was required to overcome data loss on some
    older TCP networks. This might remain a concern where MQTT 3.1.1 implementations
    are to be deployed in such environments."
-   We assume that the MQTT client is deployed on state-of-the-art TCP networks.
-
-   \li The QMqttClient currently does not support publishing messages with QoS 2.
+   We assume that the MQTT client is deployed on state-of-the-art TCP networks, and only
+   redeliver packets when a persistent session is resumed.
    \endlist
+
+   Thread safety:
+   ==============
+   The publish() functions can be called from any thread; all other functions must be called
+   from the thread the client lives in.
+   A message published from another thread is encoded on that thread, and passed to the thread
+   of the client through a lock-free queue, where it is sent together with the other messages
+   that were published in the meantime. The order of the messages of each publishing thread is
+   kept. The callback of such a message is called on the thread of the client, unless a context
+   object is given. When the queue is full (4096 messages), the message is dropped and its
+   callback is called with false right away, on the publishing thread.
  */
 
 /*!
@@ -68,6 +86,42 @@ LoggingModule("QMqttClient");
     \fn void QMqttClient::messageReceived(const QString &topicName, const QByteArray &message);
 
     This signal is emitted when a \a message was received on the topic with the given \a topicName;
+
+    To only receive the messages of one topic filter, use the QMqttSubscription returned by
+    subscribe() instead of matching \a topicName in every receiver.
+
+    Emitting this signal decodes the topic name and copies the message; when no receiver is
+    connected to it, neither is done.
+
+    \sa messageArrived()
+*/
+
+/*!
+    \fn void QMqttClient::messageArrived(const QMqttMessage &message);
+
+    This signal is emitted when a \a message was received, before messageReceived().
+    The \a message refers to its topic name and payload in the received data, so that receivers
+    that only compare or forward topic names do not pay for decoding them.
+*/
+
+/*!
+    \fn void QMqttClient::publishWindowFull()
+
+    This signal is emitted when a message published with QoS 1 or 2 (AT_LEAST_ONCE or
+    EXACTLY_ONCE) is queued in the client, because maximumInflight() messages are already waiting
+    for their acknowledgement.
+    Producers should stop publishing until readyToPublish() is emitted.
+
+    \sa setMaximumInflight(), readyToPublish()
+*/
+
+/*!
+    \fn void QMqttClient::readyToPublish()
+
+    This signal is emitted when all queued messages have been sent after publishWindowFull() was
+    emitted, so that new messages are sent right away again.
+
+    \sa publishWindowFull()
 */
 
 /*!
@@ -131,19 +185,56 @@ QMqttClientPrivate::QMqttClientPrivate(const QString &clientId, const QSet<QSslE
     m_pongReceived(false),
     m_pingTimer(),
     m_pingIntervalMs(30000), // 30 seconds
-    m_webSocket(new QWebSocket),
+    m_transport(),
     m_state(QMqttProtocol::State::OFFLINE),
     m_packetParser(new QMqttPacketParser),
-    m_packetIdentifier(0),
-    m_subscribeCallbacks(),
+    m_pendingAcks(),
+    m_receivedExactlyOnce(),
+    m_sessionStore(),
+    m_subscribedTopics(),
+    m_grantedQosReceivers(),
+    m_request(),
+    m_autoReconnect(false),
+    m_shouldReconnect(false),
+    m_reconnectAttempt(0),
+    m_minimumReconnectDelayMs(1000),   // 1 second
+    m_maximumReconnectDelayMs(60000),  // 1 minute
+    m_reconnectTimer(),
+    m_randomGenerator(std::random_device()()),
+    m_subscriptions(),
+    m_topicCache(),
     m_will(),
     m_signalSlotConnected(false),
+    m_lowLatency(false),
+    m_corked(false),
+    m_flushIntervalMs(0),
+    m_flushTimer(),
+    m_writeBuffer(),
+    m_maximumInflight(0),
+    m_inflightPublishes(0),
+    m_queuedPublishes(),
+    m_publishWindowFull(false),
+    m_postedPublishes(PUBLISH_QUEUE_CAPACITY),
+    m_clock(),
+    m_pingSentAt(0),
+    m_latencies(),
+    m_statistics(),
     m_allowedSslErrors(allowedSslErrors),
     m_userName(),
-    m_password()
+    m_password(),
+    m_ioThreadEnabled(false),
+    m_ioThread(),
+    m_ioGeneration(0)
 {
     Q_ASSERT(q);
     Q_ASSERT(!clientId.isEmpty());
+
+    m_clock.start();
+    m_packetParser->setStatistics(m_statistics.d_func());
+    m_flushTimer.setSingleShot(true);
+    QObject::connect(&m_flushTimer, &QTimer::timeout, this, &QMqttClientPrivate::flush);
+    m_reconnectTimer.setSingleShot(true);
+    QObject::connect(&m_reconnectTimer, &QTimer::timeout, this, &QMqttClientPrivate::reconnect);
 }
 
 /*!
@@ -162,15 +253,37 @@ void QMqttClientPrivate::connect(const QMqttNetworkRequest &request, const QMqtt
         qCWarning(module) << "Already connected.";
         return;
     }
+    m_request = request;
     m_will = will;
     m_userName = userName;
     m_password = password;
+    m_shouldReconnect = true;
+    m_reconnectTimer.stop();
     qCDebug(module) << "Connecting to Mqtt backend @ endpoint" << request.url();
     setState(QMqttProtocol::State::CONNECTING);
 
+    if (m_ioThreadEnabled) {
+        if (!m_ioThread) {
+            m_ioThread.reset(new QMqttIoThread([this](const QList<QSslError> &errors) {
+                return sslErrorsAllowed(errors);
+            }, m_statistics.d_func()));
+            QObject::connect(m_ioThread.data(), &QMqttIoThread::eventsAvailable,
+                             this, &QMqttClientPrivate::processIoEvents, Qt::QueuedConnection);
+        }
+        m_ioThread->open(request, ++m_ioGeneration, m_lowLatency, m_pingIntervalMs);
+        return;
+    }
+
     makeSignalSlotConnections();
+    m_packetParser->reset();
 
-    m_webSocket->open(request);
+    if (m_transport) {
+        //ignore anything the previous transport still has to say
+        m_transport->disconnect();
+    }
+    m_transport.reset(QMqttTransport::create(request.url()));
+    makeTransportConnections();
+    m_transport->open(request);
 }
 
 /*!
@@ -181,8 +294,15 @@ void QMqttClientPrivate::disconnect()
     if (m_state != QMqttProtocol::State::OFFLINE) {
         m_pingTimer.stop();
         setState(QMqttProtocol::State::DISCONNECTING);
-        m_webSocket->sendBinaryMessage(QMqttDisconnectControlPacket().encode());
-        m_webSocket->close();
+        //packets that are still buffered must precede the DISCONNECT
+        flush();
+        countSent(QMqttProtocol::PacketType::DISCONNECT);
+        writeToTransport(QMqttDisconnectControlPacket().encode());
+        if (m_ioThread) {
+            m_ioThread->close();
+        } else {
+            m_transport->close();
+        }
     }
 }
 
@@ -229,526 +349,2492 @@ void QMqttClientPrivate::subscribe(const QString &topic, QMqttProtocol::QoS qos,
     qCDebug(module) << "Subscribing to topic" << topic;
     QVector<QPair<QString, QMqttProtocol::QoS>> topicFilters
             = { { topic, qos } };
-    QMqttSubscribeControlPacket subscribePacket(++m_packetIdentifier, topicFilters);
-    m_subscribeCallbacks.insert(m_packetIdentifier, cb);
-    sendData(subscribePacket.encode());
+    const uint16_t packetIdentifier
+            = m_pendingAcks.acquire(QMqttPacketIdentifierTable::Operation::SUBSCRIBE, cb);
+    if (Q_UNLIKELY(packetIdentifier == 0)) {
+        qCWarning(module) << "No packet identifier available to subscribe to topic" << topic;
+        invokeCallback(cb, false);
+        return;
+    }
+    m_subscribedTopics.insert(topic, qos);
+    QMqttSubscribeControlPacket subscribePacket(packetIdentifier, topicFilters);
+    markSent(packetIdentifier);
+    sendPacket(subscribePacket);
 }
 
 /*!
    \internal
  */
-void QMqttClientPrivate::unsubscribe(const QString &topic, std::function<void (bool)> cb)
+QMqttSubscription *QMqttClientPrivate::subscribe(const QString &topic, QMqttProtocol::QoS qos)
 {
+    Q_Q(QMqttClient);
+
     if (!isTopicNameValid(topic)) {
         qCWarning(module) << "Invalid topic name detected:" << topic;
-        setImmediate(std::bind(cb, false));
-        return;
+        return nullptr;
     }
-    QMqttUnsubscribeControlPacket unsubscribePacket(++m_packetIdentifier, {topic});
-    m_subscribeCallbacks.insert(m_packetIdentifier, cb);
-    sendData(unsubscribePacket.encode());
+    QMqttSubscription * const subscription = new QMqttSubscription(topic, qos, this, q);
+    m_subscriptions.insert(topic, subscription);
+
+    const QPointer<QMqttSubscription> guard(subscription);
+    subscribe(topic, qos, [guard](bool success) {
+        if (guard) {
+            Q_EMIT guard->subscribed(success);
+        }
+    });
+    return subscription;
 }
 
 /*!
    \internal
  */
-void QMqttClientPrivate::publish(const QString &topic, const QByteArray &message)
+void QMqttClientPrivate::removeSubscription(QMqttSubscription *subscription)
 {
-    qCDebug(module) << "Publishing" << message << "to topic" << topic;
-    QMqttPublishControlPacket packet(topic, message, QMqttProtocol::QoS::AT_MOST_ONCE, false);
-    sendData(packet.encode());
+    m_subscriptions.remove(subscription->topicFilter(), subscription);
 }
 
 /*!
+  Returns the index one past the last of the topic filters, starting at \a begin, that fit
+  together in a packet of at most \a maximumSize bytes, given the encoded \a sizes of the
+  topic filters. At least one topic filter is always included.
    \internal
  */
-void QMqttClientPrivate::publish(const QString &topic, const QByteArray &message,
-                                std::function<void (bool)> cb)
+static int chunkEnd(const QVector<int> &sizes, int begin, int maximumSize)
 {
-    qCDebug(module) << "Publishing" << message << "to topic" << topic;
-    QMqttPublishControlPacket packet(topic, message, QMqttProtocol::QoS::AT_LEAST_ONCE,
-                                     false, ++m_packetIdentifier);
-    m_subscribeCallbacks.insert(m_packetIdentifier, cb);
-    sendData(packet.encode());
+    int size = int(sizeof(uint16_t));     //packet identifier
+    int end = begin;
+    while (end < sizes.size() && (end == begin || size + sizes.at(end) <= maximumSize)) {
+        size += sizes.at(end);
+        ++end;
+    }
+    return end;
 }
 
 /*!
+  Subscribes to all \a topicFilters with as few SUBSCRIBE packets as possible.
    \internal
  */
-void QMqttClientPrivate::setState(QMqttProtocol::State newState)
+void QMqttClientPrivate::subscribe(const QVector<QPair<QString, QMqttProtocol::QoS>> &topicFilters,
+                                  std::function<void(const QVector<QMqttProtocol::QoS> &)> cb)
 {
-    if (m_state != newState) {
-        Q_Q(QMqttClient);
+    //collects the granted QoS of all packets, and calls cb once the last packet is acknowledged
+    struct BulkSubscribe
+    {
+        QVector<QMqttProtocol::QoS> grantedQos;
+        int pendingPackets;
+        std::function<void(const QVector<QMqttProtocol::QoS> &)> cb;
+    };
+    const std::shared_ptr<BulkSubscribe> bulk = std::make_shared<BulkSubscribe>();
+    bulk->grantedQos = QVector<QMqttProtocol::QoS>(topicFilters.size(), QMqttProtocol::QoS::INVALID);
+    bulk->pendingPackets = 0;
+    bulk->cb = cb;
+
+    //invalid topic filters are not sent, and keep INVALID as granted QoS
+    QVector<int> indexes;
+    QVector<int> sizes;
+    indexes.reserve(topicFilters.size());
+    sizes.reserve(topicFilters.size());
+    for (int i = 0; i < topicFilters.size(); ++i) {
+        const QString &topic = topicFilters.at(i).first;
+        if (!isTopicNameValid(topic)) {
+            qCWarning(module) << "Invalid topic name detected:" << topic;
+            continue;
+        }
+        indexes.append(i);
+        //length prefixed topic filter followed by the requested QoS
+        sizes.append(int(sizeof(uint16_t)) + topic.toUtf8().size() + 1);
+    }
 
-        m_state = newState;
-        Q_EMIT q->stateChanged(m_state);
+    int begin = 0;
+    while (begin < indexes.size()) {
+        const int end = chunkEnd(sizes, begin, MAXIMUM_SUBSCRIPTION_PACKET_SIZE);
+        const QVector<int> chunk = indexes.mid(begin, end - begin);
+
+        const uint16_t packetIdentifier
+                = m_pendingAcks.acquire(QMqttPacketIdentifierTable::Operation::SUBSCRIBE, [bulk](bool) {
+            if (--bulk->pendingPackets == 0 && bulk->cb) {
+                bulk->cb(bulk->grantedQos);
+            }
+        });
+        if (Q_UNLIKELY(packetIdentifier == 0)) {
+            qCWarning(module) << "No packet identifier available to subscribe.";
+            break;
+        }
+        m_grantedQosReceivers.insert(packetIdentifier, [bulk, chunk](const QVector<QMqttProtocol::QoS> &qos) {
+            for (int i = 0; i < chunk.size() && i < qos.size(); ++i) {
+                bulk->grantedQos[chunk.at(i)] = qos.at(i);
+            }
+        });
+        ++bulk->pendingPackets;
+
+        QVector<QPair<QString, QMqttProtocol::QoS>> packetFilters;
+        packetFilters.reserve(chunk.size());
+        for (const int index : chunk) {
+            packetFilters.append(topicFilters.at(index));
+            m_subscribedTopics.insert(topicFilters.at(index).first, topicFilters.at(index).second);
+        }
+        markSent(packetIdentifier);
+        sendPacket(QMqttSubscribeControlPacket(packetIdentifier, packetFilters));
+        begin = end;
+    }
+
+    if (bulk->pendingPackets == 0 && cb) {
+        //nothing was sent
+        const QVector<QMqttProtocol::QoS> grantedQos = bulk->grantedQos;
+        if (m_lowLatency) {
+            cb(grantedQos);
+        } else {
+            setImmediate(std::bind(cb, grantedQos));
+        }
     }
 }
 
 /*!
+  Unsubscribes from all \a topics with as few UNSUBSCRIBE packets as possible.
    \internal
  */
-QHostAddress QMqttClientPrivate::localAddress() const
+void QMqttClientPrivate::unsubscribe(const QStringList &topics, std::function<void(bool)> cb)
 {
-    qInfo() << "socket info:" << m_webSocket->localAddress() << m_webSocket->peerAddress() << m_webSocket->state();
-    return m_webSocket->localAddress();
+    struct BulkUnsubscribe
+    {
+        bool success;
+        int pendingPackets;
+        std::function<void(bool)> cb;
+    };
+    const std::shared_ptr<BulkUnsubscribe> bulk = std::make_shared<BulkUnsubscribe>();
+    bulk->success = true;
+    bulk->pendingPackets = 0;
+    bulk->cb = cb;
+
+    QStringList validTopics;
+    QVector<int> sizes;
+    validTopics.reserve(topics.size());
+    sizes.reserve(topics.size());
+    for (const QString &topic : topics) {
+        if (!isTopicNameValid(topic)) {
+            qCWarning(module) << "Invalid topic name detected:" << topic;
+            bulk->success = false;
+            continue;
+        }
+        validTopics.append(topic);
+        sizes.append(int(sizeof(uint16_t)) + topic.toUtf8().size());
+    }
+
+    int begin = 0;
+    while (begin < validTopics.size()) {
+        const int end = chunkEnd(sizes, begin, MAXIMUM_SUBSCRIPTION_PACKET_SIZE);
+
+        const uint16_t packetIdentifier
+                = m_pendingAcks.acquire(QMqttPacketIdentifierTable::Operation::UNSUBSCRIBE, [bulk](bool success) {
+            bulk->success = bulk->success && success;
+            if (--bulk->pendingPackets == 0 && bulk->cb) {
+                bulk->cb(bulk->success);
+            }
+        });
+        if (Q_UNLIKELY(packetIdentifier == 0)) {
+            qCWarning(module) << "No packet identifier available to unsubscribe.";
+            bulk->success = false;
+            break;
+        }
+        ++bulk->pendingPackets;
+
+        QVector<QString> packetTopics;
+        packetTopics.reserve(end - begin);
+        for (int i = begin; i < end; ++i) {
+            packetTopics.append(validTopics.at(i));
+            m_subscribedTopics.remove(validTopics.at(i));
+        }
+        markSent(packetIdentifier);
+        sendPacket(QMqttUnsubscribeControlPacket(packetIdentifier, packetTopics));
+        begin = end;
+    }
+
+    if (bulk->pendingPackets == 0) {
+        invokeCallback(cb, bulk->success);
+    }
 }
 
 /*!
    \internal
  */
-quint16 QMqttClientPrivate::localPort() const
+void QMqttClientPrivate::unsubscribe(const QString &topic, std::function<void (bool)> cb)
 {
-    return m_webSocket->localPort();
+    if (!isTopicNameValid(topic)) {
+        qCWarning(module) << "Invalid topic name detected:" << topic;
+        setImmediate(std::bind(cb, false));
+        return;
+    }
+    const uint16_t packetIdentifier
+            = m_pendingAcks.acquire(QMqttPacketIdentifierTable::Operation::UNSUBSCRIBE, cb);
+    if (Q_UNLIKELY(packetIdentifier == 0)) {
+        qCWarning(module) << "No packet identifier available to unsubscribe from topic" << topic;
+        invokeCallback(cb, false);
+        return;
+    }
+    m_subscribedTopics.remove(topic);
+    QMqttUnsubscribeControlPacket unsubscribePacket(packetIdentifier, {topic});
+    markSent(packetIdentifier);
+    sendPacket(unsubscribePacket);
 }
 
 /*!
    \internal
  */
-void QMqttClientPrivate::sendPing()
+void QMqttClientPrivate::publish(const QString &topic, const QByteArray &message)
 {
-    qCDebug(module) << "Sending ping.";
-    if (m_pongReceived) {
-        m_pongReceived = false;
-        QMqttPingReqControlPacket packet;
-        m_webSocket->sendBinaryMessage(packet.encode());
-    } else {
-        Q_Q(QMqttClient);
-
-        const QString errorMessage = QStringLiteral("Pong not received within expected time.");
-
-        Q_EMIT q->error(QMqttProtocol::Error::TIME_OUT, errorMessage);
-
-        disconnect();
+    if (!isClientThread()) {
+        postPublish(topic, message, QMqttProtocol::QoS::AT_MOST_ONCE, nullptr);
+        return;
     }
+    qCDebug(module) << "Publishing" << message << "to topic" << topic;
+    QMqttPublishControlPacket packet(topic, message, QMqttProtocol::QoS::AT_MOST_ONCE, false);
+    sendPacket(packet);
 }
 
 /*!
    \internal
  */
-void QMqttClientPrivate::onPongReceived()
+void QMqttClientPrivate::publish(const QString &topic, const QByteArray &message,
+                                QMqttProtocol::QoS qos, std::function<void (bool)> cb)
 {
-    qCDebug(module) << "Received pong.";
-    m_pongReceived = true;
+    if (!isClientThread()) {
+        postPublish(topic, message, qos, cb);
+        return;
+    }
+    if (qos == QMqttProtocol::QoS::AT_MOST_ONCE) {
+        publish(topic, message);
+        invokeCallback(cb, true);
+        return;
+    }
+    if (Q_UNLIKELY(qos != QMqttProtocol::QoS::AT_LEAST_ONCE && qos != QMqttProtocol::QoS::EXACTLY_ONCE)) {
+        qCWarning(module) << "Invalid QoS" << qos << "to publish to topic" << topic;
+        invokeCallback(cb, false);
+        return;
+    }
+    if (m_maximumInflight > 0 && m_inflightPublishes >= m_maximumInflight) {
+        qCDebug(module) << "Publish window full, queueing message to topic" << topic;
+        queuePublish(QueuedPublish { topic, message, qos, cb, QByteArray() });
+        return;
+    }
+    qCDebug(module) << "Publishing" << message << "to topic" << topic << "with qos" << qos;
+    //a QoS 2 publish first awaits PUBREC, then PUBCOMP (see 4.3.3 QoS 2: Exactly once delivery)
+    const QMqttPacketIdentifierTable::Operation operation = (qos == QMqttProtocol::QoS::EXACTLY_ONCE)
+            ? QMqttPacketIdentifierTable::Operation::PUBLISH_EXACTLY_ONCE
+            : QMqttPacketIdentifierTable::Operation::PUBLISH;
+    const uint16_t packetIdentifier = m_pendingAcks.acquire(operation, cb);
+    if (Q_UNLIKELY(packetIdentifier == 0)) {
+        qCWarning(module) << "No packet identifier available to publish to topic" << topic;
+        invokeCallback(cb, false);
+        return;
+    }
+    ++m_inflightPublishes;
+    markSent(packetIdentifier);
+    QMqttPublishControlPacket packet(topic, message, qos, false, packetIdentifier);
+    if (m_sessionStore) {
+        const QByteArray encodedPacket = packet.encode();
+        m_sessionStore->store(packetIdentifier, encodedPacket);
+        sendEncoded(encodedPacket);
+    } else {
+        sendPacket(packet);
+    }
 }
 
 /*!
+  Publishes \a message like the other overloads, but calls \a cb on the thread of \a context.
+  The callback is not called if \a context is destroyed before.
    \internal
  */
-void QMqttClientPrivate::onSocketConnected()
+void QMqttClientPrivate::publish(const QString &topic, const QByteArray &message,
+                                 QMqttProtocol::QoS qos, QObject *context,
+                                 std::function<void(bool)> cb)
 {
-    qCDebug(module) << "WebSockets successfully connected.";
-
-    QMqttConnectControlPacket packet(m_clientId);
-    packet.setWill(m_will);
-    if (!m_userName.isEmpty() && !m_password.isNull())
-    {
-        packet.setCredentials(m_userName, m_password);
-    }
-    m_webSocket->sendBinaryMessage(packet.encode());
-
-    //TODO: initialize connection timeout
+    publish(topic, message, qos, contextCallback(context, cb));
 }
 
 /*!
+  Publishes \a message to the already encoded \a topic.
+  QoS 1 and 2 messages are encoded completely before their packet identifier is assigned, and
+  then take the path of messages published from other threads, which fills it in.
    \internal
  */
-void QMqttClientPrivate::onConnackReceived(QMqttProtocol::Error err, bool sessionPresent)
+void QMqttClientPrivate::publish(const QMqttTopic &topic, const QByteArray &message,
+                                 QMqttProtocol::QoS qos, std::function<void(bool)> cb)
 {
-    Q_Q(QMqttClient);
-
-    qCDebug(module) << "Received connack with returncode:" << err << "and session present:" << sessionPresent;
-    if (m_state != QMqttProtocol::State::CONNECTING) {
-        const QString errorString =
-                QStringLiteral("Received a CONNACK packet while the MQTT connection is already connected.");
-        Q_EMIT q->error(QMqttProtocol::Error::PROTOCOL_VIOLATION, errorString);
-        m_webSocket->abort();
+    if (Q_UNLIKELY(!topic.isValid() || (qos != QMqttProtocol::QoS::AT_MOST_ONCE
+                                        && qos != QMqttProtocol::QoS::AT_LEAST_ONCE
+                                        && qos != QMqttProtocol::QoS::EXACTLY_ONCE))) {
+        qCWarning(module) << "Cannot publish to topic" << topic.name() << "with qos" << qos;
+        if (!isClientThread()) {
+            if (cb) {
+                cb(false);
+            }
+        } else {
+            invokeCallback(cb, false);
+        }
         return;
     }
-    if (err != QMqttProtocol::Error::CONNECTION_ACCEPTED) {
-        const QString errorString = QStringLiteral("Connection refused");
-        Q_EMIT q->error(err, errorString);
-        m_webSocket->abort();
+    const QMqttPublishControlPacket packet(topic, message, qos, false);
+    if (!isClientThread()) {
+        postEncoded(topic.name(), packet.encode(), qos, cb);
         return;
     }
-
-    if (m_pingIntervalMs > 0) {
-        m_pongReceived = true;
-        m_pingTimer.setInterval(m_pingIntervalMs);
-        m_pingTimer.setSingleShot(false);
-        m_pingTimer.start();
+    if (qos == QMqttProtocol::QoS::AT_MOST_ONCE) {
+        sendPacket(packet);
+        invokeCallback(cb, true);
+        return;
+    }
+    const QByteArray encodedPacket = packet.encode();
+    if (Q_UNLIKELY(encodedPacket.isEmpty())) {
+        invokeCallback(cb, false);
+        return;
     }
+    publishEncoded(encodedPacket, qos, cb);
+}
 
-    Q_EMIT q->connected();
+/*!
+  Publishes \a message to \a topic like the other overloads, but calls \a cb on the thread of
+  \a context.
+   \internal
+ */
+void QMqttClientPrivate::publish(const QMqttTopic &topic, const QByteArray &message,
+                                 QMqttProtocol::QoS qos, QObject *context,
+                                 std::function<void(bool)> cb)
+{
+    publish(topic, message, qos, contextCallback(context, cb));
 }
 
 /*!
+  Returns a callback that calls \a cb on the thread of \a context, unless \a context was
+  destroyed in the meantime. Returns \a cb itself if either of them is null.
    \internal
  */
-void QMqttClientPrivate::onSubackReceived(uint16_t packetIdentifier,
-                                         QVector<QMqttProtocol::QoS> qos)
+std::function<void(bool)> QMqttClientPrivate::contextCallback(QObject *context,
+                                                              std::function<void(bool)> cb)
 {
-    qCDebug(module) << "Received suback for packet with id" << packetIdentifier;
-    if (m_subscribeCallbacks.contains(packetIdentifier)) {
-        const std::vector<QMqttProtocol::QoS> qosVector = qos.toStdVector();
-        const bool result = std::none_of(qosVector.begin(), qosVector.end(),
-                                         [](QMqttProtocol::QoS qos) { return qos == QMqttProtocol::QoS::INVALID; });
-        auto cb = m_subscribeCallbacks.value(packetIdentifier);
-        m_subscribeCallbacks.remove(packetIdentifier);
-        setImmediate(std::bind(cb, result));
+    if (!cb || !context) {
+        return cb;
     }
+    const QPointer<QObject> guard(context);
+    return [guard, cb](bool result) {
+        if (guard) {
+            QTimer::singleShot(0, guard.data(), std::bind(cb, result));
+        }
+    };
 }
 
 /*!
+  Returns true if called from the thread the client lives in.
    \internal
  */
-void QMqttClientPrivate::onPublishReceived(QMqttProtocol::QoS qos, uint16_t packetIdentifier,
-                                          const QString &topicName, const QByteArray &message)
+bool QMqttClientPrivate::isClientThread() const
 {
-    Q_Q(QMqttClient);
-
-    qCDebug(module) << "Received publish packet with qos" << qos << "and id" << packetIdentifier;
-
-    Q_EMIT q->messageReceived(topicName, message);
+    return QThread::currentThread() == q_ptr->thread();
+}
 
-    if (qos == QMqttProtocol::QoS::EXACTLY_ONCE) {
-        const QMqttPubRecControlPacket packet(packetIdentifier);
-        sendData(packet.encode());
-    } else if (qos == QMqttProtocol::QoS::AT_LEAST_ONCE) {
-        const QMqttPubAckControlPacket packet(packetIdentifier);
-        sendData(packet.encode());
+/*!
+  Encodes \a message on the calling thread, and queues it for the thread of the client, where
+  it gets its packet identifier and is sent.
+  Messages that are posted while the thread of the client is busy are sent in one batch, with a
+  single wake-up of that thread.
+  When the message cannot be encoded or the queue is full, \a cb is called with false right away,
+  on the calling thread.
+   \internal
+ */
+void QMqttClientPrivate::postPublish(const QString &topic, const QByteArray &message,
+                                     QMqttProtocol::QoS qos, std::function<void(bool)> cb)
+{
+    if (Q_UNLIKELY(qos != QMqttProtocol::QoS::AT_MOST_ONCE && qos != QMqttProtocol::QoS::AT_LEAST_ONCE
+                   && qos != QMqttProtocol::QoS::EXACTLY_ONCE)) {
+        qCWarning(module) << "Invalid QoS" << qos << "to publish to topic" << topic;
+        if (cb) {
+            cb(false);
+        }
+        return;
     }
+    //the packet identifier is filled in when the message is sent
+    postEncoded(topic, QMqttPublishControlPacket(topic, message, qos, false).encode(), qos, cb);
 }
 
 /*!
+  Queues the encoded \a packet, a message to \a topic, for the thread of the client.
+  When \a packet is empty, because the message could not be encoded, or the queue is full,
+  \a cb is called with false right away, on the calling thread.
    \internal
  */
-void QMqttClientPrivate::onPubRelReceived(uint16_t packetIdentifier)
+void QMqttClientPrivate::postEncoded(const QString &topic, const QByteArray &packet,
+                                     QMqttProtocol::QoS qos, std::function<void(bool)> cb)
 {
-    qCDebug(module) << "Received PubRel packet with id" << packetIdentifier;
-    QMqttPubCompControlPacket packet(packetIdentifier);
-    sendData(packet.encode());
+    PostedPublish posted { packet, qos, cb };
+    bool wakeUp = false;
+    if (Q_UNLIKELY(posted.packet.isEmpty() || !m_postedPublishes.push(posted, &wakeUp))) {
+        qCWarning(module) << "Cannot publish to topic" << topic << "from another thread:"
+                          << (posted.packet.isEmpty() ? "message too big." : "queue full.");
+        if (cb) {
+            cb(false);
+        }
+        return;
+    }
+    if (wakeUp) {
+        QMetaObject::invokeMethod(this, "publishPosted", Qt::QueuedConnection);
+    }
 }
 
 /*!
+  Sends the messages that were published from other threads, in batches of at most the
+  capacity of the queue, so that producers cannot keep the thread of the client busy forever.
+  A batch is written to the transport at once.
    \internal
  */
-void QMqttClientPrivate::onPubAckReceived(uint16_t packetIdentifier)
+void QMqttClientPrivate::publishPosted()
 {
-    qCDebug(module) << "Received PubAck packet with id" << packetIdentifier;
-    if (m_subscribeCallbacks.contains(packetIdentifier)) {
-        auto cb = m_subscribeCallbacks.value(packetIdentifier);
-        m_subscribeCallbacks.remove(packetIdentifier);
-        setImmediate(std::bind(cb, true));
+    const bool corked = m_corked;
+    m_corked = true;
+    PostedPublish posted;
+    int count = 0;
+    while (count < PUBLISH_QUEUE_CAPACITY && m_postedPublishes.pop(posted)) {
+        publishEncoded(posted.packet, posted.qos, posted.cb);
+        ++count;
+    }
+    m_corked = corked;
+    if (!m_corked) {
+        if (m_flushIntervalMs == 0) {
+            flush();
+        } else if (!m_writeBuffer.isEmpty() && !m_flushTimer.isActive()) {
+            m_flushTimer.start(m_flushIntervalMs);
+        }
+    }
+    if (count == PUBLISH_QUEUE_CAPACITY) {
+        //the queue was not found empty, so producers will not wake us up
+        QMetaObject::invokeMethod(this, "publishPosted", Qt::QueuedConnection);
     }
 }
 
 /*!
+  Publishes the already encoded \a packet, of which the packet identifier is assigned here.
    \internal
  */
-void QMqttClientPrivate::onUnsubackReceived(uint16_t packetIdentifier)
+void QMqttClientPrivate::publishEncoded(QByteArray packet, QMqttProtocol::QoS qos,
+                                        std::function<void(bool)> cb)
 {
-    qCDebug(module) << "Received unsuback for packet with id" << packetIdentifier;
-    if (m_subscribeCallbacks.contains(packetIdentifier)) {
-        auto cb = m_subscribeCallbacks.value(packetIdentifier);
-        m_subscribeCallbacks.remove(packetIdentifier);
-        setImmediate(std::bind(cb, true));
+    if (qos == QMqttProtocol::QoS::AT_MOST_ONCE) {
+        sendEncoded(packet);
+        invokeCallback(cb, true);
+        return;
+    }
+    if (m_maximumInflight > 0 && m_inflightPublishes >= m_maximumInflight) {
+        qCDebug(module) << "Publish window full, queueing encoded message";
+        queuePublish(QueuedPublish { QString(), QByteArray(), qos, cb, packet });
+        return;
+    }
+    const QMqttPacketIdentifierTable::Operation operation = (qos == QMqttProtocol::QoS::EXACTLY_ONCE)
+            ? QMqttPacketIdentifierTable::Operation::PUBLISH_EXACTLY_ONCE
+            : QMqttPacketIdentifierTable::Operation::PUBLISH;
+    const uint16_t packetIdentifier = m_pendingAcks.acquire(operation, cb);
+    if (Q_UNLIKELY(packetIdentifier == 0)) {
+        qCWarning(module) << "No packet identifier available to publish encoded message";
+        invokeCallback(cb, false);
+        return;
+    }
+    ++m_inflightPublishes;
+    markSent(packetIdentifier);
+    QMqttPublishControlPacket::setPacketIdentifier(packet, packetIdentifier);
+    if (m_sessionStore) {
+        m_sessionStore->store(packetIdentifier, packet);
     }
+    sendEncoded(packet);
 }
 
 /*!
+  Queues a publish that does not fit in the in-flight window.
    \internal
  */
-void QMqttClientPrivate::sendData(const QByteArray &data)
+void QMqttClientPrivate::queuePublish(const QueuedPublish &queued)
 {
-    m_webSocket->sendBinaryMessage(data);
-    if (m_pingIntervalMs > 0) {
-        m_pingTimer.start();  //restart the timer
+    m_queuedPublishes.enqueue(queued);
+    if (!m_publishWindowFull) {
+        Q_Q(QMqttClient);
+
+        m_publishWindowFull = true;
+        Q_EMIT q->publishWindowFull();
     }
 }
 
 /*!
-  Converts the given list of QSSlErrors to a list of strings.
    \internal
  */
-QString toString(const QList<QSslError> &sslErrors) {
-    QString sslErrorString;
-    for (const QSslError &sslError : sslErrors) {
-        sslErrorString.append(QStringLiteral("%1 (%2)\n")
-                              .arg(sslError.errorString()).arg(sslError.error()));
+void QMqttClientPrivate::setLowLatencyMode(bool enabled)
+{
+    if (m_lowLatency == enabled) {
+        return;
+    }
+    if (m_state != QMqttProtocol::State::OFFLINE) {
+        qCWarning(module) << "Low latency mode can only be changed while offline.";
+        return;
+    }
+    m_lowLatency = enabled;
+    if (m_signalSlotConnected) {
+        //reconnect with the new connection type on the next connect()
+        m_packetParser->disconnect();
+        m_pingTimer.disconnect();
+        m_signalSlotConnected = false;
     }
-    return sslErrorString;
 }
 
+/*!
+   \internal
+ */
+bool QMqttClientPrivate::isLowLatencyMode() const
+{
+    return m_lowLatency;
+}
 
 /*!
    \internal
  */
-bool QMqttClientPrivate::sslErrorsAllowed(const QList<QSslError> &errors) const
+void QMqttClientPrivate::setIoThreadEnabled(bool enabled)
 {
-    if (!m_allowedSslErrors.isEmpty())
-    {
-        // The QSslErrors received with the QWebSocket::sslErrors signal are probably defined with the QSslError constructor
-        // with a certificate QSslError::QSslError(QSslError::SslError error, const QSslCertificate &certificate)
-        // If m_allowedSslErrors is defined using the QSslError constructor without a certificate QSslError::QSslError(QSslError::SslError error),
-        // e.g. QSet({QSslError::HostNameMismatch, QSslError::SelfSignedCertificate, QSslError::SelfSignedCertificateInChain}),
-        // the subtraction is never empty.
-        // This is because the QSslErrors comparison operator compares both the error() and the certificate().
-        // The comparison is empty when needed:
-        // 1. if we construct a QSet<QSslError> errorsSet with only the error() of the errors received with the QWebSocket::sslErrors signal
-        // 2. and if we construct a QSet<QSslError> allowedErrors with only the error() of m_allowedSslErrors
-        QSet<QSslError> errorsSet;
-        for (const auto &error : errors)
-        {
-            errorsSet << QSslError(error.error());
-        }
-        QSet<QSslError> allowedErrors;
-        for (const auto &allowedError : m_allowedSslErrors)
-        {
-            allowedErrors << QSslError(allowedError.error());
-        }
-        const QSet<QSslError> subtraction = errorsSet.subtract(allowedErrors);
-        if (subtraction.isEmpty())
-        {
-            return true;
+    if (m_ioThreadEnabled == enabled) {
+        return;
+    }
+    if (m_state != QMqttProtocol::State::OFFLINE) {
+        qCWarning(module) << "The I/O thread can only be enabled or disabled while offline.";
+        return;
+    }
+    m_ioThreadEnabled = enabled;
+    //the transport of the other mode is not used anymore
+    if (m_ioThreadEnabled) {
+        if (m_transport) {
+            m_transport->disconnect();
+            m_transport.reset();
         }
+    } else {
+        m_ioThread.reset();
     }
-
-    return false;
 }
 
 /*!
    \internal
  */
-void QMqttClientPrivate::makeSignalSlotConnections()
+bool QMqttClientPrivate::isIoThreadEnabled() const
 {
-    if (m_signalSlotConnected)
-    {
-        return;
-    }
+    return m_ioThreadEnabled;
+}
 
-    Q_Q(QMqttClient);
+/*!
+   \internal
+ */
+void QMqttClientPrivate::setMaximumInflight(int maximum)
+{
+    m_maximumInflight = qMax(0, maximum);
+    publishQueued();
+}
 
-    QObject::connect(m_webSocket.data(), &QWebSocket::connected,
-                     this, &QMqttClientPrivate::onSocketConnected, Qt::QueuedConnection);
-    QObject::connect(m_webSocket.data(), &QWebSocket::disconnected,
-                     [this, q]() {
-        qCDebug(module) << "Received QWebSocket::disconnected, close code" << m_webSocket->closeCode() << "close reason" << m_webSocket->closeReason();
-        setState(QMqttProtocol::State::OFFLINE);
-        Q_EMIT q->disconnected();
-    });
+/*!
+   \internal
+ */
+int QMqttClientPrivate::maximumInflight() const
+{
+    return m_maximumInflight;
+}
 
-    typedef void (QWebSocket::* sslErrorsSignal)(const QList<QSslError> &);
-    QObject::connect(m_webSocket.data(), static_cast<sslErrorsSignal>(&QWebSocket::sslErrors),
-                     [this, q](const QList<QSslError> &errors) {
-        if (sslErrorsAllowed(errors))
-        {
-            qCDebug(module) << "Ignoring SSL errors" << errors;
-            m_webSocket->ignoreSslErrors();
+/*!
+   \internal
+ */
+int QMqttClientPrivate::inflightCount() const
+{
+    return m_inflightPublishes;
+}
+
+/*!
+   \internal
+ */
+int QMqttClientPrivate::queuedCount() const
+{
+    return m_queuedPublishes.size();
+}
+
+/*!
+  Moves queued publishes into the in-flight window as long as there is room, and signals
+  that the window accepts new messages once the queue is empty.
+   \internal
+ */
+void QMqttClientPrivate::publishQueued()
+{
+    while (!m_queuedPublishes.isEmpty()
+           && (m_maximumInflight == 0 || m_inflightPublishes < m_maximumInflight)) {
+        const QueuedPublish queued = m_queuedPublishes.dequeue();
+        if (queued.packet.isNull()) {
+            publish(queued.topic, queued.message, queued.qos, queued.cb);
+        } else {
+            publishEncoded(queued.packet, queued.qos, queued.cb);
         }
-        else
-        {
-            const QString errorMessage = QStringLiteral("SSL errors encountered: %1.").arg(toString(errors));
-            Q_EMIT q->error(QMqttProtocol::Error::CONNECTION_FAILED, errorMessage);
-            setState(QMqttProtocol::State::OFFLINE);
+    }
+    if (m_publishWindowFull && m_queuedPublishes.isEmpty()) {
+        Q_Q(QMqttClient);
+
+        m_publishWindowFull = false;
+        Q_EMIT q->readyToPublish();
+    }
+}
+
+/*!
+  Fails the callbacks of all requests awaiting acknowledgement and of all queued publishes,
+  as the connection they were sent on is gone.
+  With a persistent session, only subscribe and unsubscribe requests fail: messages are
+  redelivered when the session is resumed.
+   \internal
+ */
+void QMqttClientPrivate::failPending()
+{
+    m_grantedQosReceivers.clear();
+    if (m_sessionStore) {
+        for (const std::function<void(bool)> &cb
+             : m_pendingAcks.takeAll(QMqttPacketIdentifierTable::Operation::SUBSCRIBE)) {
+            invokeCallback(cb, false);
+        }
+        for (const std::function<void(bool)> &cb
+             : m_pendingAcks.takeAll(QMqttPacketIdentifierTable::Operation::UNSUBSCRIBE)) {
+            invokeCallback(cb, false);
+        }
+        updateQueueStatistics();
+        return;
+    }
+    for (const std::function<void(bool)> &cb : m_pendingAcks.takeAll()) {
+        invokeCallback(cb, false);
+    }
+    m_inflightPublishes = 0;
+    while (!m_queuedPublishes.isEmpty()) {
+        invokeCallback(m_queuedPublishes.dequeue().cb, false);
+    }
+    updateQueueStatistics();
+    publishQueued();
+}
+
+/*!
+  Releases the given \a packetIdentifier if it is in use for the operation \a op, and
+  publishes the new number of pending acknowledgements to the statistics.
+  Returns true if the identifier was released; its callback is moved to \a cb.
+   \internal
+ */
+bool QMqttClientPrivate::releaseIdentifier(uint16_t packetIdentifier,
+                                           QMqttPacketIdentifierTable::Operation op,
+                                           std::function<void(bool)> *cb)
+{
+    if (!m_pendingAcks.release(packetIdentifier, op, cb)) {
+        return false;
+    }
+    updateQueueStatistics();
+    return true;
+}
+
+/*!
+   \internal
+ */
+bool QMqttClientPrivate::setSessionFile(const QString &fileName)
+{
+    if (m_state != QMqttProtocol::State::OFFLINE) {
+        qCWarning(module) << "The session file can only be changed while offline.";
+        return false;
+    }
+    if (m_sessionStore) {
+        //forget the messages of the previous session
+        for (const QMqttSessionStore::Entry &entry : m_sessionStore->entries()) {
+            if (m_pendingAcks.release(entry.packetIdentifier,
+                                      m_pendingAcks.operation(entry.packetIdentifier), nullptr)) {
+                --m_inflightPublishes;
+            }
+        }
+        m_sessionStore.reset();
+        updateQueueStatistics();
+    }
+    if (fileName.isEmpty()) {
+        return true;
+    }
+
+    m_sessionStore.reset(new QMqttSessionStore(fileName));
+    if (!m_sessionStore->open()) {
+        m_sessionStore.reset();
+        return false;
+    }
+    //the identifiers of recovered messages stay in use until the messages are acknowledged;
+    //their callbacks did not survive the previous process
+    for (const QMqttSessionStore::Entry &entry : m_sessionStore->entries()) {
+        QMqttPacketIdentifierTable::Operation operation = QMqttPacketIdentifierTable::Operation::PUBLISH;
+        if (entry.released) {
+            operation = QMqttPacketIdentifierTable::Operation::PUBLISH_RELEASED;
+        } else if (QMqttPublishControlPacket::qos(entry.packet) == QMqttProtocol::QoS::EXACTLY_ONCE) {
+            operation = QMqttPacketIdentifierTable::Operation::PUBLISH_EXACTLY_ONCE;
+        }
+        if (m_pendingAcks.acquire(entry.packetIdentifier, operation, nullptr)) {
+            ++m_inflightPublishes;
+        }
+    }
+    updateQueueStatistics();
+    qCDebug(module) << "Recovered" << m_sessionStore->size() << "unacknowledged messages from" << fileName;
+    return true;
+}
+
+/*!
+   \internal
+ */
+QString QMqttClientPrivate::sessionFile() const
+{
+    return m_sessionStore ? m_sessionStore->fileName() : QString();
+}
+
+/*!
+  Redelivers the unacknowledged messages when the server resumed the session, as required by
+  4.4 Message delivery retry: PUBLISH packets are resent with the dup flag set, and PUBREL
+  packets for QoS 2 messages that were already received by the server.
+  When the server has no session (\a sessionPresent is false), the stored messages are
+  discarded and their callbacks are called with false.
+   \internal
+ */
+void QMqttClientPrivate::resumeSession(bool sessionPresent)
+{
+    const QVector<QMqttSessionStore::Entry> entries = m_sessionStore->entries();
+    if (sessionPresent) {
+        qCDebug(module) << "Redelivering" << entries.size() << "unacknowledged messages.";
+        for (const QMqttSessionStore::Entry &entry : entries) {
+            markSent(entry.packetIdentifier);
+            if (entry.released) {
+                sendPacket(QMqttPubRelControlPacket(entry.packetIdentifier));
+            } else {
+                sendEncoded(QMqttPublishControlPacket::markDuplicate(entry.packet));
+            }
+        }
+        return;
+    }
+
+    if (!entries.isEmpty()) {
+        qCWarning(module) << "Server has no session, discarding" << entries.size() << "unacknowledged messages.";
+    }
+    m_sessionStore->clear();
+    for (const QMqttSessionStore::Entry &entry : entries) {
+        std::function<void(bool)> cb;
+        if (m_pendingAcks.release(entry.packetIdentifier,
+                                  m_pendingAcks.operation(entry.packetIdentifier), &cb)) {
+            --m_inflightPublishes;
+            invokeCallback(cb, false);
+        }
+    }
+    updateQueueStatistics();
+    publishQueued();
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::setAutoReconnect(bool enabled)
+{
+    m_autoReconnect = enabled;
+    if (!m_autoReconnect) {
+        m_reconnectTimer.stop();
+    }
+}
+
+/*!
+   \internal
+ */
+bool QMqttClientPrivate::autoReconnect() const
+{
+    return m_autoReconnect;
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::setReconnectDelay(int minimumMs, int maximumMs)
+{
+    m_minimumReconnectDelayMs = qMax(1, minimumMs);
+    m_maximumReconnectDelayMs = qMax(m_minimumReconnectDelayMs, maximumMs);
+}
+
+/*!
+  Stops reconnecting until the next call to connect().
+   \internal
+ */
+void QMqttClientPrivate::cancelReconnect()
+{
+    m_shouldReconnect = false;
+    m_reconnectTimer.stop();
+}
+
+/*!
+  Schedules the next connection attempt after a connection was lost or could not be made.
+  The delay is chosen at random between 0 and an upper bound that starts at the minimum delay
+  and doubles with every failed attempt, up to the maximum delay ("full jitter").
+  Randomizing the whole delay spreads the reconnects of many clients that lost their connection
+  at the same time, e.g. when the server restarted.
+   \internal
+ */
+void QMqttClientPrivate::scheduleReconnect()
+{
+    if (!m_autoReconnect || !m_shouldReconnect || m_reconnectTimer.isActive()
+            || m_state != QMqttProtocol::State::OFFLINE) {
+        return;
+    }
+    std::uniform_int_distribution<int> distribution(
+                0, reconnectDelayBound(m_reconnectAttempt, m_minimumReconnectDelayMs,
+                                       m_maximumReconnectDelayMs));
+    const int delayMs = distribution(m_randomGenerator);
+    ++m_reconnectAttempt;
+
+    qCDebug(module) << "Reconnecting in" << delayMs << "ms, attempt" << m_reconnectAttempt;
+    m_reconnectTimer.start(delayMs);
+}
+
+/*!
+  Returns the upper bound of the delay before the reconnect \a attempt, counted from 0:
+  \a minimumMs doubled with every attempt, up to \a maximumMs. The exponent is capped at 30,
+  so that the shift cannot overflow.
+   \internal
+ */
+int QMqttClientPrivate::reconnectDelayBound(int attempt, int minimumMs, int maximumMs)
+{
+    const int exponent = qBound(0, attempt, 30);
+    return int(qMin(qint64(minimumMs) << exponent, qint64(maximumMs)));
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::reconnect()
+{
+    if (m_state == QMqttProtocol::State::OFFLINE && m_shouldReconnect) {
+        connect(m_request, m_will, m_userName, m_password);
+    }
+}
+
+/*!
+  Subscribes again to all topic filters the client was subscribed to, after a connection was
+  established without a session on the server.
+  The topic filters are packed into as few SUBSCRIBE packets as possible.
+   \internal
+ */
+void QMqttClientPrivate::restoreSubscriptions()
+{
+    if (m_subscribedTopics.isEmpty()) {
+        return;
+    }
+    QVector<QPair<QString, QMqttProtocol::QoS>> topicFilters;
+    topicFilters.reserve(m_subscribedTopics.size());
+    for (auto it = m_subscribedTopics.cbegin(); it != m_subscribedTopics.cend(); ++it) {
+        topicFilters.append(qMakePair(it.key(), it.value()));
+    }
+    qCDebug(module) << "Restoring" << topicFilters.size() << "subscriptions.";
+    subscribe(topicFilters, [topicFilters](const QVector<QMqttProtocol::QoS> &grantedQos) {
+        for (int i = 0; i < grantedQos.size(); ++i) {
+            if (grantedQos.at(i) == QMqttProtocol::QoS::INVALID) {
+                qCWarning(module) << "Restoring subscription to" << topicFilters.at(i).first << "failed.";
+            }
         }
     });
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::cork()
+{
+    m_corked = true;
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::uncork()
+{
+    m_corked = false;
+    flush();
+}
+
+/*!
+   \internal
+ */
+bool QMqttClientPrivate::isCorked() const
+{
+    return m_corked;
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::setFlushInterval(int ms)
+{
+    m_flushIntervalMs = qMax(0, ms);
+    if (m_flushIntervalMs == 0 && !m_corked) {
+        flush();
+    }
+}
+
+/*!
+   \internal
+ */
+int QMqttClientPrivate::flushInterval() const
+{
+    return m_flushIntervalMs;
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::setTopicCacheSize(int size)
+{
+    m_topicCache.setCapacity(size);
+}
+
+/*!
+   \internal
+ */
+int QMqttClientPrivate::topicCacheSize() const
+{
+    return m_topicCache.capacity();
+}
+
+/*!
+  Writes all buffered packets to the transport in a single write.
+   \internal
+ */
+void QMqttClientPrivate::flush()
+{
+    m_flushTimer.stop();
+    if (m_writeBuffer.isEmpty()) {
+        return;
+    }
+    sendData(m_writeBuffer);
+    m_writeBuffer.clear();
+    updateQueueStatistics();
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::setState(QMqttProtocol::State newState)
+{
+    if (m_state != newState) {
+        Q_Q(QMqttClient);
+
+        m_state = newState;
+        Q_EMIT q->stateChanged(m_state);
+    }
+}
+
+/*!
+   \internal
+ */
+QHostAddress QMqttClientPrivate::localAddress() const
+{
+    if (m_ioThread) {
+        return m_ioThread->localAddress();
+    }
+    if (!m_transport) {
+        return QHostAddress();
+    }
+    qInfo() << "socket info:" << m_transport->localAddress() << m_transport->peerAddress() << m_transport->state();
+    return m_transport->localAddress();
+}
+
+/*!
+   \internal
+ */
+quint16 QMqttClientPrivate::localPort() const
+{
+    if (m_ioThread) {
+        return m_ioThread->localPort();
+    }
+    return m_transport ? m_transport->localPort() : 0;
+}
+
+/*!
+   \internal
+ */
+qint64 QMqttClientPrivate::latencyPercentile(QMqttProtocol::Acknowledgement acknowledgement,
+                                             double percentile) const
+{
+    return m_latencies[size_t(acknowledgement)].percentile(percentile);
+}
+
+/*!
+   \internal
+ */
+quint64 QMqttClientPrivate::latencyCount(QMqttProtocol::Acknowledgement acknowledgement) const
+{
+    return m_latencies[size_t(acknowledgement)].count();
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::resetLatencies()
+{
+    for (QMqttLatencyHistogram &histogram : m_latencies) {
+        histogram.reset();
+    }
+}
+
+/*!
+  Returns the current time in nanoseconds since the client was created; never 0, as that marks
+  an unknown send time.
+   \internal
+ */
+qint64 QMqttClientPrivate::timestamp() const
+{
+    return qMax(Q_INT64_C(1), m_clock.nsecsElapsed());
+}
+
+/*!
+  Records the current time as the send time of the packet with \a packetIdentifier.
+  The packet may still wait in the write buffer when the client is corked, so the measured round
+  trip includes that delay; it does not include the time a publish waited for the in-flight
+  window.
+   \internal
+ */
+void QMqttClientPrivate::markSent(uint16_t packetIdentifier)
+{
+    m_pendingAcks.setTimestamp(packetIdentifier, timestamp());
+}
+
+/*!
+  Records the time since \a sentAt in the histogram of \a acknowledgement.
+  Does nothing if the send time is unknown (\a sentAt is 0).
+   \internal
+ */
+void QMqttClientPrivate::recordLatency(QMqttProtocol::Acknowledgement acknowledgement, qint64 sentAt)
+{
+    if (sentAt != 0) {
+        m_latencies[size_t(acknowledgement)].record((timestamp() - sentAt) / 1000);
+    }
+}
+
+/*!
+   \internal
+ */
+const QMqttStatistics &QMqttClientPrivate::statistics() const
+{
+    return m_statistics;
+}
+
+/*!
+  Writes \a data to the transport, and counts the bytes sent.
+  With an I/O thread, the data is handed to that thread, which counts the bytes as it writes them.
+   \internal
+ */
+void QMqttClientPrivate::writeToTransport(const QByteArray &data)
+{
+    if (m_ioThread) {
+        m_ioThread->write(data);
+        return;
+    }
+    m_transport->write(data);
+    QMqttStatisticsPrivate::add(m_statistics.d_func()->m_bytesSent, quint64(data.size()));
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::countSent(QMqttProtocol::PacketType type)
+{
+    m_statistics.d_func()->packetSent(type);
+}
+
+/*!
+  Publishes the current number of pending acknowledgements and buffered bytes to the statistics.
+   \internal
+ */
+void QMqttClientPrivate::updateQueueStatistics()
+{
+    QMqttStatisticsPrivate * const statistics = m_statistics.d_func();
+    statistics->m_pendingAcknowledgements.store(m_pendingAcks.size(), std::memory_order_relaxed);
+    statistics->m_writeBufferSize.store(m_writeBuffer.size(), std::memory_order_relaxed);
+    //the I/O thread keeps the size of the transport buffer up to date itself
+    if (!m_ioThread) {
+        statistics->m_transportBufferSize.store(m_transport ? m_transport->bytesToWrite() : 0,
+                                                std::memory_order_relaxed);
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::sendPing()
+{
+    qCDebug(module) << "Sending ping.";
+    if (m_pongReceived) {
+        m_pongReceived = false;
+        m_pingSentAt = timestamp();
+        QMqttPingReqControlPacket packet;
+        countSent(packet.type());
+        writeToTransport(packet.encode());
+    } else {
+        onPingTimeout();
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onPingTimeout()
+{
+    Q_Q(QMqttClient);
+
+    const QString errorMessage = QStringLiteral("Pong not received within expected time.");
+
+    Q_EMIT q->error(QMqttProtocol::Error::TIME_OUT, errorMessage);
+
+    disconnect();
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onPongReceived()
+{
+    qCDebug(module) << "Received pong.";
+    m_pongReceived = true;
+    recordLatency(QMqttProtocol::Acknowledgement::PINGRESP, m_pingSentAt);
+    m_pingSentAt = 0;
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onSocketConnected()
+{
+    qCDebug(module) << "Transport successfully connected.";
+
+    QMqttConnectControlPacket packet(m_clientId);
+    packet.setWill(m_will);
+    packet.setCleanSession(!m_sessionStore);
+    if (!m_userName.isEmpty() && !m_password.isNull())
+    {
+        packet.setCredentials(m_userName, m_password);
+    }
+    countSent(packet.type());
+    writeToTransport(packet.encode());
+
+    //TODO: initialize connection timeout
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onConnackReceived(QMqttProtocol::Error err, bool sessionPresent)
+{
+    Q_Q(QMqttClient);
+
+    qCDebug(module) << "Received connack with returncode:" << err << "and session present:" << sessionPresent;
+    if (m_state != QMqttProtocol::State::CONNECTING) {
+        const QString errorString =
+                QStringLiteral("Received a CONNACK packet while the MQTT connection is already connected.");
+        Q_EMIT q->error(QMqttProtocol::Error::PROTOCOL_VIOLATION, errorString);
+        abortTransport();
+        return;
+    }
+    if (err != QMqttProtocol::Error::CONNECTION_ACCEPTED) {
+        const QString errorString = QStringLiteral("Connection refused");
+        //only an unavailable server is worth trying again; the other refusals are permanent
+        m_shouldReconnect = (err == QMqttProtocol::Error::CONNECTION_REFUSED_SERVER_UNAVAILABLE);
+        Q_EMIT q->error(err, errorString);
+        abortTransport();
+        return;
+    }
+
+    m_reconnectAttempt = 0;
+    setState(QMqttProtocol::State::CONNECTED);
+
+    if (!sessionPresent) {
+        //the server will not redeliver messages of a previous session
+        m_receivedExactlyOnce.clear();
+    }
+    if (m_sessionStore) {
+        resumeSession(sessionPresent);
+    }
+    if (m_autoReconnect && !sessionPresent) {
+        restoreSubscriptions();
+    }
+
+    //the I/O thread handles the keep-alive itself
+    if (m_pingIntervalMs > 0 && !m_ioThread) {
+        m_pongReceived = true;
+        m_pingTimer.setInterval(m_pingIntervalMs);
+        m_pingTimer.setSingleShot(false);
+        m_pingTimer.start();
+    }
+
+    Q_EMIT q->connected();
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onSubackReceived(uint16_t packetIdentifier,
+                                         QVector<QMqttProtocol::QoS> qos)
+{
+    qCDebug(module) << "Received suback for packet with id" << packetIdentifier;
+    const qint64 sentAt = m_pendingAcks.timestamp(packetIdentifier);
+    std::function<void(bool)> cb;
+    if (releaseIdentifier(packetIdentifier, QMqttPacketIdentifierTable::Operation::SUBSCRIBE, &cb)) {
+        recordLatency(QMqttProtocol::Acknowledgement::SUBACK, sentAt);
+        if (!m_grantedQosReceivers.isEmpty()) {
+            //the granted QoS are passed on right away, before cb is invoked
+            const std::function<void(const QVector<QMqttProtocol::QoS> &)> receiver
+                    = m_grantedQosReceivers.take(packetIdentifier);
+            if (receiver) {
+                receiver(qos);
+            }
+        }
+        const bool result = std::none_of(qos.cbegin(), qos.cend(),
+                                         [](QMqttProtocol::QoS qos) { return qos == QMqttProtocol::QoS::INVALID; });
+        invokeCallback(cb, result);
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onPublishReceived(uint16_t packetIdentifier, const QMqttMessage &message)
+{
+    Q_Q(QMqttClient);
+
+    const QMqttProtocol::QoS qos = message.qos();
+    qCDebug(module) << "Received publish packet with qos" << qos << "and id" << packetIdentifier;
+
+    if (qos == QMqttProtocol::QoS::EXACTLY_ONCE) {
+        //the message is delivered once, and its id is remembered until PUBREL is received;
+        //a redelivery of the same message before that is acknowledged again, but not delivered
+        //(see 4.3.3 QoS 2: Exactly once delivery, method B)
+        if (m_receivedExactlyOnce.isEmpty()) {
+            m_receivedExactlyOnce.resize(QMqttPacketIdentifierTable::MAXIMUM_SIZE + 1);
+        }
+        if (m_receivedExactlyOnce.testBit(packetIdentifier)) {
+            qCDebug(module) << "Ignoring duplicate of publish packet with id" << packetIdentifier;
+            sendPacket(QMqttPubRecControlPacket(packetIdentifier));
+            return;
+        }
+        m_receivedExactlyOnce.setBit(packetIdentifier);
+    }
+
+    //a topic name that is cached is shared with the receivers, one that is not is only decoded
+    //when it is needed
+    m_topicCache.resolve(message);
+    Q_EMIT q->messageArrived(message);
+
+    //the topic name is only decoded, and the payload only copied out of the received data, for
+    //receivers of messageReceived() and for subscriptions
+    static const QMetaMethod messageReceivedSignal = QMetaMethod::fromSignal(&QMqttClient::messageReceived);
+    const bool deliverDecoded = q->isSignalConnected(messageReceivedSignal);
+    if (deliverDecoded || !m_subscriptions.isEmpty()) {
+        const QString topicName = m_topicCache.intern(message);
+        const QByteArray payload(message.payloadData(), message.payloadSize());
+        if (deliverDecoded) {
+            Q_EMIT q->messageReceived(topicName, payload);
+        }
+
+        //collect the matching subscriptions first, as receivers can delete subscriptions
+        QVarLengthArray<QPointer<QMqttSubscription>, 8> subscriptions;
+        m_subscriptions.match(topicName, [&subscriptions](QMqttSubscription *subscription) {
+            subscriptions.append(subscription);
+        });
+        for (const QPointer<QMqttSubscription> &subscription : subscriptions) {
+            if (subscription) {
+                Q_EMIT subscription->messageReceived(topicName, payload);
+            }
+        }
+    }
+
+    if (qos == QMqttProtocol::QoS::EXACTLY_ONCE) {
+        sendPacket(QMqttPubRecControlPacket(packetIdentifier));
+    } else if (qos == QMqttProtocol::QoS::AT_LEAST_ONCE) {
+        sendPacket(QMqttPubAckControlPacket(packetIdentifier));
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onPubRelReceived(uint16_t packetIdentifier)
+{
+    qCDebug(module) << "Received PubRel packet with id" << packetIdentifier;
+    if (!m_receivedExactlyOnce.isEmpty()) {
+        m_receivedExactlyOnce.clearBit(packetIdentifier);
+    }
+    sendPacket(QMqttPubCompControlPacket(packetIdentifier));
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onPubAckReceived(uint16_t packetIdentifier)
+{
+    qCDebug(module) << "Received PubAck packet with id" << packetIdentifier;
+    const qint64 sentAt = m_pendingAcks.timestamp(packetIdentifier);
+    std::function<void(bool)> cb;
+    if (releaseIdentifier(packetIdentifier, QMqttPacketIdentifierTable::Operation::PUBLISH, &cb)) {
+        recordLatency(QMqttProtocol::Acknowledgement::PUBACK, sentAt);
+        if (m_sessionStore) {
+            m_sessionStore->remove(packetIdentifier);
+        }
+        --m_inflightPublishes;
+        invokeCallback(cb, true);
+        publishQueued();
+    }
+}
+
+/*!
+  Releases the message of a QoS 2 publish by sending a PUBREL packet.
+  A duplicate PUBREC for a message that was already released is answered with PUBREL again.
+   \internal
+ */
+void QMqttClientPrivate::onPubRecReceived(uint16_t packetIdentifier)
+{
+    qCDebug(module) << "Received PubRec packet with id" << packetIdentifier;
+    const qint64 sentAt = m_pendingAcks.timestamp(packetIdentifier);
+    if (m_pendingAcks.transition(packetIdentifier,
+                                 QMqttPacketIdentifierTable::Operation::PUBLISH_EXACTLY_ONCE,
+                                 QMqttPacketIdentifierTable::Operation::PUBLISH_RELEASED)) {
+        recordLatency(QMqttProtocol::Acknowledgement::PUBREC, sentAt);
+        if (m_sessionStore) {
+            m_sessionStore->release(packetIdentifier);
+        }
+        markSent(packetIdentifier);
+        sendPacket(QMqttPubRelControlPacket(packetIdentifier));
+    } else if (m_pendingAcks.operation(packetIdentifier) == QMqttPacketIdentifierTable::Operation::PUBLISH_RELEASED) {
+        sendPacket(QMqttPubRelControlPacket(packetIdentifier));
+    } else {
+        qCWarning(module) << "Received PubRec packet for unknown id" << packetIdentifier;
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onPubCompReceived(uint16_t packetIdentifier)
+{
+    qCDebug(module) << "Received PubComp packet with id" << packetIdentifier;
+    const qint64 sentAt = m_pendingAcks.timestamp(packetIdentifier);
+    std::function<void(bool)> cb;
+    if (releaseIdentifier(packetIdentifier, QMqttPacketIdentifierTable::Operation::PUBLISH_RELEASED, &cb)) {
+        recordLatency(QMqttProtocol::Acknowledgement::PUBCOMP, sentAt);
+        if (m_sessionStore) {
+            m_sessionStore->remove(packetIdentifier);
+        }
+        --m_inflightPublishes;
+        invokeCallback(cb, true);
+        publishQueued();
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onUnsubackReceived(uint16_t packetIdentifier)
+{
+    qCDebug(module) << "Received unsuback for packet with id" << packetIdentifier;
+    const qint64 sentAt = m_pendingAcks.timestamp(packetIdentifier);
+    std::function<void(bool)> cb;
+    if (releaseIdentifier(packetIdentifier, QMqttPacketIdentifierTable::Operation::UNSUBSCRIBE, &cb)) {
+        recordLatency(QMqttProtocol::Acknowledgement::UNSUBACK, sentAt);
+        invokeCallback(cb, true);
+    }
+}
+
+/*!
+  Sends the given \a packet, or appends it to the write buffer when the client is corked or a
+  flush interval is set.
+   \internal
+ */
+void QMqttClientPrivate::sendPacket(const QMqttControlPacket &packet)
+{
+    countSent(packet.type());
+    if (!m_corked && m_flushIntervalMs == 0) {
+        sendData(packet.encode());
+    } else if (packet.encodeTo(m_writeBuffer) && !m_corked && !m_flushTimer.isActive()) {
+        m_flushTimer.start(m_flushIntervalMs);
+    }
+    updateQueueStatistics();
+}
+
+/*!
+  Sends the already encoded \a packet, or appends it to the write buffer when the client is
+  corked or a flush interval is set.
+   \internal
+ */
+void QMqttClientPrivate::sendEncoded(const QByteArray &packet)
+{
+    countSent(QMqttProtocol::PacketType(uint8_t(packet.at(0)) >> 4));
+    if (!m_corked && m_flushIntervalMs == 0) {
+        sendData(packet);
+    } else {
+        m_writeBuffer.append(packet);
+        if (!m_corked && !m_flushTimer.isActive()) {
+            m_flushTimer.start(m_flushIntervalMs);
+        }
+    }
+    updateQueueStatistics();
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::sendData(const QByteArray &data)
+{
+    if (Q_UNLIKELY(!m_transport && !m_ioThread)) {
+        qCWarning(module) << "Cannot send data: client was never connected.";
+        return;
+    }
+    writeToTransport(data);
+    if (m_pingIntervalMs > 0 && !m_ioThread) {
+        m_pingTimer.start();  //restart the timer
+    }
+}
+
+/*!
+  Returns the connection type used between transport, parser and client.
+  In low latency mode, packets are handled synchronously, on the stack of the socket's signal;
+  otherwise every step is queued in the event loop.
+   \internal
+ */
+Qt::ConnectionType QMqttClientPrivate::connectionType() const
+{
+    return m_lowLatency ? Qt::DirectConnection : Qt::QueuedConnection;
+}
+
+/*!
+  Invokes the callback \a cb with the given \a result, either directly when in low latency
+  mode, or from the event loop otherwise.
+   \internal
+ */
+void QMqttClientPrivate::invokeCallback(const std::function<void(bool)> &cb, bool result)
+{
+    if (!cb) {
+        return;
+    }
+    if (m_lowLatency) {
+        cb(result);
+    } else {
+        setImmediate(std::bind(cb, result));
+    }
+}
+
+/*!
+  Converts the given list of QSSlErrors to a list of strings.
+   \internal
+ */
+QString toString(const QList<QSslError> &sslErrors) {
+    QString sslErrorString;
+    for (const QSslError &sslError : sslErrors) {
+        sslErrorString.append(QStringLiteral("%1 (%2)\n")
+                              .arg(sslError.errorString()).arg(sslError.error()));
+    }
+    return sslErrorString;
+}
+
+
+/*!
+   \internal
+ */
+bool QMqttClientPrivate::sslErrorsAllowed(const QList<QSslError> &errors) const
+{
+    if (!m_allowedSslErrors.isEmpty())
+    {
+        // The QSslErrors received with the QWebSocket::sslErrors signal are probably defined with the QSslError constructor
+        // with a certificate QSslError::QSslError(QSslError::SslError error, const QSslCertificate &certificate)
+        // If m_allowedSslErrors is defined using the QSslError constructor without a certificate QSslError::QSslError(QSslError::SslError error),
+        // e.g. QSet({QSslError::HostNameMismatch, QSslError::SelfSignedCertificate, QSslError::SelfSignedCertificateInChain}),
+        // the subtraction is never empty.
+        // This is because the QSslErrors comparison operator compares both the error() and the certificate().
+        // The comparison is empty when needed:
+        // 1. if we construct a QSet<QSslError> errorsSet with only the error() of the errors received with the QWebSocket::sslErrors signal
+        // 2. and if we construct a QSet<QSslError> allowedErrors with only the error() of m_allowedSslErrors
+        QSet<QSslError> errorsSet;
+        for (const auto &error : errors)
+        {
+            errorsSet << QSslError(error.error());
+        }
+        QSet<QSslError> allowedErrors;
+        for (const auto &allowedError : m_allowedSslErrors)
+        {
+            allowedErrors << QSslError(allowedError.error());
+        }
+        const QSet<QSslError> subtraction = errorsSet.subtract(allowedErrors);
+        if (subtraction.isEmpty())
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::makeSignalSlotConnections()
+{
+    if (m_signalSlotConnected)
+    {
+        return;
+    }
+
+    Q_Q(QMqttClient);
+
+    const Qt::ConnectionType connectionType = this->connectionType();
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::connack,
+                     this, &QMqttClientPrivate::onConnackReceived, connectionType);
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::suback,
+                     this, &QMqttClientPrivate::onSubackReceived, connectionType);
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::publish,
+                     this, &QMqttClientPrivate::onPublishReceived, connectionType);
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::pubrel,
+                     this, &QMqttClientPrivate::onPubRelReceived, connectionType);
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::unsuback,
+                     this, &QMqttClientPrivate::onUnsubackReceived, connectionType);
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::puback,
+                     this, &QMqttClientPrivate::onPubAckReceived, connectionType);
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::pubrec,
+                     this, &QMqttClientPrivate::onPubRecReceived, connectionType);
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::pubcomp,
+                     this, &QMqttClientPrivate::onPubCompReceived, connectionType);
+
+    QObject::connect(&m_pingTimer, &QTimer::timeout,
+                     this, &QMqttClientPrivate::sendPing, connectionType);
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::pong,
+                     this, &QMqttClientPrivate::onPongReceived, connectionType);
+
+    //forward parser errors to user of QMqttClient
+    QObject::connect(m_packetParser.data(), &QMqttPacketParser::error,
+                     q, &QMqttClient::error, connectionType);
+
+    m_signalSlotConnected = true;
+}
+
+/*!
+  Connects the signals of a newly created transport.
+   \internal
+ */
+void QMqttClientPrivate::makeTransportConnections()
+{
+    Q_Q(QMqttClient);
+
+    QMqttTransport * const transport = m_transport.data();
+    const Qt::ConnectionType connectionType = this->connectionType();
+    transport->setLowDelay(m_lowLatency);
+
+    QObject::connect(transport, &QMqttTransport::connected,
+                     this, &QMqttClientPrivate::onSocketConnected, connectionType);
+    QObject::connect(transport, &QMqttTransport::disconnected,
+                     this, &QMqttClientPrivate::onSocketDisconnected);
+
+    QObject::connect(transport, &QMqttTransport::sslErrors,
+                     this, [this](const QList<QSslError> &errors) {
+        if (sslErrorsAllowed(errors))
+        {
+            qCDebug(module) << "Ignoring SSL errors" << errors;
+            m_transport->ignoreSslErrors();
+        }
+        else
+        {
+            refuseSslErrors(errors);
+        }
+    });
+
+    QObject::connect(transport, &QMqttTransport::error,
+                     this, [this](QAbstractSocket::SocketError error) {
+        onSocketError(error, m_transport->errorString());
+    });
+    QObject::connect(transport, &QMqttTransport::protocolViolation,
+                     this, [q](const QString &errorMessage) {
+        Q_EMIT q->error(QMqttProtocol::Error::PROTOCOL_VIOLATION, errorMessage);
+    });
+    QObject::connect(transport, &QMqttTransport::dataReceived,
+                     m_packetParser.data(), &QMqttPacketParser::parse, connectionType);
+    QObject::connect(transport, &QMqttTransport::bytesWritten,
+                     this, &QMqttClientPrivate::updateQueueStatistics);
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onSocketDisconnected()
+{
+    Q_Q(QMqttClient);
+
+    cleanupConnection();
+    setState(QMqttProtocol::State::OFFLINE);
+    Q_EMIT q->disconnected();
+    scheduleReconnect();
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPrivate::onSocketError(QAbstractSocket::SocketError error, const QString &errorString)
+{
+    Q_Q(QMqttClient);
+
+    const QString errorMessage = QStringLiteral("Error connecting to MQTT server: %1 (%2).")
+            .arg(error).arg(errorString);
+    const bool connecting = (m_state == QMqttProtocol::State::CONNECTING);
+    Q_EMIT q->error(QMqttProtocol::Error::CONNECTION_FAILED, errorMessage);
+    //a failed connection attempt does not emit disconnected(), so the requests made while
+    //connecting are failed here, before the next attempt
+    if (connecting) {
+        cleanupConnection();
+    }
+    setState(QMqttProtocol::State::OFFLINE);
+    scheduleReconnect();
+}
+
+/*!
+  Discards the buffered packets, and fails the requests that were made on the connection that
+  closed or could not be made.
+   \internal
+ */
+void QMqttClientPrivate::cleanupConnection()
+{
+    //buffered packets cannot be sent anymore
+    m_flushTimer.stop();
+    m_writeBuffer.clear();
+    failPending();
+}
+
+/*!
+  Reports SSL \a errors that are not allowed; the connection is not made.
+   \internal
+ */
+void QMqttClientPrivate::refuseSslErrors(const QList<QSslError> &errors)
+{
+    Q_Q(QMqttClient);
+
+    const QString errorMessage = QStringLiteral("SSL errors encountered: %1.").arg(toString(errors));
+    Q_EMIT q->error(QMqttProtocol::Error::CONNECTION_FAILED, errorMessage);
+    setState(QMqttProtocol::State::OFFLINE);
+}
+
+/*!
+  Aborts the connection; the disconnection is reported by the transport.
+   \internal
+ */
+void QMqttClientPrivate::abortTransport()
+{
+    if (m_ioThread) {
+        m_ioThread->abort();
+    } else {
+        m_transport->abort();
+    }
+}
+
+/*!
+  Handles the events that the I/O thread passed on since the previous call, in order.
+  Events of a connection that was replaced by a new connect() are ignored, as are the signals of
+  a replaced transport.
+   \internal
+ */
+void QMqttClientPrivate::processIoEvents()
+{
+    Q_Q(QMqttClient);
+
+    typedef QMqttIoThread::Event::Kind Kind;
+    QMqttIoThread * const ioThread = m_ioThread.data();
+    QMqttIoThread::Event event;
+    //receivers can disable the I/O thread, e.g. from a disconnected() slot
+    while (ioThread && ioThread == m_ioThread.data() && ioThread->takeEvent(event)) {
+        if (event.generation != m_ioGeneration) {
+            continue;
+        }
+        switch (event.kind) {
+        case Kind::NONE:
+            break;
+        case Kind::CONNECTED:
+            onSocketConnected();
+            break;
+        case Kind::DISCONNECTED:
+            onSocketDisconnected();
+            break;
+        case Kind::TRANSPORT_ERROR:
+            onSocketError(event.socketError, event.errorMessage);
+            break;
+        case Kind::SSL_ERRORS:
+            refuseSslErrors(event.sslErrors);
+            break;
+        case Kind::PROTOCOL_VIOLATION:
+            Q_EMIT q->error(QMqttProtocol::Error::PROTOCOL_VIOLATION, event.errorMessage);
+            break;
+        case Kind::PARSE_ERROR:
+            Q_EMIT q->error(event.error, event.errorMessage);
+            break;
+        case Kind::PING_TIMEOUT:
+            onPingTimeout();
+            break;
+        case Kind::CONNACK:
+            onConnackReceived(event.error, event.sessionPresent);
+            break;
+        case Kind::PUBLISH:
+            onPublishReceived(event.packetIdentifier, event.message);
+            break;
+        case Kind::PUBACK:
+            onPubAckReceived(event.packetIdentifier);
+            break;
+        case Kind::PUBREC:
+            onPubRecReceived(event.packetIdentifier);
+            break;
+        case Kind::PUBREL:
+            onPubRelReceived(event.packetIdentifier);
+            break;
+        case Kind::PUBCOMP:
+            onPubCompReceived(event.packetIdentifier);
+            break;
+        case Kind::SUBACK:
+            onSubackReceived(event.packetIdentifier, event.grantedQos);
+            break;
+        case Kind::UNSUBACK:
+            onUnsubackReceived(event.packetIdentifier);
+            break;
+        case Kind::PINGRESP:
+            qCDebug(module) << "Received pong.";
+            if (event.roundTripUs >= 0) {
+                m_latencies[size_t(QMqttProtocol::Acknowledgement::PINGRESP)].record(event.roundTripUs);
+            }
+            break;
+        }
+    }
+    //acknowledgements release identifiers, and can allow queued publishes to be sent
+    updateQueueStatistics();
+}
+
+/*!
+  Creates a new QMqttClient with the given \a clientId and \a parent.
+  \a clientId should be a unique id representing the connection.
+  The length of the \a clientId should be larger than smaller than 24 characters.
+  If an empty \a clientId is provided, the server will generate a random one.
+  \a allowedSslErrors: specify any SSL errors you want to allow
+ */
+QMqttClient::QMqttClient(const QString &clientId, const QSet<QSslError> &allowedSslErrors, QObject *parent) :
+    QObject(parent),
+    d_ptr(new QMqttClientPrivate(clientId, allowedSslErrors, this))
+{
+    qRegisterMetaType<QMqttProtocol::State>("QMqttProtocol::State");
+    qRegisterMetaType<QMqttMessage>("QMqttMessage");
+}
+
+/*!
+  Destroys the QMqttClient. If a connection was open, the connection is aborted and the last will
+  will be executed by the server.
+  To have an orderly disconnection, disconnect() should be called prior to destroying the
+  QMqttlient.
+
+  \sa disconnect()
+ */
+QMqttClient::~QMqttClient()
+{}
+
+/*!
+  Connects the QMqttClient to the server specified in the \a request.
+  The scheme of the url of the \a request selects the transport:
+  \list
+    \li \c mqtt: MQTT over TCP; the port defaults to 1883
+    \li \c mqtts: MQTT over TLS; the port defaults to 8883
+    \li \c ws, \c wss: MQTT over (secure) WebSockets
+  \endlist
+  For WebSocket connections, all HTTP headers present in the \a request will be sent to the
+  server during the WebSocket handshake request.
+  When the connection succeeds, a connected() signal will be emitted.
+
+  During setup of the connection, the state of the client will change from DISCONNECTED over
+  CONNECTING to CONNECTED.
+  \a userName: specify the userName to be used with connect; connect QMqttPublishControlPacket
+  does not contain this userName if it is empty
+  \a password: specify the password to be used with connect; connect QMqttPublishControlPacket
+  does not contain this password if it is null (use QByteArray() as a null password)
+
+  \sa disconnect(), stateChanged()
+ */
+void QMqttClient::connect(const QMqttNetworkRequest &request, const QMqttWill &will, const QString &userName, const QByteArray &password)
+{
+    Q_D(QMqttClient);
+
+    d->connect(request, will, userName, password);
+}
+
+/*!
+  Disconnects the client from the server in an orderly manner.
+  The client will first send a DISCONNECT packet to indicate to the server that it will close
+  the connection soon.
+
+  During tear down of the connection, the QMqttClient will change state from CONNECTED over
+  DISCONNECTING to OFFLINE.
+  The client does not reconnect automatically after disconnect(), and a pending automatic
+  reconnect is cancelled.
+
+  \sa connect(), stateChanged()
+ */
+void QMqttClient::disconnect()
+{
+    Q_D(QMqttClient);
+
+    d->cancelReconnect();
+    d->disconnect();
+}
+
+/*!
+  Subscribes the client to \a topic with the given Quality of Service \a qos.
+  When subscription has finished, the given callback \a cb is called indicating whether the
+  subscription succeeded or not.
+
+  The \a topic must follow the following rules:
+  \list
+    \li Rule #1: If any part of the topic is not `+` or `#`, then it must not contain `+` and `#`
+    \li Rule #2: Part `#` must be located at the end of the name
+    \li Rule #3: The length must be at least 1
+  \endlist
+
+  If the \a topic is invalid, the callback will be called with false. The connection will not
+  be dropped, as the check is done before it is sent to the server.
+
+  The \a topic can contain the MQTT supported wildcard characters `#` and `+`.
+
+  Example topic names:
+  \list
+  \li \c /: a single forward slash
+  \li \c +: any single topic name
+  \li \c {resources/+/weight}: matches resources/table/weight, resources/car/weight,
+                          but not resources/weight nor resources/car/door/weight
+  \li \c {resources/#}: matches all topics starting with resources/
+  \endlist
+
+  \sa unsubscribe()
+*/
+void QMqttClient::subscribe(const QString &topic, QMqttProtocol::QoS qos,
+                           std::function<void (bool)> cb)
+{
+    Q_D(QMqttClient);
+
+    d->subscribe(topic, qos, cb);
+}
+
+/*!
+  Subscribes the client to \a topic with the given Quality of Service \a qos, and returns a
+  subscription that receives the messages published on topics matching \a topic.
+  The subscription emits QMqttSubscription::subscribed() when the server acknowledged the
+  subscription.
+
+  The same rules hold for the \a topic as for the other subscribe() overload. If the \a topic is
+  invalid, no subscription is made and nullptr is returned.
+
+  The returned subscription is owned by the client. Deleting it stops the delivery of messages
+  to it, but does not unsubscribe the client from the server.
+  Messages are still also delivered through messageReceived().
+
+  \overload subscribe()
+  \sa QMqttSubscription, unsubscribe()
+*/
+QMqttSubscription *QMqttClient::subscribe(const QString &topic, QMqttProtocol::QoS qos)
+{
+    Q_D(QMqttClient);
+
+    return d->subscribe(topic, qos);
+}
+
+/*!
+  Subscribes the client to all \a topicFilters, each with its requested QoS.
+  The topic filters are packed into as few SUBSCRIBE packets as possible; a packet holds topic
+  filters up to 64 KiB, so that thousands of subscriptions only take a few round trips.
+
+  When all packets have been acknowledged, the callback \a cb is called with the QoS granted
+  by the server for each topic filter, in the order of \a topicFilters. The granted QoS can be
+  lower than the requested one. It is QMqttProtocol::QoS::INVALID for topic filters that are
+  invalid, that the server rejected, or whose packet was not acknowledged because the
+  connection closed.
+
+  The same rules hold for the topic filters as for the other subscribe() overloads.
+
+  \overload subscribe()
+  \sa unsubscribe()
+*/
+void QMqttClient::subscribe(const QVector<QPair<QString, QMqttProtocol::QoS>> &topicFilters,
+                           std::function<void(const QVector<QMqttProtocol::QoS> &)> cb)
+{
+    Q_D(QMqttClient);
+
+    d->subscribe(topicFilters, cb);
+}
+
+/*!
+  Unsubscribes the client from the given \a topic. When unsubscription has finished, the
+  callback \a cb will be called with the result.
+
+  The same rules hold for the \a topic as for the subscribe() call.
+  When an invalid \a topic is detected, the callback will be called with false. The connection
+  will not be dropped, as the check is done before the request is sent to the server.
+
+  \sa subscribe()
+ */
+void QMqttClient::unsubscribe(const QString &topic, std::function<void (bool)> cb)
+{
+    Q_D(QMqttClient);
+
+    d->unsubscribe(topic, cb);
+}
+
+/*!
+  Unsubscribes the client from all given \a topics, packed into as few UNSUBSCRIBE packets as
+  possible. When all packets have been acknowledged, the callback \a cb is called with true,
+  or with false if any of the \a topics was invalid or a packet was not acknowledged.
+
+  \overload unsubscribe()
+  \sa subscribe()
+ */
+void QMqttClient::unsubscribe(const QStringList &topics, std::function<void(bool)> cb)
+{
+    Q_D(QMqttClient);
+
+    d->unsubscribe(topics, cb);
+}
+
+/*!
+  Published the given \a message to the given \a topic with a QoS equal to AT_MOST_ONCE (0).
+  Publishing an empty \a message is allowed, however the topic name should not be empty and
+  should not contain wildcard characters.
+  If the topic name is invalid, the connection will be dropped by the server.
+
+  When an error occurs during publising, an error() signal will be emitted and errorString() will
+  contain a description of the last error.
+ */
+void QMqttClient::publish(const QString &topic, const QByteArray &message)
+{
+    Q_D(QMqttClient);
+
+    d->publish(topic, message);
+}
+
+/*!
+  Published the given \a message to the given \a topic with a QoS equal to AT_LEAST_ONCE (1).
+  When publication finished the given callback \a cb is called indicating success or failure.
+  Publishing an empty \a message is allowed, however the topic name should not be empty and
+  should not contain wildcard characters.
+  If the topic name is invalid, the connection will be dropped by the server.
+
+  When an error occurs during publising, an error() signal will be emitted and errorString() will
+  contain a description of the last error.
+
+  \overload publish()
+ */
+void QMqttClient::publish(const QString &topic, const QByteArray &message,
+                         std::function<void (bool)> cb)
+{
+    Q_D(QMqttClient);
+
+    d->publish(topic, message, QMqttProtocol::QoS::AT_LEAST_ONCE, cb);
+}
+
+/*!
+  Publishes the given \a message to the given \a topic with the given \a qos.
+  The callback \a cb is called with true when the delivery of the message completed:
+  \list
+    \li for AT_MOST_ONCE (0), as soon as the message has been sent
+    \li for AT_LEAST_ONCE (1), when the server acknowledged the message with PUBACK
+    \li for EXACTLY_ONCE (2), when the server completed the PUBREC, PUBREL, PUBCOMP exchange
+  \endlist
+  The callback is called with false if the message could not be delivered, e.g. because the
+  connection closed before the delivery completed.
+
+  The same rules hold for the \a topic as for the other publish() overloads.
+
+  \overload publish()
+ */
+void QMqttClient::publish(const QString &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                         std::function<void (bool)> cb)
+{
+    Q_D(QMqttClient);
+
+    d->publish(topic, message, qos, cb);
+}
+
+/*!
+  Publishes the given \a message to the given \a topic with the given \a qos, and calls the
+  callback \a cb on the thread of \a context, when the delivery of the message completed.
+  If \a context is destroyed first, \a cb is not called.
+
+  This is useful to publish from other threads: \a cb can then be called on the publishing
+  thread, rather than on the thread of the client.
+
+  The same rules hold for the \a topic as for the other publish() overloads.
+
+  \overload publish()
+ */
+void QMqttClient::publish(const QString &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                          QObject *context, std::function<void(bool)> cb)
+{
+    Q_D(QMqttClient);
+
+    d->publish(topic, message, qos, context, cb);
+}
+
+/*!
+  Publishes the given \a message to the given \a topic with a QoS equal to AT_MOST_ONCE (0).
+
+  Unlike the overloads that take the topic name as a QString, this does not validate and encode
+  the topic name for every message, but copies the encoded name that \a topic keeps.
+  If \a topic is invalid, the message is not sent.
+
+  \overload publish()
+ */
+void QMqttClient::publish(const QMqttTopic &topic, const QByteArray &message)
+{
+    Q_D(QMqttClient);
 
-    typedef void (QWebSocket::* errorSignal)(QAbstractSocket::SocketError);
-    QObject::connect(m_webSocket.data(), static_cast<errorSignal>(&QWebSocket::error),
-                     [this, q](QAbstractSocket::SocketError error) {
-        const QString errorMessage = QStringLiteral("Error connecting to MQTT server: %1 (%2).")
-                .arg(error).arg(m_webSocket->errorString());
-        Q_EMIT q->error(QMqttProtocol::Error::CONNECTION_FAILED, errorMessage);
-        setState(QMqttProtocol::State::OFFLINE);
-    });
-    QObject::connect(m_webSocket.data(), &QWebSocket::textMessageReceived, [this, q](const QString &msg) {
-        const QString errorMessage
-                = QStringLiteral("Received a text message on the MQTT connection (%1). This should not happen. Connection will be closed.")
-                .arg(msg);
-        Q_EMIT q->error(QMqttProtocol::Error::PROTOCOL_VIOLATION, errorMessage);
-    });
-    QObject::connect(m_webSocket.data(), &QWebSocket::binaryMessageReceived,
-                     m_packetParser.data(), &QMqttPacketParser::parse, Qt::QueuedConnection);
+    d->publish(topic, message, QMqttProtocol::QoS::AT_MOST_ONCE, nullptr);
+}
 
-    QObject::connect(m_packetParser.data(), &QMqttPacketParser::connack,
-                     this, &QMqttClientPrivate::onConnackReceived, Qt::QueuedConnection);
-    QObject::connect(m_packetParser.data(), &QMqttPacketParser::suback,
-                     this, &QMqttClientPrivate::onSubackReceived, Qt::QueuedConnection);
-    QObject::connect(m_packetParser.data(), &QMqttPacketParser::publish,
-                     this, &QMqttClientPrivate::onPublishReceived, Qt::QueuedConnection);
-    QObject::connect(m_packetParser.data(), &QMqttPacketParser::pubrel,
-                     this, &QMqttClientPrivate::onPubRelReceived, Qt::QueuedConnection);
-    QObject::connect(m_packetParser.data(), &QMqttPacketParser::unsuback,
-                     this, &QMqttClientPrivate::onUnsubackReceived, Qt::QueuedConnection);
-    QObject::connect(m_packetParser.data(), &QMqttPacketParser::puback,
-                     this, &QMqttClientPrivate::onPubAckReceived, Qt::QueuedConnection);
+/*!
+  Publishes the given \a message to the given \a topic with a QoS equal to AT_LEAST_ONCE (1),
+  and calls \a cb when the server acknowledged it, or with false if the message could not be
+  delivered or \a topic is invalid.
 
-    QObject::connect(&m_pingTimer, &QTimer::timeout,
-                     this, &QMqttClientPrivate::sendPing, Qt::QueuedConnection);
-    QObject::connect(m_packetParser.data(), &QMqttPacketParser::pong,
-                     this, &QMqttClientPrivate::onPongReceived, Qt::QueuedConnection);
+  \overload publish()
+ */
+void QMqttClient::publish(const QMqttTopic &topic, const QByteArray &message,
+                          std::function<void(bool)> cb)
+{
+    Q_D(QMqttClient);
 
-    //forward parser errors to user of QMqttClient
-    QObject::connect(m_packetParser.data(), &QMqttPacketParser::error,
-                     q, &QMqttClient::error, Qt::QueuedConnection);
+    d->publish(topic, message, QMqttProtocol::QoS::AT_LEAST_ONCE, cb);
+}
 
-    m_signalSlotConnected = true;
+/*!
+  Publishes the given \a message to the given \a topic with the given \a qos, and calls
+  \a cb when the delivery of the message completed, like the overload that takes the topic
+  name as a QString. If \a topic is invalid, \a cb is called with false.
+
+  \overload publish()
+ */
+void QMqttClient::publish(const QMqttTopic &topic, const QByteArray &message,
+                          QMqttProtocol::QoS qos, std::function<void(bool)> cb)
+{
+    Q_D(QMqttClient);
+
+    d->publish(topic, message, qos, cb);
 }
 
 /*!
-  Creates a new QMqttClient with the given \a clientId and \a parent.
-  \a clientId should be a unique id representing the connection.
-  The length of the \a clientId should be larger than smaller than 24 characters.
-  If an empty \a clientId is provided, the server will generate a random one.
-  \a allowedSslErrors: specify any SSL errors you want to allow
+  Publishes the given \a message to the given \a topic with the given \a qos, and calls the
+  callback \a cb on the thread of \a context, when the delivery of the message completed.
+  If \a context is destroyed first, \a cb is not called.
+
+  \overload publish()
  */
-QMqttClient::QMqttClient(const QString &clientId, const QSet<QSslError> &allowedSslErrors, QObject *parent) :
-    QObject(parent),
-    d_ptr(new QMqttClientPrivate(clientId, allowedSslErrors, this))
+void QMqttClient::publish(const QMqttTopic &topic, const QByteArray &message,
+                          QMqttProtocol::QoS qos, QObject *context, std::function<void(bool)> cb)
 {
-    qRegisterMetaType<QMqttProtocol::State>("QMqttProtocol::State");
+    Q_D(QMqttClient);
+
+    d->publish(topic, message, qos, context, cb);
 }
 
 /*!
-  Destroys the QMqttClient. If a connection was open, the connection is aborted and the last will
-  will be executed by the server.
-  To have an orderly disconnection, disconnect() should be called prior to destroying the
-  QMqttlient.
+  Enables or disables low latency mode, depending on \a enabled.
 
-  \sa disconnect()
+  By default, every received packet makes several trips through the event loop before it is
+  handled: from the transport to the packet parser, from the packet parser to the client, and
+  again to invoke the callbacks of acknowledged requests.
+  In low latency mode, received packets are parsed and handled synchronously, as soon as the
+  transport signals the arrival of data. Signals such as messageReceived() are emitted and
+  callbacks are invoked directly from within that handling. On TCP connections, Nagle's algorithm
+  is disabled as well (TCP_NODELAY), so that small packets are sent without delay.
+
+  As receivers run on the stack of the transport, they must not delete the client.
+  The mode can only be changed while the client is offline; it takes effect on the next
+  connect(). Low latency mode is disabled by default.
+
+  \sa isLowLatencyMode()
  */
-QMqttClient::~QMqttClient()
-{}
+void QMqttClient::setLowLatencyMode(bool enabled)
+{
+    Q_D(QMqttClient);
+
+    d->setLowLatencyMode(enabled);
+}
 
 /*!
-  Connects the QMqttClient to the server specified in the \a request.
-  All HTTP headers present in the \a request will be sent to the server during the WebSocket
-  handshake request.
-  When the connection succeeds, a connected() signal will be emitted.
+  Returns true if low latency mode is enabled.
 
-  During setup of the connection, the state of the client will change from DISCONNECTED over
-  CONNECTING to CONNECTED.
-  \a userName: specify the userName to be used with connect; connect QMqttPublishControlPacket
-  does not contain this userName if it is empty
-  \a password: specify the password to be used with connect; connect QMqttPublishControlPacket
-  does not contain this password if it is null (use QByteArray() as a null password)
+  \sa setLowLatencyMode()
+ */
+bool QMqttClient::isLowLatencyMode() const
+{
+    Q_D(const QMqttClient);
 
-  \sa disconnect(), stateChanged()
+    return d->isLowLatencyMode();
+}
+
+/*!
+  Runs the transport, the packet parser and the keep-alive of the client on an internal I/O
+  thread when \a enabled is true.
+
+  By default, receiving and sending, parsing received packets and sending keep-alive pings all
+  happen on the thread the client lives in. When that thread is busy, e.g. with a user
+  interface, received messages wait and keep-alive pings can be sent too late; conversely, a
+  burst of received messages delays the other work of the thread.
+  With the I/O thread enabled, only encoding packets and handling the decoded ones (emitting
+  signals, invoking callbacks) is left to the thread of the client. Packets are passed between
+  both threads through lock-free queues, at the cost of one thread switch per burst of packets.
+
+  The public interface of the client does not change: all signals are still emitted, and all
+  callbacks still invoked, on the thread of the client, which must run an event loop.
+  The I/O thread can only be enabled or disabled while the client is offline; it takes effect
+  on the next connect(). The I/O thread is disabled by default.
+
+  \sa isIoThreadEnabled(), setLowLatencyMode()
  */
-void QMqttClient::connect(const QMqttNetworkRequest &request, const QMqttWill &will, const QString &userName, const QByteArray &password)
+void QMqttClient::setIoThreadEnabled(bool enabled)
 {
     Q_D(QMqttClient);
 
-    d->connect(request, will, userName, password);
+    d->setIoThreadEnabled(enabled);
 }
 
 /*!
-  Disconnects the client from the server in an orderly manner.
-  The client will first send a DISCONNECT packet to indicate to the server that it will close
-  the connection soon.
+  Returns true if the transport runs on an internal I/O thread.
 
-  During tear down of the connection, the QMqttClient will change state from CONNECTED over
-  DISCONNECTING to OFFLINE.
+  \sa setIoThreadEnabled()
+ */
+bool QMqttClient::isIoThreadEnabled() const
+{
+    Q_D(const QMqttClient);
 
-  \sa connect(), stateChanged()
+    return d->isIoThreadEnabled();
+}
+
+/*!
+  Limits the number of messages published with QoS 1 or 2 (AT_LEAST_ONCE or EXACTLY_ONCE) that
+  await their acknowledgement from the server to \a maximum. A QoS 2 message counts until its
+  PUBCOMP is received.
+
+  Messages published beyond that limit are queued in the client and sent, in order, as the
+  server acknowledges earlier messages. The first message that gets queued triggers the
+  publishWindowFull() signal; readyToPublish() is emitted once the queue has been drained.
+  This bounds the memory used for unacknowledged messages, and lets producers adapt their rate
+  to the rate at which the server acknowledges.
+
+  When the connection closes, the callbacks of queued messages are called with false.
+  A \a maximum of 0, the default, means that there is no limit.
+
+  \sa maximumInflight(), inflightCount(), queuedCount()
  */
-void QMqttClient::disconnect()
+void QMqttClient::setMaximumInflight(int maximum)
 {
     Q_D(QMqttClient);
 
-    d->disconnect();
+    d->setMaximumInflight(maximum);
 }
 
 /*!
-  Subscribes the client to \a topic with the given Quality of Service \a qos.
-  When subscription has finished, the given callback \a cb is called indicating whether the
-  subscription succeeded or not.
+  Returns the maximum number of unacknowledged QoS 1 and 2 (AT_LEAST_ONCE and EXACTLY_ONCE)
+  messages; 0 means unlimited.
 
-  The \a topic must follow the following rules:
-  \list
-    \li Rule #1: If any part of the topic is not `+` or `#`, then it must not contain `+` and `#`
-    \li Rule #2: Part `#` must be located at the end of the name
-    \li Rule #3: The length must be at least 1
-  \endlist
+  \sa setMaximumInflight()
+ */
+int QMqttClient::maximumInflight() const
+{
+    Q_D(const QMqttClient);
 
-  If the \a topic is invalid, the callback will be called with false. The connection will not
-  be dropped, as the check is done before it is sent to the server.
+    return d->maximumInflight();
+}
 
-  The \a topic can contain the MQTT supported wildcard characters `#` and `+`.
+/*!
+  Returns the number of QoS 1 and 2 (AT_LEAST_ONCE and EXACTLY_ONCE) messages that were sent and
+  await acknowledgement; for QoS 2, until PUBCOMP is received.
 
-  Example topic names:
-  \list
-  \li \c /: a single forward slash
-  \li \c +: any single topic name
-  \li \c {resources/+/weight}: matches resources/table/weight, resources/car/weight,
-                          but not resources/weight nor resources/car/door/weight
-  \li \c {resources/#}: matches all topics starting with resources/
-  \endlist
+  \sa queuedCount()
+ */
+int QMqttClient::inflightCount() const
+{
+    Q_D(const QMqttClient);
 
-  \sa unsubscribe()
-*/
-void QMqttClient::subscribe(const QString &topic, QMqttProtocol::QoS qos,
-                           std::function<void (bool)> cb)
+    return d->inflightCount();
+}
+
+/*!
+  Returns the number of messages that are queued because the in-flight window is full.
+
+  \sa setMaximumInflight()
+ */
+int QMqttClient::queuedCount() const
+{
+    Q_D(const QMqttClient);
+
+    return d->queuedCount();
+}
+
+/*!
+  Enables a persistent session, with the state of the session stored in the file \a fileName.
+  Returns false if the file could not be opened, or if the client is not offline.
+
+  With a persistent session, the client connects with the clean session flag set to false, so
+  that the server keeps the subscriptions and the undelivered messages of the client while it
+  is disconnected. The messages published with QoS AT_LEAST_ONCE and EXACTLY_ONCE that were not
+  acknowledged yet are stored in \a fileName. When the session is resumed, also after a restart
+  of the process, they are sent again with the DUP flag set. Their callbacks are only called
+  when the delivery completes, not when the connection closes.
+  If the server reports that it has no session anymore, the stored messages are discarded and
+  their callbacks are called with false.
+
+  The file is an append-only log. Changes are written and synced to disk at the end of the
+  event loop iteration in which they were made, so that a burst of messages costs a single
+  fsync. A message that was published less than one event loop iteration before a crash can be
+  lost. The log is compacted when it consists mostly of acknowledged messages.
+
+  The session is identified by the client id, which therefore must be the same for every
+  connection. Passing an empty \a fileName disables the persistent session.
+
+  \sa sessionFile()
+ */
+bool QMqttClient::setSessionFile(const QString &fileName)
 {
     Q_D(QMqttClient);
 
-    d->subscribe(topic, qos, cb);
+    return d->setSessionFile(fileName);
 }
 
 /*!
-  Unsubscribes the client from the given \a topic. When unsubscription has finished, the
-  callback \a cb will be called with the result.
+  Returns the file the persistent session is stored in, or an empty string if the client uses
+  clean sessions.
 
-  The same rules hold for the \a topic as for the subscribe() call.
-  When an invalid \a topic is detected, the callback will be called with false. The connection
-  will not be dropped, as the check is done before the request is sent to the server.
+  \sa setSessionFile()
+ */
+QString QMqttClient::sessionFile() const
+{
+    Q_D(const QMqttClient);
 
-  \sa subscribe()
+    return d->sessionFile();
+}
+
+/*!
+  Enables or disables automatic reconnection, depending on \a enabled.
+
+  When automatic reconnection is enabled and the connection is lost or cannot be established,
+  the client connects again with the arguments of the last call to connect(). The delay before
+  each attempt is chosen at random between 0 and a bound that starts at the minimum reconnect
+  delay, and doubles with every failed attempt up to the maximum delay. The randomization keeps
+  a fleet of clients from reconnecting all at once after a server restart.
+
+  The client keeps track of the topic filters it is subscribed to. When it reconnects and the
+  server has no session for it, all topic filters are subscribed to again, packed into as few
+  SUBSCRIBE packets as possible. When the server resumed the session (see setSessionFile()), the
+  server still has the subscriptions and nothing is sent.
+
+  The client does not reconnect after disconnect(), or when the server refused the connection
+  for another reason than being unavailable.
+  Automatic reconnection is disabled by default.
+
+  \sa setReconnectDelay()
  */
-void QMqttClient::unsubscribe(const QString &topic, std::function<void (bool)> cb)
+void QMqttClient::setAutoReconnect(bool enabled)
 {
     Q_D(QMqttClient);
 
-    d->unsubscribe(topic, cb);
+    d->setAutoReconnect(enabled);
 }
 
 /*!
-  Published the given \a message to the given \a topic with a QoS equal to AT_MOST_ONCE (0).
-  Publishing an empty \a message is allowed, however the topic name should not be empty and
-  should not contain wildcard characters.
-  If the topic name is invalid, the connection will be dropped by the server.
+  Returns true if automatic reconnection is enabled.
 
-  When an error occurs during publising, an error() signal will be emitted and errorString() will
-  contain a description of the last error.
+  \sa setAutoReconnect()
  */
-void QMqttClient::publish(const QString &topic, const QByteArray &message)
+bool QMqttClient::autoReconnect() const
+{
+    Q_D(const QMqttClient);
+
+    return d->autoReconnect();
+}
+
+/*!
+  Sets the bounds of the delay before automatic reconnection attempts to \a minimumMs and
+  \a maximumMs milliseconds. The defaults are 1 second and 1 minute.
+
+  \sa setAutoReconnect()
+ */
+void QMqttClient::setReconnectDelay(int minimumMs, int maximumMs)
 {
     Q_D(QMqttClient);
 
-    d->publish(topic, message);
+    d->setReconnectDelay(minimumMs, maximumMs);
 }
 
 /*!
-  Published the given \a message to the given \a topic with a QoS equal to AT_LEAST_ONCE (1).
-  When publication finished the given callback \a cb is called indicating success or failure.
-  Publishing an empty \a message is allowed, however the topic name should not be empty and
-  should not contain wildcard characters.
-  If the topic name is invalid, the connection will be dropped by the server.
+  Holds back all packets sent by the client, until uncork() is called.
+
+  While the client is corked, the packets of publish(), subscribe() and unsubscribe() calls, and
+  the acknowledgements of received messages, are encoded into a write buffer instead of being
+  written to the connection one by one. uncork() writes them all at once, in one WebSocket frame
+  or one socket write. This greatly reduces the framing and system call overhead of bursts of
+  small messages:
+
+  \code
+  client.cork();
+  for (const Reading &reading : readings) {
+      client.publish(reading.topic, reading.value, [](bool ok) { ... });
+  }
+  client.uncork();
+  \endcode
+
+  Callbacks are still invoked per message, when the server acknowledges it.
+  Keep-alive pings and the DISCONNECT packet are not held back; disconnect() flushes the buffered
+  packets first.
+
+  \sa uncork(), isCorked(), setFlushInterval()
+ */
+void QMqttClient::cork()
+{
+    Q_D(QMqttClient);
 
-  When an error occurs during publising, an error() signal will be emitted and errorString() will
-  contain a description of the last error.
+    d->cork();
+}
 
-  \note Exactly once delivery (EXACTLY_ONCE) is currently not supported.
+/*!
+  Writes all packets that were held back since cork() was called, in a single write, and sends
+  subsequent packets right away again (or after the flush interval if one is set).
 
-  \overload publish()
+  \sa cork()
  */
-void QMqttClient::publish(const QString &topic, const QByteArray &message,
-                         std::function<void (bool)> cb)
+void QMqttClient::uncork()
+{
+    Q_D(QMqttClient);
+
+    d->uncork();
+}
+
+/*!
+  Returns true if the client is corked.
+
+  \sa cork(), uncork()
+ */
+bool QMqttClient::isCorked() const
+{
+    Q_D(const QMqttClient);
+
+    return d->isCorked();
+}
+
+/*!
+  Sets the flush interval to \a ms milliseconds.
+
+  When the flush interval is larger than 0, packets are not written right away, but buffered and
+  written together at most \a ms milliseconds after the first of them was sent. This batches
+  messages that are published in quick succession without having to call cork() and uncork(),
+  at the cost of adding up to \a ms milliseconds of latency.
+  Setting the interval to 0, the default, writes packets right away and flushes the buffer.
+
+  \sa flushInterval(), cork()
+ */
+void QMqttClient::setFlushInterval(int ms)
+{
+    Q_D(QMqttClient);
+
+    d->setFlushInterval(ms);
+}
+
+/*!
+  Returns the flush interval in milliseconds; 0 means packets are written right away.
+
+  \sa setFlushInterval()
+ */
+int QMqttClient::flushInterval() const
+{
+    Q_D(const QMqttClient);
+
+    return d->flushInterval();
+}
+
+/*!
+  Sets the number of topic names that are kept for sharing between received messages to
+  \a size, and forgets the topic names kept so far.
+
+  The topic name of a received message is decoded once, and then shared with the following
+  messages on the same topic, until it is replaced by a topic name that was received more
+  recently; messages on frequent topics therefore neither decode nor allocate their topic name.
+  \a size should be larger than the number of topics that messages are regularly received on.
+  A \a size of 0 decodes the topic name of every message. The default size is 1024.
+
+  \sa topicCacheSize(), QMqttMessage::topic()
+ */
+void QMqttClient::setTopicCacheSize(int size)
+{
+    Q_D(QMqttClient);
+
+    d->setTopicCacheSize(size);
+}
+
+/*!
+  Returns the number of topic names that are kept for sharing between received messages.
+
+  \sa setTopicCacheSize()
+ */
+int QMqttClient::topicCacheSize() const
+{
+    Q_D(const QMqttClient);
+
+    return d->topicCacheSize();
+}
+
+/*!
+  Returns the round trip time, in microseconds, below which \a percentile percent of the
+  \a acknowledgement packets were received, e.g. 50, 99 or 99.9 for the p50, p99 and p999
+  latencies. Returns -1 if no such acknowledgement was received yet.
+
+  The round trip is measured from the moment the packet is handed to the transport, or to the
+  write buffer when the client is corked or a flush interval is set, until its acknowledgement
+  is parsed. Time spent waiting for the in-flight window is not included, so that slowness of
+  the server can be told apart from queueing in the client.
+  Latencies are kept in log-linear buckets; a reported value is at most 6.25% above the actual
+  one.
+
+  \sa latencyCount(), resetLatencies()
+ */
+qint64 QMqttClient::latencyPercentile(QMqttProtocol::Acknowledgement acknowledgement, double percentile) const
+{
+    Q_D(const QMqttClient);
+
+    return d->latencyPercentile(acknowledgement, percentile);
+}
+
+/*!
+  Returns the number of round trip times that were measured for \a acknowledgement.
+
+  \sa latencyPercentile()
+ */
+quint64 QMqttClient::latencyCount(QMqttProtocol::Acknowledgement acknowledgement) const
+{
+    Q_D(const QMqttClient);
+
+    return d->latencyCount(acknowledgement);
+}
+
+/*!
+  Forgets all measured round trip times, e.g. at the start of a new reporting interval.
+
+  \sa latencyPercentile()
+ */
+void QMqttClient::resetLatencies()
 {
     Q_D(QMqttClient);
 
-    d->publish(topic, message, cb);
+    d->resetLatencies();
+}
+
+/*!
+  Returns the statistics of this client: the bytes and packets it sent and received, the
+  errors in the data it received, and the depth of its queues.
+  The statistics can be read from any thread while the client exists.
+
+  \sa QMqttStatistics
+ */
+const QMqttStatistics &QMqttClient::statistics() const
+{
+    Q_D(const QMqttClient);
+
+    return d->statistics();
 }
 
 /*!
@@ -4,15 +4,19 @@
 #include <QHostAddress>
 #include <QSet>
 #include <QSslError>
+#include <QVector>
+#include <QPair>
+#include <QStringList>
 #include <functional>
 #include "qmqttwill.h"
+#include "qmqttmessage.h"
+#include "qmqtttopic.h"
 #include "qmqttprotocol.h"
+#include "qmqttstatistics.h"
 #include "qmqtt_global.h"
 
-//TODO: add SSL connectivity
-//Currently only secure websockets are supported
-
 class QMqttNetworkRequest;
+class QMqttSubscription;
 class QString;
 class QByteArray;
 class QMqttClientPrivate;
@@ -32,9 +36,55 @@ public:
     void disconnect();
 
     void subscribe(const QString &topic, QMqttProtocol::QoS qos, std::function<void(bool)> cb);
+    QMqttSubscription *subscribe(const QString &topic, QMqttProtocol::QoS qos);
+    void subscribe(const QVector<QPair<QString, QMqttProtocol::QoS>> &topicFilters,
+                   std::function<void(const QVector<QMqttProtocol::QoS> &)> cb);
     void unsubscribe(const QString &topic, std::function<void(bool)> cb);
+    void unsubscribe(const QStringList &topics, std::function<void(bool)> cb);
     void publish(const QString &topic, const QByteArray &message);
     void publish(const QString &topic, const QByteArray &message, std::function<void(bool)> cb);
+    void publish(const QString &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                 std::function<void(bool)> cb);
+    void publish(const QString &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                 QObject *context, std::function<void(bool)> cb);
+    void publish(const QMqttTopic &topic, const QByteArray &message);
+    void publish(const QMqttTopic &topic, const QByteArray &message, std::function<void(bool)> cb);
+    void publish(const QMqttTopic &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                 std::function<void(bool)> cb);
+    void publish(const QMqttTopic &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                 QObject *context, std::function<void(bool)> cb);
+
+    void setLowLatencyMode(bool enabled);
+    bool isLowLatencyMode() const;
+
+    void setIoThreadEnabled(bool enabled);
+    bool isIoThreadEnabled() const;
+
+    void setMaximumInflight(int maximum);
+    int maximumInflight() const;
+    int inflightCount() const;
+    int queuedCount() const;
+
+    bool setSessionFile(const QString &fileName);
+    QString sessionFile() const;
+
+    void setAutoReconnect(bool enabled);
+    bool autoReconnect() const;
+    void setReconnectDelay(int minimumMs, int maximumMs);
+
+    void cork();
+    void uncork();
+    bool isCorked() const;
+    void setFlushInterval(int ms);
+    int flushInterval() const;
+    void setTopicCacheSize(int size);
+    int topicCacheSize() const;
+
+    qint64 latencyPercentile(QMqttProtocol::Acknowledgement acknowledgement, double percentile) const;
+    quint64 latencyCount(QMqttProtocol::Acknowledgement acknowledgement) const;
+    void resetLatencies();
+
+    const QMqttStatistics &statistics() const;
 
     QHostAddress localAddress() const;
     quint16 localPort() const;
@@ -44,6 +94,9 @@ Q_SIGNALS:
     void connected();
     void disconnected();
     void messageReceived(const QString &topicName, const QByteArray &message);
+    void messageArrived(const QMqttMessage &message);
+    void publishWindowFull();
+    void readyToPublish();
     void error(QMqttProtocol::Error err, const QString &errorMessage);
 
 private:
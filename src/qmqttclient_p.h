@@ -2,18 +2,37 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QByteArray>
-#include <QWebSocket>
-#include <QMap>
 #include <QVector>
+#include <QQueue>
+#include <QBitArray>
+#include <QHash>
+#include <random>
 #include <QScopedPointer>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <array>
 #include "qmqttprotocol.h"
 #include "qmqttpacketparser_p.h"
+#include "qmqttpacketidentifiertable_p.h"
+#include "qmqtttransport_p.h"
+#include "qmqttiothread_p.h"
+#include "qmqttmpscqueue_p.h"
+#include "qmqtttopictrie_p.h"
+#include "qmqtttopiccache_p.h"
+#include "qmqttlatencyhistogram_p.h"
+#include "qmqttstatistics.h"
 #include "qmqttwill.h"
+#include "qmqttnetworkrequest.h"
+
+//checks the validity of a topic filter, see 4.7 Topic Names and Topic Filters
+bool isTopicNameValid(const QString &topicName);
 
 class QMqttClient;
-class QMqttNetworkRequest;
+class QMqttSubscription;
+class QMqttControlPacket;
+class QMqttSessionStore;
 class QMqttClientPrivate : public QObject
 {
     Q_OBJECT
@@ -21,20 +40,73 @@ class QMqttClientPrivate : public QObject
     Q_DECLARE_PUBLIC(QMqttClient)
 
 public:
+    //SUBSCRIBE and UNSUBSCRIBE packets with several topic filters are kept below this size, as servers may
+    //limit the size of the packets they accept
+    static const int MAXIMUM_SUBSCRIPTION_PACKET_SIZE = 64 * 1024;
+    //number of messages published from other threads that can wait for the thread of the client
+    static const int PUBLISH_QUEUE_CAPACITY = 4096;
+
     QMqttClientPrivate(const QString &clientId, const QSet<QSslError> &allowedSslErrors, QMqttClient * const q);
     virtual ~QMqttClientPrivate();
 
     void connect(const QMqttNetworkRequest &request, const QMqttWill &will, const QString &userName, const QByteArray &password);
     void disconnect();
     void subscribe(const QString &topic, QMqttProtocol::QoS qos, std::function<void(bool)> cb);
+    QMqttSubscription *subscribe(const QString &topic, QMqttProtocol::QoS qos);
+    void subscribe(const QVector<QPair<QString, QMqttProtocol::QoS>> &topicFilters,
+                   std::function<void(const QVector<QMqttProtocol::QoS> &)> cb);
+    void removeSubscription(QMqttSubscription *subscription);
     void unsubscribe(const QString &topic, std::function<void (bool)> cb);
+    void unsubscribe(const QStringList &topics, std::function<void(bool)> cb);
     void publish(const QString &topic, const QByteArray &message);
-    void publish(const QString &topic, const QByteArray &message, std::function<void(bool)> cb);
+    void publish(const QString &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                 std::function<void(bool)> cb);
+    void publish(const QString &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                 QObject *context, std::function<void(bool)> cb);
+    void publish(const QMqttTopic &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                 std::function<void(bool)> cb);
+    void publish(const QMqttTopic &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                 QObject *context, std::function<void(bool)> cb);
 
     void sendPing();
 
     void setState(QMqttProtocol::State newState);
 
+    void setLowLatencyMode(bool enabled);
+    bool isLowLatencyMode() const;
+
+    void setIoThreadEnabled(bool enabled);
+    bool isIoThreadEnabled() const;
+
+    void setMaximumInflight(int maximum);
+    int maximumInflight() const;
+    int inflightCount() const;
+    int queuedCount() const;
+
+    bool setSessionFile(const QString &fileName);
+    QString sessionFile() const;
+
+    void setAutoReconnect(bool enabled);
+    bool autoReconnect() const;
+    void setReconnectDelay(int minimumMs, int maximumMs);
+    void cancelReconnect();
+    //upper bound of the random delay before the given reconnect attempt, counted from 0
+    QTMQTT_AUTOTEST_EXPORT static int reconnectDelayBound(int attempt, int minimumMs, int maximumMs);
+
+    void cork();
+    void uncork();
+    bool isCorked() const;
+    void setFlushInterval(int ms);
+    int flushInterval() const;
+    void setTopicCacheSize(int size);
+    int topicCacheSize() const;
+
+    qint64 latencyPercentile(QMqttProtocol::Acknowledgement acknowledgement, double percentile) const;
+    quint64 latencyCount(QMqttProtocol::Acknowledgement acknowledgement) const;
+    void resetLatencies();
+
+    const QMqttStatistics &statistics() const;
+
     QHostAddress localAddress() const;
     quint16 localPort() const;
 
@@ -44,32 +116,130 @@ private:
     bool m_pongReceived;
     QTimer m_pingTimer;
     int m_pingIntervalMs;
-    QScopedPointer<QWebSocket> m_webSocket;
+    //deleted later, as the transport can be replaced from within one of its own signals
+    QScopedPointer<QMqttTransport, QScopedPointerDeleteLater> m_transport;
     QMqttProtocol::State m_state;
     QScopedPointer<QMqttPacketParser> m_packetParser;
-    uint16_t m_packetIdentifier;
-    QMap<uint16_t, std::function<void(bool)>> m_subscribeCallbacks;
+    //callbacks and QoS 2 state of the subscribe, unsubscribe and publish requests awaiting
+    //acknowledgement
+    QMqttPacketIdentifierTable m_pendingAcks;
+    //ids of received QoS 2 messages that were delivered, but not released by the server yet;
+    //one bit per packet identifier, allocated when the first QoS 2 message is received
+    QBitArray m_receivedExactlyOnce;
+    //unacknowledged QoS 1 and QoS 2 messages of a persistent session (clean session = false)
+    QScopedPointer<QMqttSessionStore> m_sessionStore;
+    //topic filters to subscribe to again when a connection is made without session
+    QHash<QString, QMqttProtocol::QoS> m_subscribedTopics;
+    //receive the granted QoS of the SUBSCRIBE packets sent by a bulk subscribe
+    QHash<uint16_t, std::function<void(const QVector<QMqttProtocol::QoS> &)>> m_grantedQosReceivers;
+    QMqttNetworkRequest m_request;
+    bool m_autoReconnect;
+    bool m_shouldReconnect;     //false after disconnect() or a permanent connection refusal
+    int m_reconnectAttempt;
+    int m_minimumReconnectDelayMs;
+    int m_maximumReconnectDelayMs;
+    QTimer m_reconnectTimer;
+    std::mt19937 m_randomGenerator;
+    QMqttTopicTrie<QMqttSubscription *> m_subscriptions;
+    //shared topic names of received messages
+    QMqttTopicCache m_topicCache;
     QMqttWill m_will;
     bool m_signalSlotConnected;
+    bool m_lowLatency;
+    bool m_corked;
+    int m_flushIntervalMs;
+    QTimer m_flushTimer;
+    //encoded packets that are held back while corked or until the flush interval expires
+    QByteArray m_writeBuffer;
+    struct QueuedPublish
+    {
+        QString topic;
+        QByteArray message;
+        QMqttProtocol::QoS qos;
+        std::function<void(bool)> cb;
+        QByteArray packet;      //the encoded message, if it was published from another thread
+    };
+    //QoS 1 and 2 publishes beyond m_maximumInflight wait here until earlier ones are acknowledged
+    int m_maximumInflight;
+    int m_inflightPublishes;
+    QQueue<QueuedPublish> m_queuedPublishes;
+    bool m_publishWindowFull;
+    //messages published from other threads, encoded by the publishing thread; their packet
+    //identifier is assigned when they are taken from the queue
+    struct PostedPublish
+    {
+        QByteArray packet;
+        QMqttProtocol::QoS qos;
+        std::function<void(bool)> cb;
+    };
+    QMqttMpscQueue<PostedPublish> m_postedPublishes;
+    //round trip times of the acknowledgements, in microseconds, indexed by Acknowledgement;
+    //send times are nanoseconds since m_clock was started, 0 meaning unknown
+    QElapsedTimer m_clock;
+    qint64 m_pingSentAt;
+    std::array<QMqttLatencyHistogram, 6> m_latencies;
+    QMqttStatistics m_statistics;
     const QSet<QSslError> m_allowedSslErrors;
     QString m_userName;
     QByteArray m_password;
+    //runs transport, parser and keep-alive when enabled; declared last, as it refers to the
+    //statistics and the allowed SSL errors until it is stopped
+    bool m_ioThreadEnabled;
+    QScopedPointer<QMqttIoThread> m_ioThread;
+    quint32 m_ioGeneration;     //of the current connection of the I/O thread
 
 private Q_SLOTS:
     void onSocketConnected();
     void onConnackReceived(QMqttProtocol::Error error, bool sessionPresent);
     void onSubackReceived(uint16_t packetIdentifier, QVector<QMqttProtocol::QoS> qos);
-    void onPublishReceived(QMqttProtocol::QoS qos, uint16_t packetIdentifier,
-                           const QString &topicName, const QByteArray &message);
+    void onPublishReceived(uint16_t packetIdentifier, const QMqttMessage &message);
     void onPubRelReceived(uint16_t packetIdentifier);
     void onPubAckReceived(uint16_t packetIdentifier);
+    void onPubRecReceived(uint16_t packetIdentifier);
+    void onPubCompReceived(uint16_t packetIdentifier);
     void onUnsubackReceived(uint16_t packetIdentifier);
     void onPongReceived();
+    void onSocketDisconnected();
+    void processIoEvents();
+    void flush();
+    void publishPosted();
+    void reconnect();
+    void updateQueueStatistics();
 
 private: //helpers
     bool sslErrorsAllowed(const QList<QSslError> &sslErrors) const;
     void makeSignalSlotConnections();
+    void makeTransportConnections();
+    Qt::ConnectionType connectionType() const;
+    void invokeCallback(const std::function<void(bool)> &cb, bool result);
+    void onSocketError(QAbstractSocket::SocketError error, const QString &errorString);
+    void refuseSslErrors(const QList<QSslError> &errors);
+    void onPingTimeout();
+    void cleanupConnection();
+    void abortTransport();
 
+    void publishQueued();
+    void publishEncoded(QByteArray packet, QMqttProtocol::QoS qos, std::function<void(bool)> cb);
+    void queuePublish(const QueuedPublish &queued);
+    static std::function<void(bool)> contextCallback(QObject *context, std::function<void(bool)> cb);
+    bool isClientThread() const;
+    void postPublish(const QString &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                     std::function<void(bool)> cb);
+    void postEncoded(const QString &topic, const QByteArray &packet, QMqttProtocol::QoS qos,
+                     std::function<void(bool)> cb);
+    void failPending();
+    bool releaseIdentifier(uint16_t packetIdentifier, QMqttPacketIdentifierTable::Operation op,
+                           std::function<void(bool)> *cb);
+    void sendPacket(const QMqttControlPacket &packet);
+    void sendEncoded(const QByteArray &packet);
     void sendData(const QByteArray &data);
+    void writeToTransport(const QByteArray &data);
+    void countSent(QMqttProtocol::PacketType type);
+    void resumeSession(bool sessionPresent);
+    void scheduleReconnect();
+    void restoreSubscriptions();
+    qint64 timestamp() const;
+    void markSent(uint16_t packetIdentifier);
+    void recordLatency(QMqttProtocol::Acknowledgement acknowledgement, qint64 sentAt);
 };
 
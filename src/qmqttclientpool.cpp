@@ -0,0 +1,489 @@
+#include "qmqttclientpool.h"
+#include "qmqttclientpool_p.h"
+#include "qmqttclient.h"
+#include "qmqttnetworkrequest.h"
+#include <QCoreApplication>
+#include <QEvent>
+#include <QHash>
+#include <QTimer>
+#include "logging_p.h"
+
+LoggingModule("QMqttClientPool");
+
+namespace {
+
+//Calls a function on the thread of the object it is posted to.
+//QMetaObject::invokeMethod only accepts functors as of Qt 5.10.
+class CallEvent : public QEvent
+{
+public:
+    static QEvent::Type eventType()
+    {
+        static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+        return type;
+    }
+
+    explicit CallEvent(std::function<void()> f) :
+        QEvent(eventType()),
+        function(std::move(f))
+    {}
+
+    const std::function<void()> function;
+};
+
+}
+
+/*!
+    \class QMqttClientPoolConnection
+
+    \inmodule QtMqtt
+
+    \brief Runs the QMqttClient of one connection of a QMqttClientPool on a dedicated thread.
+
+    \internal
+ */
+
+/*!
+  Starts the thread of the connection, and creates a client with \a clientId and
+  \a allowedSslErrors on it.
+   \internal
+ */
+QMqttClientPoolConnection::QMqttClientPoolConnection(const QString &clientId,
+                                                     const QSet<QSslError> &allowedSslErrors) :
+    QObject(),
+    m_thread(),
+    m_clientId(clientId),
+    m_allowedSslErrors(allowedSslErrors),
+    m_client(nullptr)
+{
+    m_thread.setObjectName(QStringLiteral("QMqttClientPool"));
+    moveToThread(&m_thread);
+    m_thread.start();
+    //the client must exist before client() can be used
+    QMetaObject::invokeMethod(this, "createClient", Qt::BlockingQueuedConnection);
+}
+
+/*!
+  Destroys the client on the thread of the connection, which aborts its connection, and stops
+  the thread.
+   \internal
+ */
+QMqttClientPoolConnection::~QMqttClientPoolConnection()
+{
+    QCoreApplication::postEvent(this, new CallEvent([this]() {
+        delete m_client;
+        m_client = nullptr;
+        m_thread.quit();
+    }));
+    m_thread.wait();
+}
+
+/*!
+   \internal
+ */
+QString QMqttClientPoolConnection::clientId() const
+{
+    return m_clientId;
+}
+
+/*!
+  Returns the client of the connection.
+   \internal
+ */
+QMqttClient *QMqttClientPoolConnection::client() const
+{
+    return m_client;
+}
+
+/*!
+  Calls \a f with the client on the thread of the connection. Functions are called in the order
+  in which they were passed.
+   \internal
+ */
+void QMqttClientPoolConnection::call(std::function<void(QMqttClient *)> f)
+{
+    QCoreApplication::postEvent(this, new CallEvent([this, f]() {
+        f(m_client);
+    }));
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPoolConnection::customEvent(QEvent *event)
+{
+    if (event->type() == CallEvent::eventType()) {
+        static_cast<CallEvent *>(event)->function();
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPoolConnection::createClient()
+{
+    m_client = new QMqttClient(m_clientId, m_allowedSslErrors);
+}
+
+/*!
+   \internal
+ */
+QMqttClientPoolPrivate::QMqttClientPoolPrivate(const QString &clientIdPrefix, int connectionCount,
+                                               const QSet<QSslError> &allowedSslErrors,
+                                               QMqttClientPool * const q) :
+    q_ptr(q),
+    m_connections(),
+    m_connected(),
+    m_connectedCount(0)
+{
+    if (connectionCount < 1) {
+        qCWarning(module) << "Invalid connection count" << connectionCount << "; using 1 connection";
+        connectionCount = 1;
+    }
+    m_connections.reserve(connectionCount);
+    for (int index = 0; index < connectionCount; ++index) {
+        //with an empty prefix, the server assigns the client ids
+        const QString clientId = clientIdPrefix.isEmpty()
+                ? QString() : clientIdPrefix + QString::number(index);
+        m_connections.append(new QMqttClientPoolConnection(clientId, allowedSslErrors));
+        makeSignalSlotConnections(index);
+    }
+    m_connected.fill(false, connectionCount);
+}
+
+/*!
+   \internal
+ */
+QMqttClientPoolPrivate::~QMqttClientPoolPrivate()
+{
+    qDeleteAll(m_connections);
+}
+
+/*!
+  Returns the index of the connection that carries \a topic.
+   \internal
+ */
+int QMqttClientPoolPrivate::connectionIndex(const QString &topic) const
+{
+    //qHash() is not seeded when called with a seed of 0, so that a topic keeps its connection
+    return int(qHash(topic, 0) % uint(m_connections.size()));
+}
+
+/*!
+  Returns a callback that calls \a cb on the thread of the pool, or an empty callback if \a cb
+  is empty.
+  The pool outlives its clients, so that the callback never refers to a destroyed pool.
+   \internal
+ */
+std::function<void(bool)> QMqttClientPoolPrivate::poolCallback(std::function<void(bool)> cb) const
+{
+    if (!cb) {
+        return cb;
+    }
+    QMqttClientPool * const pool = q_ptr;
+    return [pool, cb](bool result) {
+        QTimer::singleShot(0, pool, std::bind(cb, result));
+    };
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPoolPrivate::onConnected(int index)
+{
+    Q_Q(QMqttClientPool);
+
+    if (m_connected.at(index)) {
+        return;
+    }
+    m_connected[index] = true;
+    ++m_connectedCount;
+    if (m_connectedCount == m_connections.size()) {
+        Q_EMIT q->connected();
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttClientPoolPrivate::onDisconnected(int index)
+{
+    Q_Q(QMqttClientPool);
+
+    if (!m_connected.at(index)) {
+        return;
+    }
+    m_connected[index] = false;
+    --m_connectedCount;
+    if (m_connectedCount == 0) {
+        Q_EMIT q->disconnected();
+    }
+}
+
+/*!
+  Forwards the signals of the client of the connection at \a index to the pool. As the client
+  lives on another thread, the signals are queued to the thread of the pool.
+   \internal
+ */
+void QMqttClientPoolPrivate::makeSignalSlotConnections(int index)
+{
+    Q_Q(QMqttClientPool);
+
+    QMqttClient * const client = m_connections.at(index)->client();
+    QObject::connect(client, &QMqttClient::messageReceived, q, &QMqttClientPool::messageReceived);
+    QObject::connect(client, &QMqttClient::error, q, &QMqttClientPool::error);
+    QObject::connect(client, &QMqttClient::connected, q, [this, index]() {
+        onConnected(index);
+    });
+    QObject::connect(client, &QMqttClient::disconnected, q, [this, index]() {
+        onDisconnected(index);
+    });
+}
+
+/*!
+   \class QMqttClientPool
+
+   \inmodule QtMqtt
+
+    \brief Spreads one logical MQTT client over several connections, each handled on a thread
+    of its own.
+
+    A single QMqttClient receives, parses and dispatches all of its messages on one thread. When
+    that thread is saturated, a QMqttClientPool opens connectionCount() connections to the same
+    server instead, and runs the client of each connection on a dedicated thread, so that the
+    throughput scales with the number of cores.
+
+    Each topic is assigned to one connection by its hash (see connectionIndex()): the messages
+    published to a topic all travel over the same connection, and a subscription is made on
+    the connection of its topic filter. This keeps the order of the messages of each topic,
+    as MQTT only orders messages within a connection.
+    The messages received on all connections are delivered through the single messageReceived()
+    signal, on the thread of the pool.
+
+   Limitations:
+   ============
+   \list 1
+   \li A message matching topic filters that were subscribed on different connections is
+   received once per connection. Subscriptions with overlapping topic filters should be avoided.
+   \li The order of messages is only kept per topic, not across topics.
+   \li The client ids are derived from the given prefix by appending the index of the
+   connection, and must stay below 24 characters.
+   \li Every connection registers the same will message.
+   \endlist
+
+   Thread safety:
+   ==============
+   The publish() functions can be called from any thread, like those of QMqttClient; all other
+   functions must be called from the thread the pool lives in. Callbacks and signals are
+   delivered on the thread of the pool, which must run an event loop.
+ */
+
+/*!
+    \fn void QMqttClientPool::connected()
+
+    This signal is emitted when all connections of the pool are established.
+
+    \sa connect(), disconnected()
+*/
+
+/*!
+    \fn void QMqttClientPool::disconnected()
+
+    This signal is emitted when the last established connection of the pool is closed.
+
+    \sa disconnect(), connected()
+*/
+
+/*!
+    \fn void QMqttClientPool::messageReceived(const QString &topicName, const QByteArray &message);
+
+    This signal is emitted when a \a message was received on the topic with the given
+    \a topicName, on any connection of the pool.
+    Messages of the same topic are emitted in the order in which they were received.
+*/
+
+/*!
+    \fn void QMqttClientPool::error(MQTTProtocol::Error err, const QString &errorMessage);
+
+    This signal is emitted when an error occurs on any connection of the pool. The \a err
+    parameter indicates the type of error that occurred and \a errorMessage contains a textual
+    description of the error.
+*/
+
+/*!
+  Creates a new QMqttClientPool with \a connectionCount connections and the given \a parent.
+  The client id of each connection is \a clientIdPrefix followed by the index of the
+  connection; if \a clientIdPrefix is empty, the server will generate the client ids.
+  \a allowedSslErrors: specify any SSL errors you want to allow
+ */
+QMqttClientPool::QMqttClientPool(const QString &clientIdPrefix, int connectionCount,
+                                 const QSet<QSslError> &allowedSslErrors, QObject *parent) :
+    QObject(parent),
+    d_ptr(new QMqttClientPoolPrivate(clientIdPrefix, connectionCount, allowedSslErrors, this))
+{}
+
+/*!
+  Destroys the pool. Open connections are aborted, and their last will will be executed by the
+  server.
+
+  \sa disconnect()
+ */
+QMqttClientPool::~QMqttClientPool()
+{}
+
+/*!
+  Returns the number of connections of the pool.
+ */
+int QMqttClientPool::connectionCount() const
+{
+    Q_D(const QMqttClientPool);
+
+    return d->m_connections.size();
+}
+
+/*!
+  Returns the index of the connection that carries the messages published to \a topic, and
+  the subscription to \a topic when it is a topic filter.
+  The index only depends on \a topic and connectionCount().
+ */
+int QMqttClientPool::connectionIndex(const QString &topic) const
+{
+    Q_D(const QMqttClientPool);
+
+    return d->connectionIndex(topic);
+}
+
+/*!
+  Returns the client id of the connection at \a index.
+ */
+QString QMqttClientPool::clientId(int index) const
+{
+    Q_D(const QMqttClientPool);
+
+    if (index < 0 || index >= d->m_connections.size()) {
+        return QString();
+    }
+    return d->m_connections.at(index)->clientId();
+}
+
+/*!
+  Returns the statistics of the connection at \a index, which must be valid.
+  The statistics can be read from any thread.
+ */
+const QMqttStatistics &QMqttClientPool::statistics(int index) const
+{
+    Q_D(const QMqttClientPool);
+
+    Q_ASSERT(index >= 0 && index < d->m_connections.size());
+    return d->m_connections.at(index)->client()->statistics();
+}
+
+/*!
+  Returns true if all connections of the pool are established.
+ */
+bool QMqttClientPool::isConnected() const
+{
+    Q_D(const QMqttClientPool);
+
+    return d->m_connectedCount == d->m_connections.size();
+}
+
+/*!
+  Connects all connections of the pool to the server specified in the \a request, with the
+  given \a will, \a userName and \a password.
+  When all connections are established, a connected() signal is emitted.
+
+  \sa QMqttClient::connect(), disconnect()
+ */
+void QMqttClientPool::connect(const QMqttNetworkRequest &request, const QMqttWill &will,
+                              const QString &userName, const QByteArray &password)
+{
+    Q_D(QMqttClientPool);
+
+    for (QMqttClientPoolConnection *connection : d->m_connections) {
+        connection->call([request, will, userName, password](QMqttClient *client) {
+            client->connect(request, will, userName, password);
+        });
+    }
+}
+
+/*!
+  Disconnects all connections of the pool in an orderly manner.
+  When no connection is established anymore, a disconnected() signal is emitted.
+
+  \sa QMqttClient::disconnect(), connect()
+ */
+void QMqttClientPool::disconnect()
+{
+    Q_D(QMqttClientPool);
+
+    for (QMqttClientPoolConnection *connection : d->m_connections) {
+        connection->call([](QMqttClient *client) {
+            client->disconnect();
+        });
+    }
+}
+
+/*!
+  Subscribes to \a topic with the given \a qos, on the connection given by connectionIndex().
+  \a cb is called on the thread of the pool when the server acknowledged the subscription.
+
+  \sa QMqttClient::subscribe(), unsubscribe()
+ */
+void QMqttClientPool::subscribe(const QString &topic, QMqttProtocol::QoS qos,
+                                std::function<void(bool)> cb)
+{
+    Q_D(QMqttClientPool);
+
+    const std::function<void(bool)> callback = d->poolCallback(cb);
+    d->m_connections.at(d->connectionIndex(topic))->call([topic, qos, callback](QMqttClient *client) {
+        client->subscribe(topic, qos, callback);
+    });
+}
+
+/*!
+  Unsubscribes from \a topic, on the connection it was subscribed on.
+  \a cb is called on the thread of the pool when the server acknowledged the request.
+
+  \sa QMqttClient::unsubscribe(), subscribe()
+ */
+void QMqttClientPool::unsubscribe(const QString &topic, std::function<void(bool)> cb)
+{
+    Q_D(QMqttClientPool);
+
+    const std::function<void(bool)> callback = d->poolCallback(cb);
+    d->m_connections.at(d->connectionIndex(topic))->call([topic, callback](QMqttClient *client) {
+        client->unsubscribe(topic, callback);
+    });
+}
+
+/*!
+  Publishes \a message to \a topic with QoS AT_MOST_ONCE, on the connection given by
+  connectionIndex().
+  This function can be called from any thread.
+
+  \sa QMqttClient::publish()
+ */
+void QMqttClientPool::publish(const QString &topic, const QByteArray &message)
+{
+    Q_D(QMqttClientPool);
+
+    d->m_connections.at(d->connectionIndex(topic))->client()->publish(topic, message);
+}
+
+/*!
+  Publishes \a message to \a topic with the given \a qos, on the connection given by
+  connectionIndex(). \a cb is called on the thread of the pool when the message was sent
+  (AT_MOST_ONCE) or acknowledged by the server.
+  This function can be called from any thread; the messages of each publishing thread keep
+  their order per topic.
+
+  \sa QMqttClient::publish()
+ */
+void QMqttClientPool::publish(const QString &topic, const QByteArray &message,
+                              QMqttProtocol::QoS qos, std::function<void(bool)> cb)
+{
+    Q_D(QMqttClientPool);
+
+    d->m_connections.at(d->connectionIndex(topic))->client()->publish(topic, message, qos, this, cb);
+}
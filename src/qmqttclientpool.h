@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QObject>
+#include <QSet>
+#include <QSslError>
+#include <functional>
+#include "qmqttwill.h"
+#include "qmqttprotocol.h"
+#include "qmqttstatistics.h"
+#include "qmqtt_global.h"
+
+class QMqttNetworkRequest;
+class QString;
+class QByteArray;
+class QMqttClientPoolPrivate;
+class QTMQTT_EXPORT QMqttClientPool : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(QMqttClientPool)
+    Q_DISABLE_COPY(QMqttClientPool)
+
+public:
+    QMqttClientPool(const QString &clientIdPrefix, int connectionCount,
+                    const QSet<QSslError> &allowedSslErrors = QSet<QSslError>(),
+                    QObject *parent = nullptr);
+    virtual ~QMqttClientPool();
+
+    int connectionCount() const;
+    int connectionIndex(const QString &topic) const;
+    QString clientId(int index) const;
+    const QMqttStatistics &statistics(int index) const;
+    bool isConnected() const;
+
+    using QObject::connect;
+    void connect(const QMqttNetworkRequest &request, const QMqttWill &will = QMqttWill(), const QString &userName = QString(), const QByteArray &password = QByteArray());
+    using QObject::disconnect;
+    void disconnect();
+
+    void subscribe(const QString &topic, QMqttProtocol::QoS qos, std::function<void(bool)> cb);
+    void unsubscribe(const QString &topic, std::function<void(bool)> cb);
+    void publish(const QString &topic, const QByteArray &message);
+    void publish(const QString &topic, const QByteArray &message, QMqttProtocol::QoS qos,
+                 std::function<void(bool)> cb);
+
+Q_SIGNALS:
+    void connected();
+    void disconnected();
+    void messageReceived(const QString &topicName, const QByteArray &message);
+    void error(QMqttProtocol::Error err, const QString &errorMessage);
+
+private:
+    QScopedPointer<QMqttClientPoolPrivate> d_ptr;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QString>
+#include <QVector>
+#include <QSet>
+#include <QSslError>
+#include <functional>
+#include "qmqttclientpool.h"
+
+class QMqttClient;
+
+//One connection of a QMqttClientPool: a QMqttClient that lives on a thread of its own.
+//The client is created and destroyed on that thread, as its private object cannot be moved
+//along with it by QObject::moveToThread().
+class QMqttClientPoolConnection : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QMqttClientPoolConnection)
+
+public:
+    QMqttClientPoolConnection(const QString &clientId, const QSet<QSslError> &allowedSslErrors);
+    virtual ~QMqttClientPoolConnection();
+
+    QString clientId() const;
+    //can be called from any thread; only the thread-safe functions of the client may be used
+    //outside call()
+    QMqttClient *client() const;
+    //calls f with the client on the thread of the connection, after the functions passed before
+    void call(std::function<void(QMqttClient *)> f);
+
+protected:
+    void customEvent(QEvent *event) Q_DECL_OVERRIDE;
+
+private:
+    QThread m_thread;
+    const QString m_clientId;
+    const QSet<QSslError> m_allowedSslErrors;
+    QMqttClient *m_client;
+
+private Q_SLOTS:
+    void createClient();
+};
+
+class QMqttClientPoolPrivate
+{
+    Q_DISABLE_COPY(QMqttClientPoolPrivate)
+    Q_DECLARE_PUBLIC(QMqttClientPool)
+
+public:
+    QMqttClientPoolPrivate(const QString &clientIdPrefix, int connectionCount,
+                           const QSet<QSslError> &allowedSslErrors, QMqttClientPool * const q);
+    ~QMqttClientPoolPrivate();
+
+    int connectionIndex(const QString &topic) const;
+    //wraps cb so that it is called on the thread of the pool
+    std::function<void(bool)> poolCallback(std::function<void(bool)> cb) const;
+
+    void onConnected(int index);
+    void onDisconnected(int index);
+
+    QMqttClientPool * const q_ptr;
+    QVector<QMqttClientPoolConnection *> m_connections;
+    //only used on the thread of the pool
+    QVector<bool> m_connected;
+    int m_connectedCount;
+
+private:
+    void makeSignalSlotConnections(int index);
+};
@@ -4,114 +4,141 @@
 #include <QVector>
 #include <QDebug>
 #include <limits>
+#include <cstring>
 #include "logging_p.h"
 
 LoggingModule("QMqttControlPacket");
 
-/*!
-    \enum ControlPacket::PacketType
-
-    \inmodule QtMqtt
-
-    The control packet types supported by MQTT v3.1.1
-
-    \value RESERVED_0                       Reserved; should not be used
-    \value CONNECT                          Client request to connect to server (client --> server)
-    \value CONNACK                          Connect acknowledgement (server --> client)
-    \value PUBLISH                          Publish message (client <--> server)
-    \value PUBACK                           Publish acknowledgement (client <--> server)
-    \value PUBREC                           Publish received (assured delivery part 1) (client <--> server)
-    \value PUBREL                           Publish received (assured delivery part 2) (client <--> server)
-    \value PUBCOMP                          Publish received (assured delivery part 2) (client <--> server)
-    \value SUBSCRIBE                        Client subscribe request (client --> server)
-    \value SUBACK                           Subscribe acknowledgement (server --> client)
-    \value UNSUBSCRIBE                      Unsubscribe request (client --> server)
-    \value UNSUBACK                         Unsubscribe acknlowedgement (server --> client)
-    \value PINGREQ                          PING request (client --> server)
-    \value PINGRESP                         PING response (server --> client)
-    \value DISCONNECT                       Client is disconnecting (client --> server)
-    \value RESERVED_15                      Reserved; should not be used
-
-    \internal
-*/
-
 //helper methods
-template<class T>
-QByteArray encodeNumber(T t) Q_DECL_NOEXCEPT {
-    QByteArray array;
-    const T tmp = qToBigEndian(t);
-    return array.append(static_cast<const char *>(static_cast<const void *>(&tmp)),
-                        sizeof(T));
-}
-
-QByteArray encodeData(const QByteArray &data) Q_DECL_NOEXCEPT
-{
-    const int size = data.size();
-    if (size < std::numeric_limits<uint16_t>::max()) {
-        QByteArray encodedData;
-        encodedData.append(encodeNumber(uint16_t(size)));
-        if (size > 0) {
-            encodedData.append(data);
-        }
-        return encodedData;
-    } else {
-        qCWarning(module) << "Data is too big: size =" << size
-                          << "maximum size=" << std::numeric_limits<uint16_t>::max();
-        return QByteArray();
+//All write helpers write to out and return the position following the last byte written.
+inline char *writeUint8(char *out, uint8_t value) Q_DECL_NOEXCEPT
+{
+    *out = char(value);
+    return out + 1;
+}
+
+inline char *writeUint16(char *out, uint16_t value) Q_DECL_NOEXCEPT
+{
+    qToBigEndian<quint16>(value, reinterpret_cast<uchar *>(out));
+    return out + sizeof(uint16_t);
+}
+
+inline char *writeBytes(char *out, const char *data, int size) Q_DECL_NOEXCEPT
+{
+    if (size > 0) {
+        memcpy(out, data, size_t(size));
     }
+    return out + size;
+}
+
+//see 1.5.3 UTF-8 encoded strings: data is prefixed with a 2 byte length field
+inline int32_t encodedDataSize(const QByteArray &data) Q_DECL_NOEXCEPT
+{
+    return int32_t(sizeof(uint16_t)) + data.size();
+}
+
+inline char *writeData(char *out, const QByteArray &data) Q_DECL_NOEXCEPT
+{
+    out = writeUint16(out, uint16_t(data.size()));
+    return writeBytes(out, data.constData(), data.size());
 }
 
-inline QByteArray encodeString(const QString &string) Q_DECL_NOEXCEPT {
-    return encodeData(string.toUtf8());
+//see 2.2.3 Remaining Length
+inline int lengthFieldSize(int32_t length) Q_DECL_NOEXCEPT
+{
+    return (length < 0x80) ? 1 : (length < 0x4000) ? 2 : (length < 0x200000) ? 3 : 4;
 }
 
-inline QByteArray encodeLength(int32_t length) Q_DECL_NOEXCEPT {
-    QByteArray encodedLength;
+inline char *writeLength(char *out, int32_t length) Q_DECL_NOEXCEPT
+{
     do {
         uint8_t digit = length % 128;
         length = length / 128;
         if (length > 0) {
             digit = digit | 0x80;
         }
-        encodedLength.append(digit);
+        out = writeUint8(out, digit);
     } while (length > 0);
-    return encodedLength;
+    return out;
+}
+
+//Checks that data fits in a length prefixed field.
+//Data that is too big is replaced by empty data, so that the packet stays well-formed.
+QByteArray checkedData(const QByteArray &data) Q_DECL_NOEXCEPT
+{
+    if (data.size() > std::numeric_limits<uint16_t>::max()) {
+        qCWarning(module) << "Data is too big: size =" << data.size()
+                          << "maximum size=" << std::numeric_limits<uint16_t>::max();
+        return QByteArray();
+    }
+    return data;
+}
+
+inline QByteArray encodeString(const QString &string) Q_DECL_NOEXCEPT
+{
+    return checkedData(string.toUtf8());
 }
 
 QMqttControlPacket::QMqttControlPacket(const PacketType &controlPacketType) :
-    QObject(),
     m_type(controlPacketType)
 {}
 
+QMqttControlPacket::~QMqttControlPacket()
+{}
+
 QMqttControlPacket::PacketType QMqttControlPacket::type() const
 {
     return m_type;
 }
 
-QByteArray QMqttControlPacket::fixedHeader() const {
-    QByteArray header;
-    const uint8_t byte1 = (uint8_t(type()) << 4) | flags();
-    return header.append(byte1);
+int32_t QMqttControlPacket::remainingLength() const
+{
+    const qint64 length = qint64(variableHeaderSize()) + payloadSize();
+    return (length > std::numeric_limits<int32_t>::max()) ? -1 : int32_t(length);
+}
+
+int32_t QMqttControlPacket::encodedSize() const
+{
+    const int32_t length = remainingLength();
+    if (length < 0 || length > QMqttControlPacket::MAXIMUM_CONTROL_PACKET_SIZE) {
+        return -1;
+    }
+    return 1 + lengthFieldSize(length) + length;
 }
 
 QByteArray QMqttControlPacket::encode() const
 {
     QByteArray packet;
+    encodeTo(packet);
+    return packet;
+}
 
-    const QByteArray fixedHdr = fixedHeader();
-    const QByteArray variableHdr = variableHeader();
-    const QByteArray payloadData = payload();
-    const int remainingLength = variableHdr.size() + payloadData.size();
-    if (remainingLength > QMqttControlPacket::MAXIMUM_CONTROL_PACKET_SIZE) {
-        qCWarning(module) << "Packet size too big:" << remainingLength
+bool QMqttControlPacket::encodeTo(QByteArray &buffer) const
+{
+    //lengthFieldSize() and writeLength() agree only up to the maximum remaining length
+    const int32_t length = remainingLength();
+    if (length < 0 || length > QMqttControlPacket::MAXIMUM_CONTROL_PACKET_SIZE) {
+        qCWarning(module) << "Packet size too big:"
+                          << qint64(variableHeaderSize()) + payloadSize()
                           << "maximum:" << QMqttControlPacket::MAXIMUM_CONTROL_PACKET_SIZE;
-        return packet;
+        return false;
+    }
+    const int offset = buffer.size();
+    const int size = 1 + lengthFieldSize(length) + length;
+    if (offset > std::numeric_limits<int>::max() - size) {
+        qCWarning(module) << "Buffer too big to append a packet of size" << size;
+        return false;
     }
-    return packet
-            .append(fixedHdr)
-            .append(encodeLength(int32_t(remainingLength)))
-            .append(variableHdr)
-            .append(payloadData);
+    buffer.resize(offset + size);
+
+    char *out = buffer.data() + offset;
+    out = writeUint8(out, (uint8_t(type()) << 4) | flags());
+    out = writeLength(out, length);
+    out = writeVariableHeader(out);
+    out = writePayload(out);
+    Q_ASSERT(out == buffer.constData() + buffer.size());
+
+    return true;
 }
 
 QMqttConnectControlPacket::QMqttConnectControlPacket(const QString &clientIdentifier) :
@@ -119,9 +146,10 @@ QMqttConnectControlPacket::QMqttConnectControlPacket(const QString &clientIdenti
     m_userName(),
     m_password(),
     m_will(),
+    m_willTopic(),
     m_clean(true),
     m_keepAlive(30),
-    m_clientIdentifier(clientIdentifier)
+    m_clientIdentifier(encodeString(clientIdentifier))
 {
     Q_ASSERT(clientIdentifier.length() < 24);
 }
@@ -130,13 +158,30 @@ void QMqttConnectControlPacket::setCredentials(const QString &userName, const QB
 {
     Q_ASSERT(!userName.isEmpty());
     Q_ASSERT(!password.isNull());
-    m_userName = userName;
-    m_password = password;
+    m_userName = encodeString(userName);
+    m_password = checkedData(password);
 }
 
 void QMqttConnectControlPacket::setWill(const QMqttWill &will)
 {
     m_will = will;
+    m_willTopic = encodeString(will.topic());
+}
+
+void QMqttConnectControlPacket::setCleanSession(bool isClean)
+{
+    m_clean = isClean;
+}
+
+void QMqttConnectControlPacket::setKeepAlive(uint16_t keepAliveSecs)
+{
+    m_keepAlive = keepAliveSecs;
+}
+
+void QMqttConnectControlPacket::setClientIdentifier(const QString &identifier)
+{
+    Q_ASSERT(identifier.length() < 24);
+    m_clientIdentifier = encodeString(identifier);
 }
 
 bool QMqttConnectControlPacket::hasUserName() const
@@ -165,13 +210,18 @@ uint8_t QMqttConnectControlPacket::flags() const
     return 0x00;
 }
 
-QByteArray QMqttConnectControlPacket::variableHeader() const
+int32_t QMqttConnectControlPacket::variableHeaderSize() const
+{
+    //protocol name (6), protocol level (1), connect flags (1) and keep alive (2)
+    return 10;
+}
+
+char *QMqttConnectControlPacket::writeVariableHeader(char *out) const
 {
-    QByteArray header;
     //protocol name
-    header.append(encodeString(QStringLiteral("MQTT")));
+    out = writeData(out, QByteArrayLiteral("MQTT"));
     //protocol level
-    header.append(uint8_t(4));
+    out = writeUint8(out, 4);
     //connect flags
     const uint8_t connectFlags =
             ((hasUserName() << 7) |
@@ -181,36 +231,48 @@ QByteArray QMqttConnectControlPacket::variableHeader() const
             (hasWill() << 2) |
             (isCleanSession() << 1)) &
             0xF7;  //set lowest bit to 0
-    header.append(connectFlags);
+    out = writeUint8(out, connectFlags);
     //keep alive
-    header.append(encodeNumber(m_keepAlive));
-    return header;
+    return writeUint16(out, m_keepAlive);
 }
 
-QByteArray QMqttConnectControlPacket::payload() const
+int32_t QMqttConnectControlPacket::payloadSize() const
 {
-    QByteArray buffer;
-    buffer.append(encodeString(m_clientIdentifier));
+    int32_t size = encodedDataSize(m_clientIdentifier);
     if (hasWill()) {
-        buffer.append(encodeString(m_will.topic()));
-        buffer.append(encodeNumber(uint16_t(m_will.message().size())));
-        buffer.append(m_will.message());
+        size += encodedDataSize(m_willTopic) + encodedDataSize(m_will.message());
     }
     if (hasUserName()) {
-        buffer.append(encodeString(m_userName));
+        size += encodedDataSize(m_userName);
     }
     if (hasPassword()) {
-        buffer.append(encodeData(m_password));
+        size += encodedDataSize(m_password);
     }
+    return size;
+}
 
-    return buffer;
+char *QMqttConnectControlPacket::writePayload(char *out) const
+{
+    out = writeData(out, m_clientIdentifier);
+    if (hasWill()) {
+        out = writeData(out, m_willTopic);
+        out = writeData(out, m_will.message());
+    }
+    if (hasUserName()) {
+        out = writeData(out, m_userName);
+    }
+    if (hasPassword()) {
+        out = writeData(out, m_password);
+    }
+    return out;
 }
 
 QMqttPublishControlPacket::QMqttPublishControlPacket(const QString &topicName, const QByteArray &message,
                                            QMqttProtocol::QoS qos, bool retain,
                                            uint16_t packetIdentifier) :
     QMqttControlPacket(PacketType::PUBLISH),
-    m_topicName(topicName),
+    m_topicName(encodeString(topicName)),
+    m_encodedTopicName(),
     m_message(message),
     m_dup(false),
     m_qos(qos),
@@ -220,24 +282,92 @@ QMqttPublishControlPacket::QMqttPublishControlPacket(const QString &topicName, c
     Q_ASSERT(!topicName.isEmpty());
 }
 
+QMqttPublishControlPacket::QMqttPublishControlPacket(const QMqttTopic &topic, const QByteArray &message,
+                                                     QMqttProtocol::QoS qos, bool retain,
+                                                     uint16_t packetIdentifier) :
+    QMqttControlPacket(PacketType::PUBLISH),
+    m_topicName(),
+    m_encodedTopicName(topic.m_encoded),
+    m_message(message),
+    m_dup(false),
+    m_qos(qos),
+    m_retain(retain),
+    m_packetIdentifier(packetIdentifier)
+{
+    Q_ASSERT(topic.isValid());
+}
+
+QByteArray QMqttPublishControlPacket::markDuplicate(const QByteArray &encodedPacket)
+{
+    Q_ASSERT(!encodedPacket.isEmpty());
+
+    QByteArray packet = encodedPacket;
+    packet[0] = char(packet.at(0) | 0x08);
+    return packet;
+}
+
+QMqttProtocol::QoS QMqttPublishControlPacket::qos(const QByteArray &encodedPacket)
+{
+    Q_ASSERT(!encodedPacket.isEmpty());
+
+    return QMqttProtocol::QoS((uint8_t(encodedPacket.at(0)) >> 1) & 0x03);
+}
+
+void QMqttPublishControlPacket::setPacketIdentifier(QByteArray &encodedPacket,
+                                                    uint16_t packetIdentifier)
+{
+    Q_ASSERT(qos(encodedPacket) != QMqttProtocol::QoS::AT_MOST_ONCE);
+
+    //skip the fixed header: the last byte of the remaining length has its high bit cleared
+    int offset = 1;
+    while (uint8_t(encodedPacket.at(offset)) & 0x80) {
+        ++offset;
+    }
+    ++offset;
+    //the packet identifier follows the topic name
+    const int topicNameSize
+            = qFromBigEndian<quint16>(reinterpret_cast<const uchar *>(encodedPacket.constData() + offset));
+    writeUint16(encodedPacket.data() + offset + int(sizeof(uint16_t)) + topicNameSize, packetIdentifier);
+}
+
 uint8_t QMqttPublishControlPacket::flags() const
 {
     return (uint8_t(m_dup) << 3) | (uint8_t(m_qos) << 1) | uint8_t(m_retain);
 }
 
-QByteArray QMqttPublishControlPacket::variableHeader() const
+int32_t QMqttPublishControlPacket::variableHeaderSize() const
 {
-    QByteArray header = encodeString(m_topicName);
+    int32_t size = m_encodedTopicName.isEmpty() ? encodedDataSize(m_topicName)
+                                                : m_encodedTopicName.size();
     if ((m_qos == QMqttProtocol::QoS::AT_LEAST_ONCE) || (m_qos == QMqttProtocol::QoS::EXACTLY_ONCE))
     {
-        header.append(encodeNumber(m_packetIdentifier));
+        size += sizeof(uint16_t);
     }
-    return header;
+    return size;
 }
 
-QByteArray QMqttPublishControlPacket::payload() const
+char *QMqttPublishControlPacket::writeVariableHeader(char *out) const
 {
-    return m_message;
+    if (m_encodedTopicName.isEmpty()) {
+        out = writeData(out, m_topicName);
+    } else {
+        out = writeBytes(out, m_encodedTopicName.constData(), m_encodedTopicName.size());
+    }
+    if ((m_qos == QMqttProtocol::QoS::AT_LEAST_ONCE) || (m_qos == QMqttProtocol::QoS::EXACTLY_ONCE))
+    {
+        out = writeUint16(out, m_packetIdentifier);
+    }
+    return out;
+}
+
+int32_t QMqttPublishControlPacket::payloadSize() const
+{
+    return m_message.size();
+}
+
+char *QMqttPublishControlPacket::writePayload(char *out) const
+{
+    return writeBytes(out, m_message.constData(), m_message.size());
 }
 
 QMqttPubAckControlPacket::QMqttPubAckControlPacket(uint16_t packetIdentifier) :
@@ -250,14 +380,24 @@ uint8_t QMqttPubAckControlPacket::flags() const
     return 0x00;
 }
 
-QByteArray QMqttPubAckControlPacket::variableHeader() const
+int32_t QMqttPubAckControlPacket::variableHeaderSize() const
+{
+    return sizeof(uint16_t);
+}
+
+char *QMqttPubAckControlPacket::writeVariableHeader(char *out) const
 {
-    return encodeNumber(m_packetIdentifier);
+    return writeUint16(out, m_packetIdentifier);
 }
 
-QByteArray QMqttPubAckControlPacket::payload() const
+int32_t QMqttPubAckControlPacket::payloadSize() const
 {
-    return QByteArray();
+    return 0;
+}
+
+char *QMqttPubAckControlPacket::writePayload(char *out) const
+{
+    return out;
 }
 
 QMqttPubRecControlPacket::QMqttPubRecControlPacket(uint16_t packetIdentifier) :
@@ -270,14 +410,55 @@ uint8_t QMqttPubRecControlPacket::flags() const
     return 0x00;
 }
 
-QByteArray QMqttPubRecControlPacket::variableHeader() const
+int32_t QMqttPubRecControlPacket::variableHeaderSize() const
+{
+    return sizeof(uint16_t);
+}
+
+char *QMqttPubRecControlPacket::writeVariableHeader(char *out) const
+{
+    return writeUint16(out, m_packetIdentifier);
+}
+
+int32_t QMqttPubRecControlPacket::payloadSize() const
+{
+    return 0;
+}
+
+char *QMqttPubRecControlPacket::writePayload(char *out) const
+{
+    return out;
+}
+
+QMqttPubRelControlPacket::QMqttPubRelControlPacket(uint16_t packetIdentifier) :
+    QMqttControlPacket(PacketType::PUBREL),
+    m_packetIdentifier(packetIdentifier)
+{}
+
+uint8_t QMqttPubRelControlPacket::flags() const
+{
+    //see 3.6.1 Fixed header: bits 3,2,1 and 0 are reserved and must be set to 0,0,1 and 0
+    return 0x02;
+}
+
+int32_t QMqttPubRelControlPacket::variableHeaderSize() const
+{
+    return sizeof(uint16_t);
+}
+
+char *QMqttPubRelControlPacket::writeVariableHeader(char *out) const
 {
-    return encodeNumber(m_packetIdentifier);
+    return writeUint16(out, m_packetIdentifier);
 }
 
-QByteArray QMqttPubRecControlPacket::payload() const
+int32_t QMqttPubRelControlPacket::payloadSize() const
 {
-    return QByteArray();
+    return 0;
+}
+
+char *QMqttPubRelControlPacket::writePayload(char *out) const
+{
+    return out;
 }
 
 QMqttPubCompControlPacket::QMqttPubCompControlPacket(uint16_t packetIdentifier) :
@@ -290,22 +471,36 @@ uint8_t QMqttPubCompControlPacket::flags() const
     return 0x00;
 }
 
-QByteArray QMqttPubCompControlPacket::variableHeader() const
+int32_t QMqttPubCompControlPacket::variableHeaderSize() const
+{
+    return sizeof(uint16_t);
+}
+
+char *QMqttPubCompControlPacket::writeVariableHeader(char *out) const
 {
-    return encodeNumber(m_packetIdentifier);
+    return writeUint16(out, m_packetIdentifier);
 }
 
-QByteArray QMqttPubCompControlPacket::payload() const
+int32_t QMqttPubCompControlPacket::payloadSize() const
 {
-    return QByteArray();
+    return 0;
+}
+
+char *QMqttPubCompControlPacket::writePayload(char *out) const
+{
+    return out;
 }
 
 QMqttSubscribeControlPacket::QMqttSubscribeControlPacket(uint16_t packetIdentifier,
                                                QVector<TopicFilter> topicFilters) :
     QMqttControlPacket(PacketType::SUBSCRIBE),
     m_packetIdentifier(packetIdentifier),
-    m_topicFilters(topicFilters)
+    m_topicFilters()
 {
+    m_topicFilters.reserve(topicFilters.size());
+    for (const TopicFilter &topicFilter : topicFilters) {
+        m_topicFilters.append(qMakePair(encodeString(topicFilter.first), topicFilter.second));
+    }
 }
 
 uint8_t QMqttSubscribeControlPacket::flags() const
@@ -313,46 +508,76 @@ uint8_t QMqttSubscribeControlPacket::flags() const
     return 0x02;    //QoS = 1
 }
 
-QByteArray QMqttSubscribeControlPacket::variableHeader() const
+int32_t QMqttSubscribeControlPacket::variableHeaderSize() const
 {
-    return encodeNumber(m_packetIdentifier);
+    return sizeof(uint16_t);
 }
 
-QByteArray QMqttSubscribeControlPacket::payload() const
+char *QMqttSubscribeControlPacket::writeVariableHeader(char *out) const
 {
-    QByteArray buffer;
-    for (const TopicFilter &topicFilter : m_topicFilters) {
-        buffer.append(encodeString(topicFilter.first));
-        const uint8_t qos = uint8_t(topicFilter.second);
-        buffer.append(qos);
+    return writeUint16(out, m_packetIdentifier);
+}
+
+int32_t QMqttSubscribeControlPacket::payloadSize() const
+{
+    int32_t size = 0;
+    for (const auto &topicFilter : m_topicFilters) {
+        size += encodedDataSize(topicFilter.first) + 1;
+    }
+    return size;
+}
+
+char *QMqttSubscribeControlPacket::writePayload(char *out) const
+{
+    for (const auto &topicFilter : m_topicFilters) {
+        out = writeData(out, topicFilter.first);
+        out = writeUint8(out, uint8_t(topicFilter.second));
     }
-    return buffer;
+    return out;
 }
 
 QMqttUnsubscribeControlPacket::QMqttUnsubscribeControlPacket(uint16_t packetIdentifier,
                                                    QVector<QString> topics) :
     QMqttControlPacket(PacketType::UNSUBSCRIBE),
     m_packetIdentifier(packetIdentifier),
-    m_topics(topics)
-{}
+    m_topics()
+{
+    m_topics.reserve(topics.size());
+    for (const QString &topic : topics) {
+        m_topics.append(encodeString(topic));
+    }
+}
 
 uint8_t QMqttUnsubscribeControlPacket::flags() const
 {
     return 0x02;
 }
 
-QByteArray QMqttUnsubscribeControlPacket::variableHeader() const
+int32_t QMqttUnsubscribeControlPacket::variableHeaderSize() const
+{
+    return sizeof(uint16_t);
+}
+
+char *QMqttUnsubscribeControlPacket::writeVariableHeader(char *out) const
+{
+    return writeUint16(out, m_packetIdentifier);
+}
+
+int32_t QMqttUnsubscribeControlPacket::payloadSize() const
 {
-    return encodeNumber(m_packetIdentifier);
+    int32_t size = 0;
+    for (const QByteArray &topic : m_topics) {
+        size += encodedDataSize(topic);
+    }
+    return size;
 }
 
-QByteArray QMqttUnsubscribeControlPacket::payload() const
+char *QMqttUnsubscribeControlPacket::writePayload(char *out) const
 {
-    QByteArray buffer;
-    for (const QString &topic : m_topics) {
-        buffer.append(encodeString(topic));
+    for (const QByteArray &topic : m_topics) {
+        out = writeData(out, topic);
     }
-    return buffer;
+    return out;
 }
 
 QMqttPingReqControlPacket::QMqttPingReqControlPacket() :
@@ -364,14 +589,24 @@ uint8_t QMqttPingReqControlPacket::flags() const
     return 0x00;
 }
 
-QByteArray QMqttPingReqControlPacket::variableHeader() const
+int32_t QMqttPingReqControlPacket::variableHeaderSize() const
+{
+    return 0;
+}
+
+char *QMqttPingReqControlPacket::writeVariableHeader(char *out) const
 {
-    return QByteArray();
+    return out;
 }
 
-QByteArray QMqttPingReqControlPacket::payload() const
+int32_t QMqttPingReqControlPacket::payloadSize() const
 {
-    return QByteArray();
+    return 0;
+}
+
+char *QMqttPingReqControlPacket::writePayload(char *out) const
+{
+    return out;
 }
 
 QMqttDisconnectControlPacket::QMqttDisconnectControlPacket() :
@@ -383,12 +618,22 @@ uint8_t QMqttDisconnectControlPacket::flags() const
     return 0x00;
 }
 
-QByteArray QMqttDisconnectControlPacket::variableHeader() const
+int32_t QMqttDisconnectControlPacket::variableHeaderSize() const
+{
+    return 0;
+}
+
+char *QMqttDisconnectControlPacket::writeVariableHeader(char *out) const
+{
+    return out;
+}
+
+int32_t QMqttDisconnectControlPacket::payloadSize() const
 {
-    return QByteArray();
+    return 0;
 }
 
-QByteArray QMqttDisconnectControlPacket::payload() const
+char *QMqttDisconnectControlPacket::writePayload(char *out) const
 {
-    return QByteArray();
+    return out;
 }
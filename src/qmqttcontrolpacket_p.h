@@ -2,55 +2,48 @@
 
 #include "qmqttprotocol.h"
 #include "qmqttwill.h"
+#include "qmqtttopic.h"
 #include "qmqtt_global.h"
 #include <QByteArray>
 #include <QVector>
+#include <QPair>
 
 //MQTT v3.1.1 specification: http://docs.oasis-open.org/mqtt/mqtt/v3.1.1/os/mqtt-v3.1.1-os.html
 
 //For Control Packets, see 3. MQTT Control Packets in the MQTT v3.1.1 specification
 
-class QTMQTT_AUTOTEST_EXPORT QMqttControlPacket:public QObject
+//Control packets are plain classes rather than QObjects, so that they are cheap to construct.
+//Encoding computes the exact size of the packet first, and then writes the fixed header,
+//variable header and payload in a single pass into one buffer.
+class QTMQTT_AUTOTEST_EXPORT QMqttControlPacket
 {
-    Q_OBJECT
-
 public:
-    //see 2.1.1 MQTT Control Packet type in MQTT v3.1.1 specification
-    enum class PacketType : uint8_t
-    {
-        RESERVED_0   = 0,   //Reserved
-        CONNECT      = 1,   //Client request to connect to server (client --> server)
-        CONNACK      = 2,   //Connect acknowledgement (server --> client)
-        PUBLISH      = 3,   //Publish message (client <--> server)
-        PUBACK       = 4,   //Publish acknowledgement (client <--> server)
-        PUBREC       = 5,   //Publish received (assured delivery part 1) (client <--> server)
-        PUBREL       = 6,   //Publish release  (assured delivery part 2) (client <--> server)
-        PUBCOMP      = 7,   //Publish complete (assured delivery part 3) (client <--> server)
-        SUBSCRIBE    = 8,   //Client subscribe request (client --> server)
-        SUBACK       = 9,   //Subscribe acknowledgement (server --> client)
-        UNSUBSCRIBE  = 10,  //Unsubscribe request (client --> server)
-        UNSUBACK     = 11,  //Unsubscribe acknlowedgement (server --> client)
-        PINGREQ      = 12,  //PING request (client --> server)
-        PINGRESP     = 13,  //PING response (server --> client)
-        DISCONNECT   = 14,  //Client is disconnecting (client --> server)
-        RESERVED_15  = 15   //Reserved
-    };
-    Q_ENUM(PacketType)
-    static const int32_t MAXIMUM_CONTROL_PACKET_SIZE = 256 * 1024 * 1024; //256MiB
+    //the packet types are public, so that the statistics of a client can be broken down by type
+    typedef QMqttProtocol::PacketType PacketType;
+    //the largest remaining length that fits in the 4 byte length field, see 2.2.3 Remaining Length
+    static const int32_t MAXIMUM_CONTROL_PACKET_SIZE = 0x0FFFFFFF; //256MiB - 1
 
     QMqttControlPacket(const PacketType &controlPacketType);
+    virtual ~QMqttControlPacket();
 
     PacketType type() const;
 
-    //fixed header without remaining length field
-    QByteArray fixedHeader() const;
-    virtual QByteArray variableHeader() const = 0;
-    virtual QByteArray payload() const = 0;
+    //size of the variable header and the payload; -1 if it does not fit in an int32_t
+    int32_t remainingLength() const;
+    //size of the complete packet, including the fixed header; -1 if the packet is too big
+    int32_t encodedSize() const;
 
     QByteArray encode() const;
+    //appends the encoded packet to buffer; returns false if the packet is too big
+    bool encodeTo(QByteArray &buffer) const;
 
 protected:
     virtual uint8_t flags() const = 0;
+    virtual int32_t variableHeaderSize() const = 0;
+    virtual int32_t payloadSize() const = 0;
+    //write the variable header or payload to out, and return the position after the last byte written
+    virtual char *writeVariableHeader(char *out) const = 0;
+    virtual char *writePayload(char *out) const = 0;
 
 private:
     PacketType m_type;
@@ -89,31 +82,27 @@ public:
 
 protected:
     uint8_t flags() const Q_DECL_OVERRIDE;
-    QByteArray variableHeader() const Q_DECL_OVERRIDE;
-    QByteArray payload() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
 
 private:
-    QString m_userName;
+    //strings are kept UTF-8 encoded, so that the size of the packet is known before encoding
+    QByteArray m_userName;
     QByteArray m_password;
     QMqttWill m_will;
+    QByteArray m_willTopic;
     bool m_clean;
     uint16_t m_keepAlive;
-    QString m_clientIdentifier;
+    QByteArray m_clientIdentifier;
 };
 
 /**
  * @brief The PublishControlPacket class
- * Limitations:
- * ============
- * The PublishControlPacket currently does not support the dup flag.
+ * The packet is always encoded without the dup flag.
  * The `dup` flag is used to indicate a redelivered control packet when clean session is set
- * to false. The MQTT Client currently does not support sessions and hence does not redeliver
- * packets.
- * From the MQTT specification (4.4 Message delivery retry):
- * "Historically retransmission of Control Packets was required to overcome data loss on some
- * older TCP networks. This might remain a concern where MQTT 3.1.1 implementations
- * are to be deployed in such environments."
- * We assume that the MQTT client is deployed on state-of-the-art TCP networks.
+ * to false. Redelivered packets are sent from their persisted encoding, see markDuplicate().
  */
 class QTMQTT_AUTOTEST_EXPORT QMqttPublishControlPacket : public QMqttControlPacket
 {
@@ -130,9 +119,22 @@ public:
      */
     QMqttPublishControlPacket(const QString &topicName, const QByteArray &message,
                          QMqttProtocol::QoS qos, bool retain, uint16_t packetIdentifier = 0);
+    //constructs a packet to the given valid topic, of which the encoded name is copied as is
+    QMqttPublishControlPacket(const QMqttTopic &topic, const QByteArray &message,
+                              QMqttProtocol::QoS qos, bool retain, uint16_t packetIdentifier = 0);
+
+    //returns a copy of the given encoded PUBLISH packet with the dup flag set
+    static QByteArray markDuplicate(const QByteArray &encodedPacket);
+    //returns the QoS of the given encoded PUBLISH packet
+    static QMqttProtocol::QoS qos(const QByteArray &encodedPacket);
+    //overwrites the packet identifier of the given encoded QoS 1 or 2 PUBLISH packet, so that a
+    //packet can be encoded before its identifier is known
+    static void setPacketIdentifier(QByteArray &encodedPacket, uint16_t packetIdentifier);
 
 private:
-    const QString m_topicName;
+    const QByteArray m_topicName;   //UTF-8 encoded
+    //UTF-8 encoded and length prefixed, taken from a QMqttTopic; m_topicName is then empty
+    const QByteArray m_encodedTopicName;
     const QByteArray m_message;
     const bool m_dup;
     QMqttProtocol::QoS m_qos;
@@ -140,8 +142,10 @@ private:
     uint16_t m_packetIdentifier;
 
     uint8_t flags() const Q_DECL_OVERRIDE;
-    QByteArray variableHeader() const Q_DECL_OVERRIDE;
-    QByteArray payload() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
 };
 
 class QTMQTT_AUTOTEST_EXPORT QMqttPubAckControlPacket: public QMqttControlPacket
@@ -153,8 +157,10 @@ private:
     const uint16_t m_packetIdentifier;
 
     uint8_t flags() const Q_DECL_OVERRIDE;
-    QByteArray variableHeader() const Q_DECL_OVERRIDE;
-    QByteArray payload() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
 };
 
 class QTMQTT_AUTOTEST_EXPORT QMqttPubRecControlPacket: public QMqttControlPacket
@@ -166,8 +172,26 @@ private:
     const uint16_t m_packetIdentifier;
 
     uint8_t flags() const Q_DECL_OVERRIDE;
-    QByteArray variableHeader() const Q_DECL_OVERRIDE;
-    QByteArray payload() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
+};
+
+//second packet of the QoS 2 protocol exchange, sent in response to a PUBREC
+class QTMQTT_AUTOTEST_EXPORT QMqttPubRelControlPacket: public QMqttControlPacket
+{
+public:
+    QMqttPubRelControlPacket(uint16_t packetIdentifier);
+
+private:
+    const uint16_t m_packetIdentifier;
+
+    uint8_t flags() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
 };
 
 class QTMQTT_AUTOTEST_EXPORT QMqttPubCompControlPacket: public QMqttControlPacket
@@ -179,8 +203,10 @@ private:
     const uint16_t m_packetIdentifier;
 
     uint8_t flags() const Q_DECL_OVERRIDE;
-    QByteArray variableHeader() const Q_DECL_OVERRIDE;
-    QByteArray payload() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
 };
 
 typedef QPair<QString, QMqttProtocol::QoS> TopicFilter;
@@ -192,11 +218,13 @@ public:
 
 private:
     const uint16_t m_packetIdentifier;
-    const QVector<TopicFilter> m_topicFilters;
+    QVector<QPair<QByteArray, QMqttProtocol::QoS>> m_topicFilters;  //UTF-8 encoded topic filters
 
     uint8_t flags() const Q_DECL_OVERRIDE;
-    QByteArray variableHeader() const Q_DECL_OVERRIDE;
-    QByteArray payload() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
 };
 
 class QTMQTT_AUTOTEST_EXPORT QMqttUnsubscribeControlPacket: public QMqttControlPacket
@@ -206,11 +234,13 @@ public:
 
 private:
     const uint16_t m_packetIdentifier;
-    const QVector<QString> m_topics;
+    QVector<QByteArray> m_topics;   //UTF-8 encoded
 
     uint8_t flags() const Q_DECL_OVERRIDE;
-    QByteArray variableHeader() const Q_DECL_OVERRIDE;
-    QByteArray payload() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
 };
 
 class QTMQTT_AUTOTEST_EXPORT QMqttPingReqControlPacket: public QMqttControlPacket
@@ -220,8 +250,10 @@ public:
 
 private:
     uint8_t flags() const Q_DECL_OVERRIDE;
-    QByteArray variableHeader() const Q_DECL_OVERRIDE;
-    QByteArray payload() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
 };
 
 class QTMQTT_AUTOTEST_EXPORT QMqttDisconnectControlPacket: public QMqttControlPacket
@@ -231,6 +263,8 @@ public:
 
 private:
     uint8_t flags() const Q_DECL_OVERRIDE;
-    QByteArray variableHeader() const Q_DECL_OVERRIDE;
-    QByteArray payload() const Q_DECL_OVERRIDE;
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE;
+    int32_t payloadSize() const Q_DECL_OVERRIDE;
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE;
+    char *writePayload(char *out) const Q_DECL_OVERRIDE;
 };
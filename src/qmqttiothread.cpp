@@ -0,0 +1,466 @@
+#include "qmqttiothread_p.h"
+#include "qmqtttransport_p.h"
+#include "qmqttpacketparser_p.h"
+#include "qmqttcontrolpacket_p.h"
+#include "qmqttstatistics_p.h"
+#include <QCoreApplication>
+#include <QEvent>
+#include <QMutexLocker>
+#include "logging_p.h"
+
+LoggingModule("QMqttIoThread");
+
+namespace {
+
+//Calls a function on the thread of the object it is posted to.
+//QMetaObject::invokeMethod only accepts functors as of Qt 5.10.
+class CallEvent : public QEvent
+{
+public:
+    static QEvent::Type eventType()
+    {
+        static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+        return type;
+    }
+
+    explicit CallEvent(std::function<void()> f) :
+        QEvent(eventType()),
+        function(std::move(f))
+    {}
+
+    const std::function<void()> function;
+};
+
+}
+
+/*!
+    \class QMqttIoThread
+
+    \inmodule QtMqtt
+
+    \brief Runs the transport, packet parsing and keep-alive of a QMqttClient on a dedicated
+    thread.
+
+    The thread that owns the client only encodes packets and handles decoded ones. Encoded
+    packets are passed to the I/O thread with write(); decoded packets, connection events and
+    errors come back as Event values, taken with takeEvent() after eventsAvailable() was emitted.
+    Both directions use a QMqttSpscQueue, so that passing a packet neither locks nor allocates,
+    and a burst of packets costs a single wake-up of the other thread.
+
+    The keep-alive is handled entirely on the I/O thread, so that a busy owner thread does not
+    delay PINGREQ packets: a PINGREQ is sent when no packet was written during the ping interval,
+    and a PING_TIMEOUT event is posted when its PINGRESP does not arrive before the next one is
+    due.
+
+    \internal
+ */
+
+/*!
+  Creates and starts the I/O thread.
+  \a sslErrorsAllowed decides on the I/O thread whether SSL errors are ignored; it is called
+  while the transport is signalling them, as they can only be ignored at that moment.
+  The bytes sent and the bytes and packets received are counted in \a statistics.
+   \internal
+ */
+QMqttIoThread::QMqttIoThread(std::function<bool(const QList<QSslError> &)> sslErrorsAllowed,
+                             QMqttStatisticsPrivate *statistics) :
+    QObject(),
+    m_thread(),
+    m_sslErrorsAllowed(std::move(sslErrorsAllowed)),
+    m_statistics(statistics),
+    m_outbound(),
+    m_inbound(),
+    m_addressMutex(),
+    m_localAddress(),
+    m_localPort(0),
+    m_transport(nullptr),
+    m_packetParser(new QMqttPacketParser),
+    m_pingTimer(new QTimer(this)),
+    m_clock(),
+    m_pingSentAt(0),
+    m_pongReceived(true),
+    m_pingIntervalMs(0),
+    m_generation(0)
+{
+    Q_ASSERT(m_statistics);
+
+    m_clock.start();
+    m_packetParser->setParent(this);
+    m_packetParser->setStatistics(m_statistics);
+    makeParserConnections();
+    QObject::connect(m_pingTimer, &QTimer::timeout, this, &QMqttIoThread::sendPing);
+
+    m_thread.setObjectName(QStringLiteral("QMqttIoThread"));
+    moveToThread(&m_thread);
+    m_thread.start();
+}
+
+/*!
+  Aborts the connection, and stops the thread.
+   \internal
+ */
+QMqttIoThread::~QMqttIoThread()
+{
+    QCoreApplication::postEvent(this, new CallEvent([this]() {
+        releaseTransport();
+        //timers must be stopped on their own thread
+        delete m_pingTimer;
+        m_pingTimer = nullptr;
+        m_thread.quit();
+    }));
+    m_thread.wait();
+}
+
+/*!
+  Opens a new connection for \a request, of which all events carry \a generation.
+  The previous connection is dropped without further events.
+  \a lowDelay disables Nagle's algorithm where the transport allows it.
+   \internal
+ */
+void QMqttIoThread::open(const QMqttNetworkRequest &request, quint32 generation, bool lowDelay,
+                         int pingIntervalMs)
+{
+    QCoreApplication::postEvent(this, new CallEvent([this, request, generation, lowDelay, pingIntervalMs]() {
+        m_generation = generation;
+        m_pingIntervalMs = pingIntervalMs;
+        openTransport(request, lowDelay);
+    }));
+}
+
+/*!
+  Queues \a data to be written to the transport.
+  Data written while the transport is not connected is dropped, as it would be by a closed
+  socket.
+   \internal
+ */
+void QMqttIoThread::write(const QByteArray &data)
+{
+    if (m_outbound.push(data)) {
+        QMetaObject::invokeMethod(this, "writePending", Qt::QueuedConnection);
+    }
+}
+
+/*!
+  Closes the connection after all data that was written before is sent.
+   \internal
+ */
+void QMqttIoThread::close()
+{
+    QCoreApplication::postEvent(this, new CallEvent([this]() {
+        writePending();
+        m_pingTimer->stop();
+        if (m_transport) {
+            m_transport->close();
+        }
+    }));
+}
+
+/*!
+  Aborts the connection; data that was not sent yet is dropped.
+  The disconnection is reported as for close().
+   \internal
+ */
+void QMqttIoThread::abort()
+{
+    QCoreApplication::postEvent(this, new CallEvent([this]() {
+        discardPending();
+        m_pingTimer->stop();
+        if (m_transport) {
+            m_transport->abort();
+        }
+    }));
+}
+
+/*!
+  Moves the oldest pending event into \a event.
+  Returns false when there is none; eventsAvailable() is emitted when new events arrive.
+   \internal
+ */
+bool QMqttIoThread::takeEvent(Event &event)
+{
+    return m_inbound.pop(event);
+}
+
+/*!
+   \internal
+ */
+QHostAddress QMqttIoThread::localAddress() const
+{
+    QMutexLocker locker(&m_addressMutex);
+    return m_localAddress;
+}
+
+/*!
+   \internal
+ */
+quint16 QMqttIoThread::localPort() const
+{
+    QMutexLocker locker(&m_addressMutex);
+    return m_localPort;
+}
+
+/*!
+  Calls the functions posted to the I/O thread.
+   \internal
+ */
+void QMqttIoThread::customEvent(QEvent *event)
+{
+    if (event->type() == CallEvent::eventType()) {
+        static_cast<CallEvent *>(event)->function();
+    }
+}
+
+/*!
+  Writes all queued data to the transport, and restarts the keep-alive interval.
+   \internal
+ */
+void QMqttIoThread::writePending()
+{
+    const bool connected = m_transport
+            && m_transport->state() == QAbstractSocket::ConnectedState;
+    bool written = false;
+    QByteArray data;
+    while (m_outbound.pop(data)) {
+        if (connected) {
+            m_transport->write(data);
+            QMqttStatisticsPrivate::add(m_statistics->m_bytesSent, quint64(data.size()));
+            written = true;
+        }
+    }
+    if (written) {
+        m_statistics->m_transportBufferSize.store(m_transport->bytesToWrite(),
+                                                  std::memory_order_relaxed);
+        if (m_pingTimer->isActive()) {
+            m_pingTimer->start();  //restart the timer
+        }
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttIoThread::discardPending()
+{
+    QByteArray data;
+    while (m_outbound.pop(data)) {}
+}
+
+/*!
+   \internal
+ */
+void QMqttIoThread::openTransport(const QMqttNetworkRequest &request, bool lowDelay)
+{
+    releaseTransport();
+    //data written for the previous connection must not be sent on the new one
+    discardPending();
+
+    m_packetParser->reset();
+    m_pongReceived = true;
+    m_pingSentAt = 0;
+    m_transport = QMqttTransport::create(request.url());
+    m_transport->setParent(this);
+    m_transport->setLowDelay(lowDelay);
+    makeTransportConnections();
+    m_transport->open(request);
+}
+
+/*!
+  Drops the transport without reporting its disconnection.
+   \internal
+ */
+void QMqttIoThread::releaseTransport()
+{
+    if (m_pingTimer) {
+        m_pingTimer->stop();
+    }
+    if (!m_transport) {
+        return;
+    }
+    m_transport->disconnect();
+    m_transport->abort();
+    //deleted later, as this can be called from within one of its own signals
+    m_transport->deleteLater();
+    m_transport = nullptr;
+    m_statistics->m_transportBufferSize.store(0, std::memory_order_relaxed);
+    setLocalAddress(QHostAddress(), 0);
+}
+
+/*!
+   \internal
+ */
+void QMqttIoThread::makeParserConnections()
+{
+    QMqttPacketParser * const parser = m_packetParser;
+    QObject::connect(parser, &QMqttPacketParser::error,
+                     this, [this](QMqttProtocol::Error error, const QString &errorMessage) {
+        Event event;
+        event.kind = Event::Kind::PARSE_ERROR;
+        event.error = error;
+        event.errorMessage = errorMessage;
+        post(std::move(event));
+    });
+    QObject::connect(parser, &QMqttPacketParser::connack,
+                     this, [this](QMqttProtocol::Error error, bool sessionPresent) {
+        if (error == QMqttProtocol::Error::CONNECTION_ACCEPTED && m_pingIntervalMs > 0
+                && !m_pingTimer->isActive()) {
+            m_pingTimer->setSingleShot(false);
+            m_pingTimer->start(m_pingIntervalMs);
+        }
+        Event event;
+        event.kind = Event::Kind::CONNACK;
+        event.error = error;
+        event.sessionPresent = sessionPresent;
+        post(std::move(event));
+    });
+    QObject::connect(parser, &QMqttPacketParser::publish,
+                     this, [this](uint16_t packetIdentifier, const QMqttMessage &message) {
+        Event event;
+        event.kind = Event::Kind::PUBLISH;
+        event.packetIdentifier = packetIdentifier;
+        event.message = message;
+        post(std::move(event));
+    });
+    QObject::connect(parser, &QMqttPacketParser::suback,
+                     this, [this](uint16_t packetIdentifier, QVector<QMqttProtocol::QoS> qos) {
+        Event event;
+        event.kind = Event::Kind::SUBACK;
+        event.packetIdentifier = packetIdentifier;
+        event.grantedQos = qos;
+        post(std::move(event));
+    });
+
+    const auto acknowledgement = [this](Event::Kind kind) {
+        return [this, kind](uint16_t packetIdentifier) {
+            Event event;
+            event.kind = kind;
+            event.packetIdentifier = packetIdentifier;
+            post(std::move(event));
+        };
+    };
+    QObject::connect(parser, &QMqttPacketParser::puback, this, acknowledgement(Event::Kind::PUBACK));
+    QObject::connect(parser, &QMqttPacketParser::pubrec, this, acknowledgement(Event::Kind::PUBREC));
+    QObject::connect(parser, &QMqttPacketParser::pubrel, this, acknowledgement(Event::Kind::PUBREL));
+    QObject::connect(parser, &QMqttPacketParser::pubcomp, this, acknowledgement(Event::Kind::PUBCOMP));
+    QObject::connect(parser, &QMqttPacketParser::unsuback, this, acknowledgement(Event::Kind::UNSUBACK));
+
+    QObject::connect(parser, &QMqttPacketParser::pong, this, [this]() {
+        m_pongReceived = true;
+        Event event;
+        event.kind = Event::Kind::PINGRESP;
+        if (m_pingSentAt != 0) {
+            event.roundTripUs = (m_clock.nsecsElapsed() - m_pingSentAt) / 1000;
+        }
+        m_pingSentAt = 0;
+        post(std::move(event));
+    });
+}
+
+/*!
+   \internal
+ */
+void QMqttIoThread::makeTransportConnections()
+{
+    QMqttTransport * const transport = m_transport;
+
+    QObject::connect(transport, &QMqttTransport::connected, this, [this]() {
+        setLocalAddress(m_transport->localAddress(), m_transport->localPort());
+        post(Event::Kind::CONNECTED);
+    });
+    QObject::connect(transport, &QMqttTransport::disconnected, this, [this]() {
+        m_pingTimer->stop();
+        m_statistics->m_transportBufferSize.store(0, std::memory_order_relaxed);
+        setLocalAddress(QHostAddress(), 0);
+        post(Event::Kind::DISCONNECTED);
+    });
+    QObject::connect(transport, &QMqttTransport::sslErrors,
+                     this, [this](const QList<QSslError> &errors) {
+        if (m_sslErrorsAllowed(errors)) {
+            qCDebug(module) << "Ignoring SSL errors" << errors;
+            m_transport->ignoreSslErrors();
+            return;
+        }
+        Event event;
+        event.kind = Event::Kind::SSL_ERRORS;
+        event.sslErrors = errors;
+        post(std::move(event));
+    });
+    QObject::connect(transport, &QMqttTransport::error,
+                     this, [this](QAbstractSocket::SocketError error) {
+        Event event;
+        event.kind = Event::Kind::TRANSPORT_ERROR;
+        event.socketError = error;
+        event.errorMessage = m_transport->errorString();
+        post(std::move(event));
+    });
+    QObject::connect(transport, &QMqttTransport::protocolViolation,
+                     this, [this](const QString &errorMessage) {
+        Event event;
+        event.kind = Event::Kind::PROTOCOL_VIOLATION;
+        event.errorMessage = errorMessage;
+        post(std::move(event));
+    });
+    QObject::connect(transport, &QMqttTransport::dataReceived,
+                     m_packetParser, &QMqttPacketParser::parse);
+    QObject::connect(transport, &QMqttTransport::bytesWritten, this, [this]() {
+        m_statistics->m_transportBufferSize.store(m_transport->bytesToWrite(),
+                                                  std::memory_order_relaxed);
+    });
+}
+
+/*!
+  Sends a PINGREQ, or reports a timeout when the previous one was not answered.
+   \internal
+ */
+void QMqttIoThread::sendPing()
+{
+    if (!m_transport) {
+        return;
+    }
+    if (!m_pongReceived) {
+        qCDebug(module) << "Pong not received within expected time.";
+        m_pingTimer->stop();
+        post(Event::Kind::PING_TIMEOUT);
+        return;
+    }
+    qCDebug(module) << "Sending ping.";
+    m_pongReceived = false;
+    m_pingSentAt = qMax(Q_INT64_C(1), m_clock.nsecsElapsed());
+    //packets queued by the owner thread precede the ping
+    writePending();
+    const QByteArray packet = QMqttPingReqControlPacket().encode();
+    m_transport->write(packet);
+    m_statistics->packetSent(QMqttProtocol::PacketType::PINGREQ);
+    QMqttStatisticsPrivate::add(m_statistics->m_bytesSent, quint64(packet.size()));
+}
+
+/*!
+  Passes \a event to the owner thread, tagged with the current connection.
+   \internal
+ */
+void QMqttIoThread::post(Event &&event)
+{
+    event.generation = m_generation;
+    if (m_inbound.push(std::move(event))) {
+        Q_EMIT eventsAvailable();
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttIoThread::post(Event::Kind kind)
+{
+    Event event;
+    event.kind = kind;
+    post(std::move(event));
+}
+
+/*!
+   \internal
+ */
+void QMqttIoThread::setLocalAddress(const QHostAddress &address, quint16 port)
+{
+    QMutexLocker locker(&m_addressMutex);
+    m_localAddress = address;
+    m_localPort = port;
+}
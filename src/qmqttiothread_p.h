@@ -0,0 +1,145 @@
+#pragma once
+
+#include <QObject>
+#include <QThread>
+#include <QMutex>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QList>
+#include <QHostAddress>
+#include <QAbstractSocket>
+#include <QSslError>
+#include <functional>
+#include "qmqttprotocol.h"
+#include "qmqttspscqueue_p.h"
+#include "qmqttnetworkrequest.h"
+#include "qmqttmessage.h"
+#include "qmqtt_global.h"
+
+class QMqttTransport;
+class QMqttPacketParser;
+class QMqttStatisticsPrivate;
+
+//Runs the transport, the packet parser and the keep-alive of a client on a thread of its own.
+//The thread that owns the client hands encoded packets to the I/O thread through one
+//single-producer/single-consumer queue, and takes the decoded packets and connection events
+//from another one. Each queue wakes up its consumer once per burst of values.
+//Unless noted otherwise, the public functions must be called from the owner thread.
+class QTMQTT_AUTOTEST_EXPORT QMqttIoThread : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QMqttIoThread)
+
+public:
+    struct Event
+    {
+        enum class Kind : uint8_t
+        {
+            NONE,
+            CONNECTED,          //the transport is ready to send the CONNECT packet
+            DISCONNECTED,
+            TRANSPORT_ERROR,    //socketError, errorMessage
+            SSL_ERRORS,         //sslErrors that are not allowed
+            PROTOCOL_VIOLATION, //errorMessage
+            PARSE_ERROR,        //error, errorMessage
+            PING_TIMEOUT,
+            CONNACK,            //error, sessionPresent
+            PUBLISH,            //packetIdentifier, message
+            PUBACK,             //packetIdentifier
+            PUBREC,             //packetIdentifier
+            PUBREL,             //packetIdentifier
+            PUBCOMP,            //packetIdentifier
+            SUBACK,             //packetIdentifier, grantedQos
+            UNSUBACK,           //packetIdentifier
+            PINGRESP            //roundTripUs
+        };
+
+        Event() :
+            kind(Kind::NONE), generation(0),
+            error(QMqttProtocol::Error::CONNECTION_ACCEPTED), sessionPresent(false),
+            packetIdentifier(0), roundTripUs(-1), message(), grantedQos(),
+            socketError(QAbstractSocket::UnknownSocketError), sslErrors(), errorMessage()
+        {}
+
+        Kind kind;
+        quint32 generation;     //of the connection the event belongs to
+        QMqttProtocol::Error error;
+        bool sessionPresent;
+        uint16_t packetIdentifier;
+        qint64 roundTripUs;     //of a ping, or -1 when unknown
+        QMqttMessage message;
+        QVector<QMqttProtocol::QoS> grantedQos;
+        QAbstractSocket::SocketError socketError;
+        QList<QSslError> sslErrors;
+        QString errorMessage;
+    };
+
+    //sslErrorsAllowed is called on the I/O thread, and must be thread-safe;
+    //statistics counts the bytes sent and the bytes and packets received
+    QMqttIoThread(std::function<bool(const QList<QSslError> &)> sslErrorsAllowed,
+                  QMqttStatisticsPrivate *statistics);
+    virtual ~QMqttIoThread();
+
+    //opens a new connection, replacing the previous one; the events of the new connection carry
+    //the given generation. A keep-alive PINGREQ is sent when no packet was sent during
+    //pingIntervalMs after the connection was accepted; 0 disables keep-alive.
+    void open(const QMqttNetworkRequest &request, quint32 generation, bool lowDelay,
+              int pingIntervalMs);
+    //sends data after the data of previous calls
+    void write(const QByteArray &data);
+    //closes the connection after the data written before; a DISCONNECTED event follows
+    void close();
+    //aborts the connection, dropping data that was not sent yet; a DISCONNECTED event follows
+    void abort();
+
+    //takes the oldest pending event; eventsAvailable() is emitted again when this returned false
+    bool takeEvent(Event &event);
+
+    //can be called from any thread
+    QHostAddress localAddress() const;
+    quint16 localPort() const;
+
+protected:
+    void customEvent(QEvent *event) Q_DECL_OVERRIDE;
+
+Q_SIGNALS:
+    //emitted on the I/O thread when events become available after takeEvent() returned false
+    void eventsAvailable();
+
+private:
+    QThread m_thread;
+    const std::function<bool(const QList<QSslError> &)> m_sslErrorsAllowed;
+    QMqttStatisticsPrivate * const m_statistics;
+    QMqttSpscQueue<QByteArray> m_outbound;
+    QMqttSpscQueue<Event> m_inbound;
+    mutable QMutex m_addressMutex;
+    QHostAddress m_localAddress;
+    quint16 m_localPort;
+
+    //only used on the I/O thread
+    QMqttTransport *m_transport;
+    QMqttPacketParser *m_packetParser;
+    QTimer *m_pingTimer;
+    QElapsedTimer m_clock;
+    qint64 m_pingSentAt;
+    bool m_pongReceived;
+    int m_pingIntervalMs;
+    quint32 m_generation;
+
+private Q_SLOTS:
+    void writePending();
+
+private: //helpers, called on the I/O thread
+    void openTransport(const QMqttNetworkRequest &request, bool lowDelay);
+    void releaseTransport();
+    void discardPending();
+    void makeParserConnections();
+    void makeTransportConnections();
+    void sendPing();
+    void post(Event &&event);
+    void post(Event::Kind kind);
+    void setLocalAddress(const QHostAddress &address, quint16 port);
+};
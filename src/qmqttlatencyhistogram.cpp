@@ -0,0 +1,142 @@
+#include "qmqttlatencyhistogram_p.h"
+#include <QtAlgorithms>
+#include <cmath>
+
+/*!
+    \class QMqttLatencyHistogram
+
+    \inmodule QtMqtt
+
+    \brief Records latencies in log-linear buckets, and reports percentiles.
+
+    \internal
+ */
+
+/*!
+   \internal
+ */
+QMqttLatencyHistogram::QMqttLatencyHistogram() :
+    m_buckets(),
+    m_count(0),
+    m_minimum(-1),
+    m_maximum(-1)
+{
+    m_buckets.fill(0);
+}
+
+/*!
+  Records a latency of \a microseconds. Negative values are counted as 0.
+
+   \internal
+ */
+void QMqttLatencyHistogram::record(qint64 microseconds)
+{
+    microseconds = qMax(Q_INT64_C(0), microseconds);
+    ++m_buckets[size_t(bucketIndex(microseconds))];
+    if (m_count == 0 || microseconds < m_minimum) {
+        m_minimum = microseconds;
+    }
+    if (m_count == 0 || microseconds > m_maximum) {
+        m_maximum = microseconds;
+    }
+    ++m_count;
+}
+
+/*!
+   \internal
+ */
+void QMqttLatencyHistogram::reset()
+{
+    m_buckets.fill(0);
+    m_count = 0;
+    m_minimum = -1;
+    m_maximum = -1;
+}
+
+/*!
+   \internal
+ */
+quint64 QMqttLatencyHistogram::count() const
+{
+    return m_count;
+}
+
+/*!
+  Returns the smallest recorded value, or -1 if no values were recorded.
+
+   \internal
+ */
+qint64 QMqttLatencyHistogram::minimum() const
+{
+    return m_minimum;
+}
+
+/*!
+  Returns the largest recorded value, or -1 if no values were recorded.
+
+   \internal
+ */
+qint64 QMqttLatencyHistogram::maximum() const
+{
+    return m_maximum;
+}
+
+/*!
+  Returns the upper bound of the bucket that contains the value at the given \a percentile, e.g.
+  50 for the median or 99.9 for the 999th permille. The result is clamped to the recorded
+  maximum, and is -1 if no values were recorded.
+
+   \internal
+ */
+qint64 QMqttLatencyHistogram::percentile(double percentile) const
+{
+    if (m_count == 0) {
+        return -1;
+    }
+    percentile = qBound(0.0, percentile, 100.0);
+    //the rank of the value, counting from 1
+    const quint64 rank = qMax(Q_UINT64_C(1), quint64(std::ceil(percentile / 100.0 * double(m_count))));
+
+    quint64 seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += m_buckets[size_t(i)];
+        if (seen >= rank) {
+            return qBound(m_minimum, bucketUpperBound(i), m_maximum);
+        }
+    }
+    return m_maximum;
+}
+
+/*!
+  Returns the index of the bucket that counts the value \a microseconds.
+
+   \internal
+ */
+int QMqttLatencyHistogram::bucketIndex(qint64 microseconds)
+{
+    if (microseconds < SUB_BUCKET_COUNT) {
+        return int(qMax(Q_INT64_C(0), microseconds));
+    }
+    //exponent is the position of the highest set bit
+    const int exponent = 63 - int(qCountLeadingZeroBits(quint64(microseconds)));
+    if (exponent > MAXIMUM_EXPONENT) {
+        return BUCKET_COUNT - 1;
+    }
+    const int subBucket = int((quint64(microseconds) >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1));
+    return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT + subBucket;
+}
+
+/*!
+   \internal
+ */
+qint64 QMqttLatencyHistogram::bucketUpperBound(int index)
+{
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+    const int exponent = index / SUB_BUCKET_COUNT + SUB_BUCKET_BITS - 1;
+    const int subBucket = index % SUB_BUCKET_COUNT;
+    const int shift = exponent - SUB_BUCKET_BITS;
+    const qint64 lowerBound = qint64(SUB_BUCKET_COUNT + subBucket) << shift;
+    return lowerBound + (Q_INT64_C(1) << shift) - 1;
+}
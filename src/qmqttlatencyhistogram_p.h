@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include "qmqtt_global.h"
+
+//A histogram of latencies in microseconds with log-linear buckets.
+//Values below 16 have a bucket each; above, every power of two is split in 16 linear buckets,
+//so that the relative error of a reported percentile is at most 1/16 (6.25%).
+//Recording a value is a few shifts and an increment, and does not allocate.
+class QTMQTT_AUTOTEST_EXPORT QMqttLatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 4;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    //values up to 2^40 microseconds (about 12 days) are distinguished; larger values are clamped
+    static const int MAXIMUM_EXPONENT = 40;
+    static const int BUCKET_COUNT = (MAXIMUM_EXPONENT - SUB_BUCKET_BITS + 2) * SUB_BUCKET_COUNT;
+
+    QMqttLatencyHistogram();
+
+    void record(qint64 microseconds);
+    void reset();
+
+    quint64 count() const;
+    qint64 minimum() const;
+    qint64 maximum() const;
+    //returns the value below which the given percentile (0..100) of the recorded values are,
+    //or -1 if no values were recorded
+    qint64 percentile(double percentile) const;
+
+    static int bucketIndex(qint64 microseconds);
+    //highest value that is counted in the bucket with the given index
+    static qint64 bucketUpperBound(int index);
+
+private:
+    std::array<quint64, BUCKET_COUNT> m_buckets;
+    quint64 m_count;
+    qint64 m_minimum;
+    qint64 m_maximum;
+};
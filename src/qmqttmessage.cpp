@@ -0,0 +1,186 @@
+#include "qmqttmessage.h"
+#include "qmqtttopiccache_p.h"
+#include <cstring>
+
+/*!
+    \class QMqttMessage
+
+    \brief A message received by a QMqttClient.
+
+    A QMqttMessage does not hold copies of its topic name and payload. It shares the memory of
+    the frame it was received in, and refers to its topic name and payload within that frame.
+    Receiving a message therefore neither copies the payload nor decodes the topic name. The topic
+    name is decoded from UTF-8 when topic() is called for the first time; receivers that only
+    compare topic names can use hasTopic(), rawTopic() or topicHash(), which do not decode it at
+    all. QMqttClient shares the decoded topic names of frequent topics between messages, so that
+    topic() does not decode these either.
+
+    As a message shares the whole frame it was received in, a message that is kept for a long time
+    keeps the memory of that frame. Such messages should be stored as a copy of topic() and a
+    copy of the payload instead.
+
+    QMqttMessage is a value type; copying a message is cheap.
+ */
+
+/*!
+    Creates an invalid message, with an empty topic name and payload.
+ */
+QMqttMessage::QMqttMessage() :
+    m_frame(), m_topic(), m_topicHash(QMqttTopicCache::hash(nullptr, 0)), m_topicOffset(0),
+    m_topicSize(0), m_payloadOffset(0), m_payloadSize(0),
+    m_qos(QMqttProtocol::QoS::AT_MOST_ONCE), m_valid(false), m_retain(false), m_duplicate(false)
+{}
+
+/*!
+    Creates a message with the given \a topic, \a payload, \a qos and \a retain flag. This
+    constructor copies \a topic and \a payload, and is meant for tests and for code that feeds
+    its own messages to the receivers of QMqttClient::messageArrived().
+ */
+QMqttMessage::QMqttMessage(const QString &topic, const QByteArray &payload,
+                           QMqttProtocol::QoS qos, bool retain) :
+    m_frame(topic.toUtf8()), m_topic(topic), m_topicHash(0), m_topicOffset(0), m_topicSize(0),
+    m_payloadOffset(0), m_payloadSize(payload.size()), m_qos(qos), m_valid(true), m_retain(retain), m_duplicate(false)
+{
+    m_topicSize = m_frame.size();
+    m_topicHash = QMqttTopicCache::hash(m_frame.constData(), m_topicSize);
+    m_payloadOffset = m_topicSize;
+    m_frame.append(payload);
+}
+
+/*!
+   \internal
+   Creates a message that refers to the topic name of \a topicSize bytes at \a topicOffset and
+   the payload of \a payloadSize bytes at \a payloadOffset in \a frame.
+ */
+QMqttMessage::QMqttMessage(const QByteArray &frame, int topicOffset, int topicSize,
+                           int payloadOffset, int payloadSize,
+                           QMqttProtocol::QoS qos, bool retain, bool duplicate) :
+    m_frame(frame), m_topic(),
+    m_topicHash(QMqttTopicCache::hash(frame.constData() + topicOffset, topicSize)),
+    m_topicOffset(topicOffset), m_topicSize(topicSize),
+    m_payloadOffset(payloadOffset), m_payloadSize(payloadSize), m_qos(qos), m_valid(true),
+    m_retain(retain), m_duplicate(duplicate)
+{}
+
+/*!
+    Returns true if this is a received message, and false if it was default constructed.
+ */
+bool QMqttMessage::isValid() const
+{
+    return m_valid;
+}
+
+/*!
+    Returns the quality of service the message was delivered with.
+ */
+QMqttProtocol::QoS QMqttMessage::qos() const
+{
+    return m_qos;
+}
+
+/*!
+    Returns true if the message is a retained message that was sent because of a new
+    subscription.
+ */
+bool QMqttMessage::retain() const
+{
+    return m_retain;
+}
+
+/*!
+    Returns true if the server marked the message as a redelivery.
+ */
+bool QMqttMessage::isDuplicate() const
+{
+    return m_duplicate;
+}
+
+/*!
+    Returns the topic name of the message. The topic name is decoded on the first call only,
+    which is why topic() must not be called for the same message from several threads at once;
+    each thread should use its own copy of the message.
+
+    \sa rawTopic()
+ */
+QString QMqttMessage::topic() const
+{
+    if (m_topic.isNull() && (m_topicSize > 0)) {
+        m_topic = QString::fromUtf8(rawTopicData(), m_topicSize);
+    }
+    return m_topic;
+}
+
+/*!
+    Returns the UTF-8 encoded topic name of the message. The returned byte array does not copy
+    the topic name, and must not be used after the message is destroyed.
+
+    \sa topic(), hasTopic()
+ */
+QByteArray QMqttMessage::rawTopic() const
+{
+    return QByteArray::fromRawData(rawTopicData(), m_topicSize);
+}
+
+/*!
+    Returns a pointer to the rawTopicSize() bytes of the UTF-8 encoded topic name. The topic name
+    is not null-terminated.
+ */
+const char *QMqttMessage::rawTopicData() const
+{
+    return m_frame.constData() + m_topicOffset;
+}
+
+/*!
+    Returns the size of the UTF-8 encoded topic name in bytes.
+ */
+int QMqttMessage::rawTopicSize() const
+{
+    return m_topicSize;
+}
+
+/*!
+    Returns true if the topic name of the message equals the UTF-8 encoded \a rawTopic.
+    This is cheaper than comparing topic() to a QString, as the topic name is not decoded.
+ */
+bool QMqttMessage::hasTopic(const QByteArray &rawTopic) const
+{
+    return (rawTopic.size() == m_topicSize)
+            && (::memcmp(rawTopic.constData(), rawTopicData(), size_t(m_topicSize)) == 0);
+}
+
+/*!
+    Returns a hash of the topic name of the message. The hash is computed from the UTF-8 encoded
+    topic name with a fixed function (32-bit FNV-1a), so that it is the same in every process and
+    on every platform, and can be used to key per topic state by an integer. Different topic names
+    can have the same hash; hasTopic() tells them apart.
+ */
+quint32 QMqttMessage::topicHash() const
+{
+    return m_topicHash;
+}
+
+/*!
+    Returns the payload of the message. The returned byte array does not copy the payload, and
+    must not be used after the message is destroyed; use QByteArray(payloadData(), payloadSize())
+    to keep a copy.
+ */
+QByteArray QMqttMessage::payload() const
+{
+    return QByteArray::fromRawData(payloadData(), m_payloadSize);
+}
+
+/*!
+    Returns a pointer to the payloadSize() bytes of the payload.
+ */
+const char *QMqttMessage::payloadData() const
+{
+    return m_frame.constData() + m_payloadOffset;
+}
+
+/*!
+    Returns the size of the payload in bytes.
+ */
+int QMqttMessage::payloadSize() const
+{
+    return m_payloadSize;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QMetaType>
+#include "qmqttprotocol.h"
+#include "qmqtt_global.h"
+
+//A received message. It does not own copies of its topic name and payload, but refers to them
+//in the frame they were received in, so that receiving a message does not allocate.
+//The members are kept inline rather than behind a private pointer for the same reason.
+class QTMQTT_EXPORT QMqttMessage
+{
+public:
+    QMqttMessage();
+    QMqttMessage(const QString &topic, const QByteArray &payload,
+                 QMqttProtocol::QoS qos = QMqttProtocol::QoS::AT_MOST_ONCE, bool retain = false);
+
+    bool isValid() const;
+    QMqttProtocol::QoS qos() const;
+    bool retain() const;
+    bool isDuplicate() const;
+
+    QString topic() const;
+    QByteArray rawTopic() const;
+    const char *rawTopicData() const;
+    int rawTopicSize() const;
+    bool hasTopic(const QByteArray &rawTopic) const;
+    quint32 topicHash() const;
+
+    QByteArray payload() const;
+    const char *payloadData() const;
+    int payloadSize() const;
+
+private:
+    friend class QMqttPacketParser;
+    friend class QMqttTopicCache;
+
+    QMqttMessage(const QByteArray &frame, int topicOffset, int topicSize,
+                 int payloadOffset, int payloadSize,
+                 QMqttProtocol::QoS qos, bool retain, bool duplicate);
+
+    //shares the memory of the frame the message was received in
+    QByteArray m_frame;
+    //decoded on the first call of topic(), or taken from a QMqttTopicCache
+    mutable QString m_topic;
+    quint32 m_topicHash;
+    int m_topicOffset;
+    int m_topicSize;
+    int m_payloadOffset;
+    int m_payloadSize;
+    QMqttProtocol::QoS m_qos;
+    bool m_valid;
+    bool m_retain;
+    bool m_duplicate;
+};
+
+Q_DECLARE_METATYPE(QMqttMessage)
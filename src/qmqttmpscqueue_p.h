@@ -0,0 +1,164 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+#include <utility>
+
+//A bounded lock-free queue for any number of producer threads and exactly one consumer thread.
+//The values are stored in a ring of cells that each carry a sequence number, which tells
+//whether the cell is free for the producer that claimed it or holds a value for the consumer
+//(D. Vyukov's bounded queue). Producers only contend on claiming a position, with a single
+//compare-and-swap; pushing and popping do not allocate.
+//
+//Like QMqttSpscQueue, the queue coalesces wake-ups: a push() only asks to wake the consumer up
+//when the consumer found the queue empty since its last wake-up.
+template <typename T>
+class QMqttMpscQueue
+{
+    Q_DISABLE_COPY(QMqttMpscQueue)
+
+public:
+    //capacity is rounded up to a power of 2
+    explicit QMqttMpscQueue(int capacity);
+    ~QMqttMpscQueue();
+
+    int capacity() const;
+
+    //producers: moves value into the queue, and sets wakeUp to true if the consumer is idle and
+    //has to be woken up; returns false, leaving value untouched, when the queue is full
+    bool push(T &value, bool *wakeUp);
+    //consumer: takes the oldest value; returns false, and marks the consumer idle, when the
+    //queue is empty
+    bool pop(T &value);
+    //consumer: returns true if there is no value to pop
+    bool isEmpty() const;
+
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    Cell *m_cells;
+    const size_t m_mask;
+    alignas(64) std::atomic<size_t> m_pushPosition;
+    //only used by the consumer
+    alignas(64) size_t m_popPosition;
+    alignas(64) std::atomic<bool> m_consumerIdle;
+
+    static size_t roundedCapacity(int capacity);
+    bool take(T &value);
+};
+
+template <typename T>
+QMqttMpscQueue<T>::QMqttMpscQueue(int capacity) :
+    m_cells(new Cell[roundedCapacity(capacity)]),
+    m_mask(roundedCapacity(capacity) - 1),
+    m_pushPosition(0),
+    m_popPosition(0),
+    m_consumerIdle(true)
+{
+    for (size_t i = 0; i <= m_mask; ++i) {
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+QMqttMpscQueue<T>::~QMqttMpscQueue()
+{
+    delete[] m_cells;
+}
+
+template <typename T>
+int QMqttMpscQueue<T>::capacity() const
+{
+    return int(m_mask + 1);
+}
+
+template <typename T>
+bool QMqttMpscQueue<T>::push(T &value, bool *wakeUp)
+{
+    Q_ASSERT(wakeUp);
+
+    *wakeUp = false;
+    size_t position = m_pushPosition.load(std::memory_order_relaxed);
+    Cell *cell = nullptr;
+    for (;;) {
+        cell = &m_cells[position & m_mask];
+        const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        const qintptr difference = qintptr(sequence) - qintptr(position);
+        if (difference == 0) {
+            //the cell is free: claim it
+            if (m_pushPosition.compare_exchange_weak(position, position + 1,
+                                                     std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (difference < 0) {
+            //the consumer did not take the value of the previous round yet
+            return false;
+        } else {
+            //another producer claimed the cell first
+            position = m_pushPosition.load(std::memory_order_relaxed);
+        }
+    }
+    cell->value = std::move(value);
+    cell->sequence.store(position + 1, std::memory_order_release);
+
+    //pairs with the fence in pop(): either the consumer sees the value, or we see it idle
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    *wakeUp = m_consumerIdle.load(std::memory_order_relaxed)
+            && m_consumerIdle.exchange(false, std::memory_order_acq_rel);
+    return true;
+}
+
+template <typename T>
+bool QMqttMpscQueue<T>::pop(T &value)
+{
+    if (take(value)) {
+        return true;
+    }
+    m_consumerIdle.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    //a value published before the consumer became idle did not wake it up: take it back,
+    //unless a producer already saw the idle consumer and woke it up again
+    if (isEmpty() || !m_consumerIdle.exchange(false, std::memory_order_acq_rel)) {
+        return false;
+    }
+    return take(value);
+}
+
+template <typename T>
+bool QMqttMpscQueue<T>::isEmpty() const
+{
+    //a claimed cell whose value is not published yet counts as empty; its producer wakes the
+    //consumer up when it publishes the value
+    const Cell &cell = m_cells[m_popPosition & m_mask];
+    return cell.sequence.load(std::memory_order_acquire) != m_popPosition + 1;
+}
+
+template <typename T>
+size_t QMqttMpscQueue<T>::roundedCapacity(int capacity)
+{
+    size_t rounded = 2;
+    while (rounded < size_t(capacity)) {
+        rounded *= 2;
+    }
+    return rounded;
+}
+
+template <typename T>
+bool QMqttMpscQueue<T>::take(T &value)
+{
+    if (isEmpty()) {
+        return false;
+    }
+    Cell &cell = m_cells[m_popPosition & m_mask];
+    value = std::move(cell.value);
+    //release what the value holds now rather than when the cell is reused
+    cell.value = T();
+    //frees the cell for the push of the next round
+    cell.sequence.store(m_popPosition + m_mask + 1, std::memory_order_release);
+    ++m_popPosition;
+    return true;
+}
@@ -8,7 +8,7 @@
 
    \inmodule QtMqtt
 
-    \brief Implements a QNetworkRequest to be used for the MQTT protocol over WebSockets.
+    \brief Implements a QNetworkRequest to be used for the MQTT protocol.
 
     QMqttNetworkRequest inherits from QNetworkRequest and adds the mqtt http header to the
     request.
@@ -21,6 +21,9 @@
 
     The example above sets an extra "Authorization" header on the request.
 
+    Headers are only used for WebSocket connections (\c ws and \c wss urls); they are ignored
+    when connecting over plain TCP or TLS (\c mqtt and \c mqtts urls).
+
     \note QMqttNetworkRequest does not support querystrings. This is due to a limitation in
     the implementation of QWebSocket.
  */
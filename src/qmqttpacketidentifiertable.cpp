@@ -0,0 +1,250 @@
+#include "qmqttpacketidentifiertable_p.h"
+
+/*!
+    \class QMqttPacketIdentifierTable
+
+    \inmodule QtMqtt
+
+    \brief Allocates packet identifiers and keeps track of the requests awaiting acknowledgement.
+
+    \internal
+ */
+
+/*!
+   \internal
+ */
+QMqttPacketIdentifierTable::QMqttPacketIdentifierTable() :
+    m_slots(),
+    m_firstFree(0),
+    m_size(0)
+{}
+
+/*!
+   \internal
+ */
+QMqttPacketIdentifierTable::~QMqttPacketIdentifierTable()
+{}
+
+/*!
+  Returns an identifier that is not in use, and marks it as being used for the operation \a op
+  with callback \a cb.
+  Returns 0 if all 65535 identifiers are in use.
+
+   \internal
+ */
+uint16_t QMqttPacketIdentifierTable::acquire(Operation op, const std::function<void(bool)> &cb)
+{
+    Q_ASSERT(op != Operation::NONE);
+
+    uint16_t packetIdentifier = m_firstFree;
+    if (packetIdentifier != 0) {
+        m_firstFree = m_slots[packetIdentifier - 1].nextFree;
+    } else if (m_slots.size() < MAXIMUM_SIZE) {
+        m_slots.append(Slot());
+        packetIdentifier = uint16_t(m_slots.size());
+    } else {
+        return 0;
+    }
+    Slot &slot = m_slots[packetIdentifier - 1];
+    slot.op = op;
+    slot.nextFree = 0;
+    slot.timestamp = 0;
+    slot.cb = cb;
+    ++m_size;
+    return packetIdentifier;
+}
+
+/*!
+  Marks the given \a packetIdentifier as being used for the operation \a op with callback \a cb.
+  Returns false if \a packetIdentifier is 0 or already in use.
+  Unlike the other operations, this is O(n) in the number of free identifiers, as the identifier
+  has to be unlinked from the free list; it is meant for restoring the identifiers of a
+  persisted session.
+
+   \internal
+ */
+bool QMqttPacketIdentifierTable::acquire(uint16_t packetIdentifier, Operation op,
+                                         const std::function<void(bool)> &cb)
+{
+    Q_ASSERT(op != Operation::NONE);
+
+    if (packetIdentifier == 0 || contains(packetIdentifier)) {
+        return false;
+    }
+    //slots between the current end and packetIdentifier become free
+    while (m_slots.size() < packetIdentifier) {
+        m_slots.append(Slot());
+        m_slots.last().nextFree = m_firstFree;
+        m_firstFree = uint16_t(m_slots.size());
+    }
+    //unlink packetIdentifier from the free list
+    uint16_t *link = &m_firstFree;
+    while (*link != packetIdentifier) {
+        Q_ASSERT(*link != 0);
+        link = &m_slots[*link - 1].nextFree;
+    }
+    Slot &slot = m_slots[packetIdentifier - 1];
+    *link = slot.nextFree;
+    slot.op = op;
+    slot.nextFree = 0;
+    slot.timestamp = 0;
+    slot.cb = cb;
+    ++m_size;
+    return true;
+}
+
+/*!
+  Releases \a packetIdentifier if it is in use for the operation \a op, and moves its
+  callback into \a cb. Returns false, and leaves the table unchanged, if \a packetIdentifier is
+  not in use for \a op; this is the case for acknowledgements the client did not ask for.
+
+   \internal
+ */
+bool QMqttPacketIdentifierTable::release(uint16_t packetIdentifier, Operation op,
+                                         std::function<void(bool)> *cb)
+{
+    if (operation(packetIdentifier) != op || op == Operation::NONE) {
+        return false;
+    }
+    Slot &slot = m_slots[packetIdentifier - 1];
+    if (cb) {
+        *cb = std::move(slot.cb);
+    }
+    slot.cb = nullptr;
+    slot.op = Operation::NONE;
+    slot.nextFree = m_firstFree;
+    m_firstFree = packetIdentifier;
+    --m_size;
+    return true;
+}
+
+/*!
+  Changes the operation of \a packetIdentifier from \a from to \a to, keeping its callback.
+  Returns false if \a packetIdentifier is not in use for \a from.
+  This tracks the steps of the QoS 2 protocol exchange without releasing the identifier.
+
+   \internal
+ */
+bool QMqttPacketIdentifierTable::transition(uint16_t packetIdentifier, Operation from, Operation to)
+{
+    Q_ASSERT(to != Operation::NONE);
+
+    if (from == Operation::NONE || operation(packetIdentifier) != from) {
+        return false;
+    }
+    m_slots[packetIdentifier - 1].op = to;
+    return true;
+}
+
+/*!
+  Returns the operation \a packetIdentifier is used for, or Operation::NONE if it is free.
+
+   \internal
+ */
+QMqttPacketIdentifierTable::Operation QMqttPacketIdentifierTable::operation(uint16_t packetIdentifier) const
+{
+    if (packetIdentifier == 0 || packetIdentifier > m_slots.size()) {
+        return Operation::NONE;
+    }
+    return m_slots.at(packetIdentifier - 1).op;
+}
+
+/*!
+  Records \a timestamp as the time at which the packet with \a packetIdentifier was sent.
+  The timestamp is kept until the identifier is released; it is used to measure the time the
+  server takes to acknowledge the packet.
+  Does nothing if \a packetIdentifier is not in use.
+
+   \internal
+ */
+void QMqttPacketIdentifierTable::setTimestamp(uint16_t packetIdentifier, qint64 timestamp)
+{
+    if (contains(packetIdentifier)) {
+        m_slots[packetIdentifier - 1].timestamp = timestamp;
+    }
+}
+
+/*!
+  Returns the timestamp of \a packetIdentifier, or 0 if none was set or the identifier is not
+  in use.
+
+   \internal
+ */
+qint64 QMqttPacketIdentifierTable::timestamp(uint16_t packetIdentifier) const
+{
+    return contains(packetIdentifier) ? m_slots.at(packetIdentifier - 1).timestamp : 0;
+}
+
+/*!
+   \internal
+ */
+bool QMqttPacketIdentifierTable::contains(uint16_t packetIdentifier) const
+{
+    return operation(packetIdentifier) != Operation::NONE;
+}
+
+/*!
+  Releases all identifiers and returns the callbacks of the operations that were in progress,
+  in the order of their identifiers.
+
+   \internal
+ */
+QVector<std::function<void(bool)>> QMqttPacketIdentifierTable::takeAll()
+{
+    QVector<std::function<void(bool)>> callbacks;
+    callbacks.reserve(m_size);
+    for (Slot &slot : m_slots) {
+        if (slot.op != Operation::NONE) {
+            callbacks.append(std::move(slot.cb));
+        }
+    }
+    m_slots.clear();
+    m_firstFree = 0;
+    m_size = 0;
+    return callbacks;
+}
+
+/*!
+  Releases all identifiers that are in use for the operation \a op, and returns their callbacks
+  in the order of their identifiers.
+
+   \internal
+ */
+QVector<std::function<void(bool)>> QMqttPacketIdentifierTable::takeAll(Operation op)
+{
+    QVector<std::function<void(bool)>> callbacks;
+    for (int i = 0; i < m_slots.size(); ++i) {
+        if (m_slots.at(i).op == op) {
+            std::function<void(bool)> cb;
+            release(uint16_t(i + 1), op, &cb);
+            callbacks.append(std::move(cb));
+        }
+    }
+    return callbacks;
+}
+
+/*!
+  Returns the number of identifiers in use.
+
+   \internal
+ */
+int QMqttPacketIdentifierTable::size() const
+{
+    return m_size;
+}
+
+/*!
+   \internal
+ */
+bool QMqttPacketIdentifierTable::isEmpty() const
+{
+    return m_size == 0;
+}
+
+/*!
+   \internal
+ */
+bool QMqttPacketIdentifierTable::isFull() const
+{
+    return m_size == MAXIMUM_SIZE;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QVector>
+#include <functional>
+#include "qmqtt_global.h"
+
+//Allocates packet identifiers and keeps the callback of every request that awaits an
+//acknowledgement from the server.
+//Identifiers are in the range 1..65535 (see 2.3.1 Packet Identifier) and are never handed out
+//while they are still in use. A slot is kept per identifier, in a vector that grows up to the
+//highest identifier that was needed; released identifiers are kept in a free list, so that
+//acquiring, looking up and releasing an identifier are O(1) and do not allocate.
+class QTMQTT_AUTOTEST_EXPORT QMqttPacketIdentifierTable
+{
+    Q_DISABLE_COPY(QMqttPacketIdentifierTable)
+
+public:
+    enum class Operation : uint8_t
+    {
+        NONE = 0,       //slot is free
+        SUBSCRIBE,
+        UNSUBSCRIBE,
+        PUBLISH,                //QoS 1 publish, awaiting PUBACK
+        PUBLISH_EXACTLY_ONCE,   //QoS 2 publish, awaiting PUBREC
+        PUBLISH_RELEASED        //QoS 2 publish, PUBREL sent, awaiting PUBCOMP
+    };
+
+    static const int MAXIMUM_SIZE = 65535;
+
+    QMqttPacketIdentifierTable();
+    ~QMqttPacketIdentifierTable();
+
+    //returns a free identifier for op, or 0 when all identifiers are in use
+    uint16_t acquire(Operation op, const std::function<void(bool)> &cb);
+    //marks the given packetIdentifier as used for op, e.g. for a message recovered from a
+    //session store; returns false if it is already in use
+    bool acquire(uint16_t packetIdentifier, Operation op, const std::function<void(bool)> &cb);
+    //releases packetIdentifier if it is in use for op, and moves its callback into cb
+    bool release(uint16_t packetIdentifier, Operation op, std::function<void(bool)> *cb);
+    //moves packetIdentifier from operation from to operation to, keeping its callback
+    bool transition(uint16_t packetIdentifier, Operation from, Operation to);
+    Operation operation(uint16_t packetIdentifier) const;
+    //time at which the packet with packetIdentifier was sent, as set by setTimestamp();
+    //0 if it is not known
+    void setTimestamp(uint16_t packetIdentifier, qint64 timestamp);
+    qint64 timestamp(uint16_t packetIdentifier) const;
+    bool contains(uint16_t packetIdentifier) const;
+    //releases all identifiers and returns their callbacks
+    QVector<std::function<void(bool)>> takeAll();
+    //releases all identifiers that are in use for op and returns their callbacks
+    QVector<std::function<void(bool)>> takeAll(Operation op);
+
+    int size() const;
+    bool isEmpty() const;
+    bool isFull() const;
+
+private:
+    struct Slot
+    {
+        Slot() : op(Operation::NONE), nextFree(0), timestamp(0), cb() {}
+
+        Operation op;
+        uint16_t nextFree;          //identifier of the next free slot, 0 terminates the list
+        qint64 timestamp;
+        std::function<void(bool)> cb;
+    };
+
+    QVector<Slot> m_slots;          //slot of identifier i is at index i - 1
+    uint16_t m_firstFree;
+    int m_size;
+};
@@ -1,8 +1,8 @@
 #include "qmqttprotocol.h"
 #include "qmqttcontrolpacket_p.h"
 #include "qmqttpacketparser_p.h"
+#include "qmqttstatistics_p.h"
 
-#include <QBuffer>
 #include <QtEndian>
 #include <QByteArray>
 #include <QDebug>
@@ -12,6 +12,18 @@
 
 LoggingModule("QMqttPacketParser");
 
+//helper methods
+inline uint16_t readUint16(const char *data) Q_DECL_NOEXCEPT
+{
+    return qFromBigEndian<quint16>(reinterpret_cast<const uchar *>(data));
+}
+
+/*!
+  \internal
+  A view on a single MQTT packet inside a received frame.
+  The packet does not copy the bytes of the frame, but keeps a (shallow, implicitly shared)
+  reference to it, and locates the payload through an offset.
+ */
 class MQTTPacket
 {
 public:
@@ -23,39 +35,53 @@ public:
     QMqttProtocol::Error error() const { return m_error; }
     QString errorString() const { return m_errorString; }
     bool isValid() const { return m_isValid; }
+    bool isComplete() const { return m_isComplete; }
     QMqttControlPacket::PacketType packetType() const { return m_packetType; }
     bool retain() const { return m_retain; }
     bool dup() const { return m_dup; }
     QMqttProtocol::QoS qos() const { return m_qos; }
     uint8_t flags() const { return m_flags; }
     int32_t remainingLength() const { return m_remainingLength; }
-    QByteArray payload() const { return m_payload; }
+    //total number of bytes occupied by the packet: fixed header, length field and payload
+    int32_t size() const { return m_size; }
+    //the frame the packet was read from
+    const QByteArray &frame() const { return m_frame; }
+    //offset of the variable header and payload within frame()
+    int payloadOffset() const { return m_payloadOffset; }
+    //points to remainingLength() bytes of variable header and payload
+    const char *payload() const { return m_frame.constData() + m_payloadOffset; }
 
-    static MQTTPacket readPacket(const QByteArray &data);
+    static MQTTPacket readPacket(const QByteArray &data, int offset);
 
 private:
     QMqttProtocol::Error m_error;
     QString m_errorString;
     bool m_isValid;
+    bool m_isComplete;
     QMqttControlPacket::PacketType m_packetType;
     bool m_retain;
     bool m_dup;
     QMqttProtocol::QoS m_qos;
     uint8_t m_flags;
     int32_t m_remainingLength;
-    QByteArray m_payload;
+    int32_t m_size;
+    QByteArray m_frame;
+    int m_payloadOffset;
 
     void clear() {
         m_error = QMqttProtocol::Error::OK;
         m_errorString.clear();
         m_isValid = false;
+        m_isComplete = true;
         m_packetType = QMqttControlPacket::PacketType::RESERVED_0;
         m_retain = false;
         m_dup = false;
         m_qos = QMqttProtocol::QoS::AT_MOST_ONCE;
         m_flags = 0;
         m_remainingLength = 0;
-        m_payload.clear();
+        m_size = 0;
+        m_frame.clear();
+        m_payloadOffset = 0;
     }
 
     void setError(QMqttProtocol::Error error, const QString &errorString) {
@@ -65,91 +91,101 @@ private:
         m_isValid = false;
     }
 
-    static bool parseHeader(QBuffer &buffer, MQTTPacket &packet);
-    static bool parseRemainingLength(QBuffer &buffer, MQTTPacket &packet);
+    void setIncomplete() {
+        clear();
+        m_isComplete = false;
+    }
+
+    bool parseHeader(uint8_t header);
+    bool parseRemainingLength(const char *data, int available, int *lengthFieldSize);
 };
 
-MQTTPacket MQTTPacket::readPacket(const QByteArray &data)
+/*!
+  Reads the packet starting at \a offset in \a data.
+  When \a data does not yet contain all bytes of the packet, the returned packet is marked as
+  incomplete. Any bytes following the packet are left untouched; size() tells how many bytes
+  were consumed.
+  No bytes are copied: the returned packet refers to \a data.
+  \internal
+ */
+MQTTPacket MQTTPacket::readPacket(const QByteArray &data, int offset)
 {
     MQTTPacket packet;
 
-    QByteArray frameData(data);
-    QBuffer buffer(&frameData);
-    //TODO: check on open error
-    buffer.open(QIODevice::ReadOnly);
-
-    if (parseHeader(buffer, packet) && parseRemainingLength(buffer, packet)) {
-        if (buffer.bytesAvailable() >= packet.remainingLength()) {
-            packet.m_payload = buffer.read(packet.remainingLength());
-            //TODO: check if packet.m_payload.size() == packet.remainingLength()
+    const int available = data.size() - offset;
+    if (available < 1) {
+        packet.setIncomplete();
+        return packet;
+    }
+    const char * const begin = data.constData() + offset;
+
+    int lengthFieldSize = 0;
+    if (packet.parseHeader(uint8_t(begin[0]))
+            && packet.parseRemainingLength(begin + 1, available - 1, &lengthFieldSize)) {
+        const int headerSize = 1 + lengthFieldSize;
+        if (available - headerSize >= packet.remainingLength()) {
+            packet.m_frame = data;
+            packet.m_payloadOffset = offset + headerSize;
+            packet.m_size = headerSize + packet.remainingLength();
             packet.m_isValid = true;
         } else {
-            packet.setError(QMqttProtocol::Error::INVALID_PACKET,
-                            QStringLiteral("Payload of packet is too small"));
+            packet.setIncomplete();
         }
     }
 
-    buffer.close();
-
     return packet;
 }
 
-bool MQTTPacket::parseHeader(QBuffer &buffer, MQTTPacket &packet)
+bool MQTTPacket::parseHeader(uint8_t header)
 {
-    if (buffer.bytesAvailable() < 1) {
-        packet.setError(QMqttProtocol::Error::INVALID_PACKET,
-                        QStringLiteral("Packet is empty"));
+    m_packetType = QMqttControlPacket::PacketType(header >> 4);
+    if ((m_packetType == QMqttControlPacket::PacketType::RESERVED_0)
+            || (m_packetType >= QMqttControlPacket::PacketType::RESERVED_15)) {
+        setError(QMqttProtocol::Error::INVALID_PACKET,
+                 QStringLiteral("Invalid command detected %1").arg(uint8_t(m_packetType)));
         return false;
     }
-
-    uint8_t header = 0;
-    //TODO: check on read error
-    buffer.read((char *)&header, sizeof(header));
-
-    packet.m_packetType = QMqttControlPacket::PacketType(header >> 4);
-    if ((packet.m_packetType == QMqttControlPacket::PacketType::RESERVED_0)
-            || (packet.m_packetType >= QMqttControlPacket::PacketType::RESERVED_15)) {
-        packet.setError(QMqttProtocol::Error::INVALID_PACKET,
-                        QStringLiteral("Invalid command detected %1").arg(uint8_t(packet.m_packetType)));
-        return false;
-    }
-    packet.m_flags = header & 0x0F;
-    packet.m_retain = bool(packet.m_flags & 0x01);
-    const uint8_t qos = (packet.m_flags & 0x06) >> 1;
-    packet.m_dup = bool((packet.m_flags & 0x08) >> 3);
+    m_flags = header & 0x0F;
+    m_retain = bool(m_flags & 0x01);
+    const uint8_t qos = (m_flags & 0x06) >> 1;
+    m_dup = bool((m_flags & 0x08) >> 3);
 
     if (qos > 2) { //possible values are 0, 1, 2
-        packet.setError(QMqttProtocol::Error::INVALID_PACKET,
-                        QStringLiteral("Invalid qos value detected %1").arg(qos));
+        setError(QMqttProtocol::Error::INVALID_PACKET,
+                 QStringLiteral("Invalid qos value detected %1").arg(qos));
         return false;
     }
-    packet.m_qos = QMqttProtocol::QoS(qos);
+    m_qos = QMqttProtocol::QoS(qos);
 
     return true;
 }
 
-bool MQTTPacket::parseRemainingLength(QBuffer &buffer, MQTTPacket &packet)
+bool MQTTPacket::parseRemainingLength(const char *data, int available, int *lengthFieldSize)
 {
-    uint8_t current = 0;
     int count = 0;
     int32_t length = 0;
     int32_t multiplier = 1;
 
-    while (count < 5) {
-        if (buffer.bytesAvailable() < 1) {
-            packet.setError(QMqttProtocol::Error::INVALID_PACKET,
-                            QStringLiteral("Packet does not contain complete length field"));
+    //see 2.2.3 Remaining Length: the length field is at most 4 bytes long
+    while (true) {
+        if (count == 4) {
+            setError(QMqttProtocol::Error::INVALID_PACKET,
+                     QStringLiteral("Remaining length field is longer than 4 bytes"));
             return false;
         }
-        //TODO: check for read errors
-        buffer.read((char *)&current, sizeof(uint8_t));
+        if (count == available) {
+            setIncomplete();
+            return false;
+        }
+        const uint8_t current = uint8_t(data[count++]);
         length += multiplier * (current & 0x7F);
         multiplier *= 0x80;
 
         if ((current & 0x80) == 0) break;
     }
 
-    packet.m_remainingLength = length;
+    m_remainingLength = length;
+    *lengthFieldSize = count;
 
     return true;
 }
@@ -167,22 +203,100 @@ inline typename QtPrivate::QEnableIf<!QtPrivate::IsQEnumHelper<T>::Value, QStrin
     return Q_NULLPTR;
 }
 
-QMqttPacketParser::QMqttPacketParser()
+QMqttPacketParser::QMqttPacketParser() :
+    QObject(),
+    m_buffer(),
+    m_statistics(nullptr)
 {
 }
 
-void QMqttPacketParser::parse(const QByteArray &packet)
+/*!
+  Counts the received bytes, packets and parse errors in \a statistics, which must outlive the
+  parser. Passing nullptr stops counting.
+ */
+void QMqttPacketParser::setStatistics(QMqttStatisticsPrivate *statistics)
 {
-    const MQTTPacket mqttPacket = MQTTPacket::readPacket(packet);
-    if (Q_UNLIKELY(!mqttPacket.isValid())) {
-        const QString errorMessage = QStringLiteral("Error reading packet: %1 (%2).")
-                .arg(toString(mqttPacket.error()))
-                .arg(mqttPacket.errorString());
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
-        return;
+    m_statistics = statistics;
+}
+
+/*!
+  Feeds the bytes in \a data to the parser.
+  \a data can contain any number of complete MQTT packets, possibly followed by the first part
+  of a packet whose remaining bytes will be delivered by a subsequent call. All complete packets
+  are parsed and signalled in order; incomplete packets are kept until the rest arrives.
+  When an invalid packet is encountered, an error() is emitted and all buffered data is
+  discarded, as the byte stream cannot be resynchronized.
+
+  \sa reset()
+ */
+void QMqttPacketParser::parse(const QByteArray &data)
+{
+    parse(data, m_buffer);
+}
+
+/*!
+  Feeds the bytes in \a data to the parser, like parse(), but keeps the first part of an
+  incomplete packet in \a buffer rather than in the parser.
+  A parser that is shared by several connections is called with the buffer of the connection
+  that received \a data; reset() does not apply to \a buffer.
+ */
+void QMqttPacketParser::parse(const QByteArray &data, QByteArray &buffer)
+{
+    if (m_statistics) {
+        QMqttStatisticsPrivate::add(m_statistics->m_bytesReceived, quint64(data.size()));
+    }
+    //when no partial packet is pending, parse straight from data, without copying it
+    QByteArray frame;
+    if (buffer.isEmpty()) {
+        frame = data;
+    } else {
+        buffer.append(data);
+        frame.swap(buffer);
+    }
+
+    int offset = 0;
+    while (offset < frame.size()) {
+        const MQTTPacket mqttPacket = MQTTPacket::readPacket(frame, offset);
+        if (!mqttPacket.isComplete()) {
+            //keep only the bytes of the incomplete packet
+            buffer = (offset == 0) ? frame : frame.mid(offset);
+            return;
+        }
+        if (Q_UNLIKELY(!mqttPacket.isValid())) {
+            const QString errorMessage = QStringLiteral("Error reading packet: %1 (%2).")
+                    .arg(toString(mqttPacket.error()))
+                    .arg(mqttPacket.errorString());
+            reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+            return;
+        }
+        offset += mqttPacket.size();
+        if (m_statistics) {
+            m_statistics->packetReceived(mqttPacket.packetType());
+        }
+        parsePacket(mqttPacket);
+    }
+}
+
+/*!
+  Discards any partially received packet.
+  Must be called whenever a new connection is set up.
+ */
+void QMqttPacketParser::reset()
+{
+    m_buffer.clear();
+}
+
+void QMqttPacketParser::reportError(QMqttProtocol::Error errorCode, const QString &errorMessage)
+{
+    qCWarning(module) << errorMessage;
+    if (m_statistics) {
+        m_statistics->parseError(errorCode);
     }
+    Q_EMIT error(errorCode, errorMessage);
+}
 
+void QMqttPacketParser::parsePacket(const MQTTPacket &mqttPacket)
+{
     switch (mqttPacket.packetType()) {
         case QMqttControlPacket::PacketType::CONNACK: {
             parseCONNACK(mqttPacket);
@@ -218,9 +332,13 @@ void QMqttPacketParser::parse(const QByteArray &packet)
             break;
         }
 
-        case QMqttControlPacket::PacketType::PUBREC:
+        case QMqttControlPacket::PacketType::PUBREC: {
+            parsePUBREC(mqttPacket);
+            break;
+        }
+
         case QMqttControlPacket::PacketType::PUBCOMP: {
-            qCWarning(module) << "PUBREC and PUBCOMP is not supported currently.";
+            parsePUBCOMP(mqttPacket);
             break;
         }
 
@@ -245,11 +363,10 @@ void QMqttPacketParser::parseCONNACK(const MQTTPacket &packet)
 {
     if (packet.remainingLength() != 2) {
         const QString errorMessage = QStringLiteral("Invalid CONNACK packet received");
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
         return;
     }
-    const QByteArray payload = packet.payload();
+    const char * const payload = packet.payload();
     const uint8_t connectAcknowledgeFlags = payload[0];
     const uint8_t connectReturnCode = payload[1];
 
@@ -257,8 +374,7 @@ void QMqttPacketParser::parseCONNACK(const MQTTPacket &packet)
         const QString errorMessage =
                 QStringLiteral("Invalid acknowledge flags detected: %1. Upper 7 bits must be zero.")
                 .arg(connectAcknowledgeFlags);
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
         return;
     }
     const bool sessionPresent = bool(connectAcknowledgeFlags & 0x01);
@@ -266,8 +382,7 @@ void QMqttPacketParser::parseCONNACK(const MQTTPacket &packet)
     if (connectReturnCode > 5) {
         const QString errorMessage =
                 QStringLiteral("Invalid return code detected: %1.").arg(connectReturnCode);
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
         return;
     }
 
@@ -278,152 +393,94 @@ void QMqttPacketParser::parseSUBACK(const MQTTPacket &packet)
 {
     if (packet.remainingLength() < 2) {
         const QString errorMessage = QStringLiteral("Invalid SUBACK packet received");
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
         return;
     }
-    const QByteArray payload = packet.payload();
-    const uint16_t packetIdentifier = (uint16_t(payload[0]) * 256) + uint8_t(payload[1]); //big endian
-    QVector<QMqttProtocol::QoS> qos;
+    const char * const payload = packet.payload();
+    const uint16_t packetIdentifier = readUint16(payload);
 
-    int remainingSize = payload.size() - 2;
-    while (remainingSize > 0) {
-        const uint8_t returnCode = payload[--remainingSize + 2];
+    //one return code per topic filter of the SUBSCRIBE packet, in the same order
+    const int returnCodeCount = packet.remainingLength() - 2;
+    QVector<QMqttProtocol::QoS> qos;
+    qos.reserve(returnCodeCount);
+    for (int i = 0; i < returnCodeCount; ++i) {
+        const uint8_t returnCode = uint8_t(payload[2 + i]);
         if (returnCode == 0x80) {
-            qos.prepend(QMqttProtocol::QoS::INVALID);
+            qos.append(QMqttProtocol::QoS::INVALID);
         } else {
             if (returnCode > 2) {
                 const QString errorMessage =
                         QStringLiteral("Invalid return code detected in SUBACK packet: %1")
                         .arg(returnCode);
-                qCWarning(module) << errorMessage;
-                Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+                reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
                 return;
             }
-            qos.prepend(QMqttProtocol::QoS(returnCode));
+            qos.append(QMqttProtocol::QoS(returnCode));
         }
     }
     Q_EMIT suback(packetIdentifier, qos);
 }
 
+/*!
+  Decodes the PUBLISH \a packet directly from the received frame.
+  The emitted QMqttMessage shares the frame and refers to the topic name and the payload within
+  it, so that nothing is copied or decoded; receivers decode the topic name when they need it.
+ */
 void QMqttPacketParser::parsePUBLISH(const MQTTPacket &packet)
 {
     if (packet.remainingLength() <  2) {
         const QString errorMessage = QStringLiteral("Invalid PUBLISH packet received");
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
         return;
     }
-    QByteArray payload = packet.payload();
-    QBuffer buffer(&payload);
+    const char * const payload = packet.payload();
+    const int32_t payloadLength = packet.remainingLength();
 
-    if (!buffer.open(QIODevice::ReadOnly)) {
-        const QString errorMessage
-                = QStringLiteral("Error opening read buffer: %1")
-                .arg(buffer.errorString());
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::PARSE_ERROR, errorMessage);
-        return;
-    }
-
-    int variableHeaderLength = 0;
-
-    uint16_t topicNameLength;
-    const qint64 bytesRead =
-            buffer.read(static_cast<char *>(static_cast<void *>(&topicNameLength)),
-                        sizeof(uint16_t));
-    if (bytesRead != sizeof(uint16_t)) {
-        const QString errorMessage
-                = QStringLiteral("Error reading from packet buffer. Bytes read = %1 <> 2")
-                .arg(bytesRead);
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::PARSE_ERROR, errorMessage);
-        return;
-    }
-    topicNameLength = qFromBigEndian(topicNameLength);
-    variableHeaderLength += 2;
-
-    if (buffer.bytesAvailable() < topicNameLength) {
+    const uint16_t topicNameLength = readUint16(payload);
+    int32_t variableHeaderLength = 2 + topicNameLength;
+    if (payloadLength < variableHeaderLength) {
         const QString errorMessage
                 = QStringLiteral("Invalid PUBLISH packet received. Invalid topic name.");
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
-        return;
-    }
-    variableHeaderLength += topicNameLength;
-    const QString topicName = QString::fromUtf8(buffer.read(topicNameLength));
-    if (topicName.length() != topicNameLength) {
-        const QString errorMessage
-                = QStringLiteral("Error reading from packet buffer. Bytes read = %1 <> %2")
-                .arg(bytesRead).arg(topicNameLength);
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::PARSE_ERROR, errorMessage);
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
         return;
     }
 
     uint16_t packetIdentifier = 0;
 
     if (packet.qos() != QMqttProtocol::QoS::AT_MOST_ONCE) {
-        if (packet.remainingLength() <  2) {
+        if (payloadLength < variableHeaderLength + 2) {
             const QString errorMessage
                     = QStringLiteral("Invalid PUBLISH packet received. No packet identifier.");
-            qCWarning(module) << errorMessage;
-            Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
-            return;
-        }
-
-        const qint64 bytesRead =
-                buffer.read(static_cast<char *>(static_cast<void *>(&packetIdentifier)),
-                            sizeof(uint16_t));
-        if (bytesRead != sizeof(uint16_t)) {
-            const QString errorMessage
-                    = QStringLiteral("Error reading from packet buffer. Bytes read = %1 <> 2")
-                    .arg(bytesRead);
-            qCWarning(module) << errorMessage;
-            Q_EMIT error(QMqttProtocol::Error::PARSE_ERROR, errorMessage);
+            reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
             return;
         }
-        packetIdentifier = qFromBigEndian(packetIdentifier);
-
+        packetIdentifier = readUint16(payload + variableHeaderLength);
         variableHeaderLength += 2;
     }
 
-    const int32_t messageLength = packet.remainingLength() - variableHeaderLength;
-    if (buffer.bytesAvailable() != messageLength) {
-        const QString errorMessage
-                = QStringLiteral("Invalid PUBLISH packet received. Payload too small.");
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
-        return;
-    }
-    const QByteArray message = buffer.read(messageLength);
-    if (message.size() != messageLength) {
-        const QString errorMessage = QStringLiteral("Error reading message: %1.").arg(buffer.errorString());
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::PARSE_ERROR, errorMessage);
-        return;
-    }
+    //neither the topic name nor the payload are copied out of the frame
+    const int32_t messageLength = payloadLength - variableHeaderLength;
+    const QMqttMessage message(packet.frame(), packet.payloadOffset() + 2, topicNameLength,
+                               packet.payloadOffset() + variableHeaderLength, messageLength,
+                               packet.qos(), packet.retain(), packet.dup());
 
-    Q_EMIT publish(packet.qos(), packetIdentifier, topicName, message);
+    Q_EMIT publish(packetIdentifier, message);
 }
 
 void QMqttPacketParser::parsePUBREL(const MQTTPacket &packet)
 {
     if (packet.remainingLength() < 2) {
         const QString errorMessage = QStringLiteral("Invalid PUBREL packet received");
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
         return;
     }
     if (packet.flags() != 0x02) {
         const QString errorMessage = QStringLiteral("Invalid flags in PUBREL packet.");
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::PROTOCOL_VIOLATION, errorMessage);
+        reportError(QMqttProtocol::Error::PROTOCOL_VIOLATION, errorMessage);
         return;
     }
 
-    const QByteArray payload = packet.payload();
-    const uint16_t packetIdentifier = uint16_t(uint8_t(payload[0])) * 256 + uint8_t(payload[1]);
+    const uint16_t packetIdentifier = readUint16(packet.payload());
 
     Q_EMIT pubrel(packetIdentifier);
 }
@@ -432,28 +489,50 @@ void QMqttPacketParser::parsePUBACK(const MQTTPacket &packet)
 {
     if (packet.remainingLength() < 2) {
         const QString errorMessage = QStringLiteral("Invalid PUBACK packet received");
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
         return;
     }
 
-    const QByteArray payload = packet.payload();
-    const uint16_t packetIdentifier = uint16_t(uint8_t(payload[0])) * 256 + uint8_t(payload[1]);
+    const uint16_t packetIdentifier = readUint16(packet.payload());
 
     Q_EMIT puback(packetIdentifier);
 }
 
+void QMqttPacketParser::parsePUBREC(const MQTTPacket &packet)
+{
+    if (packet.remainingLength() < 2) {
+        const QString errorMessage = QStringLiteral("Invalid PUBREC packet received");
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        return;
+    }
+
+    const uint16_t packetIdentifier = readUint16(packet.payload());
+
+    Q_EMIT pubrec(packetIdentifier);
+}
+
+void QMqttPacketParser::parsePUBCOMP(const MQTTPacket &packet)
+{
+    if (packet.remainingLength() < 2) {
+        const QString errorMessage = QStringLiteral("Invalid PUBCOMP packet received");
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        return;
+    }
+
+    const uint16_t packetIdentifier = readUint16(packet.payload());
+
+    Q_EMIT pubcomp(packetIdentifier);
+}
+
 void QMqttPacketParser::parseUNSUBACK(const MQTTPacket &packet)
 {
     if (packet.remainingLength() < 2) {
         const QString errorMessage = QStringLiteral("Invalid UNSUBACK packet received");
-        qCWarning(module) << errorMessage;
-        Q_EMIT error(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
+        reportError(QMqttProtocol::Error::INVALID_PACKET, errorMessage);
         return;
     }
 
-    const QByteArray payload = packet.payload();
-    const uint16_t packetIdentifier = uint16_t(uint8_t(payload[0])) * 256 + uint8_t(payload[1]);
+    const uint16_t packetIdentifier = readUint16(packet.payload());
 
     Q_EMIT unsuback(packetIdentifier);
 }
@@ -1,11 +1,13 @@
 #pragma once
 
 #include <QObject>
+#include <QByteArray>
 #include "qmqttprotocol.h"
+#include "qmqttmessage.h"
 
-class QByteArray;
 class QString;
 class MQTTPacket;
+class QMqttStatisticsPrivate;
 class QTMQTT_AUTOTEST_EXPORT QMqttPacketParser : public QObject
 {
     Q_OBJECT
@@ -13,24 +15,38 @@ class QTMQTT_AUTOTEST_EXPORT QMqttPacketParser : public QObject
 public:
     QMqttPacketParser();
 
-    void parse(const QByteArray &packet);
+    void parse(const QByteArray &data);
+    //parses data of a connection that keeps its own partial packet in buffer, so that one
+    //parser can serve many connections
+    void parse(const QByteArray &data, QByteArray &buffer);
+    void reset();
+    void setStatistics(QMqttStatisticsPrivate *statistics);
 
 Q_SIGNALS:
     void error(QMqttProtocol::Error error, const QString &errorMessage);
     void connack(QMqttProtocol::Error error, bool sessionPresent);
-    void publish(QMqttProtocol::QoS qos, uint16_t packetIdentifier,
-                 const QString &topicName, const QByteArray &message);
+    //message refers to the frame it was parsed from, its topic name is not decoded yet
+    void publish(uint16_t packetIdentifier, const QMqttMessage &message);
     void puback(uint16_t packetIdentifier);
+    void pubrec(uint16_t packetIdentifier);
+    void pubcomp(uint16_t packetIdentifier);
     void pubrel(uint16_t packetIdentifier);
     void suback(uint16_t packetIdentifier, QVector<QMqttProtocol::QoS> qos);
     void unsuback(uint16_t packetIdentifier);
     void pong();
 
 private:
+    QByteArray m_buffer;
+    QMqttStatisticsPrivate *m_statistics;
+
+    void reportError(QMqttProtocol::Error errorCode, const QString &errorMessage);
+    void parsePacket(const MQTTPacket &packet);
     void parseCONNACK(const MQTTPacket &packet);
     void parseSUBACK(const MQTTPacket &packet);
     void parsePUBLISH(const MQTTPacket &packet);
     void parsePUBREL(const MQTTPacket &packet);
     void parsePUBACK(const MQTTPacket &packet);
+    void parsePUBREC(const MQTTPacket &packet);
+    void parsePUBCOMP(const MQTTPacket &packet);
     void parseUNSUBACK(const MQTTPacket &packet);
 };
@@ -40,6 +40,28 @@ public:
     };
     Q_ENUM(Error)
 
+    //see 2.1.1 MQTT Control Packet type in MQTT v3.1.1 specification
+    enum class PacketType : uint8_t
+    {
+        RESERVED_0   = 0,   //Reserved
+        CONNECT      = 1,   //Client request to connect to server (client --> server)
+        CONNACK      = 2,   //Connect acknowledgement (server --> client)
+        PUBLISH      = 3,   //Publish message (client <--> server)
+        PUBACK       = 4,   //Publish acknowledgement (client <--> server)
+        PUBREC       = 5,   //Publish received (assured delivery part 1) (client <--> server)
+        PUBREL       = 6,   //Publish release  (assured delivery part 2) (client <--> server)
+        PUBCOMP      = 7,   //Publish complete (assured delivery part 3) (client <--> server)
+        SUBSCRIBE    = 8,   //Client subscribe request (client --> server)
+        SUBACK       = 9,   //Subscribe acknowledgement (server --> client)
+        UNSUBSCRIBE  = 10,  //Unsubscribe request (client --> server)
+        UNSUBACK     = 11,  //Unsubscribe acknlowedgement (server --> client)
+        PINGREQ      = 12,  //PING request (client --> server)
+        PINGRESP     = 13,  //PING response (server --> client)
+        DISCONNECT   = 14,  //Client is disconnecting (client --> server)
+        RESERVED_15  = 15   //Reserved
+    };
+    Q_ENUM(PacketType)
+
     enum State {
         OFFLINE,
         CONNECTING,
@@ -47,4 +69,15 @@ public:
         DISCONNECTING
     };
     Q_ENUM(State)
+
+    //the acknowledgements whose round trip time is measured, see QMqttClient::latencyPercentile()
+    enum class Acknowledgement {
+        PUBACK,
+        PUBREC,
+        PUBCOMP,
+        SUBACK,
+        UNSUBACK,
+        PINGRESP
+    };
+    Q_ENUM(Acknowledgement)
 };
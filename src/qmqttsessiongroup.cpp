@@ -0,0 +1,1002 @@
+#include "qmqttsessiongroup.h"
+#include "qmqttsessiongroup_p.h"
+#include "qmqttclient_p.h"
+#include "qmqttcontrolpacket_p.h"
+#include "qmqtttransport_p.h"
+#include "qmqttnetworkrequest.h"
+#include <QStringList>
+#include <algorithm>
+#include "logging_p.h"
+
+LoggingModule("QMqttSessionGroup");
+
+/*!
+   \internal
+ */
+QMqttSessionGroupPrivate::QMqttSessionGroupPrivate(const QSet<QSslError> &allowedSslErrors,
+                                                   QMqttSessionGroup * const q) :
+    QObject(),
+    q_ptr(q),
+    m_allowedSslErrors(allowedSslErrors),
+    m_sessions(),
+    m_freeIndexes(),
+    m_sessionCount(0),
+    m_sessionsByTransport(),
+    m_packetParser(),
+    m_current(-1),
+    m_topicCache(),
+    m_keepAliveWheel(WHEEL_SLOT_COUNT),
+    m_tickTimer(),
+    m_keepAliveSecs(30)
+{
+    m_tickTimer.setInterval(TICK_INTERVAL_MS);
+    makeSignalSlotConnections();
+}
+
+/*!
+   \internal
+ */
+QMqttSessionGroupPrivate::~QMqttSessionGroupPrivate()
+{
+    for (Session *session : m_sessions) {
+        if (session) {
+            releaseTransport(session);
+        }
+    }
+    qDeleteAll(m_sessions);
+}
+
+/*!
+  Connects the parser and the tick timer, once for all sessions.
+  Received packets are handled synchronously, while the session they belong to is known.
+   \internal
+ */
+void QMqttSessionGroupPrivate::makeSignalSlotConnections()
+{
+    QMqttPacketParser * const parser = &m_packetParser;
+    QObject::connect(parser, &QMqttPacketParser::connack,
+                     this, &QMqttSessionGroupPrivate::onConnackReceived, Qt::DirectConnection);
+    QObject::connect(parser, &QMqttPacketParser::suback,
+                     this, &QMqttSessionGroupPrivate::onSubackReceived, Qt::DirectConnection);
+    QObject::connect(parser, &QMqttPacketParser::publish,
+                     this, &QMqttSessionGroupPrivate::onPublishReceived, Qt::DirectConnection);
+    QObject::connect(parser, &QMqttPacketParser::puback,
+                     this, &QMqttSessionGroupPrivate::onPubAckReceived, Qt::DirectConnection);
+    QObject::connect(parser, &QMqttPacketParser::pubrec,
+                     this, &QMqttSessionGroupPrivate::onPubRecReceived, Qt::DirectConnection);
+    QObject::connect(parser, &QMqttPacketParser::pubrel,
+                     this, &QMqttSessionGroupPrivate::onPubRelReceived, Qt::DirectConnection);
+    QObject::connect(parser, &QMqttPacketParser::pubcomp,
+                     this, &QMqttSessionGroupPrivate::onPubCompReceived, Qt::DirectConnection);
+    QObject::connect(parser, &QMqttPacketParser::unsuback,
+                     this, &QMqttSessionGroupPrivate::onUnsubackReceived, Qt::DirectConnection);
+    QObject::connect(parser, &QMqttPacketParser::pong,
+                     this, &QMqttSessionGroupPrivate::onPongReceived, Qt::DirectConnection);
+    QObject::connect(parser, &QMqttPacketParser::error,
+                     this, &QMqttSessionGroupPrivate::onParseError, Qt::DirectConnection);
+
+    QObject::connect(&m_tickTimer, &QTimer::timeout, this, &QMqttSessionGroupPrivate::tick);
+}
+
+/*!
+  Adds a session with \a clientId, reusing the id of a removed session if there is one.
+   \internal
+ */
+int QMqttSessionGroupPrivate::addSession(const QString &clientId)
+{
+    int index;
+    if (m_freeIndexes.isEmpty()) {
+        index = m_sessions.size();
+        m_sessions.append(nullptr);
+    } else {
+        index = m_freeIndexes.takeLast();
+    }
+    m_sessions[index] = new Session(clientId);
+    ++m_sessionCount;
+    return index;
+}
+
+/*!
+  Removes the session at \a index, aborting its connection without further signals.
+  The callbacks of its pending requests are called with false.
+   \internal
+ */
+void QMqttSessionGroupPrivate::removeSession(int index)
+{
+    Session * const session = this->session(index);
+    if (!session) {
+        qCWarning(module) << "Cannot remove unknown session" << index;
+        return;
+    }
+    releaseTransport(session);
+    m_sessions[index] = nullptr;
+    m_freeIndexes.append(index);
+    --m_sessionCount;
+    failPending(session);
+    delete session;
+}
+
+/*!
+  Returns the session at \a index, or nullptr if there is none.
+   \internal
+ */
+QMqttSessionGroupPrivate::Session *QMqttSessionGroupPrivate::session(int index) const
+{
+    return (index >= 0 && index < m_sessions.size()) ? m_sessions.at(index) : nullptr;
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::connect(int index, const QMqttNetworkRequest &request,
+                                       const QString &userName, const QByteArray &password)
+{
+    Session * const session = this->session(index);
+    if (!session) {
+        qCWarning(module) << "Cannot connect unknown session" << index;
+        return;
+    }
+    if (session->state != QMqttProtocol::State::OFFLINE) {
+        qCWarning(module) << "Session" << index << "is already connected.";
+        return;
+    }
+    session->userName = userName;
+    session->password = password;
+    session->state = QMqttProtocol::State::CONNECTING;
+    //the transport of a failed attempt can still be around
+    releaseTransport(session);
+
+    QMqttTransport * const transport = QMqttTransport::create(request.url());
+    session->transport = transport;
+    m_sessionsByTransport.insert(transport, index);
+    QObject::connect(transport, &QMqttTransport::connected,
+                     this, &QMqttSessionGroupPrivate::onTransportConnected);
+    QObject::connect(transport, &QMqttTransport::disconnected,
+                     this, &QMqttSessionGroupPrivate::onTransportDisconnected);
+    QObject::connect(transport, &QMqttTransport::dataReceived,
+                     this, &QMqttSessionGroupPrivate::onTransportDataReceived);
+    QObject::connect(transport, &QMqttTransport::error,
+                     this, &QMqttSessionGroupPrivate::onTransportError);
+    QObject::connect(transport, &QMqttTransport::sslErrors,
+                     this, &QMqttSessionGroupPrivate::onTransportSslErrors);
+    QObject::connect(transport, &QMqttTransport::protocolViolation,
+                     this, &QMqttSessionGroupPrivate::onTransportProtocolViolation);
+    transport->open(request);
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::disconnect(int index)
+{
+    Session * const session = this->session(index);
+    if (!session || !session->transport
+            || session->state == QMqttProtocol::State::OFFLINE
+            || session->state == QMqttProtocol::State::DISCONNECTING) {
+        return;
+    }
+    const bool connected = session->state == QMqttProtocol::State::CONNECTED;
+    session->state = QMqttProtocol::State::DISCONNECTING;
+    if (connected) {
+        sendPacket(index, QMqttDisconnectControlPacket());
+    }
+    session->transport->close();
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::subscribe(int index, const QString &topic, QMqttProtocol::QoS qos,
+                                         std::function<void(bool)> cb)
+{
+    Session * const session = this->session(index);
+    if (!session || session->state != QMqttProtocol::State::CONNECTED) {
+        qCWarning(module) << "Cannot subscribe to topic" << topic << ": session" << index
+                          << "is not connected.";
+        failLater(cb);
+        return;
+    }
+    if (!isTopicNameValid(topic)) {
+        qCWarning(module) << "Invalid topic name detected:" << topic;
+        failLater(cb);
+        return;
+    }
+    const uint16_t packetIdentifier
+            = session->pendingAcks.acquire(QMqttPacketIdentifierTable::Operation::SUBSCRIBE, cb);
+    if (Q_UNLIKELY(packetIdentifier == 0)) {
+        qCWarning(module) << "No packet identifier available to subscribe to topic" << topic;
+        failLater(cb);
+        return;
+    }
+    sendPacket(index, QMqttSubscribeControlPacket(packetIdentifier, {qMakePair(topic, qos)}));
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::unsubscribe(int index, const QString &topic,
+                                           std::function<void(bool)> cb)
+{
+    Session * const session = this->session(index);
+    if (!session || session->state != QMqttProtocol::State::CONNECTED) {
+        qCWarning(module) << "Cannot unsubscribe from topic" << topic << ": session" << index
+                          << "is not connected.";
+        failLater(cb);
+        return;
+    }
+    if (!isTopicNameValid(topic)) {
+        qCWarning(module) << "Invalid topic name detected:" << topic;
+        failLater(cb);
+        return;
+    }
+    const uint16_t packetIdentifier
+            = session->pendingAcks.acquire(QMqttPacketIdentifierTable::Operation::UNSUBSCRIBE, cb);
+    if (Q_UNLIKELY(packetIdentifier == 0)) {
+        qCWarning(module) << "No packet identifier available to unsubscribe from topic" << topic;
+        failLater(cb);
+        return;
+    }
+    sendPacket(index, QMqttUnsubscribeControlPacket(packetIdentifier, {topic}));
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::publish(int index, const QString &topic, const QByteArray &message,
+                                       QMqttProtocol::QoS qos, std::function<void(bool)> cb)
+{
+    Session * const session = this->session(index);
+    if (!session || session->state != QMqttProtocol::State::CONNECTED) {
+        qCWarning(module) << "Cannot publish to topic" << topic << ": session" << index
+                          << "is not connected.";
+        failLater(cb);
+        return;
+    }
+    if (qos == QMqttProtocol::QoS::AT_MOST_ONCE) {
+        sendPacket(index, QMqttPublishControlPacket(topic, message, qos, false));
+        if (cb) {
+            cb(true);
+        }
+        return;
+    }
+    if (Q_UNLIKELY(qos != QMqttProtocol::QoS::AT_LEAST_ONCE && qos != QMqttProtocol::QoS::EXACTLY_ONCE)) {
+        qCWarning(module) << "Invalid QoS" << qos << "to publish to topic" << topic;
+        failLater(cb);
+        return;
+    }
+    //a QoS 2 publish first awaits PUBREC, then PUBCOMP (see 4.3.3 QoS 2: Exactly once delivery)
+    const QMqttPacketIdentifierTable::Operation operation = (qos == QMqttProtocol::QoS::EXACTLY_ONCE)
+            ? QMqttPacketIdentifierTable::Operation::PUBLISH_EXACTLY_ONCE
+            : QMqttPacketIdentifierTable::Operation::PUBLISH;
+    const uint16_t packetIdentifier = session->pendingAcks.acquire(operation, cb);
+    if (Q_UNLIKELY(packetIdentifier == 0)) {
+        qCWarning(module) << "No packet identifier available to publish to topic" << topic;
+        failLater(cb);
+        return;
+    }
+    sendPacket(index, QMqttPublishControlPacket(topic, message, qos, false, packetIdentifier));
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::setKeepAlive(int seconds)
+{
+    m_keepAliveSecs = qBound(0, seconds, 0xFFFF);
+}
+
+/*!
+   \internal
+ */
+int QMqttSessionGroupPrivate::keepAlive() const
+{
+    return m_keepAliveSecs;
+}
+
+/*!
+   \internal
+ */
+int QMqttSessionGroupPrivate::sessionCount() const
+{
+    return m_sessionCount;
+}
+
+/*!
+  Returns the session whose transport sent the signal being handled, or -1.
+   \internal
+ */
+int QMqttSessionGroupPrivate::senderSession() const
+{
+    return m_sessionsByTransport.value(sender(), -1);
+}
+
+/*!
+  Sends the CONNECT packet of the session.
+   \internal
+ */
+void QMqttSessionGroupPrivate::onTransportConnected()
+{
+    const int index = senderSession();
+    Session * const session = this->session(index);
+    if (!session) {
+        return;
+    }
+    QMqttConnectControlPacket packet(session->clientId);
+    packet.setKeepAlive(uint16_t(m_keepAliveSecs));
+    if (!session->userName.isEmpty() && !session->password.isNull()) {
+        packet.setCredentials(session->userName, session->password);
+    }
+    session->userName.clear();
+    session->password.clear();
+    sendPacket(index, packet);
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onTransportDisconnected()
+{
+    Q_Q(QMqttSessionGroup);
+
+    const int index = senderSession();
+    Session * const session = this->session(index);
+    if (!session) {
+        return;
+    }
+    releaseTransport(session);
+    session->state = QMqttProtocol::State::OFFLINE;
+    session->buffer.clear();
+    session->receivedExactlyOnce.clear();
+    session->pingPending = false;
+    failPending(session);
+    Q_EMIT q->disconnected(index);
+}
+
+/*!
+  Parses \a data with the buffer of the session that received it.
+   \internal
+ */
+void QMqttSessionGroupPrivate::onTransportDataReceived(const QByteArray &data)
+{
+    const int index = senderSession();
+    Session * const session = this->session(index);
+    if (!session) {
+        return;
+    }
+    //receivers can remove the session or drop its connection while its data is parsed
+    QByteArray buffer;
+    buffer.swap(session->buffer);
+    m_current = index;
+    m_packetParser.parse(data, buffer);
+    if (m_current == index) {
+        session->buffer.swap(buffer);
+    }
+    m_current = -1;
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onTransportError(QAbstractSocket::SocketError error)
+{
+    Q_Q(QMqttSessionGroup);
+
+    const int index = senderSession();
+    Session * const session = this->session(index);
+    if (!session) {
+        return;
+    }
+    const QString errorMessage = QStringLiteral("Error connecting to MQTT server: %1 (%2).")
+            .arg(error).arg(session->transport->errorString());
+    //a failed connection attempt does not emit disconnected()
+    if (session->state == QMqttProtocol::State::CONNECTING
+            && session->transport->state() == QAbstractSocket::UnconnectedState) {
+        releaseTransport(session);
+        session->state = QMqttProtocol::State::OFFLINE;
+    }
+    Q_EMIT q->error(index, QMqttProtocol::Error::CONNECTION_FAILED, errorMessage);
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onTransportSslErrors(const QList<QSslError> &errors)
+{
+    Q_Q(QMqttSessionGroup);
+
+    const int index = senderSession();
+    Session * const session = this->session(index);
+    if (!session) {
+        return;
+    }
+    if (sslErrorsAllowed(errors)) {
+        qCDebug(module) << "Ignoring SSL errors" << errors;
+        session->transport->ignoreSslErrors();
+        return;
+    }
+    QStringList errorStrings;
+    for (const QSslError &error : errors) {
+        errorStrings.append(error.errorString());
+    }
+    releaseTransport(session);
+    session->state = QMqttProtocol::State::OFFLINE;
+    Q_EMIT q->error(index, QMqttProtocol::Error::CONNECTION_FAILED,
+                    QStringLiteral("SSL errors encountered: %1.").arg(errorStrings.join(QStringLiteral(", "))));
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onTransportProtocolViolation(const QString &errorMessage)
+{
+    Q_Q(QMqttSessionGroup);
+
+    const int index = senderSession();
+    if (session(index)) {
+        Q_EMIT q->error(index, QMqttProtocol::Error::PROTOCOL_VIOLATION, errorMessage);
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onConnackReceived(QMqttProtocol::Error error, bool sessionPresent)
+{
+    Q_Q(QMqttSessionGroup);
+    Q_UNUSED(sessionPresent);
+
+    const int index = m_current;
+    Session * const session = this->session(index);
+    if (!session) {
+        return;
+    }
+    if (session->state != QMqttProtocol::State::CONNECTING) {
+        session->transport->abort();
+        Q_EMIT q->error(index, QMqttProtocol::Error::PROTOCOL_VIOLATION,
+                        QStringLiteral("Received a CONNACK packet while the MQTT connection is already connected."));
+        return;
+    }
+    if (error != QMqttProtocol::Error::CONNECTION_ACCEPTED) {
+        session->transport->abort();
+        Q_EMIT q->error(index, error, QStringLiteral("Connection refused"));
+        return;
+    }
+    session->state = QMqttProtocol::State::CONNECTED;
+    if (m_keepAliveSecs > 0) {
+        session->pingPending = false;
+        scheduleKeepAlive(index, m_keepAliveWheel.now() + quint64(m_keepAliveSecs));
+    }
+    Q_EMIT q->connected(index);
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onSubackReceived(uint16_t packetIdentifier,
+                                                QVector<QMqttProtocol::QoS> qos)
+{
+    Session * const session = this->session(m_current);
+    std::function<void(bool)> cb;
+    if (session && session->pendingAcks.release(packetIdentifier, QMqttPacketIdentifierTable::Operation::SUBSCRIBE, &cb)
+            && cb) {
+        cb(std::none_of(qos.cbegin(), qos.cend(), [](QMqttProtocol::QoS qos) {
+            return qos == QMqttProtocol::QoS::INVALID;
+        }));
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onPublishReceived(uint16_t packetIdentifier, const QMqttMessage &message)
+{
+    Q_Q(QMqttSessionGroup);
+
+    const QMqttProtocol::QoS qos = message.qos();
+    const int index = m_current;
+    Session *session = this->session(index);
+    if (!session) {
+        return;
+    }
+    if (qos == QMqttProtocol::QoS::EXACTLY_ONCE) {
+        //a redelivery of a message that was not released yet is acknowledged again, but not
+        //delivered (see 4.3.3 QoS 2: Exactly once delivery, method B)
+        if (session->receivedExactlyOnce.contains(packetIdentifier)) {
+            sendPacket(index, QMqttPubRecControlPacket(packetIdentifier));
+            return;
+        }
+        session->receivedExactlyOnce.append(packetIdentifier);
+    }
+
+    Q_EMIT q->messageReceived(index, m_topicCache.intern(message),
+                              QByteArray(message.payloadData(), message.payloadSize()));
+
+    //receivers can remove the session
+    if (m_current != index) {
+        return;
+    }
+    if (qos == QMqttProtocol::QoS::EXACTLY_ONCE) {
+        sendPacket(index, QMqttPubRecControlPacket(packetIdentifier));
+    } else if (qos == QMqttProtocol::QoS::AT_LEAST_ONCE) {
+        sendPacket(index, QMqttPubAckControlPacket(packetIdentifier));
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onPubAckReceived(uint16_t packetIdentifier)
+{
+    Session * const session = this->session(m_current);
+    std::function<void(bool)> cb;
+    if (session && session->pendingAcks.release(packetIdentifier, QMqttPacketIdentifierTable::Operation::PUBLISH, &cb)
+            && cb) {
+        cb(true);
+    }
+}
+
+/*!
+  Releases the message of a QoS 2 publish by sending a PUBREL packet.
+   \internal
+ */
+void QMqttSessionGroupPrivate::onPubRecReceived(uint16_t packetIdentifier)
+{
+    Session * const session = this->session(m_current);
+    if (!session) {
+        return;
+    }
+    if (session->pendingAcks.transition(packetIdentifier,
+                                        QMqttPacketIdentifierTable::Operation::PUBLISH_EXACTLY_ONCE,
+                                        QMqttPacketIdentifierTable::Operation::PUBLISH_RELEASED)
+            || session->pendingAcks.operation(packetIdentifier) == QMqttPacketIdentifierTable::Operation::PUBLISH_RELEASED) {
+        sendPacket(m_current, QMqttPubRelControlPacket(packetIdentifier));
+    } else {
+        qCWarning(module) << "Received PubRec packet for unknown id" << packetIdentifier;
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onPubRelReceived(uint16_t packetIdentifier)
+{
+    Session * const session = this->session(m_current);
+    if (!session) {
+        return;
+    }
+    session->receivedExactlyOnce.removeOne(packetIdentifier);
+    sendPacket(m_current, QMqttPubCompControlPacket(packetIdentifier));
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onPubCompReceived(uint16_t packetIdentifier)
+{
+    Session * const session = this->session(m_current);
+    std::function<void(bool)> cb;
+    if (session && session->pendingAcks.release(packetIdentifier, QMqttPacketIdentifierTable::Operation::PUBLISH_RELEASED, &cb)
+            && cb) {
+        cb(true);
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onUnsubackReceived(uint16_t packetIdentifier)
+{
+    Session * const session = this->session(m_current);
+    std::function<void(bool)> cb;
+    if (session && session->pendingAcks.release(packetIdentifier, QMqttPacketIdentifierTable::Operation::UNSUBSCRIBE, &cb)
+            && cb) {
+        cb(true);
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionGroupPrivate::onPongReceived()
+{
+    Session * const session = this->session(m_current);
+    if (session) {
+        session->pingPending = false;
+    }
+}
+
+/*!
+  The byte stream of the session cannot be resynchronized after a parse error: its connection is
+  aborted.
+   \internal
+ */
+void QMqttSessionGroupPrivate::onParseError(QMqttProtocol::Error error, const QString &errorMessage)
+{
+    Q_Q(QMqttSessionGroup);
+
+    const int index = m_current;
+    Session * const session = this->session(index);
+    if (!session) {
+        return;
+    }
+    session->transport->abort();
+    Q_EMIT q->error(index, error, errorMessage);
+}
+
+/*!
+  Advances the keep-alive wheel by one tick. The timer only runs while keep-alives are scheduled.
+   \internal
+ */
+void QMqttSessionGroupPrivate::tick()
+{
+    m_keepAliveWheel.advance([this](quint32 index) {
+        onKeepAliveExpired(int(index));
+    });
+    if (m_keepAliveWheel.size() == 0) {
+        m_tickTimer.stop();
+    }
+}
+
+/*!
+  Encodes \a packet and writes it to the transport of the session at \a index.
+   \internal
+ */
+void QMqttSessionGroupPrivate::sendPacket(int index, const QMqttControlPacket &packet)
+{
+    Session * const session = this->session(index);
+    if (Q_UNLIKELY(!session || !session->transport)) {
+        return;
+    }
+    session->transport->write(packet.encode());
+    session->lastSentTick = m_keepAliveWheel.now();
+}
+
+/*!
+  Makes the keep-alive of the session at \a index expire at the tick \a deadline.
+   \internal
+ */
+void QMqttSessionGroupPrivate::scheduleKeepAlive(int index, quint64 deadline)
+{
+    Session * const session = this->session(index);
+    session->keepAliveDeadline = deadline;
+    m_keepAliveWheel.schedule(quint32(index), int(deadline - m_keepAliveWheel.now()));
+    if (!m_tickTimer.isActive()) {
+        m_tickTimer.start();
+    }
+}
+
+/*!
+  Sends a PINGREQ when the session at \a index did not send anything during the keep-alive
+  interval. Sending postpones the keep-alive, as does restarting the ping timer of a QMqttClient;
+  rather than moving the timer in the wheel on every packet, the expiration is rescheduled here.
+  Expirations of removed sessions and of earlier connections are ignored.
+   \internal
+ */
+void QMqttSessionGroupPrivate::onKeepAliveExpired(int index)
+{
+    Q_Q(QMqttSessionGroup);
+
+    Session * const session = this->session(index);
+    const quint64 now = m_keepAliveWheel.now();
+    if (!session || session->state != QMqttProtocol::State::CONNECTED
+            || session->keepAliveDeadline != now || m_keepAliveSecs == 0) {
+        return;
+    }
+    const quint64 idleDeadline = session->lastSentTick + quint64(m_keepAliveSecs);
+    if (idleDeadline > now) {
+        scheduleKeepAlive(index, idleDeadline);
+        return;
+    }
+    if (session->pingPending) {
+        Q_EMIT q->error(index, QMqttProtocol::Error::TIME_OUT,
+                        QStringLiteral("Pong not received within expected time."));
+        disconnect(index);
+        return;
+    }
+    session->pingPending = true;
+    sendPacket(index, QMqttPingReqControlPacket());
+    scheduleKeepAlive(index, now + quint64(m_keepAliveSecs));
+}
+
+/*!
+  Drops the transport of \a session without further signals, and stops parsing its data.
+   \internal
+ */
+void QMqttSessionGroupPrivate::releaseTransport(Session *session)
+{
+    if (!session->transport) {
+        return;
+    }
+    if (this->session(m_current) == session) {
+        //the rest of the data being parsed belongs to the released connection
+        m_current = -1;
+    }
+    m_sessionsByTransport.remove(session->transport);
+    session->transport->disconnect(this);
+    session->transport->abort();
+    //deleted later, as the transport can be released from within one of its own signals
+    session->transport->deleteLater();
+    session->transport = nullptr;
+}
+
+/*!
+  Fails the callbacks of all requests of \a session that await acknowledgement.
+   \internal
+ */
+void QMqttSessionGroupPrivate::failPending(Session *session)
+{
+    const QVector<std::function<void(bool)>> callbacks = session->pendingAcks.takeAll();
+    for (const std::function<void(bool)> &cb : callbacks) {
+        if (cb) {
+            cb(false);
+        }
+    }
+}
+
+/*!
+  Calls \a cb with false from the event loop, so that a request that fails right away does not
+  call back into its caller.
+   \internal
+ */
+void QMqttSessionGroupPrivate::failLater(const std::function<void(bool)> &cb)
+{
+    if (cb) {
+        QTimer::singleShot(0, this, std::bind(cb, false));
+    }
+}
+
+/*!
+  Returns true if all \a errors are allowed. Like QMqttClient, only the kinds of the errors are
+  compared, not their certificates.
+   \internal
+ */
+bool QMqttSessionGroupPrivate::sslErrorsAllowed(const QList<QSslError> &errors) const
+{
+    if (m_allowedSslErrors.isEmpty()) {
+        return false;
+    }
+    for (const QSslError &error : errors) {
+        const bool allowed = std::any_of(m_allowedSslErrors.cbegin(), m_allowedSslErrors.cend(),
+                                         [&error](const QSslError &allowedError) {
+            return allowedError.error() == error.error();
+        });
+        if (!allowed) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*!
+   \class QMqttSessionGroup
+
+   \inmodule QtMqtt
+
+    \brief Runs many lightweight MQTT sessions, e.g. to simulate a fleet of devices.
+
+    Every QMqttClient owns a private object, a packet parser, several timers and the signal
+    connections between them. That is negligible for a few clients, but not for the thousands
+    of connections of a device simulation. A QMqttSessionGroup shares all of these between its
+    sessions instead: one packet parser handles the data of every session, one timer drives
+    the keep-alives of all sessions through a timer wheel, and the parser and timer are
+    connected once for the whole group. A session only costs a small struct and its transport.
+
+    Sessions are identified by the id returned by addSession(); the ids of removed sessions are
+    reused. All signals carry the id of the session they concern.
+
+    Received packets are handled synchronously, as soon as the transport signals the arrival of
+    data, like in the low latency mode of QMqttClient: signals are emitted and callbacks are
+    called from within that handling, and receivers must not delete the group.
+
+   Limitations:
+   ============
+   Compared to QMqttClient, a session
+   \list 1
+   \li always uses a clean session, and has no will message;
+   \li does not reconnect automatically;
+   \li has no in-flight window, write buffer, statistics or latency measurement;
+   \li can only publish, subscribe and unsubscribe while connected; otherwise the callback is
+   called with false.
+   \endlist
+ */
+
+/*!
+    \fn void QMqttSessionGroup::connected(int session)
+
+    This signal is emitted when the connection of \a session is acknowledged by the server.
+*/
+
+/*!
+    \fn void QMqttSessionGroup::disconnected(int session)
+
+    This signal is emitted when the connection of \a session is completely closed.
+*/
+
+/*!
+    \fn void QMqttSessionGroup::messageReceived(int session, const QString &topicName, const QByteArray &message);
+
+    This signal is emitted when \a session received a \a message on the topic with the given
+    \a topicName.
+*/
+
+/*!
+    \fn void QMqttSessionGroup::error(int session, MQTTProtocol::Error err, const QString &errorMessage);
+
+    This signal is emitted when an error occurs on \a session. The \a err parameter indicates the
+    type of error that occurred and \a errorMessage contains a textual description of the error.
+*/
+
+/*!
+  Creates an empty QMqttSessionGroup with the given \a parent.
+  \a allowedSslErrors: specify any SSL errors you want to allow for all sessions
+ */
+QMqttSessionGroup::QMqttSessionGroup(const QSet<QSslError> &allowedSslErrors, QObject *parent) :
+    QObject(parent),
+    d_ptr(new QMqttSessionGroupPrivate(allowedSslErrors, this))
+{}
+
+/*!
+  Destroys the group. The connections of all sessions are aborted.
+ */
+QMqttSessionGroup::~QMqttSessionGroup()
+{}
+
+/*!
+  Sets the keep-alive interval of the sessions to \a seconds; 0 disables keep-alive.
+  A session sends a PINGREQ packet when it did not send anything during the interval, and
+  is disconnected with a QMqttProtocol::Error::TIME_OUT error when the server does not answer
+  within the next interval. The interval is also announced to the server in the CONNECT packet.
+  The interval should be set before the sessions connect; the default is 30 seconds.
+
+  \sa keepAlive()
+ */
+void QMqttSessionGroup::setKeepAlive(int seconds)
+{
+    Q_D(QMqttSessionGroup);
+
+    d->setKeepAlive(seconds);
+}
+
+/*!
+  Returns the keep-alive interval of the sessions, in seconds.
+
+  \sa setKeepAlive()
+ */
+int QMqttSessionGroup::keepAlive() const
+{
+    Q_D(const QMqttSessionGroup);
+
+    return d->keepAlive();
+}
+
+/*!
+  Adds an offline session with the given \a clientId, and returns its id.
+  The length of the \a clientId should be smaller than 24 characters. If an empty \a clientId is
+  provided, the server will generate a random one.
+
+  \sa removeSession(), connect()
+ */
+int QMqttSessionGroup::addSession(const QString &clientId)
+{
+    Q_D(QMqttSessionGroup);
+
+    return d->addSession(clientId);
+}
+
+/*!
+  Removes \a session. Its connection is aborted without a disconnected() signal, and the
+  callbacks of its pending requests are called with false. The id can be returned again by
+  addSession().
+ */
+void QMqttSessionGroup::removeSession(int session)
+{
+    Q_D(QMqttSessionGroup);
+
+    d->removeSession(session);
+}
+
+/*!
+  Returns the number of sessions in the group.
+ */
+int QMqttSessionGroup::sessionCount() const
+{
+    Q_D(const QMqttSessionGroup);
+
+    return d->sessionCount();
+}
+
+/*!
+  Returns the client id of \a session, or an empty string if there is no such session.
+ */
+QString QMqttSessionGroup::clientId(int session) const
+{
+    Q_D(const QMqttSessionGroup);
+
+    const QMqttSessionGroupPrivate::Session * const s = d->session(session);
+    return s ? s->clientId : QString();
+}
+
+/*!
+  Returns the connection state of \a session; a session that does not exist is OFFLINE.
+ */
+QMqttProtocol::State QMqttSessionGroup::state(int session) const
+{
+    Q_D(const QMqttSessionGroup);
+
+    const QMqttSessionGroupPrivate::Session * const s = d->session(session);
+    return s ? s->state : QMqttProtocol::State::OFFLINE;
+}
+
+/*!
+  Connects \a session to the server specified in the \a request, with the given \a userName and
+  \a password. The scheme of the url of the \a request selects the transport, as for
+  QMqttClient::connect(). When the connection is acknowledged by the server, connected() is
+  emitted.
+
+  \sa disconnect()
+ */
+void QMqttSessionGroup::connect(int session, const QMqttNetworkRequest &request,
+                                const QString &userName, const QByteArray &password)
+{
+    Q_D(QMqttSessionGroup);
+
+    d->connect(session, request, userName, password);
+}
+
+/*!
+  Disconnects \a session from the server in an orderly manner. disconnected() is emitted when
+  the connection is closed.
+
+  \sa connect()
+ */
+void QMqttSessionGroup::disconnect(int session)
+{
+    Q_D(QMqttSessionGroup);
+
+    d->disconnect(session);
+}
+
+/*!
+  Subscribes \a session to \a topic with the given \a qos. \a cb is called when the server
+  acknowledged the subscription.
+ */
+void QMqttSessionGroup::subscribe(int session, const QString &topic, QMqttProtocol::QoS qos,
+                                  std::function<void(bool)> cb)
+{
+    Q_D(QMqttSessionGroup);
+
+    d->subscribe(session, topic, qos, cb);
+}
+
+/*!
+  Unsubscribes \a session from \a topic. \a cb is called when the server acknowledged the
+  request.
+ */
+void QMqttSessionGroup::unsubscribe(int session, const QString &topic, std::function<void(bool)> cb)
+{
+    Q_D(QMqttSessionGroup);
+
+    d->unsubscribe(session, topic, cb);
+}
+
+/*!
+  Publishes \a message to \a topic from \a session, with QoS AT_MOST_ONCE.
+ */
+void QMqttSessionGroup::publish(int session, const QString &topic, const QByteArray &message)
+{
+    Q_D(QMqttSessionGroup);
+
+    d->publish(session, topic, message, QMqttProtocol::QoS::AT_MOST_ONCE, nullptr);
+}
+
+/*!
+  Publishes \a message to \a topic from \a session, with the given \a qos. \a cb is called when
+  the message was sent (AT_MOST_ONCE) or acknowledged by the server.
+ */
+void QMqttSessionGroup::publish(int session, const QString &topic, const QByteArray &message,
+                                QMqttProtocol::QoS qos, std::function<void(bool)> cb)
+{
+    Q_D(QMqttSessionGroup);
+
+    d->publish(session, topic, message, qos, cb);
+}
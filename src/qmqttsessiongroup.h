@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QObject>
+#include <QSet>
+#include <QSslError>
+#include <functional>
+#include "qmqttprotocol.h"
+#include "qmqtt_global.h"
+
+class QMqttNetworkRequest;
+class QString;
+class QByteArray;
+class QMqttSessionGroupPrivate;
+class QTMQTT_EXPORT QMqttSessionGroup : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(QMqttSessionGroup)
+    Q_DISABLE_COPY(QMqttSessionGroup)
+
+public:
+    explicit QMqttSessionGroup(const QSet<QSslError> &allowedSslErrors = QSet<QSslError>(),
+                               QObject *parent = nullptr);
+    virtual ~QMqttSessionGroup();
+
+    void setKeepAlive(int seconds);
+    int keepAlive() const;
+
+    int addSession(const QString &clientId);
+    void removeSession(int session);
+    int sessionCount() const;
+    QString clientId(int session) const;
+    QMqttProtocol::State state(int session) const;
+
+    using QObject::connect;
+    void connect(int session, const QMqttNetworkRequest &request, const QString &userName = QString(), const QByteArray &password = QByteArray());
+    using QObject::disconnect;
+    void disconnect(int session);
+
+    void subscribe(int session, const QString &topic, QMqttProtocol::QoS qos,
+                   std::function<void(bool)> cb);
+    void unsubscribe(int session, const QString &topic, std::function<void(bool)> cb);
+    void publish(int session, const QString &topic, const QByteArray &message);
+    void publish(int session, const QString &topic, const QByteArray &message,
+                 QMqttProtocol::QoS qos, std::function<void(bool)> cb);
+
+Q_SIGNALS:
+    void connected(int session);
+    void disconnected(int session);
+    void messageReceived(int session, const QString &topicName, const QByteArray &message);
+    void error(int session, QMqttProtocol::Error err, const QString &errorMessage);
+
+private:
+    QScopedPointer<QMqttSessionGroupPrivate> d_ptr;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QTimer>
+#include <QAbstractSocket>
+#include <QSslError>
+#include "qmqttprotocol.h"
+#include "qmqttpacketparser_p.h"
+#include "qmqttpacketidentifiertable_p.h"
+#include "qmqtttimerwheel_p.h"
+#include "qmqtttopiccache_p.h"
+
+class QMqttSessionGroup;
+class QMqttTransport;
+class QMqttControlPacket;
+class QMqttNetworkRequest;
+class QMqttSessionGroupPrivate : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QMqttSessionGroupPrivate)
+    Q_DECLARE_PUBLIC(QMqttSessionGroup)
+
+public:
+    static const int WHEEL_SLOT_COUNT = 64;
+    static const int TICK_INTERVAL_MS = 1000;
+
+    //The state of one session. Everything that a QMqttClient keeps in QObjects of its own (the
+    //parser, the timers and their signal connections) is shared by the group, so that a session
+    //only costs this struct and its transport.
+    struct Session
+    {
+        explicit Session(const QString &clientId) :
+            clientId(clientId), userName(), password(), transport(nullptr), buffer(),
+            pendingAcks(), receivedExactlyOnce(), lastSentTick(0), keepAliveDeadline(0),
+            state(QMqttProtocol::State::OFFLINE), pingPending(false)
+        {}
+
+        const QString clientId;
+        //kept from connect() until the CONNECT packet is sent
+        QString userName;
+        QByteArray password;
+        QMqttTransport *transport;
+        //first part of an incomplete packet
+        QByteArray buffer;
+        QMqttPacketIdentifierTable pendingAcks;
+        //ids of received QoS 2 messages that were delivered, but not released yet
+        QVector<uint16_t> receivedExactlyOnce;
+        quint64 lastSentTick;
+        quint64 keepAliveDeadline;
+        QMqttProtocol::State state;
+        bool pingPending;
+    };
+
+    QMqttSessionGroupPrivate(const QSet<QSslError> &allowedSslErrors, QMqttSessionGroup * const q);
+    virtual ~QMqttSessionGroupPrivate();
+
+    int addSession(const QString &clientId);
+    void removeSession(int index);
+    Session *session(int index) const;
+
+    void connect(int index, const QMqttNetworkRequest &request, const QString &userName,
+                 const QByteArray &password);
+    void disconnect(int index);
+    void subscribe(int index, const QString &topic, QMqttProtocol::QoS qos,
+                   std::function<void(bool)> cb);
+    void unsubscribe(int index, const QString &topic, std::function<void(bool)> cb);
+    void publish(int index, const QString &topic, const QByteArray &message,
+                 QMqttProtocol::QoS qos, std::function<void(bool)> cb);
+
+    void setKeepAlive(int seconds);
+    int keepAlive() const;
+    int sessionCount() const;
+
+private:
+    QMqttSessionGroup * const q_ptr;
+    const QSet<QSslError> m_allowedSslErrors;
+    //indexed by session id; removed sessions leave a nullptr, which is reused
+    QVector<Session *> m_sessions;
+    QVector<int> m_freeIndexes;
+    int m_sessionCount;
+    QHash<const QObject *, int> m_sessionsByTransport;
+    //one parser for all sessions, fed with the buffer of the session that received data
+    QMqttPacketParser m_packetParser;
+    //session whose data is being parsed, or -1
+    int m_current;
+    //topic names of received messages, shared by all sessions
+    QMqttTopicCache m_topicCache;
+    //keep-alive deadlines of all sessions, counted in ticks of m_tickTimer
+    QMqttTimerWheel m_keepAliveWheel;
+    QTimer m_tickTimer;
+    int m_keepAliveSecs;
+
+private Q_SLOTS:
+    void onTransportConnected();
+    void onTransportDisconnected();
+    void onTransportDataReceived(const QByteArray &data);
+    void onTransportError(QAbstractSocket::SocketError error);
+    void onTransportSslErrors(const QList<QSslError> &errors);
+    void onTransportProtocolViolation(const QString &errorMessage);
+
+    void onConnackReceived(QMqttProtocol::Error error, bool sessionPresent);
+    void onSubackReceived(uint16_t packetIdentifier, QVector<QMqttProtocol::QoS> qos);
+    void onPublishReceived(uint16_t packetIdentifier, const QMqttMessage &message);
+    void onPubAckReceived(uint16_t packetIdentifier);
+    void onPubRecReceived(uint16_t packetIdentifier);
+    void onPubRelReceived(uint16_t packetIdentifier);
+    void onPubCompReceived(uint16_t packetIdentifier);
+    void onUnsubackReceived(uint16_t packetIdentifier);
+    void onPongReceived();
+    void onParseError(QMqttProtocol::Error error, const QString &errorMessage);
+
+    void tick();
+
+private: //helpers
+    void makeSignalSlotConnections();
+    int senderSession() const;
+    void sendPacket(int index, const QMqttControlPacket &packet);
+    void scheduleKeepAlive(int index, quint64 deadline);
+    void onKeepAliveExpired(int index);
+    void releaseTransport(Session *session);
+    void failPending(Session *session);
+    void failLater(const std::function<void(bool)> &cb);
+    bool sslErrorsAllowed(const QList<QSslError> &errors) const;
+};
@@ -0,0 +1,510 @@
+#include "qmqttsessionstore_p.h"
+#include <QSaveFile>
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+#include "logging_p.h"
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+LoggingModule("QMqttSessionStore");
+
+//A log starts with a header, followed by records of the form
+//  uint8 type | uint16 packet identifier | uint32 data length | uint32 checksum | data
+//with all integers in network byte order, like in MQTT itself. The checksum is the CRC-32 of
+//the type, packet identifier, data length and data.
+static const char LOG_MAGIC[] = { 'Q', 'M', 'Q', 'T', 'T', 'S', 'E', 'S', 2 };
+static const int RECORD_HEADER_SIZE = 1 + 2 + 4 + 4;
+static const int CHECKSUM_OFFSET = 1 + 2 + 4;
+
+/*!
+  Continues the CRC-32 (as used by zlib and PNG) \a crc over \a size bytes at \a data.
+  Start with a \a crc of 0.
+   \internal
+ */
+static quint32 crc32(quint32 crc, const uchar *data, size_t size)
+{
+    static const struct Table
+    {
+        Table()
+        {
+            for (quint32 i = 0; i < 256; ++i) {
+                quint32 value = i;
+                for (int bit = 0; bit < 8; ++bit) {
+                    value = (value & 1) ? (0xEDB88320u ^ (value >> 1)) : (value >> 1);
+                }
+                entries[i] = value;
+            }
+        }
+        quint32 entries[256];
+    } table;
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/*!
+  Returns the checksum of the record at \a record, with \a length bytes of data.
+   \internal
+ */
+static quint32 recordChecksum(const uchar *record, quint32 length)
+{
+    const quint32 crc = crc32(0, record, CHECKSUM_OFFSET);
+    return crc32(crc, record + RECORD_HEADER_SIZE, length);
+}
+
+/*!
+  Flushes the buffers of \a file and forces its contents to the storage device.
+   \internal
+ */
+static bool syncToDisk(QFileDevice &file)
+{
+    if (!file.flush()) {
+        return false;
+    }
+#ifdef Q_OS_WIN
+    return ::_commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
+
+/*!
+    \class QMqttSessionStore
+
+    \inmodule QtMqtt
+
+    \brief Persists unacknowledged outgoing messages in an append-only log on local disk.
+
+    Every change is appended to the log as a record: a message is stored when it is sent, a QoS 2
+    message is marked released when its PUBREC is received, and a message is removed when its
+    delivery completed. The records added during one iteration of the event loop are written with
+    a single write and fsync.
+
+    The log is recovered with a single sequential pass over a memory mapping of the file, which
+    only copies the messages that are still unacknowledged. Every record carries a checksum.
+    A record that was only partially written, because the process crashed in the middle of a
+    write, or that does not match its checksum, is discarded together with the rest of the log.
+
+    \internal
+ */
+
+/*!
+  Constructs a session store that uses the file \a fileName.
+
+   \internal
+ */
+QMqttSessionStore::QMqttSessionStore(const QString &fileName) :
+    m_file(fileName),
+    m_errorString(),
+    m_entries(),
+    m_nextSequence(0),
+    m_pendingRecords(),
+    m_fileSize(0),
+    m_liveSize(0),
+    m_commitTimer()
+{
+    m_commitTimer.setSingleShot(true);
+    m_commitTimer.setInterval(0);
+    QObject::connect(&m_commitTimer, &QTimer::timeout, &m_commitTimer, [this]() { commit(); });
+}
+
+/*!
+   \internal
+ */
+QMqttSessionStore::~QMqttSessionStore()
+{
+    close();
+}
+
+/*!
+  Opens the log, creating it when it does not exist yet, and recovers the entries it contains.
+  Returns false if the file cannot be opened or is not a session log.
+
+   \internal
+ */
+bool QMqttSessionStore::open()
+{
+    if (m_file.isOpen()) {
+        return true;
+    }
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Unbuffered)) {
+        m_errorString = m_file.errorString();
+        qCWarning(module) << "Cannot open session file" << m_file.fileName() << m_errorString;
+        return false;
+    }
+    if (!recover()) {
+        qCWarning(module) << "Cannot recover session file" << m_file.fileName() << m_errorString;
+        m_file.close();
+        m_entries.clear();
+        return false;
+    }
+    return true;
+}
+
+/*!
+  Writes the pending records and closes the log. The entries are forgotten.
+
+   \internal
+ */
+void QMqttSessionStore::close()
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+    commit();
+    m_commitTimer.stop();
+    m_file.close();
+    m_entries.clear();
+    m_pendingRecords.clear();
+    m_fileSize = 0;
+    m_liveSize = 0;
+}
+
+/*!
+   \internal
+ */
+bool QMqttSessionStore::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+/*!
+   \internal
+ */
+QString QMqttSessionStore::fileName() const
+{
+    return m_file.fileName();
+}
+
+/*!
+   \internal
+ */
+QString QMqttSessionStore::errorString() const
+{
+    return m_errorString;
+}
+
+/*!
+  Stores the encoded PUBLISH \a packet with the given \a packetIdentifier.
+
+   \internal
+ */
+void QMqttSessionStore::store(uint16_t packetIdentifier, const QByteArray &packet)
+{
+    Q_ASSERT(!m_entries.contains(packetIdentifier));
+
+    m_entries.insert(packetIdentifier, StoredEntry { m_nextSequence++, packet, false });
+    m_liveSize += recordSize(packet.size());
+    append(RecordType::STORE, packetIdentifier, packet);
+}
+
+/*!
+  Marks the QoS 2 message with the given \a packetIdentifier as released: on redelivery a
+  PUBREL is sent rather than the message itself.
+
+   \internal
+ */
+void QMqttSessionStore::release(uint16_t packetIdentifier)
+{
+    const auto it = m_entries.find(packetIdentifier);
+    if (it == m_entries.end() || it->released) {
+        return;
+    }
+    it->released = true;
+    m_liveSize += recordSize(0);
+    append(RecordType::RELEASE, packetIdentifier);
+}
+
+/*!
+  Removes the message with the given \a packetIdentifier, as its delivery completed.
+
+   \internal
+ */
+void QMqttSessionStore::remove(uint16_t packetIdentifier)
+{
+    const auto it = m_entries.find(packetIdentifier);
+    if (it == m_entries.end()) {
+        return;
+    }
+    m_liveSize -= recordSize(it->packet.size()) + (it->released ? recordSize(0) : 0);
+    m_entries.erase(it);
+    append(RecordType::REMOVE, packetIdentifier);
+}
+
+/*!
+  Removes all entries, and truncates the log.
+
+   \internal
+ */
+void QMqttSessionStore::clear()
+{
+    m_entries.clear();
+    m_pendingRecords.clear();
+    m_liveSize = 0;
+    if (m_file.isOpen()) {
+        compact();
+    }
+}
+
+/*!
+   \internal
+ */
+QVector<QMqttSessionStore::Entry> QMqttSessionStore::entries() const
+{
+    QVector<QPair<quint64, Entry>> sorted;
+    sorted.reserve(m_entries.size());
+    for (auto it = m_entries.cbegin(); it != m_entries.cend(); ++it) {
+        sorted.append(qMakePair(it->sequence, Entry { it.key(), it->packet, it->released }));
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const QPair<quint64, Entry> &a, const QPair<quint64, Entry> &b) {
+        return a.first < b.first;
+    });
+
+    QVector<Entry> result;
+    result.reserve(sorted.size());
+    for (const QPair<quint64, Entry> &entry : sorted) {
+        result.append(entry.second);
+    }
+    return result;
+}
+
+/*!
+   \internal
+ */
+int QMqttSessionStore::size() const
+{
+    return m_entries.size();
+}
+
+/*!
+   \internal
+ */
+bool QMqttSessionStore::isEmpty() const
+{
+    return m_entries.isEmpty();
+}
+
+/*!
+  Writes the records added since the last commit with a single write, and syncs them to disk.
+  The log is compacted when it grew beyond COMPACTION_THRESHOLD and consists mostly of records
+  of acknowledged messages.
+  Normally called from the event loop; can be called directly to make the records durable right
+  away. Returns false if writing failed; the log is then truncated to its last complete record,
+  and the records are written again by the next commit.
+  The file is unbuffered, so that a failed write leaves no bytes behind in a buffer.
+
+   \internal
+ */
+bool QMqttSessionStore::commit()
+{
+    m_commitTimer.stop();
+    if (m_pendingRecords.isEmpty() || !m_file.isOpen()) {
+        return true;
+    }
+    const qint64 committedSize = m_file.pos();
+    if (m_file.write(m_pendingRecords) != m_pendingRecords.size() || !syncToDisk(m_file)) {
+        m_errorString = m_file.errorString();
+        qCWarning(module) << "Cannot write session file" << m_file.fileName() << m_errorString;
+        //cut off the records that were written partially, so that the log still ends with a
+        //complete record when they are written again
+        if (!m_file.resize(committedSize) || !m_file.seek(committedSize)) {
+            qCWarning(module) << "Cannot truncate session file" << m_file.fileName()
+                              << m_file.errorString();
+        }
+        return false;
+    }
+    m_pendingRecords.clear();
+
+    if (m_fileSize > COMPACTION_THRESHOLD && m_fileSize > 2 * m_liveSize) {
+        return compact();
+    }
+    return true;
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionStore::append(RecordType type, uint16_t packetIdentifier, const QByteArray &data)
+{
+    if (!m_file.isOpen()) {
+        return;
+    }
+    appendRecord(m_pendingRecords, type, packetIdentifier, data);
+    m_fileSize += recordSize(data.size());
+    if (!m_commitTimer.isActive()) {
+        m_commitTimer.start();
+    }
+}
+
+/*!
+  Rebuilds the entries from the log.
+
+   \internal
+ */
+bool QMqttSessionStore::recover()
+{
+    m_entries.clear();
+    m_pendingRecords.clear();
+    m_nextSequence = 0;
+    m_liveSize = sizeof(LOG_MAGIC);
+
+    const qint64 size = m_file.size();
+    if (size == 0) {
+        if (m_file.write(header()) != qint64(sizeof(LOG_MAGIC)) || !syncToDisk(m_file)) {
+            m_errorString = m_file.errorString();
+            return false;
+        }
+        m_fileSize = sizeof(LOG_MAGIC);
+        return true;
+    }
+
+    const uchar * const data = m_file.map(0, size);
+    if (!data) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    if (size < qint64(sizeof(LOG_MAGIC)) || std::memcmp(data, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+        m_file.unmap(const_cast<uchar *>(data));
+        m_errorString = QStringLiteral("Not a session file.");
+        return false;
+    }
+
+    qint64 offset = sizeof(LOG_MAGIC);
+    while (offset + RECORD_HEADER_SIZE <= size) {
+        const uchar * const record = data + offset;
+        const RecordType type = RecordType(record[0]);
+        const uint16_t packetIdentifier = qFromBigEndian<quint16>(record + 1);
+        const quint32 length = qFromBigEndian<quint32>(record + 3);
+        if (length > quint32(size - offset - RECORD_HEADER_SIZE)) {
+            break;  //partially written record
+        }
+        if (qFromBigEndian<quint32>(record + CHECKSUM_OFFSET) != recordChecksum(record, length)) {
+            break;  //torn or corrupted record
+        }
+        const char * const recordData = reinterpret_cast<const char *>(record + RECORD_HEADER_SIZE);
+
+        if (type == RecordType::STORE) {
+            //a stored message always has an identifier and a packet; anything else is garbage,
+            //that must not be redelivered
+            if (packetIdentifier == 0 || length == 0) {
+                break;
+            }
+            const QByteArray packet(recordData, int(length));
+            m_entries.insert(packetIdentifier, StoredEntry { m_nextSequence++, packet, false });
+        } else if (type == RecordType::RELEASE) {
+            const auto it = m_entries.find(packetIdentifier);
+            if (it != m_entries.end()) {
+                it->released = true;
+            }
+        } else if (type == RecordType::REMOVE) {
+            m_entries.remove(packetIdentifier);
+        } else {
+            break;  //garbage at the end of the log
+        }
+        offset += RECORD_HEADER_SIZE + length;
+    }
+    m_file.unmap(const_cast<uchar *>(data));
+
+    if (offset < size) {
+        qCWarning(module) << "Discarding" << (size - offset) << "bytes of incomplete or corrupted records at the end of"
+                          << m_file.fileName();
+        if (!m_file.resize(offset)) {
+            m_errorString = m_file.errorString();
+            return false;
+        }
+    }
+    if (!m_file.seek(offset)) {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    m_fileSize = offset;
+    for (const StoredEntry &entry : m_entries) {
+        m_liveSize += recordSize(entry.packet.size()) + (entry.released ? recordSize(0) : 0);
+    }
+    return true;
+}
+
+/*!
+  Replaces the log by a log that only contains the current entries.
+  The new log is written next to the old one, and atomically renamed over it.
+
+   \internal
+ */
+bool QMqttSessionStore::compact()
+{
+    QByteArray compacted = header();
+    compacted.reserve(int(m_liveSize));
+    for (const Entry &entry : entries()) {
+        appendRecord(compacted, RecordType::STORE, entry.packetIdentifier, entry.packet);
+        if (entry.released) {
+            appendRecord(compacted, RecordType::RELEASE, entry.packetIdentifier, QByteArray());
+        }
+    }
+
+    QSaveFile saveFile(m_file.fileName());
+    if (!saveFile.open(QIODevice::WriteOnly) || saveFile.write(compacted) != compacted.size()
+            || !syncToDisk(saveFile)) {
+        m_errorString = saveFile.errorString();
+        qCWarning(module) << "Cannot compact session file" << m_file.fileName() << m_errorString;
+        saveFile.cancelWriting();
+        return false;
+    }
+    m_file.close();
+    const bool committed = saveFile.commit();
+    if (!committed) {
+        m_errorString = saveFile.errorString();
+        qCWarning(module) << "Cannot compact session file" << m_file.fileName() << m_errorString;
+    }
+    //the old log is still valid when the new one could not be committed
+    if (!m_file.open(QIODevice::ReadWrite | QIODevice::Unbuffered) || !m_file.seek(m_file.size())) {
+        m_errorString = m_file.errorString();
+        qCWarning(module) << "Cannot reopen session file" << m_file.fileName() << m_errorString;
+        return false;
+    }
+    m_fileSize = m_file.size() + m_pendingRecords.size();
+    m_liveSize = compacted.size();
+    return committed;
+}
+
+/*!
+   \internal
+ */
+QByteArray QMqttSessionStore::header()
+{
+    return QByteArray(LOG_MAGIC, sizeof(LOG_MAGIC));
+}
+
+/*!
+   \internal
+ */
+qint64 QMqttSessionStore::recordSize(int dataSize)
+{
+    return RECORD_HEADER_SIZE + dataSize;
+}
+
+/*!
+   \internal
+ */
+void QMqttSessionStore::appendRecord(QByteArray &buffer, RecordType type, uint16_t packetIdentifier,
+                                     const QByteArray &data)
+{
+    const int offset = buffer.size();
+    buffer.resize(offset + RECORD_HEADER_SIZE + data.size());
+    uchar * const out = reinterpret_cast<uchar *>(buffer.data() + offset);
+    out[0] = uchar(type);
+    qToBigEndian<quint16>(packetIdentifier, out + 1);
+    qToBigEndian<quint32>(quint32(data.size()), out + 3);
+    if (!data.isEmpty()) {
+        std::memcpy(out + RECORD_HEADER_SIZE, data.constData(), size_t(data.size()));
+    }
+    qToBigEndian<quint32>(recordChecksum(out, quint32(data.size())), out + CHECKSUM_OFFSET);
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <QTimer>
+#include <QVector>
+#include "qmqtt_global.h"
+
+//Persists the outgoing QoS 1 and QoS 2 messages that were not acknowledged yet, so that they
+//can be redelivered after a restart of the process (see 4.1 Storing state).
+//The store is an append-only log of records on local disk. Records are collected in memory and
+//written with a single write and fsync at the end of the event loop iteration in which they were
+//added (group commit). When the log mostly consists of records of acknowledged messages, it is
+//compacted by rewriting only the unacknowledged ones.
+class QTMQTT_AUTOTEST_EXPORT QMqttSessionStore
+{
+    Q_DISABLE_COPY(QMqttSessionStore)
+
+public:
+    struct Entry
+    {
+        uint16_t packetIdentifier;
+        QByteArray packet;      //the encoded PUBLISH packet, without DUP flag
+        bool released;          //QoS 2: PUBREC received and PUBREL sent, awaiting PUBCOMP
+    };
+
+    static const qint64 COMPACTION_THRESHOLD = 1024 * 1024;  //1MiB
+
+    explicit QMqttSessionStore(const QString &fileName);
+    ~QMqttSessionStore();
+
+    //opens the log, creating it if needed, and recovers the stored entries
+    bool open();
+    void close();
+    bool isOpen() const;
+    QString fileName() const;
+    QString errorString() const;
+
+    void store(uint16_t packetIdentifier, const QByteArray &packet);
+    void release(uint16_t packetIdentifier);
+    void remove(uint16_t packetIdentifier);
+    void clear();
+
+    //returns the stored entries in the order they were stored
+    QVector<Entry> entries() const;
+    int size() const;
+    bool isEmpty() const;
+
+    //writes and syncs the pending records
+    bool commit();
+
+private:
+    enum class RecordType : uint8_t
+    {
+        STORE = 1,
+        RELEASE = 2,
+        REMOVE = 3
+    };
+
+    struct StoredEntry
+    {
+        quint64 sequence;
+        QByteArray packet;
+        bool released;
+    };
+
+    QFile m_file;
+    QString m_errorString;
+    QHash<uint16_t, StoredEntry> m_entries;
+    quint64 m_nextSequence;
+    QByteArray m_pendingRecords;
+    qint64 m_fileSize;          //including pending records
+    qint64 m_liveSize;          //size of the records needed to recreate m_entries
+    QTimer m_commitTimer;
+
+    void append(RecordType type, uint16_t packetIdentifier, const QByteArray &data = QByteArray());
+    bool recover();
+    bool compact();
+    static QByteArray header();
+    static qint64 recordSize(int dataSize);
+    static void appendRecord(QByteArray &buffer, RecordType type, uint16_t packetIdentifier,
+                             const QByteArray &data);
+};
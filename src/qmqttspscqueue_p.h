@@ -0,0 +1,138 @@
+#pragma once
+
+#include <QtGlobal>
+#include <atomic>
+#include <utility>
+
+//An unbounded lock-free queue for exactly one producer thread and one consumer thread.
+//Values are stored in blocks of BLOCK_SIZE slots: the producer only allocates when a block is
+//full, and the consumer frees a block once it has taken all of its values, so that pushing and
+//popping neither lock nor allocate per value.
+//
+//The queue also coalesces wake-ups of the consumer: push() returns true only for the first
+//value pushed after the consumer found the queue empty, so that a burst of values costs a single
+//wake-up (e.g. one queued invocation) instead of one per value.
+template <typename T>
+class QMqttSpscQueue
+{
+    Q_DISABLE_COPY(QMqttSpscQueue)
+
+public:
+    static const int BLOCK_SIZE = 256;
+
+    QMqttSpscQueue();
+    ~QMqttSpscQueue();
+
+    //producer: appends value; returns true if the consumer is idle and has to be woken up
+    bool push(T value);
+    //consumer: takes the oldest value; returns false, and marks the consumer idle, when the
+    //queue is empty
+    bool pop(T &value);
+    //consumer: returns true if there is no value to pop
+    bool isEmpty() const;
+
+private:
+    struct Block
+    {
+        Block() : values(), written(0), next(nullptr) {}
+
+        T values[BLOCK_SIZE];
+        std::atomic<int> written;       //number of values published by the producer
+        std::atomic<Block *> next;
+    };
+
+    //written by the producer only
+    alignas(64) Block *m_tail;
+    //written by the consumer only
+    alignas(64) Block *m_head;
+    int m_headIndex;
+    alignas(64) std::atomic<bool> m_consumerIdle;
+
+    bool take(T &value);
+};
+
+template <typename T>
+QMqttSpscQueue<T>::QMqttSpscQueue() :
+    m_tail(new Block),
+    m_head(m_tail),
+    m_headIndex(0),
+    m_consumerIdle(true)
+{}
+
+template <typename T>
+QMqttSpscQueue<T>::~QMqttSpscQueue()
+{
+    while (m_head) {
+        Block * const next = m_head->next.load(std::memory_order_relaxed);
+        delete m_head;
+        m_head = next;
+    }
+}
+
+template <typename T>
+bool QMqttSpscQueue<T>::push(T value)
+{
+    int index = m_tail->written.load(std::memory_order_relaxed);
+    if (index == BLOCK_SIZE) {
+        Block * const block = new Block;
+        m_tail->next.store(block, std::memory_order_release);
+        m_tail = block;
+        index = 0;
+    }
+    m_tail->values[index] = std::move(value);
+    m_tail->written.store(index + 1, std::memory_order_release);
+
+    //pairs with the fence in pop(): either the consumer sees the value, or we see it idle
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return m_consumerIdle.load(std::memory_order_relaxed)
+            && m_consumerIdle.exchange(false, std::memory_order_acq_rel);
+}
+
+template <typename T>
+bool QMqttSpscQueue<T>::pop(T &value)
+{
+    if (take(value)) {
+        return true;
+    }
+    m_consumerIdle.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    //a value pushed before the consumer became idle did not wake it up: take it back, unless
+    //the producer already saw the idle consumer and woke it up again
+    if (isEmpty() || !m_consumerIdle.exchange(false, std::memory_order_acq_rel)) {
+        return false;
+    }
+    return take(value);
+}
+
+template <typename T>
+bool QMqttSpscQueue<T>::isEmpty() const
+{
+    if (m_headIndex < BLOCK_SIZE) {
+        return m_headIndex == m_head->written.load(std::memory_order_acquire);
+    }
+    const Block * const next = m_head->next.load(std::memory_order_acquire);
+    return !next || next->written.load(std::memory_order_acquire) == 0;
+}
+
+template <typename T>
+bool QMqttSpscQueue<T>::take(T &value)
+{
+    if (m_headIndex == BLOCK_SIZE) {
+        Block * const next = m_head->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        //the producer moved on to the next block, and does not touch this one anymore
+        delete m_head;
+        m_head = next;
+        m_headIndex = 0;
+    }
+    if (m_headIndex == m_head->written.load(std::memory_order_acquire)) {
+        return false;
+    }
+    value = std::move(m_head->values[m_headIndex]);
+    //release what the value holds now rather than when the block is freed
+    m_head->values[m_headIndex] = T();
+    ++m_headIndex;
+    return true;
+}
@@ -0,0 +1,138 @@
+#include "qmqttstatistics.h"
+#include "qmqttstatistics_p.h"
+
+/*!
+   \internal
+ */
+QMqttStatisticsPrivate::QMqttStatisticsPrivate() :
+    m_bytesReceived(0),
+    m_bytesSent(0),
+    m_packetsReceived(),
+    m_packetsSent(),
+    m_parseErrors(),
+    m_pendingAcknowledgements(0),
+    m_writeBufferSize(0),
+    m_transportBufferSize(0)
+{}
+
+/*!
+    \class QMqttStatistics
+
+    \inmodule QtMqtt
+
+    \brief Counts the traffic of a QMqttClient.
+
+    The statistics of a client are obtained with QMqttClient::statistics(). The counters are
+    updated by the client as it sends and receives packets, and are cumulative over all
+    connections the client made.
+
+    The counters can be read from any thread without locking, so that a metrics collector does
+    not have to synchronize with the thread of the client. Each counter is read atomically, but
+    the counters are not a consistent snapshot: a packet can be counted in packetsReceived()
+    before its bytes are counted in bytesReceived(), or vice versa.
+    The statistics object lives as long as its client.
+ */
+
+/*!
+   \internal
+ */
+QMqttStatistics::QMqttStatistics() :
+    d_ptr(new QMqttStatisticsPrivate)
+{}
+
+/*!
+   Destroys the statistics.
+ */
+QMqttStatistics::~QMqttStatistics()
+{}
+
+/*!
+  Returns the number of bytes received from the server.
+ */
+quint64 QMqttStatistics::bytesReceived() const
+{
+    Q_D(const QMqttStatistics);
+
+    return d->m_bytesReceived.load(std::memory_order_relaxed);
+}
+
+/*!
+  Returns the number of bytes written to the transport.
+ */
+quint64 QMqttStatistics::bytesSent() const
+{
+    Q_D(const QMqttStatistics);
+
+    return d->m_bytesSent.load(std::memory_order_relaxed);
+}
+
+/*!
+  Returns the number of valid packets of the given \a type received from the server.
+ */
+quint64 QMqttStatistics::packetsReceived(QMqttProtocol::PacketType type) const
+{
+    Q_D(const QMqttStatistics);
+
+    return d->m_packetsReceived[size_t(type) & 0x0F].load(std::memory_order_relaxed);
+}
+
+/*!
+  Returns the number of packets of the given \a type sent to the server.
+  A packet is counted when it is handed to the transport or, when the client is corked or has a
+  flush interval, to the write buffer.
+ */
+quint64 QMqttStatistics::packetsSent(QMqttProtocol::PacketType type) const
+{
+    Q_D(const QMqttStatistics);
+
+    return d->m_packetsSent[size_t(type) & 0x0F].load(std::memory_order_relaxed);
+}
+
+/*!
+  Returns the number of times parsing the data from the server failed with \a error, typically
+  QMqttProtocol::Error::INVALID_PACKET.
+ */
+quint64 QMqttStatistics::parseErrors(QMqttProtocol::Error error) const
+{
+    Q_D(const QMqttStatistics);
+
+    if (int(error) < 0 || int(error) >= QMqttStatisticsPrivate::ERROR_COUNT) {
+        return 0;
+    }
+    return d->m_parseErrors[size_t(error)].load(std::memory_order_relaxed);
+}
+
+/*!
+  Returns the number of subscribe, unsubscribe and publish requests that await an
+  acknowledgement from the server.
+ */
+int QMqttStatistics::pendingAcknowledgements() const
+{
+    Q_D(const QMqttStatistics);
+
+    return d->m_pendingAcknowledgements.load(std::memory_order_relaxed);
+}
+
+/*!
+  Returns the number of bytes held back in the write buffer of the client, because it is
+  corked or waits for its flush interval.
+
+  \sa QMqttClient::cork(), QMqttClient::setFlushInterval()
+ */
+qint64 QMqttStatistics::writeBufferSize() const
+{
+    Q_D(const QMqttStatistics);
+
+    return d->m_writeBufferSize.load(std::memory_order_relaxed);
+}
+
+/*!
+  Returns the number of bytes written to the transport that were not yet sent over the network.
+  For WebSocket connections this is an estimate, as the framing overhead is not accounted for.
+ */
+qint64 QMqttStatistics::transportBufferSize() const
+{
+    Q_D(const QMqttStatistics);
+
+    return d->m_transportBufferSize.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QScopedPointer>
+#include "qmqttprotocol.h"
+#include "qmqtt_global.h"
+
+class QMqttStatisticsPrivate;
+class QTMQTT_EXPORT QMqttStatistics
+{
+    Q_DECLARE_PRIVATE(QMqttStatistics)
+    Q_DISABLE_COPY(QMqttStatistics)
+
+public:
+    ~QMqttStatistics();
+
+    quint64 bytesReceived() const;
+    quint64 bytesSent() const;
+    quint64 packetsReceived(QMqttProtocol::PacketType type) const;
+    quint64 packetsSent(QMqttProtocol::PacketType type) const;
+    quint64 parseErrors(QMqttProtocol::Error error) const;
+
+    int pendingAcknowledgements() const;
+    qint64 writeBufferSize() const;
+    qint64 transportBufferSize() const;
+
+private:
+    friend class QMqttClientPrivate;
+
+    QMqttStatistics();
+
+    QScopedPointer<QMqttStatisticsPrivate> d_ptr;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <QtGlobal>
+#include <array>
+#include <atomic>
+#include "qmqttprotocol.h"
+#include "qmqtt_global.h"
+
+//The counters of a QMqttStatistics.
+//Each counter is only written by one thread: the thread of the client or, for the bytes sent and
+//everything received, the I/O thread when it is enabled. Counters can be read from any thread
+//without locking. As there is a single writer, a counter is incremented with a relaxed load
+//and store instead of an atomic read-modify-write, which would lock the memory bus.
+class QTMQTT_AUTOTEST_EXPORT QMqttStatisticsPrivate
+{
+    Q_DISABLE_COPY(QMqttStatisticsPrivate)
+
+public:
+    static const int PACKET_TYPE_COUNT = int(QMqttProtocol::PacketType::RESERVED_15) + 1;
+    static const int ERROR_COUNT = int(QMqttProtocol::Error::CONNECTION_FAILED) + 1;
+
+    QMqttStatisticsPrivate();
+
+    static void add(std::atomic<quint64> &counter, quint64 value = 1)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+
+    void packetReceived(QMqttProtocol::PacketType type)
+    {
+        add(m_packetsReceived[size_t(type) & 0x0F]);
+    }
+
+    void packetSent(QMqttProtocol::PacketType type)
+    {
+        add(m_packetsSent[size_t(type) & 0x0F]);
+    }
+
+    void parseError(QMqttProtocol::Error error)
+    {
+        if (int(error) >= 0 && int(error) < ERROR_COUNT) {
+            add(m_parseErrors[size_t(error)]);
+        }
+    }
+
+    std::atomic<quint64> m_bytesReceived;
+    std::atomic<quint64> m_bytesSent;
+    std::array<std::atomic<quint64>, PACKET_TYPE_COUNT> m_packetsReceived;
+    std::array<std::atomic<quint64>, PACKET_TYPE_COUNT> m_packetsSent;
+    std::array<std::atomic<quint64>, ERROR_COUNT> m_parseErrors;
+    std::atomic<int> m_pendingAcknowledgements;
+    std::atomic<qint64> m_writeBufferSize;
+    std::atomic<qint64> m_transportBufferSize;
+};
@@ -0,0 +1,87 @@
+#include "qmqttsubscription.h"
+#include "qmqttsubscription_p.h"
+
+/*!
+   \class QMqttSubscription
+
+   \inmodule QtMqtt
+
+    \brief A handle to a subscription on a topic filter.
+
+    A QMqttSubscription is returned by QMqttClient::subscribe() and only receives the messages
+    whose topic name matches its topicFilter(). This saves the application from matching the
+    topic of every message delivered through QMqttClient::messageReceived() against its own
+    filters: the client dispatches messages to subscriptions through a trie of topic levels,
+    at a cost proportional to the depth of the topic instead of the number of subscriptions.
+
+    Destroying the subscription stops the delivery of messages to it, but does not unsubscribe
+    the client from the server. Use QMqttClient::unsubscribe() for that.
+
+    \sa QMqttClient::subscribe()
+ */
+
+/*!
+    \fn void QMqttSubscription::subscribed(bool success)
+
+    This signal is emitted when the server acknowledged the subscription. \a success is false
+    when the server refused the subscription.
+*/
+
+/*!
+    \fn void QMqttSubscription::messageReceived(const QString &topicName, const QByteArray &message)
+
+    This signal is emitted when a \a message was received on a topic with the given \a topicName
+    that matches the topicFilter() of this subscription.
+*/
+
+/*!
+   \internal
+ */
+QMqttSubscriptionPrivate::QMqttSubscriptionPrivate(const QString &topicFilter,
+                                                   QMqttProtocol::QoS qos,
+                                                   QMqttClientPrivate *client) :
+    m_topicFilter(topicFilter),
+    m_qos(qos),
+    m_client(client)
+{}
+
+/*!
+   \internal
+ */
+QMqttSubscription::QMqttSubscription(const QString &topicFilter, QMqttProtocol::QoS qos,
+                                     QMqttClientPrivate *client, QObject *parent) :
+    QObject(parent),
+    d_ptr(new QMqttSubscriptionPrivate(topicFilter, qos, client))
+{}
+
+/*!
+  Destroys the subscription. No more messages will be delivered to it.
+ */
+QMqttSubscription::~QMqttSubscription()
+{
+    Q_D(QMqttSubscription);
+
+    if (d->m_client) {
+        d->m_client->removeSubscription(this);
+    }
+}
+
+/*!
+  Returns the topic filter of this subscription.
+ */
+QString QMqttSubscription::topicFilter() const
+{
+    Q_D(const QMqttSubscription);
+
+    return d->m_topicFilter;
+}
+
+/*!
+  Returns the requested Quality of Service of this subscription.
+ */
+QMqttProtocol::QoS QMqttSubscription::qos() const
+{
+    Q_D(const QMqttSubscription);
+
+    return d->m_qos;
+}
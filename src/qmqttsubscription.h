@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QScopedPointer>
+#include "qmqttprotocol.h"
+#include "qmqtt_global.h"
+
+class QMqttClientPrivate;
+class QMqttSubscriptionPrivate;
+class QTMQTT_EXPORT QMqttSubscription : public QObject
+{
+    Q_OBJECT
+    Q_DECLARE_PRIVATE(QMqttSubscription)
+    Q_DISABLE_COPY(QMqttSubscription)
+
+public:
+    virtual ~QMqttSubscription();
+
+    QString topicFilter() const;
+    QMqttProtocol::QoS qos() const;
+
+Q_SIGNALS:
+    void subscribed(bool success);
+    void messageReceived(const QString &topicName, const QByteArray &message);
+
+private:
+    friend class QMqttClientPrivate;
+    QMqttSubscription(const QString &topicFilter, QMqttProtocol::QoS qos,
+                      QMqttClientPrivate *client, QObject *parent);
+
+    QScopedPointer<QMqttSubscriptionPrivate> d_ptr;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QString>
+#include <QPointer>
+#include "qmqttprotocol.h"
+#include "qmqttclient_p.h"
+
+class QMqttSubscriptionPrivate
+{
+public:
+    QMqttSubscriptionPrivate(const QString &topicFilter, QMqttProtocol::QoS qos,
+                             QMqttClientPrivate *client);
+
+public:
+    const QString m_topicFilter;
+    const QMqttProtocol::QoS m_qos;
+    //the client private is destroyed before the subscriptions that are parented to the client
+    QPointer<QMqttClientPrivate> m_client;
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QVector>
+#include <QVarLengthArray>
+
+//A hashed timer wheel, to run the timers of many objects off a single ticking QTimer.
+//A timer is an id with a deadline, counted in ticks; it is kept in the slot of its deadline
+//modulo the number of slots, so that scheduling a timer is O(1) and a tick only visits the
+//timers of one slot. Timers further away than one turn of the wheel wait in their slot for
+//the turns in between.
+//Timers cannot be cancelled: the owner of an id ignores expirations that it no longer expects,
+//which is cheaper than looking the timer up when e.g. a keep-alive is postponed.
+class QMqttTimerWheel
+{
+    Q_DISABLE_COPY(QMqttTimerWheel)
+
+public:
+    explicit QMqttTimerWheel(int slotCount);
+
+    //the current tick, which starts at 0
+    quint64 now() const;
+    //number of scheduled timers
+    int size() const;
+
+    //schedules id to expire after ticks, which is at least 1
+    void schedule(quint32 id, int ticks);
+
+    //advances the wheel by one tick, and calls f(id) for each timer that expires; f can
+    //schedule new timers
+    template <typename F>
+    void advance(F f);
+
+private:
+    struct Timer
+    {
+        quint32 id;
+        quint64 deadline;
+    };
+
+    QVector<QVector<Timer>> m_slots;
+    quint64 m_now;
+    int m_size;
+};
+
+inline QMqttTimerWheel::QMqttTimerWheel(int slotCount) :
+    m_slots(qMax(1, slotCount)),
+    m_now(0),
+    m_size(0)
+{}
+
+inline quint64 QMqttTimerWheel::now() const
+{
+    return m_now;
+}
+
+inline int QMqttTimerWheel::size() const
+{
+    return m_size;
+}
+
+inline void QMqttTimerWheel::schedule(quint32 id, int ticks)
+{
+    const quint64 deadline = m_now + quint64(qMax(1, ticks));
+    m_slots[int(deadline % quint64(m_slots.size()))].append(Timer { id, deadline });
+    ++m_size;
+}
+
+template <typename F>
+void QMqttTimerWheel::advance(F f)
+{
+    ++m_now;
+    QVector<Timer> &slot = m_slots[int(m_now % quint64(m_slots.size()))];
+    //collect the expired timers first, as f can schedule timers into this slot
+    QVarLengthArray<quint32, 64> expired;
+    int i = 0;
+    while (i < slot.size()) {
+        if (slot.at(i).deadline == m_now) {
+            expired.append(slot.at(i).id);
+            slot[i] = slot.last();
+            slot.removeLast();
+        } else {
+            ++i;
+        }
+    }
+    m_size -= expired.size();
+    for (quint32 id : expired) {
+        f(id);
+    }
+}
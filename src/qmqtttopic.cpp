@@ -0,0 +1,76 @@
+#include "qmqtttopic.h"
+#include <QtEndian>
+#include <QDebug>
+#include <limits>
+#include <cstring>
+#include "logging_p.h"
+
+LoggingModule("QMqttTopic");
+
+/*!
+    \class QMqttTopic
+
+    \brief A topic name to publish messages to.
+
+    Publishing to a topic given as a QString validates and encodes the topic name for every
+    message. A QMqttTopic does this once, when it is created: it keeps the topic name in the
+    form in which it is written into PUBLISH packets, so that publishing to it only copies these
+    bytes. Applications that publish to the same topics repeatedly should create a QMqttTopic
+    for each of them, and pass it to QMqttClient::publish().
+
+    A topic name is valid if it is not empty, does not contain the wildcard characters \c + and
+    \c #, nor the null character, and is at most 65535 bytes long when encoded in UTF-8
+    (see 4.7 Topic Names and Topic Filters of the MQTT 3.1.1 specification).
+
+    QMqttTopic is a value type; copying a topic is cheap.
+ */
+
+/*!
+    Creates an invalid topic.
+ */
+QMqttTopic::QMqttTopic() :
+    m_name(),
+    m_encoded()
+{}
+
+/*!
+    Creates a topic with the given \a name. If \a name is not a valid topic name, a warning is
+    logged and the topic is invalid; messages published to it are not sent.
+
+    \sa isValid()
+ */
+QMqttTopic::QMqttTopic(const QString &name) :
+    m_name(name),
+    m_encoded()
+{
+    if (name.isEmpty() || name.contains(QLatin1Char('+')) || name.contains(QLatin1Char('#'))
+            || name.contains(QChar(0))) {
+        qCWarning(module) << "Invalid topic name" << name;
+        return;
+    }
+    const QByteArray utf8 = name.toUtf8();
+    if (utf8.size() > std::numeric_limits<uint16_t>::max()) {
+        qCWarning(module) << "Topic name is too long: size =" << utf8.size()
+                          << "maximum size=" << std::numeric_limits<uint16_t>::max();
+        return;
+    }
+    m_encoded.resize(int(sizeof(uint16_t)) + utf8.size());
+    qToBigEndian<quint16>(quint16(utf8.size()), reinterpret_cast<uchar *>(m_encoded.data()));
+    memcpy(m_encoded.data() + sizeof(uint16_t), utf8.constData(), size_t(utf8.size()));
+}
+
+/*!
+    Returns true if the topic has a valid name.
+ */
+bool QMqttTopic::isValid() const
+{
+    return !m_encoded.isEmpty();
+}
+
+/*!
+    Returns the name of the topic.
+ */
+QString QMqttTopic::name() const
+{
+    return m_name;
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QMetaType>
+#include "qmqtt_global.h"
+
+//A topic name to publish to, validated and encoded once. The members are kept inline rather
+//than behind a private pointer, so that copying a topic does not allocate.
+class QTMQTT_EXPORT QMqttTopic
+{
+public:
+    QMqttTopic();
+    explicit QMqttTopic(const QString &name);
+
+    bool isValid() const;
+    QString name() const;
+
+private:
+    friend class QMqttPublishControlPacket;
+
+    QString m_name;
+    //the UTF-8 encoded name, preceded by its 2 byte length, as it is written into PUBLISH packets;
+    //empty if the name is invalid
+    QByteArray m_encoded;
+};
+
+Q_DECLARE_METATYPE(QMqttTopic)
@@ -0,0 +1,167 @@
+#include "qmqtttopiccache_p.h"
+#include "qmqttmessage.h"
+#include <cstring>
+
+/*!
+    \class QMqttTopicCache
+
+    \inmodule QtMqtt
+
+    \brief Shares the decoded topic names of received messages.
+
+    \internal
+ */
+
+/*!
+   \internal
+ */
+QMqttTopicCache::QMqttTopicCache(int capacity) :
+    m_entries(),
+    m_indexes(),
+    m_capacity(qMax(0, capacity)),
+    m_hand(0)
+{}
+
+/*!
+   \internal
+ */
+QMqttTopicCache::~QMqttTopicCache()
+{}
+
+/*!
+  Returns the 32-bit FNV-1a hash of the \a size bytes at \a rawTopic.
+
+   \internal
+ */
+quint32 QMqttTopicCache::hash(const char *rawTopic, int size)
+{
+    quint32 h = 2166136261u;
+    for (int i = 0; i < size; ++i) {
+        h ^= quint8(rawTopic[i]);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/*!
+  Returns the cached topic name whose UTF-8 encoding is the \a size bytes at \a rawTopic, with
+  the given \a hash, and marks it as referenced. Returns a null QString if it is not cached.
+
+   \internal
+ */
+QString QMqttTopicCache::find(const char *rawTopic, int size, quint32 hash)
+{
+    for (auto it = m_indexes.constFind(hash); (it != m_indexes.cend()) && (it.key() == hash); ++it) {
+        Entry &entry = m_entries[it.value()];
+        if ((entry.rawTopic.size() == size)
+                && (::memcmp(entry.rawTopic.constData(), rawTopic, size_t(size)) == 0)) {
+            entry.referenced = true;
+            return entry.topic;
+        }
+    }
+    return QString();
+}
+
+/*!
+  Returns the topic name whose UTF-8 encoding is the \a size bytes at \a rawTopic, with the
+  given \a hash. If it is not cached, it is decoded and cached, replacing the entry under the
+  hand of the clock when the cache is full.
+
+   \internal
+ */
+QString QMqttTopicCache::intern(const char *rawTopic, int size, quint32 hash)
+{
+    QString topic = find(rawTopic, size, hash);
+    if (!topic.isNull()) {
+        return topic;
+    }
+    topic = QString::fromUtf8(rawTopic, size);
+    if (m_capacity == 0) {
+        return topic;
+    }
+    //new entries start unreferenced, so that a topic that is seen only once is the first to go
+    const Entry entry { QByteArray(rawTopic, size), topic, hash, false };
+    if (m_entries.size() < m_capacity) {
+        m_indexes.insert(hash, m_entries.size());
+        m_entries.append(entry);
+        return topic;
+    }
+    while (m_entries.at(m_hand).referenced) {
+        m_entries[m_hand].referenced = false;
+        m_hand = (m_hand + 1) % m_entries.size();
+    }
+    m_indexes.remove(m_entries.at(m_hand).hash, m_hand);
+    m_entries[m_hand] = entry;
+    m_indexes.insert(hash, m_hand);
+    m_hand = (m_hand + 1) % m_entries.size();
+    return topic;
+}
+
+/*!
+  Sets the topic name of \a message to the cached one, without decoding it.
+  Returns false if the topic name of \a message is not cached.
+
+   \internal
+ */
+bool QMqttTopicCache::resolve(const QMqttMessage &message)
+{
+    if (!message.m_topic.isNull()) {
+        return true;
+    }
+    message.m_topic = find(message.rawTopicData(), message.rawTopicSize(), message.topicHash());
+    return !message.m_topic.isNull();
+}
+
+/*!
+  Sets the topic name of \a message, taking it from the cache or decoding and caching it,
+  and returns it.
+
+   \internal
+ */
+QString QMqttTopicCache::intern(const QMqttMessage &message)
+{
+    if (message.m_topic.isNull()) {
+        message.m_topic = intern(message.rawTopicData(), message.rawTopicSize(), message.topicHash());
+    }
+    return message.m_topic;
+}
+
+/*!
+  Sets the maximum number of cached topic names to \a capacity, and clears the cache.
+  A \a capacity of 0 disables the cache.
+
+   \internal
+ */
+void QMqttTopicCache::setCapacity(int capacity)
+{
+    clear();
+    m_capacity = qMax(0, capacity);
+}
+
+/*!
+   \internal
+ */
+int QMqttTopicCache::capacity() const
+{
+    return m_capacity;
+}
+
+/*!
+  Returns the number of cached topic names.
+
+   \internal
+ */
+int QMqttTopicCache::size() const
+{
+    return m_entries.size();
+}
+
+/*!
+   \internal
+ */
+void QMqttTopicCache::clear()
+{
+    m_entries.clear();
+    m_indexes.clear();
+    m_hand = 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QMultiHash>
+#include "qmqtt_global.h"
+
+class QMqttMessage;
+
+//A bounded table of decoded topic names, keyed by their UTF-8 bytes, so that messages on the
+//same topic share one QString instead of each decoding and allocating a copy of it.
+//When the table is full, an entry is replaced using the CLOCK algorithm: the hand sweeps over
+//the entries, clearing the referenced flag of entries that were looked up since its last pass,
+//and replaces the first entry whose flag is already clear. This approximates LRU without
+//reordering entries on every lookup.
+class QTMQTT_AUTOTEST_EXPORT QMqttTopicCache
+{
+    Q_DISABLE_COPY(QMqttTopicCache)
+
+public:
+    static const int DEFAULT_CAPACITY = 1024;
+
+    explicit QMqttTopicCache(int capacity = DEFAULT_CAPACITY);
+    ~QMqttTopicCache();
+
+    //a 32-bit FNV-1a hash of the UTF-8 bytes of a topic name; it does not depend on the process,
+    //so that it can be used as a key outside of it
+    static quint32 hash(const char *rawTopic, int size);
+
+    //returns the cached topic name with the given UTF-8 bytes, or a null QString
+    QString find(const char *rawTopic, int size, quint32 hash);
+    //returns the topic name with the given UTF-8 bytes, decoding and caching it if needed
+    QString intern(const char *rawTopic, int size, quint32 hash);
+
+    //sets the topic name of message to the cached one, if there is one; returns true if it did
+    bool resolve(const QMqttMessage &message);
+    //sets the topic name of message, decoding and caching it if needed, and returns it
+    QString intern(const QMqttMessage &message);
+
+    //a capacity of 0 disables caching; changing the capacity clears the cache
+    void setCapacity(int capacity);
+    int capacity() const;
+    int size() const;
+    void clear();
+
+private:
+    struct Entry
+    {
+        QByteArray rawTopic;
+        QString topic;
+        quint32 hash;
+        bool referenced;
+    };
+
+    QVector<Entry> m_entries;
+    //entry indexes by hash
+    QMultiHash<quint32, int> m_indexes;
+    int m_capacity;
+    int m_hand;
+};
@@ -0,0 +1,210 @@
+#pragma once
+
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QVector>
+#include <QtAlgorithms>
+
+//A trie of topic filters, with one node per topic level.
+//Matching a topic name visits at most one exact, one `+` and one `#` child per level, so the
+//cost of a match depends on the depth of the topic name and not on the number of filters.
+//See 4.7 Topic Names and Topic Filters in the MQTT v3.1.1 specification for the matching rules.
+//The topic filters inserted in the trie are supposed to be valid.
+template <typename T>
+class QMqttTopicTrie
+{
+    Q_DISABLE_COPY(QMqttTopicTrie)
+
+public:
+    QMqttTopicTrie();
+    ~QMqttTopicTrie();
+
+    void insert(const QString &topicFilter, const T &value);
+    //removes one occurrence of value from topicFilter; returns true if it was found
+    bool remove(const QString &topicFilter, const T &value);
+    //returns the values that are registered with exactly the given topicFilter
+    QVector<T> values(const QString &topicFilter) const;
+    bool isEmpty() const;
+
+    //calls f(value) for each value whose topic filter matches topicName
+    template <typename F>
+    void match(const QString &topicName, F f) const;
+
+private:
+    struct Node
+    {
+        Node() : children(), singleLevel(nullptr), multiLevel(nullptr), values() {}
+        ~Node() { qDeleteAll(children); delete singleLevel; delete multiLevel; }
+
+        bool isEmpty() const
+        {
+            return children.isEmpty() && !singleLevel && !multiLevel && values.isEmpty();
+        }
+
+        QHash<QString, Node *> children;
+        Node *singleLevel;   // +
+        Node *multiLevel;    // #
+        QVector<T> values;
+    };
+
+    Node m_root;
+
+    Node *find(const QString &topicFilter) const;
+    static bool remove(Node *node, const QStringList &levels, int index, const T &value);
+    template <typename F>
+    static void match(const Node *node, const QString &topicName, int from, F &f);
+};
+
+template <typename T>
+QMqttTopicTrie<T>::QMqttTopicTrie() :
+    m_root()
+{}
+
+template <typename T>
+QMqttTopicTrie<T>::~QMqttTopicTrie()
+{}
+
+template <typename T>
+void QMqttTopicTrie<T>::insert(const QString &topicFilter, const T &value)
+{
+    Node *node = &m_root;
+    for (const QString &level : topicFilter.split(QLatin1Char('/'))) {
+        Node **next = nullptr;
+        if (level == QLatin1String("+")) {
+            next = &node->singleLevel;
+        } else if (level == QLatin1String("#")) {
+            next = &node->multiLevel;
+        } else {
+            next = &node->children[level];
+        }
+        if (!*next) {
+            *next = new Node;
+        }
+        node = *next;
+    }
+    node->values.append(value);
+}
+
+template <typename T>
+bool QMqttTopicTrie<T>::remove(const QString &topicFilter, const T &value)
+{
+    return remove(&m_root, topicFilter.split(QLatin1Char('/')), 0, value);
+}
+
+template <typename T>
+QVector<T> QMqttTopicTrie<T>::values(const QString &topicFilter) const
+{
+    const Node * const node = find(topicFilter);
+    return node ? node->values : QVector<T>();
+}
+
+template <typename T>
+bool QMqttTopicTrie<T>::isEmpty() const
+{
+    return m_root.isEmpty();
+}
+
+template <typename T>
+template <typename F>
+void QMqttTopicTrie<T>::match(const QString &topicName, F f) const
+{
+    if (topicName.isEmpty() || m_root.isEmpty()) {
+        return;
+    }
+    match(&m_root, topicName, 0, f);
+}
+
+template <typename T>
+typename QMqttTopicTrie<T>::Node *QMqttTopicTrie<T>::find(const QString &topicFilter) const
+{
+    const Node *node = &m_root;
+    for (const QString &level : topicFilter.split(QLatin1Char('/'))) {
+        if (level == QLatin1String("+")) {
+            node = node->singleLevel;
+        } else if (level == QLatin1String("#")) {
+            node = node->multiLevel;
+        } else {
+            node = node->children.value(level, nullptr);
+        }
+        if (!node) {
+            return nullptr;
+        }
+    }
+    return const_cast<Node *>(node);
+}
+
+//removes value from the node at levels[index..], and prunes nodes that became empty
+template <typename T>
+bool QMqttTopicTrie<T>::remove(Node *node, const QStringList &levels, int index, const T &value)
+{
+    if (index == levels.size()) {
+        return node->values.removeOne(value);
+    }
+
+    const QString &level = levels.at(index);
+    Node **child = nullptr;
+    typename QHash<QString, Node *>::iterator it;
+    if (level == QLatin1String("+")) {
+        child = &node->singleLevel;
+    } else if (level == QLatin1String("#")) {
+        child = &node->multiLevel;
+    } else {
+        it = node->children.find(level);
+        if (it == node->children.end()) {
+            return false;
+        }
+        child = &it.value();
+    }
+    if (!*child || !remove(*child, levels, index + 1, value)) {
+        return false;
+    }
+    if ((*child)->isEmpty()) {
+        delete *child;
+        if (child == &node->singleLevel || child == &node->multiLevel) {
+            *child = nullptr;
+        } else {
+            node->children.erase(it);
+        }
+    }
+    return true;
+}
+
+//from is the index of the first character of the current level in topicName;
+//it is past the end of topicName when all levels have been consumed
+template <typename T>
+template <typename F>
+void QMqttTopicTrie<T>::match(const Node *node, const QString &topicName, int from, F &f)
+{
+    //topic names starting with $ are not matched by filters starting with a wildcard
+    const bool wildcardsAllowed = (from != 0) || !topicName.startsWith(QLatin1Char('$'));
+
+    //# also matches the parent level: sport/# matches sport
+    if (node->multiLevel && wildcardsAllowed) {
+        for (const T &value : node->multiLevel->values) {
+            f(value);
+        }
+    }
+    if (from > topicName.size()) {
+        for (const T &value : node->values) {
+            f(value);
+        }
+        return;
+    }
+
+    int end = topicName.indexOf(QLatin1Char('/'), from);
+    if (end < 0) {
+        end = topicName.size();
+    }
+    if (!node->children.isEmpty()) {
+        //fromRawData does not copy the characters of the level
+        const QString level = QString::fromRawData(topicName.constData() + from, end - from);
+        const Node * const child = node->children.value(level, nullptr);
+        if (child) {
+            match(child, topicName, end + 1, f);
+        }
+    }
+    if (node->singleLevel && wildcardsAllowed) {
+        match(node->singleLevel, topicName, end + 1, f);
+    }
+}
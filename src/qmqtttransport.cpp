@@ -0,0 +1,358 @@
+#include "qmqtttransport_p.h"
+#include "qmqttnetworkrequest.h"
+#include <QUrl>
+#include <QSslSocket>
+#include "logging_p.h"
+
+LoggingModule("QMqttTransport");
+
+/*!
+    \class QMqttTransport
+
+    \inmodule QtMqtt
+
+    \brief Abstract byte stream transport for MQTT control packets.
+
+    The bytes received from the server are signalled through dataReceived(). They are not
+    aligned to packet boundaries and should be fed to a QMqttPacketParser.
+
+    \sa QMqttWebSocketTransport, QMqttTcpTransport
+
+    \internal
+ */
+
+/*!
+    Creates the transport to be used to connect to \a url.
+    The \c mqtt and \c mqtts schemes select a plain TCP or a TLS connection; any other scheme
+    (\c ws, \c wss) selects a WebSocket connection.
+    The caller takes ownership of the returned transport.
+
+    \internal
+ */
+QMqttTransport *QMqttTransport::create(const QUrl &url)
+{
+    const QString scheme = url.scheme().toLower();
+    if (scheme == QStringLiteral("mqtt")) {
+        return new QMqttTcpTransport(false);
+    }
+    if (scheme == QStringLiteral("mqtts")) {
+        return new QMqttTcpTransport(true);
+    }
+    return new QMqttWebSocketTransport;
+}
+
+/*!
+   \internal
+ */
+QMqttTransport::QMqttTransport() :
+    QObject()
+{}
+
+/*!
+   \internal
+ */
+QMqttTransport::~QMqttTransport()
+{}
+
+/*!
+   \internal
+ */
+QMqttWebSocketTransport::QMqttWebSocketTransport() :
+    QMqttTransport(),
+    m_webSocket(),
+    m_bytesToWrite(0)
+{
+    QObject::connect(&m_webSocket, &QWebSocket::connected, this, &QMqttTransport::connected);
+    QObject::connect(&m_webSocket, &QWebSocket::disconnected, this, [this]() {
+        qCDebug(module) << "Received QWebSocket::disconnected, close code" << m_webSocket.closeCode()
+                        << "close reason" << m_webSocket.closeReason();
+        Q_EMIT disconnected();
+    });
+    QObject::connect(&m_webSocket, &QWebSocket::binaryMessageReceived,
+                     this, &QMqttTransport::dataReceived);
+    QObject::connect(&m_webSocket, &QWebSocket::bytesWritten, this, [this](qint64 bytes) {
+        m_bytesToWrite = qMax(Q_INT64_C(0), m_bytesToWrite - bytes);
+        Q_EMIT bytesWritten(bytes);
+    });
+    QObject::connect(&m_webSocket, &QWebSocket::textMessageReceived, this, [this](const QString &msg) {
+        const QString errorMessage
+                = QStringLiteral("Received a text message on the MQTT connection (%1). This should not happen. Connection will be closed.")
+                .arg(msg);
+        Q_EMIT protocolViolation(errorMessage);
+    });
+
+    typedef void (QWebSocket::* sslErrorsSignal)(const QList<QSslError> &);
+    QObject::connect(&m_webSocket, static_cast<sslErrorsSignal>(&QWebSocket::sslErrors),
+                     this, &QMqttTransport::sslErrors);
+
+    typedef void (QWebSocket::* errorSignal)(QAbstractSocket::SocketError);
+    QObject::connect(&m_webSocket, static_cast<errorSignal>(&QWebSocket::error),
+                     this, &QMqttTransport::error);
+}
+
+/*!
+   \internal
+ */
+QMqttWebSocketTransport::~QMqttWebSocketTransport()
+{}
+
+/*!
+   \internal
+ */
+void QMqttWebSocketTransport::open(const QMqttNetworkRequest &request)
+{
+    m_webSocket.open(request);
+}
+
+/*!
+   \internal
+ */
+void QMqttWebSocketTransport::close()
+{
+    m_bytesToWrite = 0;
+    m_webSocket.close();
+}
+
+/*!
+   \internal
+ */
+void QMqttWebSocketTransport::abort()
+{
+    m_bytesToWrite = 0;
+    m_webSocket.abort();
+}
+
+/*!
+   \internal
+ */
+void QMqttWebSocketTransport::write(const QByteArray &data)
+{
+    m_bytesToWrite += m_webSocket.sendBinaryMessage(data);
+}
+
+/*!
+   \internal
+ */
+void QMqttWebSocketTransport::ignoreSslErrors()
+{
+    m_webSocket.ignoreSslErrors();
+}
+
+/*!
+  QWebSocket does not give access to its underlying socket, so \a lowDelay is ignored.
+   \internal
+ */
+void QMqttWebSocketTransport::setLowDelay(bool lowDelay)
+{
+    Q_UNUSED(lowDelay);
+}
+
+/*!
+   \internal
+ */
+QAbstractSocket::SocketState QMqttWebSocketTransport::state() const
+{
+    return m_webSocket.state();
+}
+
+/*!
+   \internal
+ */
+QHostAddress QMqttWebSocketTransport::localAddress() const
+{
+    return m_webSocket.localAddress();
+}
+
+/*!
+   \internal
+ */
+quint16 QMqttWebSocketTransport::localPort() const
+{
+    return m_webSocket.localPort();
+}
+
+/*!
+   \internal
+ */
+QHostAddress QMqttWebSocketTransport::peerAddress() const
+{
+    return m_webSocket.peerAddress();
+}
+
+/*!
+   \internal
+ */
+QString QMqttWebSocketTransport::errorString() const
+{
+    return m_webSocket.errorString();
+}
+
+/*!
+  Returns an estimate of the bytes that were not yet sent, as QWebSocket does not expose its
+  write buffer: the WebSocket framing is counted when bytes are written, but not when they are
+  queued, so the estimate is slightly low.
+   \internal
+ */
+qint64 QMqttWebSocketTransport::bytesToWrite() const
+{
+    return m_bytesToWrite;
+}
+
+/*!
+   \internal
+ */
+QMqttTcpTransport::QMqttTcpTransport(bool secure) :
+    QMqttTransport(),
+    m_secure(secure),
+    m_lowDelay(false),
+    m_socket(secure ? new QSslSocket : new QTcpSocket)
+{
+    //must be connected before the connected signal is forwarded, so that the option is set
+    //before the first packet is written
+    QObject::connect(m_socket.data(), &QTcpSocket::connected, this, [this]() {
+        if (m_lowDelay) {
+            m_socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        }
+    });
+    if (m_secure) {
+        //the MQTT connection can only be used after the TLS handshake has completed
+        QSslSocket * const sslSocket = static_cast<QSslSocket *>(m_socket.data());
+        QObject::connect(sslSocket, &QSslSocket::encrypted, this, &QMqttTransport::connected);
+
+        typedef void (QSslSocket::* sslErrorsSignal)(const QList<QSslError> &);
+        QObject::connect(sslSocket, static_cast<sslErrorsSignal>(&QSslSocket::sslErrors),
+                         this, &QMqttTransport::sslErrors);
+    } else {
+        QObject::connect(m_socket.data(), &QTcpSocket::connected, this, &QMqttTransport::connected);
+    }
+    QObject::connect(m_socket.data(), &QTcpSocket::disconnected, this, &QMqttTransport::disconnected);
+    QObject::connect(m_socket.data(), &QTcpSocket::readyRead, this, [this]() {
+        Q_EMIT dataReceived(m_socket->readAll());
+    });
+    QObject::connect(m_socket.data(), &QTcpSocket::bytesWritten, this, &QMqttTransport::bytesWritten);
+
+    typedef void (QAbstractSocket::* errorSignal)(QAbstractSocket::SocketError);
+    QObject::connect(m_socket.data(), static_cast<errorSignal>(&QAbstractSocket::error),
+                     this, &QMqttTransport::error);
+}
+
+/*!
+   \internal
+ */
+QMqttTcpTransport::~QMqttTcpTransport()
+{}
+
+/*!
+   Connects to the host and port of the url of the \a request.
+   When the url has no port, the IANA registered port for MQTT (1883) or MQTT over TLS (8883)
+   is used.
+   Headers of the \a request are ignored, as there is no HTTP handshake.
+
+   \internal
+ */
+void QMqttTcpTransport::open(const QMqttNetworkRequest &request)
+{
+    const QUrl url = request.url();
+    if (m_secure) {
+        QSslSocket * const sslSocket = static_cast<QSslSocket *>(m_socket.data());
+        sslSocket->setSslConfiguration(request.sslConfiguration());
+        sslSocket->connectToHostEncrypted(url.host(), quint16(url.port(DEFAULT_SECURE_PORT)));
+    } else {
+        m_socket->connectToHost(url.host(), quint16(url.port(DEFAULT_PORT)));
+    }
+}
+
+/*!
+   \internal
+ */
+void QMqttTcpTransport::close()
+{
+    m_socket->disconnectFromHost();
+}
+
+/*!
+   \internal
+ */
+void QMqttTcpTransport::abort()
+{
+    m_socket->abort();
+}
+
+/*!
+   \internal
+ */
+void QMqttTcpTransport::write(const QByteArray &data)
+{
+    m_socket->write(data);
+}
+
+/*!
+   \internal
+ */
+void QMqttTcpTransport::ignoreSslErrors()
+{
+    if (m_secure) {
+        static_cast<QSslSocket *>(m_socket.data())->ignoreSslErrors();
+    }
+}
+
+/*!
+  Sets the TCP_NODELAY option on the socket when \a lowDelay is true.
+  The option is applied as soon as the socket is connected.
+   \internal
+ */
+void QMqttTcpTransport::setLowDelay(bool lowDelay)
+{
+    m_lowDelay = lowDelay;
+    if (m_socket->state() == QAbstractSocket::ConnectedState) {
+        m_socket->setSocketOption(QAbstractSocket::LowDelayOption, m_lowDelay ? 1 : 0);
+    }
+}
+
+/*!
+   \internal
+ */
+QAbstractSocket::SocketState QMqttTcpTransport::state() const
+{
+    return m_socket->state();
+}
+
+/*!
+   \internal
+ */
+QHostAddress QMqttTcpTransport::localAddress() const
+{
+    return m_socket->localAddress();
+}
+
+/*!
+   \internal
+ */
+quint16 QMqttTcpTransport::localPort() const
+{
+    return m_socket->localPort();
+}
+
+/*!
+   \internal
+ */
+QHostAddress QMqttTcpTransport::peerAddress() const
+{
+    return m_socket->peerAddress();
+}
+
+/*!
+   \internal
+ */
+QString QMqttTcpTransport::errorString() const
+{
+    return m_socket->errorString();
+}
+
+/*!
+   \internal
+ */
+qint64 QMqttTcpTransport::bytesToWrite() const
+{
+    return m_socket->bytesToWrite();
+}
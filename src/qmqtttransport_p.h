@@ -0,0 +1,124 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QList>
+#include <QHostAddress>
+#include <QAbstractSocket>
+#include <QSslError>
+#include <QScopedPointer>
+#include <QWebSocket>
+#include <QTcpSocket>
+#include "qmqtt_global.h"
+
+class QUrl;
+class QMqttNetworkRequest;
+
+//A transport carries the MQTT byte stream between client and server.
+//The stream delivered through dataReceived() has no relation to MQTT packet boundaries:
+//it can contain several packets, or only a part of a packet.
+class QTMQTT_AUTOTEST_EXPORT QMqttTransport : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QMqttTransport)
+
+public:
+    //Creates a transport suited for the scheme of the given url:
+    //mqtt and mqtts use a TCP and TLS connection respectively, all other schemes use WebSockets.
+    static QMqttTransport *create(const QUrl &url);
+
+    virtual ~QMqttTransport();
+
+    virtual void open(const QMqttNetworkRequest &request) = 0;
+    virtual void close() = 0;
+    virtual void abort() = 0;
+    virtual void write(const QByteArray &data) = 0;
+    virtual void ignoreSslErrors() = 0;
+    //disables Nagle's algorithm where the transport allows it
+    virtual void setLowDelay(bool lowDelay) = 0;
+
+    virtual QAbstractSocket::SocketState state() const = 0;
+    virtual QHostAddress localAddress() const = 0;
+    virtual quint16 localPort() const = 0;
+    virtual QHostAddress peerAddress() const = 0;
+    virtual QString errorString() const = 0;
+    //number of bytes written that were not yet sent over the network
+    virtual qint64 bytesToWrite() const = 0;
+
+Q_SIGNALS:
+    void connected();
+    void disconnected();
+    void dataReceived(const QByteArray &data);
+    void bytesWritten(qint64 bytes);
+    void sslErrors(const QList<QSslError> &errors);
+    void error(QAbstractSocket::SocketError error);
+    void protocolViolation(const QString &errorMessage);
+
+protected:
+    QMqttTransport();
+};
+
+//MQTT over WebSockets (ws and wss schemes), see 6.0 Using WebSocket as a network transport
+class QTMQTT_AUTOTEST_EXPORT QMqttWebSocketTransport : public QMqttTransport
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QMqttWebSocketTransport)
+
+public:
+    QMqttWebSocketTransport();
+    virtual ~QMqttWebSocketTransport();
+
+    void open(const QMqttNetworkRequest &request) Q_DECL_OVERRIDE;
+    void close() Q_DECL_OVERRIDE;
+    void abort() Q_DECL_OVERRIDE;
+    void write(const QByteArray &data) Q_DECL_OVERRIDE;
+    void ignoreSslErrors() Q_DECL_OVERRIDE;
+    void setLowDelay(bool lowDelay) Q_DECL_OVERRIDE;
+
+    QAbstractSocket::SocketState state() const Q_DECL_OVERRIDE;
+    QHostAddress localAddress() const Q_DECL_OVERRIDE;
+    quint16 localPort() const Q_DECL_OVERRIDE;
+    QHostAddress peerAddress() const Q_DECL_OVERRIDE;
+    QString errorString() const Q_DECL_OVERRIDE;
+    qint64 bytesToWrite() const Q_DECL_OVERRIDE;
+
+private:
+    QWebSocket m_webSocket;
+    //QWebSocket does not report its buffered bytes; they are counted from the writes and the
+    //bytesWritten() notifications, which include the WebSocket framing
+    qint64 m_bytesToWrite;
+};
+
+//MQTT directly over TCP (mqtt scheme) or TLS (mqtts scheme)
+class QTMQTT_AUTOTEST_EXPORT QMqttTcpTransport : public QMqttTransport
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(QMqttTcpTransport)
+
+public:
+    static const quint16 DEFAULT_PORT = 1883;
+    static const quint16 DEFAULT_SECURE_PORT = 8883;
+
+    explicit QMqttTcpTransport(bool secure);
+    virtual ~QMqttTcpTransport();
+
+    void open(const QMqttNetworkRequest &request) Q_DECL_OVERRIDE;
+    void close() Q_DECL_OVERRIDE;
+    void abort() Q_DECL_OVERRIDE;
+    void write(const QByteArray &data) Q_DECL_OVERRIDE;
+    void ignoreSslErrors() Q_DECL_OVERRIDE;
+    void setLowDelay(bool lowDelay) Q_DECL_OVERRIDE;
+
+    QAbstractSocket::SocketState state() const Q_DECL_OVERRIDE;
+    QHostAddress localAddress() const Q_DECL_OVERRIDE;
+    quint16 localPort() const Q_DECL_OVERRIDE;
+    QHostAddress peerAddress() const Q_DECL_OVERRIDE;
+    QString errorString() const Q_DECL_OVERRIDE;
+    qint64 bytesToWrite() const Q_DECL_OVERRIDE;
+
+private:
+    const bool m_secure;
+    bool m_lowDelay;
+    QScopedPointer<QTcpSocket> m_socket;
+};
@@ -0,0 +1,408 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QtEndian>
+
+#include "qmqttclient.h"
+#include "qmqttnetworkrequest.h"
+#include "mqttbrokerstub.h"
+
+class tst_QMqttClient: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttClient();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+
+    void exactlyOnceDuplicates_data();
+    void exactlyOnceDuplicates();
+    void restoreSubscriptions_data();
+    void restoreSubscriptions();
+    void replaceLostConnection();
+    void publishWindow();
+    void cork();
+    void flushInterval();
+    void lowLatencyMode();
+    void subscribeInChunks();
+};
+
+static QByteArray packetIdentifierBytes(quint16 packetIdentifier)
+{
+    QByteArray bytes(2, Qt::Uninitialized);
+    qToBigEndian<quint16>(packetIdentifier, reinterpret_cast<uchar *>(bytes.data()));
+    return bytes;
+}
+
+//the body of a QoS 2 PUBLISH packet
+static QByteArray publishBody(const QByteArray &topicName, quint16 packetIdentifier,
+                              const QByteArray &message)
+{
+    return packetIdentifierBytes(quint16(topicName.size())) + topicName
+            + packetIdentifierBytes(packetIdentifier) + message;
+}
+
+tst_QMqttClient::tst_QMqttClient() :
+    QObject()
+{}
+
+//the scenarios that depend on how received packets reach the client run with and without the
+//I/O thread
+static void addIoThreadColumn()
+{
+    QTest::addColumn<bool>("ioThread");
+
+    QTest::newRow("client thread") << false;
+    QTest::newRow("I/O thread") << true;
+}
+
+void tst_QMqttClient::exactlyOnceDuplicates_data()
+{
+    addIoThreadColumn();
+}
+
+void tst_QMqttClient::exactlyOnceDuplicates()
+{
+    QFETCH(bool, ioThread);
+
+    //packet types and fixed header bytes, see 2.2 Fixed header
+    const quint8 pubRec = 5;
+    const quint8 pubComp = 7;
+    const quint8 publishExactlyOnce = 0x34;
+    const quint8 publishDuplicate = 0x3C;
+    const quint8 pubRel = 0x62;
+
+    MqttBrokerStub broker;
+    QVERIFY2(broker.listen(), qPrintable(broker.errorString()));
+    QMqttClient client(QStringLiteral("client"));
+    client.setIoThreadEnabled(ioThread);
+    QSignalSpy connected(&client, &QMqttClient::connected);
+    QSignalSpy received(&client, &QMqttClient::messageReceived);
+    client.connect(QMqttNetworkRequest(broker.url()));
+    QTRY_COMPARE(connected.count(), 1);
+
+    const QByteArray body = publishBody(QByteArrayLiteral("a/b"), 7, QByteArrayLiteral("hello"));
+    broker.sendToClients(publishExactlyOnce, body);
+    QTRY_COMPARE(broker.packetsReceived(pubRec), quint64(1));
+    QCOMPARE(received.count(), 1);
+    QCOMPARE(received.at(0).at(0).toString(), QStringLiteral("a/b"));
+    QCOMPARE(received.at(0).at(1).toByteArray(), QByteArrayLiteral("hello"));
+
+    //a redelivery before PUBREL is acknowledged again, but not delivered
+    broker.sendToClients(publishDuplicate, body);
+    QTRY_COMPARE(broker.packetsReceived(pubRec), quint64(2));
+    QCOMPARE(received.count(), 1);
+
+    broker.sendToClients(pubRel, packetIdentifierBytes(7));
+    QTRY_COMPARE(broker.packetsReceived(pubComp), quint64(1));
+
+    //after PUBREL, the identifier belongs to a new message
+    broker.sendToClients(publishExactlyOnce, body);
+    QTRY_COMPARE(broker.packetsReceived(pubRec), quint64(3));
+    QCOMPARE(received.count(), 2);
+
+    client.disconnect();
+}
+
+void tst_QMqttClient::restoreSubscriptions_data()
+{
+    addIoThreadColumn();
+}
+
+void tst_QMqttClient::restoreSubscriptions()
+{
+    QFETCH(bool, ioThread);
+    const quint8 subscribe = 8;
+
+    MqttBrokerStub broker;
+    QVERIFY2(broker.listen(), qPrintable(broker.errorString()));
+    QMqttClient client(QStringLiteral("client"));
+    client.setIoThreadEnabled(ioThread);
+    client.setAutoReconnect(true);
+    client.setReconnectDelay(1, 10);
+    QSignalSpy connected(&client, &QMqttClient::connected);
+    QSignalSpy disconnected(&client, &QMqttClient::disconnected);
+    client.connect(QMqttNetworkRequest(broker.url()));
+    QTRY_COMPARE(connected.count(), 1);
+
+    int subscribed = 0;
+    client.subscribe(QStringLiteral("a/#"), QMqttProtocol::QoS::AT_LEAST_ONCE,
+                     [&subscribed](bool success) { subscribed += success ? 1 : 0; });
+    client.subscribe(QStringLiteral("b/+"), QMqttProtocol::QoS::EXACTLY_ONCE,
+                     [&subscribed](bool success) { subscribed += success ? 1 : 0; });
+    QTRY_COMPARE(subscribed, 2);
+    QCOMPARE(broker.packetsReceived(subscribe), quint64(2));
+
+    //the stub keeps no sessions, so the client subscribes again after it reconnected
+    broker.closeConnections();
+    QTRY_COMPARE(disconnected.count(), 1);
+    QTRY_COMPARE(connected.count(), 2);
+    QTRY_COMPARE(broker.subscriptions().size(), 2);
+    QCOMPARE(broker.packetsReceived(subscribe), quint64(3));
+    QVERIFY(broker.subscriptions().contains(QByteArrayLiteral("a/#")));
+    QVERIFY(broker.subscriptions().contains(QByteArrayLiteral("b/+")));
+
+    client.disconnect();
+}
+
+void tst_QMqttClient::replaceLostConnection()
+{
+    MqttBrokerStub broker;
+    QVERIFY2(broker.listen(), qPrintable(broker.errorString()));
+    QMqttClient client(QStringLiteral("client"));
+    client.setIoThreadEnabled(true);
+    QSignalSpy connected(&client, &QMqttClient::connected);
+    QSignalSpy disconnected(&client, &QMqttClient::disconnected);
+    QSignalSpy errors(&client, &QMqttClient::error);
+    client.connect(QMqttNetworkRequest(broker.url()));
+    QTRY_COMPARE(connected.count(), 1);
+
+    //a lost connection is reported by the I/O thread as a transport error and a disconnection;
+    //the client connects again as soon as the first of them makes it go offline, so that the
+    //other one belongs to the replaced connection and must be ignored
+    bool reconnected = false;
+    QObject::connect(&client, &QMqttClient::stateChanged, &client,
+                     [&client, &broker, &reconnected](QMqttProtocol::State state) {
+        if (state == QMqttProtocol::State::OFFLINE && !reconnected) {
+            reconnected = true;
+            client.connect(QMqttNetworkRequest(broker.url()));
+        }
+    });
+    broker.closeConnections();
+
+    QTRY_COMPARE(connected.count(), 2);
+    QVERIFY(reconnected);
+    QTest::qWait(50);
+    QCOMPARE(errors.count() + disconnected.count(), 1);
+
+    //the new connection works
+    bool subscribed = false;
+    client.subscribe(QStringLiteral("a/b"), QMqttProtocol::QoS::AT_LEAST_ONCE,
+                     [&subscribed](bool success) { subscribed = success; });
+    QTRY_VERIFY(subscribed);
+
+    client.disconnect();
+}
+
+void tst_QMqttClient::publishWindow()
+{
+    const quint8 publish = 3;
+    const int window = 3;
+    const int queued = 2;
+
+    MqttBrokerStub broker;
+    QVERIFY2(broker.listen(), qPrintable(broker.errorString()));
+    broker.setRecordMessages(true);
+    QMqttClient client(QStringLiteral("client"));
+    client.setMaximumInflight(window);
+    QSignalSpy connected(&client, &QMqttClient::connected);
+    QSignalSpy windowFull(&client, &QMqttClient::publishWindowFull);
+    QSignalSpy readyToPublish(&client, &QMqttClient::readyToPublish);
+    client.connect(QMqttNetworkRequest(broker.url()));
+    QTRY_COMPARE(connected.count(), 1);
+
+    broker.setHoldAcknowledgements(true);
+    QVector<int> acknowledged;
+    QVector<QByteArray> messages;
+    for (int i = 0; i < window + queued; ++i) {
+        messages.append(QByteArray::number(i));
+        client.publish(QStringLiteral("a/b"), messages.last(), QMqttProtocol::QoS::AT_LEAST_ONCE,
+                       [&acknowledged, i](bool success) {
+            if (success) {
+                acknowledged.append(i);
+            }
+        });
+    }
+    QCOMPARE(windowFull.count(), 1);
+    QCOMPARE(client.inflightCount(), window);
+    QCOMPARE(client.queuedCount(), queued);
+
+    //only the messages in the window are sent while they are not acknowledged
+    QTRY_COMPARE(broker.packetsReceived(publish), quint64(window));
+    QTest::qWait(50);
+    QCOMPARE(broker.packetsReceived(publish), quint64(window));
+    QVERIFY(acknowledged.isEmpty());
+    QCOMPARE(readyToPublish.count(), 0);
+
+    //the acknowledgements make room for the queued messages, which are sent in order
+    broker.setHoldAcknowledgements(false);
+    QTRY_COMPARE(acknowledged.size(), window + queued);
+    QCOMPARE(acknowledged, QVector<int>({ 0, 1, 2, 3, 4 }));
+    QCOMPARE(broker.packetsReceived(publish), quint64(window + queued));
+    QCOMPARE(broker.messagesReceived(), messages);
+    QCOMPARE(readyToPublish.count(), 1);
+    QCOMPARE(windowFull.count(), 1);
+    QCOMPARE(client.inflightCount(), 0);
+    QCOMPARE(client.queuedCount(), 0);
+
+    client.disconnect();
+}
+
+void tst_QMqttClient::cork()
+{
+    const quint8 publish = 3;
+
+    MqttBrokerStub broker;
+    QVERIFY2(broker.listen(), qPrintable(broker.errorString()));
+    QMqttClient client(QStringLiteral("client"));
+    QSignalSpy connected(&client, &QMqttClient::connected);
+    client.connect(QMqttNetworkRequest(broker.url()));
+    QTRY_COMPARE(connected.count(), 1);
+    const quint64 frames = broker.framesReceived();
+
+    client.cork();
+    QVector<int> acknowledged;
+    for (int i = 0; i < 5; ++i) {
+        client.publish(QStringLiteral("a/b"), QByteArray::number(i), QMqttProtocol::QoS::AT_LEAST_ONCE,
+                       [&acknowledged, i](bool success) {
+            if (success) {
+                acknowledged.append(i);
+            }
+        });
+    }
+    QVERIFY(client.statistics().writeBufferSize() > 0);
+    QTest::qWait(50);
+    QCOMPARE(broker.packetsReceived(publish), quint64(0));
+
+    //the packets are written at once, and still acknowledged one by one
+    client.uncork();
+    QCOMPARE(client.statistics().writeBufferSize(), qint64(0));
+    QTRY_COMPARE(broker.packetsReceived(publish), quint64(5));
+    QCOMPARE(broker.framesReceived(), frames + 1);
+    QTRY_COMPARE(acknowledged, QVector<int>({ 0, 1, 2, 3, 4 }));
+
+    client.disconnect();
+}
+
+void tst_QMqttClient::flushInterval()
+{
+    const quint8 publish = 3;
+
+    MqttBrokerStub broker;
+    QVERIFY2(broker.listen(), qPrintable(broker.errorString()));
+    QMqttClient client(QStringLiteral("client"));
+    QSignalSpy connected(&client, &QMqttClient::connected);
+    client.connect(QMqttNetworkRequest(broker.url()));
+    QTRY_COMPARE(connected.count(), 1);
+    const quint64 frames = broker.framesReceived();
+
+    client.setFlushInterval(100);
+    for (int i = 0; i < 3; ++i) {
+        client.publish(QStringLiteral("a/b"), QByteArray::number(i));
+    }
+    QVERIFY(client.statistics().writeBufferSize() > 0);
+    QCOMPARE(broker.packetsReceived(publish), quint64(0));
+
+    //the buffer is written when the flush interval expires
+    QTRY_COMPARE(broker.packetsReceived(publish), quint64(3));
+    QCOMPARE(broker.framesReceived(), frames + 1);
+    QCOMPARE(client.statistics().writeBufferSize(), qint64(0));
+
+    client.disconnect();
+}
+
+void tst_QMqttClient::lowLatencyMode()
+{
+    const quint8 publish = 3;
+    const quint8 subscribe = 8;
+
+    MqttBrokerStub broker;
+    QVERIFY2(broker.listen(), qPrintable(broker.errorString()));
+    QMqttClient client(QStringLiteral("client"));
+    client.setLowLatencyMode(true);
+    QSignalSpy connected(&client, &QMqttClient::connected);
+    client.connect(QMqttNetworkRequest(broker.url()));
+    QTRY_COMPARE(connected.count(), 1);
+
+    //the mode cannot change while connected
+    QTest::ignoreMessage(QtWarningMsg, "Low latency mode can only be changed while offline.");
+    client.setLowLatencyMode(false);
+    QVERIFY(client.isLowLatencyMode());
+
+    //the PUBACK and the SUBACK arrive in the same WebSocket message; the publish callback
+    //starts a timer, that cannot fire before the subscribe callback if both are called while
+    //the message is handled, without returning to the event loop
+    broker.setHoldAcknowledgements(true);
+    bool eventLoopReturned = false;
+    bool published = false;
+    bool subscribedInSameDispatch = false;
+    bool subscribed = false;
+    client.publish(QStringLiteral("a/b"), QByteArrayLiteral("hello"), QMqttProtocol::QoS::AT_LEAST_ONCE,
+                   [&](bool success) {
+        QTimer::singleShot(0, &client, [&eventLoopReturned]() { eventLoopReturned = true; });
+        published = success;
+    });
+    client.subscribe(QStringLiteral("c/d"), QMqttProtocol::QoS::AT_LEAST_ONCE, [&](bool success) {
+        subscribedInSameDispatch = published && !eventLoopReturned;
+        subscribed = success;
+    });
+    QTRY_COMPARE(broker.packetsReceived(publish), quint64(1));
+    QTRY_COMPARE(broker.packetsReceived(subscribe), quint64(1));
+    QVERIFY(!published);
+    QVERIFY(!subscribed);
+
+    broker.setHoldAcknowledgements(false);
+    QTRY_VERIFY(subscribed);
+    QVERIFY(published);
+    QVERIFY(subscribedInSameDispatch);
+
+    client.disconnect();
+}
+
+void tst_QMqttClient::subscribeInChunks()
+{
+    const quint8 subscribe = 8;
+    //the limit of the size of the variable header and payload of SUBSCRIBE packets
+    const int maximumPacketSize = 64 * 1024;
+    const int count = 1000;
+    const QVector<int> refused = { 10, 900 };
+
+    MqttBrokerStub broker;
+    QVERIFY2(broker.listen(), qPrintable(broker.errorString()));
+    QMqttClient client(QStringLiteral("client"));
+    QSignalSpy connected(&client, &QMqttClient::connected);
+    client.connect(QMqttNetworkRequest(broker.url()));
+    QTRY_COMPARE(connected.count(), 1);
+
+    //about 100 KiB of topic filters, with varying QoS
+    QVector<QPair<QString, QMqttProtocol::QoS>> topicFilters;
+    QVector<QMqttProtocol::QoS> expected;
+    for (int i = 0; i < count; ++i) {
+        const QString topicFilter = QStringLiteral("sensors/%1/").arg(i, 4, 10, QLatin1Char('0'))
+                + QString(80, QLatin1Char('x'));
+        const QMqttProtocol::QoS qos = QMqttProtocol::QoS(i % 3);
+        topicFilters.append(qMakePair(topicFilter, qos));
+        if (refused.contains(i)) {
+            broker.refuseTopicFilter(topicFilter.toUtf8());
+            expected.append(QMqttProtocol::QoS::INVALID);
+        } else {
+            expected.append(qos);
+        }
+    }
+
+    bool called = false;
+    QVector<QMqttProtocol::QoS> grantedQos;
+    client.subscribe(topicFilters, [&called, &grantedQos](const QVector<QMqttProtocol::QoS> &qos) {
+        called = true;
+        grantedQos = qos;
+    });
+    QTRY_VERIFY(called);
+
+    QVERIFY(broker.packetsReceived(subscribe) > 1);
+    for (const int size : broker.subscribeSizes()) {
+        QVERIFY(size <= maximumPacketSize);
+    }
+    //the granted QoS of all packets are in the order of the topic filters
+    QCOMPARE(grantedQos.size(), count);
+    QVERIFY(grantedQos == expected);
+
+    client.disconnect();
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttClient)
+
+#include "tst_qmqttclient.moc"
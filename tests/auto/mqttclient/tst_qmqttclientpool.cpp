@@ -0,0 +1,90 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QThread>
+
+#include "qmqttclientpool.h"
+
+class tst_QMqttClientPool: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttClientPool();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+
+    void clientIds();
+    void invalidConnectionCount();
+    void connectionIndex();
+    void callbackOnPoolThread();
+};
+
+tst_QMqttClientPool::tst_QMqttClientPool() :
+    QObject()
+{}
+
+void tst_QMqttClientPool::clientIds()
+{
+    QMqttClientPool pool(QStringLiteral("device"), 3);
+
+    QCOMPARE(pool.connectionCount(), 3);
+    QCOMPARE(pool.clientId(0), QStringLiteral("device0"));
+    QCOMPARE(pool.clientId(2), QStringLiteral("device2"));
+    QVERIFY(pool.clientId(3).isEmpty());
+    QVERIFY(!pool.isConnected());
+
+    //the server assigns the client ids
+    QMqttClientPool anonymousPool(QString(), 2);
+    QVERIFY(anonymousPool.clientId(0).isEmpty());
+}
+
+void tst_QMqttClientPool::invalidConnectionCount()
+{
+    QMqttClientPool pool(QStringLiteral("device"), 0);
+
+    QCOMPARE(pool.connectionCount(), 1);
+}
+
+void tst_QMqttClientPool::connectionIndex()
+{
+    QMqttClientPool pool(QStringLiteral("device"), 4);
+
+    QVector<int> topicsPerConnection(pool.connectionCount(), 0);
+    for (int i = 0; i < 100; ++i) {
+        const QString topic = QStringLiteral("sensors/%1/temperature").arg(i);
+        const int index = pool.connectionIndex(topic);
+        QVERIFY(index >= 0 && index < pool.connectionCount());
+        //a topic keeps its connection
+        QCOMPARE(pool.connectionIndex(topic), index);
+        ++topicsPerConnection[index];
+    }
+    for (int count : topicsPerConnection) {
+        QVERIFY(count > 0);
+    }
+}
+
+void tst_QMqttClientPool::callbackOnPoolThread()
+{
+    QMqttClientPool pool(QStringLiteral("device"), 2);
+
+    bool called = false;
+    bool result = true;
+    QThread *callbackThread = nullptr;
+    pool.publish(QStringLiteral("sensors/1"), QByteArrayLiteral("20.5"), QMqttProtocol::QoS::INVALID,
+                 [&](bool success) {
+        called = true;
+        result = success;
+        callbackThread = QThread::currentThread();
+    });
+    QTRY_VERIFY(called);
+    QVERIFY(!result);
+    QCOMPARE(callbackThread, QThread::currentThread());
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttClientPool)
+
+#include "tst_qmqttclientpool.moc"
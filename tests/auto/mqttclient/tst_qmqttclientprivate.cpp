@@ -0,0 +1,62 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <limits>
+
+#include "qmqttclient_p.h"
+
+class tst_QMqttClientPrivate: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttClientPrivate();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+
+    void reconnectDelayBound_data();
+    void reconnectDelayBound();
+};
+
+tst_QMqttClientPrivate::tst_QMqttClientPrivate() :
+    QObject()
+{}
+
+void tst_QMqttClientPrivate::reconnectDelayBound_data()
+{
+    const int maximumInt = std::numeric_limits<int>::max();
+
+    QTest::addColumn<int>("attempt");
+    QTest::addColumn<int>("minimumMs");
+    QTest::addColumn<int>("maximumMs");
+    QTest::addColumn<int>("bound");
+
+    QTest::newRow("first attempt") << 0 << 100 << 10000 << 100;
+    QTest::newRow("second attempt") << 1 << 100 << 10000 << 200;
+    QTest::newRow("third attempt") << 2 << 100 << 10000 << 400;
+    QTest::newRow("below maximum") << 6 << 100 << 10000 << 6400;
+    QTest::newRow("capped at maximum") << 7 << 100 << 10000 << 10000;
+    QTest::newRow("stays at maximum") << 1000 << 100 << 10000 << 10000;
+    QTest::newRow("minimum is maximum") << 3 << 500 << 500 << 500;
+    QTest::newRow("exponent 30") << 30 << 1 << maximumInt << (1 << 30);
+    QTest::newRow("exponent capped at 30") << 31 << 1 << maximumInt << (1 << 30);
+    QTest::newRow("exponent stays at 30") << maximumInt << 1 << maximumInt << (1 << 30);
+    QTest::newRow("no overflow") << 30 << maximumInt << maximumInt << maximumInt;
+}
+
+void tst_QMqttClientPrivate::reconnectDelayBound()
+{
+    QFETCH(int, attempt);
+    QFETCH(int, minimumMs);
+    QFETCH(int, maximumMs);
+    QFETCH(int, bound);
+
+    QCOMPARE(QMqttClientPrivate::reconnectDelayBound(attempt, minimumMs, maximumMs), bound);
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttClientPrivate)
+
+#include "tst_qmqttclientprivate.moc"
@@ -1,6 +1,7 @@
 #include <QtTest/QtTest>
 #include <QtTest/qtestcase.h>
 #include <QUrl>
+#include <limits>
 
 #include "qmqttcontrolpacket_p.h"
 
@@ -17,6 +18,40 @@ private Q_SLOTS:
 //    void init();
 //    void cleanup();
     void packetTypes();
+    void encodeAcknowledgements();
+    void encodePublish();
+    void encodePublishToTopic();
+    void setPacketIdentifier();
+    void encodeSubscribe();
+    void encodeConnect();
+    void encodeLargeRemainingLength();
+    void encodeMaximumRemainingLength();
+    void encodeTooLarge_data();
+    void encodeTooLarge();
+    void encodeTo();
+};
+
+//A packet with a payload of the given size, that is not written, so that packets of the maximum
+//size can be encoded without allocating their payload twice
+class SizedControlPacket : public QMqttControlPacket
+{
+public:
+    SizedControlPacket(int32_t variableHeaderSize, int32_t payloadSize) :
+        QMqttControlPacket(PacketType::PUBLISH),
+        m_variableHeaderSize(variableHeaderSize),
+        m_payloadSize(payloadSize)
+    {}
+
+protected:
+    uint8_t flags() const Q_DECL_OVERRIDE { return 0; }
+    int32_t variableHeaderSize() const Q_DECL_OVERRIDE { return m_variableHeaderSize; }
+    int32_t payloadSize() const Q_DECL_OVERRIDE { return m_payloadSize; }
+    char *writeVariableHeader(char *out) const Q_DECL_OVERRIDE { return out + m_variableHeaderSize; }
+    char *writePayload(char *out) const Q_DECL_OVERRIDE { return out + m_payloadSize; }
+
+private:
+    int32_t m_variableHeaderSize;
+    int32_t m_payloadSize;
 };
 
 tst_QMqttControlPacket::tst_QMqttControlPacket() :
@@ -43,6 +78,150 @@ void tst_QMqttControlPacket::packetTypes()
     QCOMPARE(int(QMqttControlPacket::PacketType::RESERVED_15), 15);
 }
 
+void tst_QMqttControlPacket::encodeAcknowledgements()
+{
+    QCOMPARE(QMqttPubAckControlPacket(0x1234).encode(), QByteArrayLiteral("\x40\x02\x12\x34"));
+    QCOMPARE(QMqttPubRecControlPacket(1).encode(), QByteArrayLiteral("\x50\x02\x00\x01"));
+    QCOMPARE(QMqttPubRelControlPacket(1).encode(), QByteArrayLiteral("\x62\x02\x00\x01"));
+    QCOMPARE(QMqttPubCompControlPacket(1).encode(), QByteArrayLiteral("\x70\x02\x00\x01"));
+    QCOMPARE(QMqttPingReqControlPacket().encode(), QByteArrayLiteral("\xC0\x00"));
+    QCOMPARE(QMqttDisconnectControlPacket().encode(), QByteArrayLiteral("\xE0\x00"));
+}
+
+void tst_QMqttControlPacket::encodePublish()
+{
+    const QMqttPublishControlPacket qos0(QStringLiteral("a/b"), QByteArrayLiteral("hi"),
+                                         QMqttProtocol::QoS::AT_MOST_ONCE, false);
+    QCOMPARE(qos0.encode(), QByteArrayLiteral("\x30\x07\x00\x03" "a/b" "hi"));
+    QCOMPARE(qos0.encodedSize(), 9);
+
+    //the packet identifier is only present for QoS > 0
+    const QMqttPublishControlPacket qos1(QStringLiteral("a/b"), QByteArrayLiteral("hi"),
+                                         QMqttProtocol::QoS::AT_LEAST_ONCE, true, 10);
+    QCOMPARE(qos1.encode(), QByteArrayLiteral("\x33\x09\x00\x03" "a/b" "\x00\x0A" "hi"));
+
+    //redelivered packets carry the dup flag
+    QCOMPARE(QMqttPublishControlPacket::markDuplicate(qos1.encode()),
+             QByteArrayLiteral("\x3B\x09\x00\x03" "a/b" "\x00\x0A" "hi"));
+    QCOMPARE(QMqttPublishControlPacket::qos(qos1.encode()), QMqttProtocol::QoS::AT_LEAST_ONCE);
+    QCOMPARE(QMqttPublishControlPacket::qos(qos0.encode()), QMqttProtocol::QoS::AT_MOST_ONCE);
+}
+
+void tst_QMqttControlPacket::encodePublishToTopic()
+{
+    const QMqttTopic topic(QStringLiteral("a/b"));
+    const QMqttPublishControlPacket qos0(topic, QByteArrayLiteral("hi"),
+                                         QMqttProtocol::QoS::AT_MOST_ONCE, false);
+    QCOMPARE(qos0.encode(), QByteArrayLiteral("\x30\x07\x00\x03" "a/b" "hi"));
+    QCOMPARE(qos0.encodedSize(), 9);
+
+    const QMqttPublishControlPacket qos1(topic, QByteArrayLiteral("hi"),
+                                         QMqttProtocol::QoS::AT_LEAST_ONCE, true, 10);
+    QCOMPARE(qos1.encode(), QByteArrayLiteral("\x33\x09\x00\x03" "a/b" "\x00\x0A" "hi"));
+
+    //the same as with a topic name given as string
+    const QString topicName = QString::fromUtf8("sensors/\xC3\xA9t\xC3\xA9");
+    const QByteArray message(200, 'x');
+    QCOMPARE(QMqttPublishControlPacket(QMqttTopic(topicName), message,
+                                       QMqttProtocol::QoS::EXACTLY_ONCE, false, 3).encode(),
+             QMqttPublishControlPacket(topicName, message,
+                                       QMqttProtocol::QoS::EXACTLY_ONCE, false, 3).encode());
+}
+
+void tst_QMqttControlPacket::setPacketIdentifier()
+{
+    QByteArray packet = QMqttPublishControlPacket(QStringLiteral("a/b"), QByteArrayLiteral("hi"),
+                                                  QMqttProtocol::QoS::EXACTLY_ONCE, false).encode();
+    QMqttPublishControlPacket::setPacketIdentifier(packet, 0x1234);
+    QCOMPARE(packet, QByteArrayLiteral("\x34\x09\x00\x03" "a/b" "\x12\x34" "hi"));
+
+    //with a remaining length field of several bytes
+    const QByteArray message(200, 'x');
+    packet = QMqttPublishControlPacket(QStringLiteral("t"), message,
+                                       QMqttProtocol::QoS::AT_LEAST_ONCE, false).encode();
+    QMqttPublishControlPacket::setPacketIdentifier(packet, 7);
+    QCOMPARE(packet, QMqttPublishControlPacket(QStringLiteral("t"), message,
+                                               QMqttProtocol::QoS::AT_LEAST_ONCE, false, 7).encode());
+}
+
+void tst_QMqttControlPacket::encodeSubscribe()
+{
+    const QMqttSubscribeControlPacket subscribe(1, { { QStringLiteral("a"), QMqttProtocol::QoS::AT_LEAST_ONCE },
+                                                     { QStringLiteral("b/#"), QMqttProtocol::QoS::AT_MOST_ONCE } });
+    QCOMPARE(subscribe.encode(),
+             QByteArrayLiteral("\x82\x0C\x00\x01" "\x00\x01" "a" "\x01" "\x00\x03" "b/#" "\x00"));
+
+    const QMqttUnsubscribeControlPacket unsubscribe(2, { QStringLiteral("a") });
+    QCOMPARE(unsubscribe.encode(), QByteArrayLiteral("\xA2\x05\x00\x02" "\x00\x01" "a"));
+}
+
+void tst_QMqttControlPacket::encodeConnect()
+{
+    QMqttConnectControlPacket packet(QStringLiteral("id"));
+    packet.setCredentials(QStringLiteral("user"), QByteArrayLiteral("pw"));
+
+    QCOMPARE(packet.encode(),
+             QByteArrayLiteral("\x10\x18" "\x00\x04" "MQTT" "\x04" "\xC2" "\x00\x1E"
+                               "\x00\x02" "id" "\x00\x04" "user" "\x00\x02" "pw"));
+}
+
+void tst_QMqttControlPacket::encodeLargeRemainingLength()
+{
+    const QByteArray message(20000, 'x');
+    const QByteArray packet = QMqttPublishControlPacket(QStringLiteral("t"), message,
+                                                        QMqttProtocol::QoS::AT_MOST_ONCE, false).encode();
+    //remaining length = 3 + 20000 = 20003 = 0x4E23, encoded as 3 bytes
+    QCOMPARE(packet.size(), 1 + 3 + 20003);
+    QCOMPARE(packet.mid(1, 3), QByteArrayLiteral("\xA3\x9C\x01"));
+    QVERIFY(packet.endsWith(message));
+}
+
+void tst_QMqttControlPacket::encodeMaximumRemainingLength()
+{
+    const SizedControlPacket packet(0, 0x0FFFFFFF);
+    QCOMPARE(packet.remainingLength(), 0x0FFFFFFF);
+    QCOMPARE(packet.encodedSize(), 1 + 4 + 0x0FFFFFFF);
+
+    QByteArray buffer;
+    QVERIFY(packet.encodeTo(buffer));
+    QCOMPARE(buffer.size(), 1 + 4 + 0x0FFFFFFF);
+    QCOMPARE(buffer.left(5), QByteArrayLiteral("\x30\xFF\xFF\xFF\x7F"));
+}
+
+void tst_QMqttControlPacket::encodeTooLarge_data()
+{
+    QTest::addColumn<int>("variableHeaderSize");
+    QTest::addColumn<int>("payloadSize");
+
+    //would need a 5 byte remaining length field
+    QTest::newRow("0x10000000") << 0 << 0x10000000;
+    QTest::newRow("0x10000000 with variable header") << 2 << 0x0FFFFFFE;
+    //the sum does not fit in an int32_t
+    QTest::newRow("overflow") << 2 << std::numeric_limits<int>::max();
+}
+
+void tst_QMqttControlPacket::encodeTooLarge()
+{
+    QFETCH(int, variableHeaderSize);
+    QFETCH(int, payloadSize);
+
+    const SizedControlPacket packet(variableHeaderSize, payloadSize);
+    QCOMPARE(packet.encodedSize(), -1);
+    QByteArray buffer = QByteArrayLiteral("prefix");
+    QVERIFY(!packet.encodeTo(buffer));
+    QCOMPARE(buffer, QByteArrayLiteral("prefix"));
+    QVERIFY(packet.encode().isEmpty());
+}
+
+void tst_QMqttControlPacket::encodeTo()
+{
+    QByteArray buffer = QByteArrayLiteral("prefix");
+    QVERIFY(QMqttPubAckControlPacket(1).encodeTo(buffer));
+    QVERIFY(QMqttPingReqControlPacket().encodeTo(buffer));
+
+    QCOMPARE(buffer, QByteArrayLiteral("prefix" "\x40\x02\x00\x01" "\xC0\x00"));
+}
+
 QTEST_GUILESS_MAIN(tst_QMqttControlPacket)
 
 #include "tst_qmqttcontrolpacket.moc"
@@ -0,0 +1,113 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+
+#include "qmqttlatencyhistogram_p.h"
+
+class tst_QMqttLatencyHistogram: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttLatencyHistogram();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void empty();
+    void bucketBoundaries();
+    void percentiles_data();
+    void percentiles();
+    void outOfRangeValues();
+    void reset();
+};
+
+tst_QMqttLatencyHistogram::tst_QMqttLatencyHistogram() :
+    QObject()
+{}
+
+void tst_QMqttLatencyHistogram::empty()
+{
+    QMqttLatencyHistogram histogram;
+
+    QCOMPARE(histogram.count(), quint64(0));
+    QCOMPARE(histogram.minimum(), qint64(-1));
+    QCOMPARE(histogram.maximum(), qint64(-1));
+    QCOMPARE(histogram.percentile(50), qint64(-1));
+}
+
+void tst_QMqttLatencyHistogram::bucketBoundaries()
+{
+    int previousIndex = 0;
+    for (qint64 value = 0; value < 100000; ++value) {
+        const int index = QMqttLatencyHistogram::bucketIndex(value);
+        QVERIFY(index >= previousIndex);
+        QVERIFY(index < QMqttLatencyHistogram::BUCKET_COUNT);
+        //the value falls in its bucket, and the bucket is at most 1/16th of the value wide
+        QVERIFY(QMqttLatencyHistogram::bucketUpperBound(index) >= value);
+        QVERIFY(index == 0 || QMqttLatencyHistogram::bucketUpperBound(index - 1) < value);
+        QVERIFY(QMqttLatencyHistogram::bucketUpperBound(index) - value <= value / 16);
+        previousIndex = index;
+    }
+}
+
+void tst_QMqttLatencyHistogram::percentiles_data()
+{
+    QTest::addColumn<double>("percentile");
+    QTest::addColumn<qint64>("expectedValue");
+
+    //1..1000 recorded once each; the result is the upper bound of the bucket holding the value
+    QTest::newRow("p0") << 0.0 << qint64(1);
+    QTest::newRow("p50") << 50.0 << qint64(511);
+    QTest::newRow("p99") << 99.0 << qint64(991);
+    QTest::newRow("p999") << 99.9 << qint64(1000);
+    QTest::newRow("p100") << 100.0 << qint64(1000);
+}
+
+void tst_QMqttLatencyHistogram::percentiles()
+{
+    QFETCH(double, percentile);
+    QFETCH(qint64, expectedValue);
+
+    QMqttLatencyHistogram histogram;
+    for (qint64 value = 1000; value >= 1; --value) {
+        histogram.record(value);
+    }
+
+    QCOMPARE(histogram.count(), quint64(1000));
+    QCOMPARE(histogram.minimum(), qint64(1));
+    QCOMPARE(histogram.maximum(), qint64(1000));
+    QCOMPARE(histogram.percentile(percentile), expectedValue);
+}
+
+void tst_QMqttLatencyHistogram::outOfRangeValues()
+{
+    QMqttLatencyHistogram histogram;
+    histogram.record(-5);
+    QCOMPARE(histogram.minimum(), qint64(0));
+    QCOMPARE(histogram.percentile(100), qint64(0));
+
+    const qint64 huge = Q_INT64_C(1) << 50;
+    QCOMPARE(QMqttLatencyHistogram::bucketIndex(huge), QMqttLatencyHistogram::BUCKET_COUNT - 1);
+    histogram.record(huge);
+    QCOMPARE(histogram.maximum(), huge);
+    QCOMPARE(histogram.percentile(100), huge);
+}
+
+void tst_QMqttLatencyHistogram::reset()
+{
+    QMqttLatencyHistogram histogram;
+    histogram.record(42);
+    histogram.reset();
+
+    QCOMPARE(histogram.count(), quint64(0));
+    QCOMPARE(histogram.percentile(50), qint64(-1));
+
+    histogram.record(7);
+    QCOMPARE(histogram.percentile(50), qint64(7));
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttLatencyHistogram)
+
+#include "tst_qmqttlatencyhistogram.moc"
@@ -0,0 +1,83 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+
+#include "qmqttmessage.h"
+
+class tst_QMqttMessage: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttMessage();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+
+    void defaultConstructed();
+    void constructed();
+    void rawTopic();
+    void copy();
+};
+
+tst_QMqttMessage::tst_QMqttMessage() :
+    QObject()
+{}
+
+void tst_QMqttMessage::defaultConstructed()
+{
+    const QMqttMessage message;
+
+    QVERIFY(!message.isValid());
+    QVERIFY(message.topic().isEmpty());
+    QCOMPARE(message.rawTopicSize(), 0);
+    QCOMPARE(message.payloadSize(), 0);
+    QVERIFY(message.hasTopic(QByteArray()));
+}
+
+void tst_QMqttMessage::constructed()
+{
+    const QMqttMessage message(QStringLiteral("sensors/1"), QByteArrayLiteral("20.5"),
+                               QMqttProtocol::QoS::AT_LEAST_ONCE, true);
+
+    QVERIFY(message.isValid());
+    QCOMPARE(message.topic(), QStringLiteral("sensors/1"));
+    QCOMPARE(message.payload(), QByteArrayLiteral("20.5"));
+    QCOMPARE(message.qos(), QMqttProtocol::QoS::AT_LEAST_ONCE);
+    QVERIFY(message.retain());
+    QVERIFY(!message.isDuplicate());
+}
+
+void tst_QMqttMessage::rawTopic()
+{
+    //a topic name with multi-byte UTF-8 characters
+    const QString topic = QString::fromUtf8("sensors/\xC3\xA9t\xC3\xA9");
+    const QMqttMessage message(topic, QByteArrayLiteral("payload"));
+
+    QCOMPARE(message.rawTopic(), topic.toUtf8());
+    QCOMPARE(message.rawTopicSize(), topic.toUtf8().size());
+    QVERIFY(message.hasTopic(topic.toUtf8()));
+    QVERIFY(!message.hasTopic(QByteArrayLiteral("sensors/ete")));
+    QVERIFY(!message.hasTopic(QByteArrayLiteral("sensors")));
+    QCOMPARE(message.topicHash(), QMqttMessage(topic, QByteArray()).topicHash());
+    QVERIFY(message.topicHash() != QMqttMessage(QStringLiteral("sensors"), QByteArray()).topicHash());
+    QCOMPARE(message.topic(), topic);
+}
+
+void tst_QMqttMessage::copy()
+{
+    QMqttMessage copy;
+    {
+        const QMqttMessage message(QStringLiteral("a/b"), QByteArrayLiteral("hello"));
+        copy = message;
+    }
+    //the copy keeps the data of the destroyed message
+    QCOMPARE(copy.topic(), QStringLiteral("a/b"));
+    QCOMPARE(copy.payload(), QByteArrayLiteral("hello"));
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttMessage)
+
+#include "tst_qmqttmessage.moc"
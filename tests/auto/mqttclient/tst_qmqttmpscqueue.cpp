@@ -0,0 +1,174 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QThread>
+#include <QSemaphore>
+#include <QVector>
+#include <QPair>
+
+#include "qmqttmpscqueue_p.h"
+
+typedef QPair<int, int> Value;  //producer, sequence number
+
+class tst_QMqttMpscQueue: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttMpscQueue();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void fifo();
+    void full();
+    void coalescedWakeUps();
+    void producerThreads();
+};
+
+namespace {
+
+class Producer : public QThread
+{
+public:
+    Producer(QMqttMpscQueue<Value> &queue, QSemaphore &wakeUps, int id, int count) :
+        QThread(),
+        m_queue(queue),
+        m_wakeUps(wakeUps),
+        m_id(id),
+        m_count(count)
+    {}
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        for (int i = 0; i < m_count;) {
+            Value value(m_id, i);
+            bool wakeUp = false;
+            if (!m_queue.push(value, &wakeUp)) {
+                //wait for the consumer to make room
+                QThread::yieldCurrentThread();
+                continue;
+            }
+            if (wakeUp) {
+                m_wakeUps.release();
+            }
+            ++i;
+        }
+    }
+
+private:
+    QMqttMpscQueue<Value> &m_queue;
+    QSemaphore &m_wakeUps;
+    const int m_id;
+    const int m_count;
+};
+
+}
+
+tst_QMqttMpscQueue::tst_QMqttMpscQueue() :
+    QObject()
+{}
+
+void tst_QMqttMpscQueue::fifo()
+{
+    QMqttMpscQueue<QByteArray> queue(16);
+    QVERIFY(queue.isEmpty());
+
+    bool wakeUp = false;
+    QByteArray value = QByteArrayLiteral("one");
+    QVERIFY(queue.push(value, &wakeUp));
+    value = QByteArrayLiteral("two");
+    QVERIFY(queue.push(value, &wakeUp));
+    QVERIFY(!queue.isEmpty());
+
+    QVERIFY(queue.pop(value));
+    QCOMPARE(value, QByteArrayLiteral("one"));
+    QVERIFY(queue.pop(value));
+    QCOMPARE(value, QByteArrayLiteral("two"));
+    QVERIFY(!queue.pop(value));
+    QVERIFY(queue.isEmpty());
+}
+
+void tst_QMqttMpscQueue::full()
+{
+    QMqttMpscQueue<int> queue(3);
+    //the capacity is rounded up to a power of 2
+    QCOMPARE(queue.capacity(), 4);
+
+    bool wakeUp = false;
+    for (int i = 0; i < queue.capacity(); ++i) {
+        int value = i;
+        QVERIFY(queue.push(value, &wakeUp));
+    }
+    int value = 4;
+    QVERIFY(!queue.push(value, &wakeUp));
+    QCOMPARE(value, 4);
+
+    //taking a value makes room for one more, in a ring
+    int popped = -1;
+    QVERIFY(queue.pop(popped));
+    QCOMPARE(popped, 0);
+    QVERIFY(queue.push(value, &wakeUp));
+    for (int i = 1; i <= 4; ++i) {
+        QVERIFY(queue.pop(popped));
+        QCOMPARE(popped, i);
+    }
+    QVERIFY(!queue.pop(popped));
+}
+
+void tst_QMqttMpscQueue::coalescedWakeUps()
+{
+    QMqttMpscQueue<int> queue(16);
+    bool wakeUp = false;
+    int value = 1;
+    //the consumer starts idle
+    QVERIFY(queue.push(value, &wakeUp));
+    QVERIFY(wakeUp);
+    QVERIFY(queue.push(value, &wakeUp));
+    QVERIFY(!wakeUp);
+
+    while (queue.pop(value)) {}
+
+    //the consumer found the queue empty, and has to be woken up again
+    QVERIFY(queue.push(value, &wakeUp));
+    QVERIFY(wakeUp);
+}
+
+void tst_QMqttMpscQueue::producerThreads()
+{
+    const int producerCount = 4;
+    const int count = 200000;
+    QMqttMpscQueue<Value> queue(1024);
+    QSemaphore wakeUps;
+
+    QVector<Producer *> producers;
+    for (int id = 0; id < producerCount; ++id) {
+        producers.append(new Producer(queue, wakeUps, id, count));
+        producers.last()->start();
+    }
+
+    //the values of each producer arrive in order
+    QVector<int> expected(producerCount, 0);
+    int received = 0;
+    Value value;
+    while (received < producerCount * count) {
+        if (queue.pop(value)) {
+            QCOMPARE(value.second, expected[value.first]);
+            ++expected[value.first];
+            ++received;
+        } else {
+            QVERIFY(wakeUps.tryAcquire(1, 10000));
+        }
+    }
+    for (Producer *producer : producers) {
+        QVERIFY(producer->wait(10000));
+    }
+    qDeleteAll(producers);
+    QVERIFY(!queue.pop(value));
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttMpscQueue)
+
+#include "tst_qmqttmpscqueue.moc"
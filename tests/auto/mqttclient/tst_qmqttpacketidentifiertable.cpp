@@ -0,0 +1,186 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <functional>
+#include <algorithm>
+
+#include "qmqttpacketidentifiertable_p.h"
+
+typedef QMqttPacketIdentifierTable::Operation Operation;
+
+class tst_QMqttPacketIdentifierTable: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttPacketIdentifierTable();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void acquireAndRelease();
+    void releaseWrongOperation();
+    void reuseReleasedIdentifier();
+    void exhaustion();
+    void exactlyOnceTransitions();
+    void acquireGivenIdentifier();
+    void takeAll();
+    void timestamps();
+};
+
+tst_QMqttPacketIdentifierTable::tst_QMqttPacketIdentifierTable() :
+    QObject()
+{}
+
+void tst_QMqttPacketIdentifierTable::acquireAndRelease()
+{
+    QMqttPacketIdentifierTable table;
+    bool result = false;
+    const uint16_t packetIdentifier
+            = table.acquire(Operation::PUBLISH, [&result](bool ok) { result = ok; });
+
+    QCOMPARE(packetIdentifier, uint16_t(1));
+    QVERIFY(table.contains(packetIdentifier));
+    QCOMPARE(table.operation(packetIdentifier), Operation::PUBLISH);
+    QCOMPARE(table.size(), 1);
+
+    std::function<void(bool)> cb;
+    QVERIFY(table.release(packetIdentifier, Operation::PUBLISH, &cb));
+    QVERIFY(bool(cb));
+    cb(true);
+    QVERIFY(result);
+    QVERIFY(!table.contains(packetIdentifier));
+    QVERIFY(table.isEmpty());
+
+    //an unexpected acknowledgement is ignored
+    QVERIFY(!table.release(packetIdentifier, Operation::PUBLISH, &cb));
+    QVERIFY(!table.release(0, Operation::PUBLISH, &cb));
+}
+
+void tst_QMqttPacketIdentifierTable::releaseWrongOperation()
+{
+    QMqttPacketIdentifierTable table;
+    const uint16_t packetIdentifier = table.acquire(Operation::SUBSCRIBE, nullptr);
+
+    QVERIFY(!table.release(packetIdentifier, Operation::UNSUBSCRIBE, nullptr));
+    QVERIFY(!table.release(packetIdentifier, Operation::NONE, nullptr));
+    QCOMPARE(table.operation(packetIdentifier), Operation::SUBSCRIBE);
+    QVERIFY(table.release(packetIdentifier, Operation::SUBSCRIBE, nullptr));
+}
+
+void tst_QMqttPacketIdentifierTable::reuseReleasedIdentifier()
+{
+    QMqttPacketIdentifierTable table;
+    QCOMPARE(table.acquire(Operation::PUBLISH, nullptr), uint16_t(1));
+    QCOMPARE(table.acquire(Operation::PUBLISH, nullptr), uint16_t(2));
+    QCOMPARE(table.acquire(Operation::PUBLISH, nullptr), uint16_t(3));
+
+    QVERIFY(table.release(2, Operation::PUBLISH, nullptr));
+    QCOMPARE(table.acquire(Operation::SUBSCRIBE, nullptr), uint16_t(2));
+    QCOMPARE(table.acquire(Operation::PUBLISH, nullptr), uint16_t(4));
+    QCOMPARE(table.size(), 4);
+}
+
+void tst_QMqttPacketIdentifierTable::exhaustion()
+{
+    QMqttPacketIdentifierTable table;
+    for (int i = 1; i <= QMqttPacketIdentifierTable::MAXIMUM_SIZE; ++i) {
+        QCOMPARE(int(table.acquire(Operation::PUBLISH, nullptr)), i);
+    }
+    QVERIFY(table.isFull());
+    //identifiers that are in use are never handed out again, and 0 is never handed out
+    QCOMPARE(table.acquire(Operation::PUBLISH, nullptr), uint16_t(0));
+
+    QVERIFY(table.release(12345, Operation::PUBLISH, nullptr));
+    QCOMPARE(table.acquire(Operation::PUBLISH, nullptr), uint16_t(12345));
+    QCOMPARE(table.acquire(Operation::PUBLISH, nullptr), uint16_t(0));
+}
+
+void tst_QMqttPacketIdentifierTable::exactlyOnceTransitions()
+{
+    QMqttPacketIdentifierTable table;
+    bool result = false;
+    const uint16_t packetIdentifier
+            = table.acquire(Operation::PUBLISH_EXACTLY_ONCE, [&result](bool ok) { result = ok; });
+
+    //PUBCOMP before PUBREC is not accepted
+    QVERIFY(!table.release(packetIdentifier, Operation::PUBLISH_RELEASED, nullptr));
+    QVERIFY(!table.transition(packetIdentifier, Operation::PUBLISH, Operation::PUBLISH_RELEASED));
+    QVERIFY(table.transition(packetIdentifier, Operation::PUBLISH_EXACTLY_ONCE, Operation::PUBLISH_RELEASED));
+    QCOMPARE(table.operation(packetIdentifier), Operation::PUBLISH_RELEASED);
+    QVERIFY(!table.transition(packetIdentifier, Operation::PUBLISH_EXACTLY_ONCE, Operation::PUBLISH_RELEASED));
+
+    std::function<void(bool)> cb;
+    QVERIFY(table.release(packetIdentifier, Operation::PUBLISH_RELEASED, &cb));
+    cb(true);
+    QVERIFY(result);
+    QVERIFY(table.isEmpty());
+}
+
+void tst_QMqttPacketIdentifierTable::acquireGivenIdentifier()
+{
+    QMqttPacketIdentifierTable table;
+    QVERIFY(table.acquire(uint16_t(5), Operation::PUBLISH, nullptr));
+    QVERIFY(table.acquire(uint16_t(2), Operation::PUBLISH_RELEASED, nullptr));
+    QVERIFY(!table.acquire(uint16_t(5), Operation::PUBLISH, nullptr));
+    QVERIFY(!table.acquire(uint16_t(0), Operation::PUBLISH, nullptr));
+    QCOMPARE(table.operation(2), Operation::PUBLISH_RELEASED);
+
+    //the identifiers below and around the given ones are still handed out
+    QVector<uint16_t> acquired;
+    for (int i = 0; i < 4; ++i) {
+        acquired.append(table.acquire(Operation::SUBSCRIBE, nullptr));
+    }
+    std::sort(acquired.begin(), acquired.end());
+    QCOMPARE(acquired, QVector<uint16_t>({ 1, 3, 4, 6 }));
+    QCOMPARE(table.size(), 6);
+
+    QCOMPARE(table.takeAll(Operation::SUBSCRIBE).size(), 4);
+    QCOMPARE(table.size(), 2);
+    QVERIFY(table.contains(5));
+}
+
+void tst_QMqttPacketIdentifierTable::takeAll()
+{
+    QMqttPacketIdentifierTable table;
+    int calls = 0;
+    const std::function<void(bool)> cb = [&calls](bool) { ++calls; };
+    table.acquire(Operation::SUBSCRIBE, cb);
+    table.acquire(Operation::PUBLISH, cb);
+    table.acquire(Operation::UNSUBSCRIBE, cb);
+    QVERIFY(table.release(2, Operation::PUBLISH, nullptr));
+
+    const QVector<std::function<void(bool)>> callbacks = table.takeAll();
+    QCOMPARE(callbacks.size(), 2);
+    for (const std::function<void(bool)> &callback : callbacks) {
+        callback(false);
+    }
+    QCOMPARE(calls, 2);
+    QVERIFY(table.isEmpty());
+    QCOMPARE(table.acquire(Operation::PUBLISH, nullptr), uint16_t(1));
+}
+
+void tst_QMqttPacketIdentifierTable::timestamps()
+{
+    QMqttPacketIdentifierTable table;
+    const uint16_t packetIdentifier = table.acquire(Operation::PUBLISH_EXACTLY_ONCE, nullptr);
+    QCOMPARE(table.timestamp(packetIdentifier), qint64(0));
+
+    table.setTimestamp(packetIdentifier, 1234);
+    QCOMPARE(table.timestamp(packetIdentifier), qint64(1234));
+    QVERIFY(table.transition(packetIdentifier, Operation::PUBLISH_EXACTLY_ONCE, Operation::PUBLISH_RELEASED));
+    QCOMPARE(table.timestamp(packetIdentifier), qint64(1234));
+
+    //a reused identifier does not inherit the timestamp of its previous use
+    QVERIFY(table.release(packetIdentifier, Operation::PUBLISH_RELEASED, nullptr));
+    QCOMPARE(table.timestamp(packetIdentifier), qint64(0));
+    table.setTimestamp(packetIdentifier, 5678);
+    QCOMPARE(table.timestamp(packetIdentifier), qint64(0));
+    QCOMPARE(table.acquire(Operation::PUBLISH, nullptr), packetIdentifier);
+    QCOMPARE(table.timestamp(packetIdentifier), qint64(0));
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttPacketIdentifierTable)
+
+#include "tst_qmqttpacketidentifiertable.moc"
@@ -0,0 +1,276 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QByteArray>
+#include <QVector>
+
+#include "qmqttcontrolpacket_p.h"
+#include "qmqttpacketparser_p.h"
+#include "qmqttstatistics_p.h"
+
+class tst_QMqttPacketParser: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttPacketParser();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void multiplePacketsInOneFrame();
+    void packetSplitAcrossFrames();
+    void lengthFieldSplitAcrossFrames();
+    void publishWithPacketIdentifier();
+    void publishRefersToFrame();
+    void invalidPacket();
+    void exactlyOnceAcknowledgements();
+    void subackReturnCodes();
+    void reset();
+    void externalBuffers();
+    void statistics();
+};
+
+tst_QMqttPacketParser::tst_QMqttPacketParser() :
+    QObject()
+{}
+
+void tst_QMqttPacketParser::multiplePacketsInOneFrame()
+{
+    QMqttPacketParser parser;
+    QVector<uint16_t> pubAcks;
+    int pongs = 0;
+    QObject::connect(&parser, &QMqttPacketParser::puback,
+                     [&pubAcks](uint16_t packetIdentifier) { pubAcks.append(packetIdentifier); });
+    QObject::connect(&parser, &QMqttPacketParser::pong, [&pongs]() { ++pongs; });
+
+    QByteArray frame;
+    frame.append(QByteArrayLiteral("\x40\x02\x00\x01"));    //PUBACK 1
+    frame.append(QByteArrayLiteral("\x40\x02\x00\x02"));    //PUBACK 2
+    frame.append(QByteArrayLiteral("\xD0\x00"));            //PINGRESP
+    frame.append(QByteArrayLiteral("\x40\x02\x01\x00"));    //PUBACK 256
+    parser.parse(frame);
+
+    QCOMPARE(pubAcks, QVector<uint16_t>({ 1, 2, 256 }));
+    QCOMPARE(pongs, 1);
+}
+
+void tst_QMqttPacketParser::packetSplitAcrossFrames()
+{
+    QMqttPacketParser parser;
+    QVector<QString> topics;
+    QVector<QByteArray> messages;
+    QObject::connect(&parser, &QMqttPacketParser::publish,
+                     [&topics, &messages](uint16_t, const QMqttMessage &message) {
+        topics.append(message.topic());
+        messages.append(QByteArray(message.payloadData(), message.payloadSize()));
+    });
+
+    const QByteArray packet =
+            QMqttPublishControlPacket(QStringLiteral("a/b"), QByteArrayLiteral("hello"),
+                                      QMqttProtocol::QoS::AT_MOST_ONCE, false).encode();
+    const QByteArray stream = packet + packet;
+    //deliver the stream byte by byte
+    for (int i = 0; i < stream.size(); ++i) {
+        parser.parse(stream.mid(i, 1));
+    }
+
+    QCOMPARE(topics, QVector<QString>({ QStringLiteral("a/b"), QStringLiteral("a/b") }));
+    QCOMPARE(messages, QVector<QByteArray>({ QByteArrayLiteral("hello"),
+                                             QByteArrayLiteral("hello") }));
+}
+
+void tst_QMqttPacketParser::lengthFieldSplitAcrossFrames()
+{
+    QMqttPacketParser parser;
+    QByteArray received;
+    QObject::connect(&parser, &QMqttPacketParser::publish,
+                     [&received](uint16_t, const QMqttMessage &message) {
+        received = QByteArray(message.payloadData(), message.payloadSize());
+    });
+
+    //200 bytes of payload need a remaining length field of 2 bytes
+    const QByteArray message(200, 'x');
+    const QByteArray packet =
+            QMqttPublishControlPacket(QStringLiteral("t"), message,
+                                      QMqttProtocol::QoS::AT_MOST_ONCE, false).encode();
+    parser.parse(packet.left(2));
+    QVERIFY(received.isEmpty());
+    parser.parse(packet.mid(2));
+
+    QCOMPARE(received, message);
+}
+
+void tst_QMqttPacketParser::publishWithPacketIdentifier()
+{
+    QMqttPacketParser parser;
+    QMqttProtocol::QoS receivedQos = QMqttProtocol::QoS::INVALID;
+    uint16_t receivedPacketIdentifier = 0;
+    QString receivedTopicName;
+    QByteArray receivedMessage;
+    QObject::connect(&parser, &QMqttPacketParser::publish,
+                     [&](uint16_t packetIdentifier, const QMqttMessage &message) {
+        receivedQos = message.qos();
+        receivedPacketIdentifier = packetIdentifier;
+        receivedTopicName = message.topic();
+        receivedMessage = QByteArray(message.payloadData(), message.payloadSize());
+    });
+
+    //a topic name with multi-byte UTF-8 characters
+    const QString topicName = QString::fromUtf8("sensors/\xC3\xA9t\xC3\xA9");
+    parser.parse(QMqttPublishControlPacket(topicName, QByteArrayLiteral("payload"),
+                                           QMqttProtocol::QoS::AT_LEAST_ONCE, false, 4242).encode());
+
+    QCOMPARE(receivedQos, QMqttProtocol::QoS::AT_LEAST_ONCE);
+    QCOMPARE(receivedPacketIdentifier, uint16_t(4242));
+    QCOMPARE(receivedTopicName, topicName);
+    QCOMPARE(receivedMessage, QByteArrayLiteral("payload"));
+}
+
+void tst_QMqttPacketParser::publishRefersToFrame()
+{
+    QMqttPacketParser parser;
+    QMqttMessage receivedMessage;
+    QObject::connect(&parser, &QMqttPacketParser::publish,
+                     [&receivedMessage](uint16_t, const QMqttMessage &message) {
+        receivedMessage = message;
+    });
+
+    const QByteArray frame =
+            QMqttPublishControlPacket(QStringLiteral("a/b"), QByteArrayLiteral("hello"),
+                                      QMqttProtocol::QoS::AT_MOST_ONCE, true).encode();
+    parser.parse(frame);
+
+    QVERIFY(receivedMessage.isValid());
+    QVERIFY(receivedMessage.retain());
+    QVERIFY(!receivedMessage.isDuplicate());
+    QVERIFY(receivedMessage.hasTopic(QByteArrayLiteral("a/b")));
+    QCOMPARE(receivedMessage.payload(), QByteArrayLiteral("hello"));
+    //neither the topic name nor the payload were copied
+    QVERIFY(receivedMessage.rawTopicData() > frame.constData());
+    QVERIFY(receivedMessage.payloadData() + receivedMessage.payloadSize()
+            == frame.constData() + frame.size());
+}
+
+void tst_QMqttPacketParser::invalidPacket()
+{
+    QMqttPacketParser parser;
+    int errors = 0;
+    int pubAcks = 0;
+    QObject::connect(&parser, &QMqttPacketParser::error,
+                     [&errors](QMqttProtocol::Error, const QString &) { ++errors; });
+    QObject::connect(&parser, &QMqttPacketParser::puback, [&pubAcks](uint16_t) { ++pubAcks; });
+
+    //reserved packet type 15, followed by a valid PUBACK that must be discarded
+    parser.parse(QByteArrayLiteral("\xF0\x00\x40\x02\x00\x01"));
+
+    QCOMPARE(errors, 1);
+    QCOMPARE(pubAcks, 0);
+}
+
+void tst_QMqttPacketParser::exactlyOnceAcknowledgements()
+{
+    QMqttPacketParser parser;
+    QVector<uint16_t> pubRecs;
+    QVector<uint16_t> pubComps;
+    QObject::connect(&parser, &QMqttPacketParser::pubrec,
+                     [&pubRecs](uint16_t packetIdentifier) { pubRecs.append(packetIdentifier); });
+    QObject::connect(&parser, &QMqttPacketParser::pubcomp,
+                     [&pubComps](uint16_t packetIdentifier) { pubComps.append(packetIdentifier); });
+
+    QByteArray frame;
+    frame.append(QByteArrayLiteral("\x50\x02\x00\x05"));    //PUBREC 5
+    frame.append(QByteArrayLiteral("\x70\x02\x00\x05"));    //PUBCOMP 5
+    frame.append(QByteArrayLiteral("\x50\x02\x12\x34"));    //PUBREC 0x1234
+    parser.parse(frame);
+
+    QCOMPARE(pubRecs, QVector<uint16_t>({ 5, 0x1234 }));
+    QCOMPARE(pubComps, QVector<uint16_t>({ 5 }));
+}
+
+void tst_QMqttPacketParser::subackReturnCodes()
+{
+    QMqttPacketParser parser;
+    uint16_t subackIdentifier = 0;
+    QVector<QMqttProtocol::QoS> grantedQos;
+    QObject::connect(&parser, &QMqttPacketParser::suback,
+                     [&subackIdentifier, &grantedQos](uint16_t packetIdentifier,
+                                                     QVector<QMqttProtocol::QoS> qos) {
+        subackIdentifier = packetIdentifier;
+        grantedQos = qos;
+    });
+
+    //return codes are in the order of the topic filters of the SUBSCRIBE packet
+    parser.parse(QByteArrayLiteral("\x90\x06\x00\x09\x02\x00\x80\x01"));
+
+    QCOMPARE(subackIdentifier, uint16_t(9));
+    QCOMPARE(grantedQos, QVector<QMqttProtocol::QoS>({ QMqttProtocol::QoS::EXACTLY_ONCE,
+                                                       QMqttProtocol::QoS::AT_MOST_ONCE,
+                                                       QMqttProtocol::QoS::INVALID,
+                                                       QMqttProtocol::QoS::AT_LEAST_ONCE }));
+}
+
+void tst_QMqttPacketParser::reset()
+{
+    QMqttPacketParser parser;
+    QVector<uint16_t> pubAcks;
+    QObject::connect(&parser, &QMqttPacketParser::puback,
+                     [&pubAcks](uint16_t packetIdentifier) { pubAcks.append(packetIdentifier); });
+
+    parser.parse(QByteArrayLiteral("\x40\x02\x00"));
+    parser.reset();
+    parser.parse(QByteArrayLiteral("\x40\x02\x00\x07"));
+
+    QCOMPARE(pubAcks, QVector<uint16_t>({ 7 }));
+}
+
+void tst_QMqttPacketParser::externalBuffers()
+{
+    QMqttPacketParser parser;
+    QVector<uint16_t> pubAcks;
+    QObject::connect(&parser, &QMqttPacketParser::puback,
+                     [&pubAcks](uint16_t packetIdentifier) { pubAcks.append(packetIdentifier); });
+
+    //one parser, two connections whose packets arrive interleaved and split
+    QByteArray first;
+    QByteArray second;
+    parser.parse(QByteArrayLiteral("\x40\x02"), first);
+    parser.parse(QByteArrayLiteral("\x40"), second);
+    QVERIFY(pubAcks.isEmpty());
+    parser.parse(QByteArrayLiteral("\x02\x00\x02"), second);
+    parser.parse(QByteArrayLiteral("\x00\x01"), first);
+
+    QCOMPARE(pubAcks, QVector<uint16_t>({ 2, 1 }));
+    QVERIFY(first.isEmpty());
+    QVERIFY(second.isEmpty());
+}
+
+void tst_QMqttPacketParser::statistics()
+{
+    QMqttStatisticsPrivate statistics;
+    QMqttPacketParser parser;
+    parser.setStatistics(&statistics);
+
+    QByteArray frame;
+    frame.append(QByteArrayLiteral("\x40\x02\x00\x01"));    //PUBACK 1
+    frame.append(QByteArrayLiteral("\xD0\x00"));            //PINGRESP
+    frame.append(QByteArrayLiteral("\x40\x02\x00"));        //first part of PUBACK 2
+    parser.parse(frame);
+    parser.parse(QByteArrayLiteral("\x02"));
+
+    QCOMPARE(statistics.m_bytesReceived.load(), quint64(10));
+    QCOMPARE(statistics.m_packetsReceived[size_t(QMqttProtocol::PacketType::PUBACK)].load(), quint64(2));
+    QCOMPARE(statistics.m_packetsReceived[size_t(QMqttProtocol::PacketType::PINGRESP)].load(), quint64(1));
+    QCOMPARE(statistics.m_parseErrors[size_t(QMqttProtocol::Error::INVALID_PACKET)].load(), quint64(0));
+
+    //PUBACK without packet identifier
+    parser.parse(QByteArrayLiteral("\x40\x00"));
+    QCOMPARE(statistics.m_parseErrors[size_t(QMqttProtocol::Error::INVALID_PACKET)].load(), quint64(1));
+    QCOMPARE(statistics.m_packetsReceived[size_t(QMqttProtocol::PacketType::PUBACK)].load(), quint64(3));
+    QCOMPARE(statistics.m_bytesReceived.load(), quint64(12));
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttPacketParser)
+
+#include "tst_qmqttpacketparser.moc"
@@ -18,6 +18,7 @@ private Q_SLOTS:
 //    void cleanup();
     void qos();
     void standardErrors();
+    void packetTypes();
 };
 
 tst_QMqttProtocol::tst_QMqttProtocol() :
@@ -42,6 +43,15 @@ void tst_QMqttProtocol::standardErrors()
     QCOMPARE(int(QMqttProtocol::Error::CONNECTION_REFUSED_NOT_AUTHORIZED), 5);
 }
 
+void tst_QMqttProtocol::packetTypes()
+{
+    //the values are the packet type field of the fixed header, see 2.2.1 MQTT Control Packet type
+    QCOMPARE(int(QMqttProtocol::PacketType::CONNECT), 1);
+    QCOMPARE(int(QMqttProtocol::PacketType::PUBLISH), 3);
+    QCOMPARE(int(QMqttProtocol::PacketType::PINGRESP), 13);
+    QCOMPARE(int(QMqttProtocol::PacketType::DISCONNECT), 14);
+}
+
 QTEST_GUILESS_MAIN(tst_QMqttProtocol)
 
 #include "tst_qmqttprotocol.moc"
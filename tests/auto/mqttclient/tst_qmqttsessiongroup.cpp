@@ -0,0 +1,81 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+
+#include "qmqttsessiongroup.h"
+
+class tst_QMqttSessionGroup: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttSessionGroup();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void sessions();
+    void keepAlive();
+    void requestsWhileOffline();
+};
+
+tst_QMqttSessionGroup::tst_QMqttSessionGroup() :
+    QObject()
+{}
+
+void tst_QMqttSessionGroup::sessions()
+{
+    QMqttSessionGroup group;
+    QCOMPARE(group.sessionCount(), 0);
+
+    const int first = group.addSession(QStringLiteral("device0"));
+    const int second = group.addSession(QStringLiteral("device1"));
+    QVERIFY(first != second);
+    QCOMPARE(group.sessionCount(), 2);
+    QCOMPARE(group.clientId(second), QStringLiteral("device1"));
+    QCOMPARE(group.state(first), QMqttProtocol::State::OFFLINE);
+
+    group.removeSession(first);
+    QCOMPARE(group.sessionCount(), 1);
+    QVERIFY(group.clientId(first).isEmpty());
+
+    //the id of a removed session is reused
+    QCOMPARE(group.addSession(QStringLiteral("device2")), first);
+    QCOMPARE(group.clientId(first), QStringLiteral("device2"));
+}
+
+void tst_QMqttSessionGroup::keepAlive()
+{
+    QMqttSessionGroup group;
+    QCOMPARE(group.keepAlive(), 30);
+
+    group.setKeepAlive(5);
+    QCOMPARE(group.keepAlive(), 5);
+    group.setKeepAlive(-1);
+    QCOMPARE(group.keepAlive(), 0);
+}
+
+void tst_QMqttSessionGroup::requestsWhileOffline()
+{
+    QMqttSessionGroup group;
+    const int session = group.addSession(QStringLiteral("device0"));
+
+    int failures = 0;
+    const auto cb = [&failures](bool success) {
+        if (!success) {
+            ++failures;
+        }
+    };
+    group.publish(session, QStringLiteral("sensors/1"), QByteArrayLiteral("20.5"),
+                  QMqttProtocol::QoS::AT_LEAST_ONCE, cb);
+    group.subscribe(session, QStringLiteral("commands/#"), QMqttProtocol::QoS::AT_MOST_ONCE, cb);
+    group.unsubscribe(session + 1, QStringLiteral("commands/#"), cb);
+    //callbacks of failed requests are not called back into the caller
+    QCOMPARE(failures, 0);
+    QTRY_COMPARE(failures, 3);
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttSessionGroup)
+
+#include "tst_qmqttsessiongroup.moc"
@@ -0,0 +1,247 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "qmqttsessionstore_p.h"
+
+class tst_QMqttSessionStore: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttSessionStore();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void storeReleaseRemove();
+    void recover();
+    void recoverTruncatedRecord();
+    void recoverCorruptedRecord();
+    void recoverInvalidRecord_data();
+    void recoverInvalidRecord();
+    void rejectForeignFile();
+    void compaction();
+    void clear();
+
+private:
+    QTemporaryDir m_dir;
+
+    QString fileName(const QString &name) const;
+};
+
+tst_QMqttSessionStore::tst_QMqttSessionStore() :
+    QObject(),
+    m_dir()
+{}
+
+QString tst_QMqttSessionStore::fileName(const QString &name) const
+{
+    return m_dir.filePath(name);
+}
+
+void tst_QMqttSessionStore::storeReleaseRemove()
+{
+    QMqttSessionStore store(fileName(QStringLiteral("storeReleaseRemove")));
+    QVERIFY(store.open());
+    QVERIFY(store.isEmpty());
+
+    store.store(3, QByteArrayLiteral("third"));
+    store.store(1, QByteArrayLiteral("first"));
+    store.store(2, QByteArrayLiteral("second"));
+    store.release(1);
+    store.remove(3);
+
+    const QVector<QMqttSessionStore::Entry> entries = store.entries();
+    QCOMPARE(entries.size(), 2);
+    //entries are returned in the order they were stored, not by packet identifier
+    QCOMPARE(entries.at(0).packetIdentifier, uint16_t(1));
+    QCOMPARE(entries.at(0).packet, QByteArrayLiteral("first"));
+    QVERIFY(entries.at(0).released);
+    QCOMPARE(entries.at(1).packetIdentifier, uint16_t(2));
+    QVERIFY(!entries.at(1).released);
+}
+
+void tst_QMqttSessionStore::recover()
+{
+    const QString name = fileName(QStringLiteral("recover"));
+    {
+        QMqttSessionStore store(name);
+        QVERIFY(store.open());
+        store.store(10, QByteArrayLiteral("ten"));
+        store.store(11, QByteArrayLiteral("eleven"));
+        store.store(12, QByteArrayLiteral("twelve"));
+        store.remove(10);
+        store.release(12);
+        QVERIFY(store.commit());
+    }
+
+    QMqttSessionStore store(name);
+    QVERIFY(store.open());
+    const QVector<QMqttSessionStore::Entry> entries = store.entries();
+    QCOMPARE(entries.size(), 2);
+    QCOMPARE(entries.at(0).packetIdentifier, uint16_t(11));
+    QCOMPARE(entries.at(0).packet, QByteArrayLiteral("eleven"));
+    QVERIFY(!entries.at(0).released);
+    QCOMPARE(entries.at(1).packetIdentifier, uint16_t(12));
+    QVERIFY(entries.at(1).released);
+
+    //appending after recovery continues the same log
+    store.remove(11);
+    QVERIFY(store.commit());
+    store.close();
+    QVERIFY(store.open());
+    QCOMPARE(store.size(), 1);
+}
+
+void tst_QMqttSessionStore::recoverTruncatedRecord()
+{
+    const QString name = fileName(QStringLiteral("recoverTruncatedRecord"));
+    {
+        QMqttSessionStore store(name);
+        QVERIFY(store.open());
+        store.store(1, QByteArrayLiteral("complete"));
+        store.store(2, QByteArrayLiteral("torn"));
+        QVERIFY(store.commit());
+    }
+    //simulate a crash in the middle of writing the last record
+    QFile file(name);
+    QVERIFY(file.resize(file.size() - 2));
+
+    QMqttSessionStore store(name);
+    QVERIFY(store.open());
+    QCOMPARE(store.size(), 1);
+    QCOMPARE(store.entries().at(0).packet, QByteArrayLiteral("complete"));
+
+    store.store(3, QByteArrayLiteral("after"));
+    QVERIFY(store.commit());
+    store.close();
+    QVERIFY(store.open());
+    QCOMPARE(store.size(), 2);
+}
+
+void tst_QMqttSessionStore::recoverCorruptedRecord()
+{
+    const QString name = fileName(QStringLiteral("recoverCorruptedRecord"));
+    {
+        QMqttSessionStore store(name);
+        QVERIFY(store.open());
+        store.store(1, QByteArrayLiteral("complete"));
+        store.store(2, QByteArrayLiteral("corrupted"));
+        QVERIFY(store.commit());
+    }
+    //flip a bit in the data of the last record, which keeps its length intact
+    QFile file(name);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    const qint64 size = file.size();
+    QVERIFY(file.seek(size - 1));
+    char last = 0;
+    QVERIFY(file.getChar(&last));
+    QVERIFY(file.seek(size - 1));
+    QVERIFY(file.putChar(char(last ^ 0x01)));
+    file.close();
+
+    QMqttSessionStore store(name);
+    QVERIFY(store.open());
+    QCOMPARE(store.size(), 1);
+    QCOMPARE(store.entries().at(0).packet, QByteArrayLiteral("complete"));
+    QVERIFY(QFileInfo(name).size() < size);
+
+    //the log continues after the last valid record
+    store.store(3, QByteArrayLiteral("after"));
+    QVERIFY(store.commit());
+    store.close();
+    QVERIFY(store.open());
+    QCOMPARE(store.size(), 2);
+}
+
+void tst_QMqttSessionStore::recoverInvalidRecord_data()
+{
+    QTest::addColumn<int>("packetIdentifier");
+    QTest::addColumn<QByteArray>("packet");
+
+    QTest::newRow("identifier 0") << 0 << QByteArrayLiteral("packet");
+    QTest::newRow("empty packet") << 5 << QByteArray();
+}
+
+void tst_QMqttSessionStore::recoverInvalidRecord()
+{
+    QFETCH(int, packetIdentifier);
+    QFETCH(QByteArray, packet);
+
+    const QString name = fileName(QStringLiteral("recoverInvalidRecord"));
+    QFile::remove(name);
+    {
+        QMqttSessionStore store(name);
+        QVERIFY(store.open());
+        store.store(1, QByteArrayLiteral("valid"));
+        store.store(uint16_t(packetIdentifier), packet);
+        store.store(2, QByteArrayLiteral("after the invalid record"));
+        QVERIFY(store.commit());
+    }
+
+    //the invalid record is treated as the end of the log
+    QMqttSessionStore store(name);
+    QVERIFY(store.open());
+    QCOMPARE(store.size(), 1);
+    QCOMPARE(store.entries().at(0).packetIdentifier, uint16_t(1));
+}
+
+void tst_QMqttSessionStore::rejectForeignFile()
+{
+    const QString name = fileName(QStringLiteral("rejectForeignFile"));
+    QFile file(name);
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write("this is not a session file");
+    file.close();
+
+    QMqttSessionStore store(name);
+    QVERIFY(!store.open());
+    QVERIFY(!store.isOpen());
+}
+
+void tst_QMqttSessionStore::compaction()
+{
+    const QString name = fileName(QStringLiteral("compaction"));
+    QMqttSessionStore store(name);
+    QVERIFY(store.open());
+
+    const QByteArray packet(1024, 'x');
+    store.store(1, QByteArrayLiteral("survivor"));
+    for (int i = 0; i < 2 * 1024; ++i) {
+        store.store(2, packet);
+        store.remove(2);
+        if (i % 16 == 15) {
+            QVERIFY(store.commit());
+        }
+    }
+    //the acknowledged messages were compacted away
+    QVERIFY(QFileInfo(name).size() < QMqttSessionStore::COMPACTION_THRESHOLD);
+
+    store.close();
+    QVERIFY(store.open());
+    QCOMPARE(store.size(), 1);
+    QCOMPARE(store.entries().at(0).packet, QByteArrayLiteral("survivor"));
+}
+
+void tst_QMqttSessionStore::clear()
+{
+    const QString name = fileName(QStringLiteral("clear"));
+    QMqttSessionStore store(name);
+    QVERIFY(store.open());
+    store.store(1, QByteArrayLiteral("one"));
+    QVERIFY(store.commit());
+
+    store.clear();
+    QVERIFY(store.isEmpty());
+    store.close();
+    QVERIFY(store.open());
+    QVERIFY(store.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttSessionStore)
+
+#include "tst_qmqttsessionstore.moc"
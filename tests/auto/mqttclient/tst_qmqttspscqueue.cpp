@@ -0,0 +1,150 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QThread>
+#include <QSemaphore>
+
+#include "qmqttspscqueue_p.h"
+
+class tst_QMqttSpscQueue: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttSpscQueue();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void fifo();
+    void blockBoundaries();
+    void coalescedWakeUps();
+    void twoThreads();
+};
+
+namespace {
+
+class Producer : public QThread
+{
+public:
+    Producer(QMqttSpscQueue<int> &queue, QSemaphore &wakeUps, int count) :
+        QThread(),
+        m_queue(queue),
+        m_wakeUps(wakeUps),
+        m_count(count)
+    {}
+
+protected:
+    void run() Q_DECL_OVERRIDE
+    {
+        for (int i = 0; i < m_count; ++i) {
+            if (m_queue.push(i)) {
+                m_wakeUps.release();
+            }
+        }
+    }
+
+private:
+    QMqttSpscQueue<int> &m_queue;
+    QSemaphore &m_wakeUps;
+    const int m_count;
+};
+
+}
+
+tst_QMqttSpscQueue::tst_QMqttSpscQueue() :
+    QObject()
+{}
+
+void tst_QMqttSpscQueue::fifo()
+{
+    QMqttSpscQueue<QByteArray> queue;
+    QVERIFY(queue.isEmpty());
+
+    queue.push(QByteArrayLiteral("one"));
+    queue.push(QByteArrayLiteral("two"));
+    QVERIFY(!queue.isEmpty());
+
+    QByteArray value;
+    QVERIFY(queue.pop(value));
+    QCOMPARE(value, QByteArrayLiteral("one"));
+    QVERIFY(queue.pop(value));
+    QCOMPARE(value, QByteArrayLiteral("two"));
+    QVERIFY(!queue.pop(value));
+    QVERIFY(queue.isEmpty());
+}
+
+void tst_QMqttSpscQueue::blockBoundaries()
+{
+    QMqttSpscQueue<int> queue;
+    const int count = 3 * QMqttSpscQueue<int>::BLOCK_SIZE + 1;
+    for (int i = 0; i < count; ++i) {
+        queue.push(i);
+    }
+    int value = -1;
+    for (int i = 0; i < count; ++i) {
+        QVERIFY(queue.pop(value));
+        QCOMPARE(value, i);
+    }
+    QVERIFY(!queue.pop(value));
+
+    //an exhausted block is not reused; pushing continues in a new one
+    for (int i = 0; i < QMqttSpscQueue<int>::BLOCK_SIZE; ++i) {
+        queue.push(i);
+        QVERIFY(queue.pop(value));
+        QCOMPARE(value, i);
+    }
+    QVERIFY(queue.isEmpty());
+}
+
+void tst_QMqttSpscQueue::coalescedWakeUps()
+{
+    QMqttSpscQueue<int> queue;
+    //the consumer starts idle
+    QVERIFY(queue.push(1));
+    QVERIFY(!queue.push(2));
+    QVERIFY(!queue.push(3));
+
+    int value = 0;
+    QVERIFY(queue.pop(value));
+    //not idle as long as values are taken
+    QVERIFY(!queue.push(4));
+    while (queue.pop(value)) {}
+    QCOMPARE(value, 4);
+
+    //the consumer found the queue empty, and has to be woken up again
+    QVERIFY(queue.push(5));
+    QVERIFY(!queue.push(6));
+}
+
+void tst_QMqttSpscQueue::twoThreads()
+{
+    const int count = 1000000;
+    QMqttSpscQueue<int> queue;
+    QSemaphore wakeUps;
+
+    Producer producer(queue, wakeUps, count);
+    producer.start();
+
+    int expected = 0;
+    int value = -1;
+    while (expected < count) {
+        if (queue.pop(value)) {
+            QCOMPARE(value, expected);
+            ++expected;
+        } else {
+            //every time the queue is found empty, the producer must wake the consumer up
+            QVERIFY(wakeUps.tryAcquire(1, 10000));
+        }
+    }
+    QVERIFY(producer.wait(10000));
+    QVERIFY(!queue.pop(value));
+    //only the wake-up of the very first value can be left over, when the consumer did not find
+    //the queue empty before it
+    QVERIFY(wakeUps.available() <= 1);
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttSpscQueue)
+
+#include "tst_qmqttspscqueue.moc"
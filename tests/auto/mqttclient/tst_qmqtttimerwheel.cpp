@@ -0,0 +1,99 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <algorithm>
+
+#include "qmqtttimerwheel_p.h"
+
+class tst_QMqttTimerWheel: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttTimerWheel();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void expiration();
+    void severalTurns();
+    void rescheduleFromExpiration();
+};
+
+namespace {
+
+QVector<quint32> advance(QMqttTimerWheel &wheel)
+{
+    QVector<quint32> expired;
+    wheel.advance([&expired](quint32 id) {
+        expired.append(id);
+    });
+    std::sort(expired.begin(), expired.end());
+    return expired;
+}
+
+}
+
+tst_QMqttTimerWheel::tst_QMqttTimerWheel() :
+    QObject()
+{}
+
+void tst_QMqttTimerWheel::expiration()
+{
+    QMqttTimerWheel wheel(8);
+    QCOMPARE(wheel.now(), quint64(0));
+
+    wheel.schedule(1, 2);
+    wheel.schedule(2, 1);
+    wheel.schedule(3, 2);
+    QCOMPARE(wheel.size(), 3);
+
+    QCOMPARE(advance(wheel), QVector<quint32>({2}));
+    QCOMPARE(advance(wheel), QVector<quint32>({1, 3}));
+    QCOMPARE(advance(wheel), QVector<quint32>());
+    QCOMPARE(wheel.now(), quint64(3));
+    QCOMPARE(wheel.size(), 0);
+}
+
+void tst_QMqttTimerWheel::severalTurns()
+{
+    QMqttTimerWheel wheel(4);
+    //both timers share a slot, but expire on different turns of the wheel
+    wheel.schedule(1, 2);
+    wheel.schedule(2, 10);
+
+    for (int tick = 1; tick <= 10; ++tick) {
+        const QVector<quint32> expired = advance(wheel);
+        if (tick == 2) {
+            QCOMPARE(expired, QVector<quint32>({1}));
+        } else if (tick == 10) {
+            QCOMPARE(expired, QVector<quint32>({2}));
+        } else {
+            QVERIFY(expired.isEmpty());
+        }
+    }
+    QCOMPARE(wheel.size(), 0);
+}
+
+void tst_QMqttTimerWheel::rescheduleFromExpiration()
+{
+    QMqttTimerWheel wheel(4);
+    wheel.schedule(7, 1);
+
+    //a periodic timer reschedules itself, a full turn later into the same slot
+    int expirations = 0;
+    for (int tick = 0; tick < 12; ++tick) {
+        wheel.advance([&wheel, &expirations](quint32 id) {
+            QCOMPARE(id, quint32(7));
+            ++expirations;
+            wheel.schedule(id, 4);
+        });
+    }
+    QCOMPARE(expirations, 3);
+    QCOMPARE(wheel.size(), 1);
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttTimerWheel)
+
+#include "tst_qmqtttimerwheel.moc"
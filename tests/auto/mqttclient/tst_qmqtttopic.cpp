@@ -0,0 +1,101 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+
+#include "qmqtttopic.h"
+#include "qmqttclient.h"
+
+class tst_QMqttTopic: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttTopic();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+
+    void valid_data();
+    void valid();
+    void invalid_data();
+    void invalid();
+    void copy();
+    void publishToInvalidTopic();
+};
+
+tst_QMqttTopic::tst_QMqttTopic() :
+    QObject()
+{}
+
+void tst_QMqttTopic::valid_data()
+{
+    QTest::addColumn<QString>("name");
+
+    QTest::newRow("single level") << QStringLiteral("sensors");
+    QTest::newRow("multiple levels") << QStringLiteral("sensors/1/temperature");
+    QTest::newRow("empty levels") << QStringLiteral("/sensors//1/");
+    QTest::newRow("multi-byte characters") << QString::fromUtf8("sensors/\xC3\xA9t\xC3\xA9");
+    QTest::newRow("maximum size") << QString(65535, QLatin1Char('t'));
+}
+
+void tst_QMqttTopic::valid()
+{
+    QFETCH(QString, name);
+
+    const QMqttTopic topic(name);
+    QVERIFY(topic.isValid());
+    QCOMPARE(topic.name(), name);
+}
+
+void tst_QMqttTopic::invalid_data()
+{
+    QTest::addColumn<QString>("name");
+
+    QTest::newRow("empty") << QString();
+    QTest::newRow("single level wildcard") << QStringLiteral("sensors/+/temperature");
+    QTest::newRow("multi level wildcard") << QStringLiteral("sensors/#");
+    QTest::newRow("null character") << QStringLiteral("sensors/") + QChar(0);
+    QTest::newRow("too long") << QString(65536, QLatin1Char('t'));
+    //3 bytes per character in UTF-8
+    QTest::newRow("too long in UTF-8") << QString(30000, QChar(0x20AC));
+}
+
+void tst_QMqttTopic::invalid()
+{
+    QFETCH(QString, name);
+
+    QVERIFY(!QMqttTopic(name).isValid());
+    QVERIFY(!QMqttTopic().isValid());
+}
+
+void tst_QMqttTopic::copy()
+{
+    QMqttTopic copy;
+    {
+        const QMqttTopic topic(QStringLiteral("a/b"));
+        copy = topic;
+    }
+    QVERIFY(copy.isValid());
+    QCOMPARE(copy.name(), QStringLiteral("a/b"));
+}
+
+void tst_QMqttTopic::publishToInvalidTopic()
+{
+    QMqttClient client(QStringLiteral("client"));
+
+    bool called = false;
+    bool result = true;
+    client.publish(QMqttTopic(QStringLiteral("sensors/#")), QByteArrayLiteral("20.5"),
+                   QMqttProtocol::QoS::AT_LEAST_ONCE, [&](bool success) {
+        called = true;
+        result = success;
+    });
+    QTRY_VERIFY(called);
+    QVERIFY(!result);
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttTopic)
+
+#include "tst_qmqtttopic.moc"
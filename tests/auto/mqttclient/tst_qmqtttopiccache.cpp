@@ -0,0 +1,152 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "qmqtttopiccache_p.h"
+#include "qmqttmessage.h"
+#include "qmqttpacketparser_p.h"
+#include "qmqttcontrolpacket_p.h"
+
+class tst_QMqttTopicCache: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttTopicCache();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+
+    void hash();
+    void intern();
+    void find();
+    void replaceUnreferenced();
+    void disabled();
+    void setCapacity();
+    void message();
+};
+
+static QString intern(QMqttTopicCache &cache, const QByteArray &rawTopic)
+{
+    return cache.intern(rawTopic.constData(), rawTopic.size(),
+                        QMqttTopicCache::hash(rawTopic.constData(), rawTopic.size()));
+}
+
+static QString find(QMqttTopicCache &cache, const QByteArray &rawTopic)
+{
+    return cache.find(rawTopic.constData(), rawTopic.size(),
+                      QMqttTopicCache::hash(rawTopic.constData(), rawTopic.size()));
+}
+
+tst_QMqttTopicCache::tst_QMqttTopicCache() :
+    QObject()
+{}
+
+void tst_QMqttTopicCache::hash()
+{
+    //the hash must not change between processes, versions or platforms
+    QCOMPARE(QMqttTopicCache::hash(nullptr, 0), quint32(0x811C9DC5));
+    QCOMPARE(QMqttTopicCache::hash("a", 1), quint32(0xE40C292C));
+    QCOMPARE(QMqttTopicCache::hash("foobar", 6), quint32(0xBF9CF968));
+}
+
+void tst_QMqttTopicCache::intern()
+{
+    QMqttTopicCache cache(4);
+
+    const QString first = intern(cache, QByteArrayLiteral("sensors/1"));
+    const QString second = intern(cache, QByteArrayLiteral("sensors/1"));
+    QCOMPARE(first, QStringLiteral("sensors/1"));
+    //the second lookup shares the topic name of the first one
+    QCOMPARE(second.constData(), first.constData());
+    QCOMPARE(cache.size(), 1);
+
+    const QString topic = QString::fromUtf8("sensors/\xC3\xA9t\xC3\xA9");
+    QCOMPARE(intern(cache, topic.toUtf8()), topic);
+    QCOMPARE(cache.size(), 2);
+}
+
+void tst_QMqttTopicCache::find()
+{
+    QMqttTopicCache cache(4);
+
+    QVERIFY(find(cache, QByteArrayLiteral("a/b")).isNull());
+    QCOMPARE(cache.size(), 0);
+    intern(cache, QByteArrayLiteral("a/b"));
+    QCOMPARE(find(cache, QByteArrayLiteral("a/b")), QStringLiteral("a/b"));
+    QVERIFY(find(cache, QByteArrayLiteral("a/c")).isNull());
+    QVERIFY(find(cache, QByteArrayLiteral("a")).isNull());
+}
+
+void tst_QMqttTopicCache::replaceUnreferenced()
+{
+    QMqttTopicCache cache(2);
+
+    intern(cache, QByteArrayLiteral("a"));
+    intern(cache, QByteArrayLiteral("b"));
+    //a is referenced again, so b is replaced by c
+    intern(cache, QByteArrayLiteral("a"));
+    intern(cache, QByteArrayLiteral("c"));
+
+    QCOMPARE(cache.size(), 2);
+    QVERIFY(!find(cache, QByteArrayLiteral("a")).isNull());
+    QVERIFY(find(cache, QByteArrayLiteral("b")).isNull());
+    QVERIFY(!find(cache, QByteArrayLiteral("c")).isNull());
+}
+
+void tst_QMqttTopicCache::disabled()
+{
+    QMqttTopicCache cache(0);
+
+    QCOMPARE(intern(cache, QByteArrayLiteral("a/b")), QStringLiteral("a/b"));
+    QCOMPARE(cache.size(), 0);
+    QVERIFY(find(cache, QByteArrayLiteral("a/b")).isNull());
+}
+
+void tst_QMqttTopicCache::setCapacity()
+{
+    QMqttTopicCache cache(4);
+    intern(cache, QByteArrayLiteral("a"));
+
+    cache.setCapacity(1);
+    QCOMPARE(cache.capacity(), 1);
+    QCOMPARE(cache.size(), 0);
+    intern(cache, QByteArrayLiteral("a"));
+    intern(cache, QByteArrayLiteral("b"));
+    QCOMPARE(cache.size(), 1);
+
+    cache.setCapacity(-1);
+    QCOMPARE(cache.capacity(), 0);
+}
+
+void tst_QMqttTopicCache::message()
+{
+    QMqttTopicCache cache(4);
+    QMqttPacketParser parser;
+    QVector<QMqttMessage> messages;
+    QObject::connect(&parser, &QMqttPacketParser::publish,
+                     [&messages](uint16_t, const QMqttMessage &message) {
+        messages.append(message);
+    });
+    const QByteArray packet =
+            QMqttPublishControlPacket(QStringLiteral("a/b"), QByteArrayLiteral("hello"),
+                                      QMqttProtocol::QoS::AT_MOST_ONCE, false).encode();
+    parser.parse(packet + packet);
+    QCOMPARE(messages.size(), 2);
+    QCOMPARE(messages.at(0).topicHash(), QMqttTopicCache::hash("a/b", 3));
+
+    QVERIFY(!cache.resolve(messages.at(0)));
+    const QString topic = cache.intern(messages.at(0));
+    QCOMPARE(topic, QStringLiteral("a/b"));
+    QVERIFY(cache.resolve(messages.at(1)));
+    QCOMPARE(messages.at(1).topic().constData(), topic.constData());
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttTopicCache)
+
+#include "tst_qmqtttopiccache.moc"
@@ -0,0 +1,109 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QVector>
+#include <algorithm>
+
+#include "qmqtttopictrie_p.h"
+
+class tst_QMqttTopicTrie: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttTopicTrie();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void match_data();
+    void match();
+    void multipleValues();
+    void remove();
+
+private:
+    static QVector<int> matches(const QMqttTopicTrie<int> &trie, const QString &topicName);
+};
+
+tst_QMqttTopicTrie::tst_QMqttTopicTrie() :
+    QObject()
+{}
+
+QVector<int> tst_QMqttTopicTrie::matches(const QMqttTopicTrie<int> &trie, const QString &topicName)
+{
+    QVector<int> values;
+    trie.match(topicName, [&values](int value) { values.append(value); });
+    std::sort(values.begin(), values.end());
+    return values;
+}
+
+void tst_QMqttTopicTrie::match_data()
+{
+    QTest::addColumn<QString>("topicFilter");
+    QTest::addColumn<QString>("topicName");
+    QTest::addColumn<bool>("matches");
+
+    QTest::newRow("exact") << QStringLiteral("sport/tennis") << QStringLiteral("sport/tennis") << true;
+    QTest::newRow("exact mismatch") << QStringLiteral("sport/tennis") << QStringLiteral("sport/golf") << false;
+    QTest::newRow("longer topic") << QStringLiteral("sport") << QStringLiteral("sport/tennis") << false;
+    QTest::newRow("# matches children") << QStringLiteral("sport/#") << QStringLiteral("sport/tennis/player1") << true;
+    QTest::newRow("# matches parent") << QStringLiteral("sport/#") << QStringLiteral("sport") << true;
+    QTest::newRow("# alone") << QStringLiteral("#") << QStringLiteral("sport/tennis") << true;
+    QTest::newRow("+ one level") << QStringLiteral("sport/+") << QStringLiteral("sport/tennis") << true;
+    QTest::newRow("+ not two levels") << QStringLiteral("sport/+") << QStringLiteral("sport/tennis/player1") << false;
+    QTest::newRow("+ not parent") << QStringLiteral("sport/+") << QStringLiteral("sport") << false;
+    QTest::newRow("+ empty level") << QStringLiteral("sport/+") << QStringLiteral("sport/") << true;
+    QTest::newRow("+ in the middle") << QStringLiteral("sport/+/player1") << QStringLiteral("sport/tennis/player1") << true;
+    QTest::newRow("+ and #") << QStringLiteral("+/tennis/#") << QStringLiteral("sport/tennis/player1/ranking") << true;
+    QTest::newRow("leading slash") << QStringLiteral("/+") << QStringLiteral("/finance") << true;
+    QTest::newRow("+ not leading slash") << QStringLiteral("+") << QStringLiteral("/finance") << false;
+    QTest::newRow("$ not matched by #") << QStringLiteral("#") << QStringLiteral("$SYS/broker") << false;
+    QTest::newRow("$ not matched by +") << QStringLiteral("+/broker") << QStringLiteral("$SYS/broker") << false;
+    QTest::newRow("$ matched explicitly") << QStringLiteral("$SYS/#") << QStringLiteral("$SYS/broker") << true;
+}
+
+void tst_QMqttTopicTrie::match()
+{
+    QFETCH(QString, topicFilter);
+    QFETCH(QString, topicName);
+    QFETCH(bool, matches);
+
+    QMqttTopicTrie<int> trie;
+    trie.insert(topicFilter, 1);
+
+    QCOMPARE(tst_QMqttTopicTrie::matches(trie, topicName).size(), matches ? 1 : 0);
+}
+
+void tst_QMqttTopicTrie::multipleValues()
+{
+    QMqttTopicTrie<int> trie;
+    trie.insert(QStringLiteral("a/b"), 1);
+    trie.insert(QStringLiteral("a/+"), 2);
+    trie.insert(QStringLiteral("a/#"), 3);
+    trie.insert(QStringLiteral("a/b"), 4);
+    trie.insert(QStringLiteral("c"), 5);
+
+    QCOMPARE(matches(trie, QStringLiteral("a/b")), QVector<int>({ 1, 2, 3, 4 }));
+    QCOMPARE(matches(trie, QStringLiteral("a/c")), QVector<int>({ 2, 3 }));
+    QCOMPARE(matches(trie, QStringLiteral("c")), QVector<int>({ 5 }));
+    QCOMPARE(trie.values(QStringLiteral("a/b")), QVector<int>({ 1, 4 }));
+}
+
+void tst_QMqttTopicTrie::remove()
+{
+    QMqttTopicTrie<int> trie;
+    trie.insert(QStringLiteral("a/+/c"), 1);
+    trie.insert(QStringLiteral("a/#"), 2);
+
+    QVERIFY(!trie.remove(QStringLiteral("a/+/c"), 2));
+    QVERIFY(!trie.remove(QStringLiteral("x/y"), 1));
+    QVERIFY(trie.remove(QStringLiteral("a/+/c"), 1));
+    QCOMPARE(matches(trie, QStringLiteral("a/b/c")), QVector<int>({ 2 }));
+    QVERIFY(trie.remove(QStringLiteral("a/#"), 2));
+    QVERIFY(trie.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttTopicTrie)
+
+#include "tst_qmqtttopictrie.moc"
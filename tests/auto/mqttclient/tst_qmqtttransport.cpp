@@ -0,0 +1,55 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QUrl>
+#include <QScopedPointer>
+
+#include "qmqtttransport_p.h"
+
+class tst_QMqttTransport: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_QMqttTransport();
+
+private Q_SLOTS:
+//    void initTestCase();
+//    void cleanupTestCase();
+//    void init();
+//    void cleanup();
+    void create_data();
+    void create();
+};
+
+tst_QMqttTransport::tst_QMqttTransport() :
+    QObject()
+{}
+
+void tst_QMqttTransport::create_data()
+{
+    QTest::addColumn<QUrl>("url");
+    QTest::addColumn<bool>("isTcp");
+
+    QTest::newRow("mqtt") << QUrl(QStringLiteral("mqtt://test.mqtt.org")) << true;
+    QTest::newRow("mqtts") << QUrl(QStringLiteral("mqtts://test.mqtt.org:8884")) << true;
+    QTest::newRow("MQTT") << QUrl(QStringLiteral("MQTT://test.mqtt.org")) << true;
+    QTest::newRow("ws") << QUrl(QStringLiteral("ws://test.mqtt.org")) << false;
+    QTest::newRow("wss") << QUrl(QStringLiteral("wss://test.mqtt.org")) << false;
+}
+
+void tst_QMqttTransport::create()
+{
+    QFETCH(QUrl, url);
+    QFETCH(bool, isTcp);
+
+    QScopedPointer<QMqttTransport> transport(QMqttTransport::create(url));
+
+    QVERIFY(transport);
+    QCOMPARE(qobject_cast<QMqttTcpTransport *>(transport.data()) != nullptr, isTcp);
+    QCOMPARE(qobject_cast<QMqttWebSocketTransport *>(transport.data()) != nullptr, !isTcp);
+    QCOMPARE(transport->state(), QAbstractSocket::UnconnectedState);
+}
+
+QTEST_GUILESS_MAIN(tst_QMqttTransport)
+
+#include "tst_qmqtttransport.moc"
@@ -0,0 +1,134 @@
+#include "benchmarkclient.h"
+#include <QtEndian>
+#include "qmqttnetworkrequest.h"
+
+BenchmarkClient::BenchmarkClient(int index, QMqttProtocol::QoS qos, int messagesPerSecond,
+                                 int payloadSize, int maximumInflight, const QElapsedTimer &clock,
+                                 QObject *parent) :
+    QObject(parent),
+    m_client(QStringLiteral("benchmark-%1").arg(index)),
+    m_topic(QStringLiteral("benchmark/%1").arg(index)),
+    m_qos(qos),
+    m_messagesPerSecond(messagesPerSecond),
+    //the first 8 bytes carry the publish time
+    m_payload(qMax(payloadSize, int(sizeof(qint64))), 'p'),
+    m_clock(clock),
+    m_publishTimer(),
+    m_lastTick(0),
+    m_credit(0),
+    m_sent(0),
+    m_received(0),
+    m_latencies()
+{
+    m_client.setMaximumInflight(maximumInflight);
+    m_publishTimer.setTimerType(Qt::PreciseTimer);
+    m_publishTimer.setInterval(1);
+    QObject::connect(&m_publishTimer, &QTimer::timeout, this, &BenchmarkClient::publishDue);
+
+    QObject::connect(&m_client, &QMqttClient::connected, this, [this]() {
+        m_client.subscribe(m_topic, m_qos, [this](bool success) {
+            if (success) {
+                Q_EMIT ready();
+            } else {
+                Q_EMIT failed(QStringLiteral("Subscription to %1 was refused.").arg(m_topic));
+            }
+        });
+    });
+    QObject::connect(&m_client, &QMqttClient::error,
+                     this, [this](QMqttProtocol::Error, const QString &errorMessage) {
+        Q_EMIT failed(errorMessage);
+    });
+    QObject::connect(&m_client, &QMqttClient::messageReceived,
+                     this, [this](const QString &, const QByteArray &message) {
+        onMessageReceived(message);
+    });
+}
+
+BenchmarkClient::~BenchmarkClient()
+{}
+
+void BenchmarkClient::connectToBroker(const QUrl &url)
+{
+    m_client.connect(QMqttNetworkRequest(url));
+}
+
+void BenchmarkClient::startPublishing()
+{
+    m_lastTick = m_clock.nsecsElapsed();
+    m_credit = 0;
+    m_publishTimer.start();
+}
+
+void BenchmarkClient::stopPublishing()
+{
+    m_publishTimer.stop();
+}
+
+void BenchmarkClient::disconnectFromBroker()
+{
+    m_client.disconnect();
+}
+
+quint64 BenchmarkClient::sent() const
+{
+    return m_sent;
+}
+
+quint64 BenchmarkClient::received() const
+{
+    return m_received;
+}
+
+const QVector<qint64> &BenchmarkClient::latencies() const
+{
+    return m_latencies;
+}
+
+const QMqttClient &BenchmarkClient::client() const
+{
+    return m_client;
+}
+
+void BenchmarkClient::publishDue()
+{
+    const qint64 now = m_clock.nsecsElapsed();
+    int count = BURST_SIZE;
+    if (m_messagesPerSecond > 0) {
+        m_credit += double(m_messagesPerSecond) * double(now - m_lastTick) / 1e9;
+        count = int(m_credit);
+        m_credit -= count;
+    }
+    m_lastTick = now;
+
+    //group the burst into as few writes as possible
+    m_client.cork();
+    for (int i = 0; i < count; ++i) {
+        //without a rate, publishing stops when the in-flight window is full
+        if (m_messagesPerSecond == 0 && m_client.queuedCount() > 0) {
+            break;
+        }
+        publishOne();
+    }
+    m_client.uncork();
+}
+
+void BenchmarkClient::publishOne()
+{
+    qToBigEndian<qint64>(m_clock.nsecsElapsed(), reinterpret_cast<uchar *>(m_payload.data()));
+    if (m_qos == QMqttProtocol::QoS::AT_MOST_ONCE) {
+        m_client.publish(m_topic, m_payload);
+    } else {
+        m_client.publish(m_topic, m_payload, m_qos, nullptr);
+    }
+    ++m_sent;
+}
+
+void BenchmarkClient::onMessageReceived(const QByteArray &message)
+{
+    if (message.size() < int(sizeof(qint64))) {
+        return;
+    }
+    const qint64 publishedAt = qFromBigEndian<qint64>(reinterpret_cast<const uchar *>(message.constData()));
+    m_latencies.append(m_clock.nsecsElapsed() - publishedAt);
+    ++m_received;
+}
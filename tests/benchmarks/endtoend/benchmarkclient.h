@@ -0,0 +1,60 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QString>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+#include "qmqttclient.h"
+
+//A client that publishes messages to its own topic at a fixed rate, subscribes to that topic,
+//and measures the time from publishing a message until receiving it back.
+//Each message carries its publish time, taken from a clock shared by all clients.
+class BenchmarkClient : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(BenchmarkClient)
+
+public:
+    //messagesPerSecond 0 publishes as fast as the in-flight window allows
+    BenchmarkClient(int index, QMqttProtocol::QoS qos, int messagesPerSecond, int payloadSize,
+                    int maximumInflight, const QElapsedTimer &clock, QObject *parent = nullptr);
+    virtual ~BenchmarkClient();
+
+    void connectToBroker(const QUrl &url);
+    void startPublishing();
+    void stopPublishing();
+    void disconnectFromBroker();
+
+    quint64 sent() const;
+    quint64 received() const;
+    //end-to-end latencies in nanoseconds, in order of reception
+    const QVector<qint64> &latencies() const;
+    const QMqttClient &client() const;
+
+Q_SIGNALS:
+    void ready();
+    void failed(const QString &errorMessage);
+
+private:
+    static const int BURST_SIZE = 100;
+
+    QMqttClient m_client;
+    const QString m_topic;
+    const QMqttProtocol::QoS m_qos;
+    const int m_messagesPerSecond;
+    QByteArray m_payload;
+    const QElapsedTimer &m_clock;
+    QTimer m_publishTimer;
+    qint64 m_lastTick;
+    double m_credit;    //messages that are due, but not yet published
+    quint64 m_sent;
+    quint64 m_received;
+    QVector<qint64> m_latencies;
+
+    void publishDue();
+    void publishOne();
+    void onMessageReceived(const QByteArray &message);
+};
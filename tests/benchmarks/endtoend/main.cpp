@@ -0,0 +1,153 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include "mqttbrokerstub.h"
+#include "benchmarkclient.h"
+
+//End-to-end benchmark of QMqttClient against an in-process broker stub on localhost.
+//Every client publishes to its own topic and is subscribed to it, so each message makes a
+//round trip client -> broker -> client; the time of that round trip is the reported latency.
+
+static qint64 percentile(const QVector<qint64> &sortedValues, double percentile)
+{
+    if (sortedValues.isEmpty()) {
+        return -1;
+    }
+    const int index = qBound(0, int(percentile / 100.0 * sortedValues.size() + 0.5) - 1, sortedValues.size() - 1);
+    return sortedValues.at(index);
+}
+
+static int intOption(const QCommandLineParser &parser, const QString &name)
+{
+    bool ok = false;
+    const int value = parser.value(name).toInt(&ok);
+    if (!ok || value < 0) {
+        std::fprintf(stderr, "Invalid value for --%s: %s\n", qPrintable(name), qPrintable(parser.value(name)));
+        std::exit(1);
+    }
+    return value;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Measures the throughput and latency of QMqttClient against an in-process broker stub."));
+    parser.addHelpOption();
+    parser.addOptions({
+        { QStringLiteral("clients"), QStringLiteral("Number of clients."), QStringLiteral("n"), QStringLiteral("4") },
+        { QStringLiteral("rate"), QStringLiteral("Messages per second per client; 0 publishes as fast as possible."),
+          QStringLiteral("msgs/s"), QStringLiteral("1000") },
+        { QStringLiteral("qos"), QStringLiteral("QoS of the published messages (0, 1 or 2)."), QStringLiteral("qos"), QStringLiteral("1") },
+        { QStringLiteral("payload"), QStringLiteral("Payload size in bytes (at least 8)."), QStringLiteral("bytes"), QStringLiteral("64") },
+        { QStringLiteral("duration"), QStringLiteral("Publishing time in seconds."), QStringLiteral("s"), QStringLiteral("5") },
+        { QStringLiteral("inflight"), QStringLiteral("Maximum in-flight QoS 1 and 2 messages per client; 0 is unlimited."),
+          QStringLiteral("n"), QStringLiteral("100") }
+    });
+    parser.process(app);
+
+    const int clientCount = qMax(1, intOption(parser, QStringLiteral("clients")));
+    const int rate = intOption(parser, QStringLiteral("rate"));
+    const int qosValue = intOption(parser, QStringLiteral("qos"));
+    const int payloadSize = intOption(parser, QStringLiteral("payload"));
+    const int durationMs = intOption(parser, QStringLiteral("duration")) * 1000;
+    const int maximumInflight = intOption(parser, QStringLiteral("inflight"));
+    if (qosValue > 2) {
+        std::fprintf(stderr, "Invalid QoS: %d\n", qosValue);
+        return 1;
+    }
+    const QMqttProtocol::QoS qos = QMqttProtocol::QoS(qosValue);
+
+    MqttBrokerStub broker;
+    if (!broker.listen()) {
+        std::fprintf(stderr, "Broker stub cannot listen: %s\n", qPrintable(broker.errorString()));
+        return 1;
+    }
+
+    QElapsedTimer clock;
+    clock.start();
+    QVector<BenchmarkClient *> clients;
+    int readyClients = 0;
+    qint64 publishStart = 0;
+    qint64 publishEnd = 0;
+
+    const auto report = [&]() {
+        QVector<qint64> latencies;
+        quint64 sent = 0;
+        quint64 received = 0;
+        for (const BenchmarkClient * const client : clients) {
+            sent += client->sent();
+            received += client->received();
+            latencies += client->latencies();
+        }
+        std::sort(latencies.begin(), latencies.end());
+        const double seconds = double(publishEnd - publishStart) / 1e9;
+
+        std::printf("clients %d, rate %d msgs/s per client, QoS %d, payload %d B, in-flight %d\n",
+                    clientCount, rate, qosValue, payloadSize, maximumInflight);
+        std::printf("sent      %llu messages, %.0f msgs/s\n", static_cast<unsigned long long>(sent), double(sent) / seconds);
+        std::printf("received  %llu messages, %.0f msgs/s\n", static_cast<unsigned long long>(received), double(received) / seconds);
+        std::printf("end-to-end latency (us): p50 %.1f, p99 %.1f, p999 %.1f, max %.1f\n",
+                    percentile(latencies, 50) / 1e3, percentile(latencies, 99) / 1e3,
+                    percentile(latencies, 99.9) / 1e3, percentile(latencies, 100) / 1e3);
+        if (qos != QMqttProtocol::QoS::AT_MOST_ONCE) {
+            const QMqttProtocol::Acknowledgement acknowledgement = (qos == QMqttProtocol::QoS::AT_LEAST_ONCE)
+                    ? QMqttProtocol::Acknowledgement::PUBACK : QMqttProtocol::Acknowledgement::PUBREC;
+            qint64 worst50 = -1;
+            qint64 worst99 = -1;
+            for (const BenchmarkClient * const client : clients) {
+                worst50 = qMax(worst50, client->client().latencyPercentile(acknowledgement, 50));
+                worst99 = qMax(worst99, client->client().latencyPercentile(acknowledgement, 99));
+            }
+            std::printf("acknowledgement round trip (us, worst client): p50 %lld, p99 %lld\n",
+                        static_cast<long long>(worst50), static_cast<long long>(worst99));
+        }
+    };
+
+    const auto finish = [&]() {
+        for (BenchmarkClient * const client : clients) {
+            client->disconnectFromBroker();
+        }
+        report();
+        app.quit();
+    };
+
+    const auto startPublishing = [&]() {
+        publishStart = clock.nsecsElapsed();
+        for (BenchmarkClient * const client : clients) {
+            client->startPublishing();
+        }
+        QTimer::singleShot(durationMs, &app, [&]() {
+            for (BenchmarkClient * const client : clients) {
+                client->stopPublishing();
+            }
+            publishEnd = clock.nsecsElapsed();
+            //give the messages that are still underway time to arrive
+            QTimer::singleShot(1000, &app, finish);
+        });
+    };
+
+    for (int i = 0; i < clientCount; ++i) {
+        BenchmarkClient * const client
+                = new BenchmarkClient(i, qos, rate, payloadSize, maximumInflight, clock, &app);
+        QObject::connect(client, &BenchmarkClient::ready, &app, [&]() {
+            if (++readyClients == clientCount) {
+                startPublishing();
+            }
+        });
+        QObject::connect(client, &BenchmarkClient::failed, &app, [&app](const QString &errorMessage) {
+            std::fprintf(stderr, "Client failed: %s\n", qPrintable(errorMessage));
+            app.exit(1);
+        });
+        clients.append(client);
+        client->connectToBroker(broker.url());
+    }
+
+    return app.exec();
+}
@@ -0,0 +1,390 @@
+#include "mqttbrokerstub.h"
+#include <QWebSocket>
+#include <QtEndian>
+
+namespace {
+inline quint16 readUint16(const char *data)
+{
+    return qFromBigEndian<quint16>(reinterpret_cast<const uchar *>(data));
+}
+
+inline QByteArray uint16ToBytes(quint16 value)
+{
+    QByteArray bytes(2, Qt::Uninitialized);
+    qToBigEndian<quint16>(value, reinterpret_cast<uchar *>(bytes.data()));
+    return bytes;
+}
+}
+
+MqttBrokerStub::MqttBrokerStub(QObject *parent) :
+    QObject(parent),
+    m_server(QStringLiteral("MqttBrokerStub"), QWebSocketServer::NonSecureMode),
+    m_sessions(),
+    m_publishesReceived(0),
+    m_publishesSent(0),
+    m_framesReceived(0),
+    m_packetsReceived(),
+    m_holdAcknowledgements(false),
+    m_recordMessages(false),
+    m_messagesReceived(),
+    m_subscribeSizes(),
+    m_refusedTopicFilters()
+{
+    QObject::connect(&m_server, &QWebSocketServer::newConnection, this, &MqttBrokerStub::onNewConnection);
+}
+
+MqttBrokerStub::~MqttBrokerStub()
+{
+    m_server.close();
+    for (QWebSocket * const socket : m_sessions.keys()) {
+        socket->disconnect(this);
+        delete socket;
+    }
+}
+
+bool MqttBrokerStub::listen(const QHostAddress &address, quint16 port)
+{
+    return m_server.listen(address, port);
+}
+
+QUrl MqttBrokerStub::url() const
+{
+    QUrl url;
+    url.setScheme(QStringLiteral("ws"));
+    url.setHost(m_server.serverAddress().toString());
+    url.setPort(m_server.serverPort());
+    return url;
+}
+
+QString MqttBrokerStub::errorString() const
+{
+    return m_server.errorString();
+}
+
+quint64 MqttBrokerStub::publishesReceived() const
+{
+    return m_publishesReceived;
+}
+
+quint64 MqttBrokerStub::publishesSent() const
+{
+    return m_publishesSent;
+}
+
+quint64 MqttBrokerStub::framesReceived() const
+{
+    return m_framesReceived;
+}
+
+quint64 MqttBrokerStub::packetsReceived(quint8 type) const
+{
+    return type < 16 ? m_packetsReceived[type] : 0;
+}
+
+void MqttBrokerStub::sendToClients(quint8 header, const QByteArray &body)
+{
+    for (QWebSocket * const socket : m_sessions.keys()) {
+        sendPacket(socket, header, body);
+    }
+}
+
+QVector<QByteArray> MqttBrokerStub::subscriptions() const
+{
+    QVector<QByteArray> topicFilters;
+    for (const Session &session : m_sessions) {
+        for (const QPair<QByteArray, quint8> &subscription : session.subscriptions) {
+            topicFilters.append(subscription.first);
+        }
+    }
+    return topicFilters;
+}
+
+void MqttBrokerStub::closeConnections()
+{
+    for (QWebSocket * const socket : m_sessions.keys()) {
+        socket->abort();
+    }
+}
+
+QVector<int> MqttBrokerStub::subscribeSizes() const
+{
+    return m_subscribeSizes;
+}
+
+void MqttBrokerStub::refuseTopicFilter(const QByteArray &topicFilter)
+{
+    m_refusedTopicFilters.insert(topicFilter);
+}
+
+void MqttBrokerStub::setHoldAcknowledgements(bool hold)
+{
+    m_holdAcknowledgements = hold;
+    if (hold) {
+        return;
+    }
+    for (auto it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+        if (!it.value().heldAcknowledgements.isEmpty()) {
+            it.key()->sendBinaryMessage(it.value().heldAcknowledgements);
+            it.value().heldAcknowledgements.clear();
+        }
+    }
+}
+
+void MqttBrokerStub::setRecordMessages(bool record)
+{
+    m_recordMessages = record;
+}
+
+QVector<QByteArray> MqttBrokerStub::messagesReceived() const
+{
+    return m_messagesReceived;
+}
+
+void MqttBrokerStub::onNewConnection()
+{
+    while (QWebSocket * const socket = m_server.nextPendingConnection()) {
+        m_sessions.insert(socket, Session());
+        QObject::connect(socket, &QWebSocket::binaryMessageReceived, this, [this, socket](const QByteArray &data) {
+            onBinaryMessageReceived(socket, data);
+        });
+        QObject::connect(socket, &QWebSocket::disconnected, this, [this, socket]() {
+            m_sessions.remove(socket);
+            socket->deleteLater();
+        });
+    }
+}
+
+//splits the received bytes into packets; a packet can span several WebSocket messages
+void MqttBrokerStub::onBinaryMessageReceived(QWebSocket *socket, const QByteArray &data)
+{
+    ++m_framesReceived;
+    QByteArray &buffer = m_sessions[socket].buffer;
+    buffer.append(data);
+
+    int offset = 0;
+    while (buffer.size() - offset >= 2) {
+        int position = offset + 1;
+        int length = 0;
+        int multiplier = 1;
+        bool lengthComplete = false;
+        for (int i = 0; i < 4 && position < buffer.size(); ++i) {
+            const quint8 byte = quint8(buffer.at(position++));
+            length += (byte & 0x7F) * multiplier;
+            multiplier *= 0x80;
+            if (!(byte & 0x80)) {
+                lengthComplete = true;
+                break;
+            }
+        }
+        if (!lengthComplete) {
+            if (position - offset > 4) {
+                qWarning("MqttBrokerStub: invalid remaining length, closing connection");
+                socket->abort();
+                return;
+            }
+            break;
+        }
+        if (buffer.size() - position < length) {
+            break;
+        }
+        const quint8 header = quint8(buffer.at(offset));
+        offset = position + length;
+        handlePacket(socket, header, buffer.constData() + position, length);
+        if (!m_sessions.contains(socket)) {
+            return;
+        }
+    }
+    buffer.remove(0, offset);
+}
+
+void MqttBrokerStub::handlePacket(QWebSocket *socket, quint8 header, const char *data, int length)
+{
+    ++m_packetsReceived[header >> 4];
+    switch (header >> 4) {
+    case 1:     //CONNECT
+        sendPacket(socket, 0x20, QByteArray(2, '\0'));
+        break;
+    case 3:     //PUBLISH
+        handlePublish(header, data, length, socket);
+        break;
+    case 5:     //PUBREC; only the messages forwarded by the stub are released
+        if (m_sessions[socket].releasing.contains(readUint16(data))) {
+            sendPacket(socket, 0x62, QByteArray(data, 2));
+        }
+        break;
+    case 6:     //PUBREL
+        sendPacket(socket, 0x70, QByteArray(data, 2));
+        break;
+    case 7:     //PUBCOMP of a forwarded QoS 2 message
+        m_sessions[socket].releasing.remove(readUint16(data));
+        break;
+    case 8:     //SUBSCRIBE
+        handleSubscribe(socket, data, length);
+        break;
+    case 10:    //UNSUBSCRIBE
+        handleUnsubscribe(socket, data, length);
+        break;
+    case 12:    //PINGREQ
+        sendPacket(socket, 0xD0, QByteArray());
+        break;
+    case 14:    //DISCONNECT
+        socket->close();
+        break;
+    default:    //PUBACK of forwarded messages needs no answer
+        break;
+    }
+}
+
+void MqttBrokerStub::handlePublish(quint8 header, const char *data, int length, QWebSocket *socket)
+{
+    ++m_publishesReceived;
+    const quint8 qos = (header >> 1) & 0x03;
+    const int topicLength = readUint16(data);
+    const QByteArray topicName(data + 2, topicLength);
+    int position = 2 + topicLength;
+    if (qos > 0) {
+        const QByteArray packetIdentifier(data + position, 2);
+        position += 2;
+        acknowledge(socket, qos == 1 ? 0x40 : 0x50, packetIdentifier);
+    }
+    const QByteArray message(data + position, length - position);
+    if (m_recordMessages) {
+        m_messagesReceived.append(message);
+    }
+
+    for (QHash<QWebSocket *, Session>::iterator it = m_sessions.begin(); it != m_sessions.end(); ++it) {
+        for (const QPair<QByteArray, quint8> &subscription : it.value().subscriptions) {
+            if (!matches(subscription.first, topicName)) {
+                continue;
+            }
+            const quint8 forwardQos = qMin(qos, subscription.second);
+            QByteArray body = uint16ToBytes(quint16(topicName.size())) + topicName;
+            if (forwardQos > 0) {
+                Session &session = it.value();
+                body.append(uint16ToBytes(session.nextPacketIdentifier));
+                if (forwardQos == 2) {
+                    session.releasing.insert(session.nextPacketIdentifier);
+                }
+                session.nextPacketIdentifier = quint16(session.nextPacketIdentifier + 1);
+                if (session.nextPacketIdentifier == 0) {
+                    session.nextPacketIdentifier = 1;
+                }
+            }
+            body.append(message);
+            sendPacket(it.key(), quint8(0x30 | (forwardQos << 1)), body);
+            ++m_publishesSent;
+            //a message is forwarded once per session, even if several filters match
+            break;
+        }
+    }
+}
+
+void MqttBrokerStub::handleSubscribe(QWebSocket *socket, const char *data, int length)
+{
+    m_subscribeSizes.append(length);
+    Session &session = m_sessions[socket];
+    QByteArray body(data, 2);   //packet identifier
+    int position = 2;
+    while (position + 2 <= length) {
+        const int filterLength = readUint16(data + position);
+        position += 2;
+        if (position + filterLength + 1 > length) {
+            break;
+        }
+        const QByteArray topicFilter(data + position, filterLength);
+        const quint8 qos = quint8(qMin(2, int(quint8(data[position + filterLength]))));
+        position += filterLength + 1;
+        if (m_refusedTopicFilters.contains(topicFilter)) {
+            body.append(char(0x80));
+            continue;
+        }
+
+        bool replaced = false;
+        for (QPair<QByteArray, quint8> &subscription : session.subscriptions) {
+            if (subscription.first == topicFilter) {
+                subscription.second = qos;
+                replaced = true;
+            }
+        }
+        if (!replaced) {
+            session.subscriptions.append(qMakePair(topicFilter, qos));
+        }
+        body.append(char(qos));
+    }
+    acknowledge(socket, 0x90, body);
+}
+
+void MqttBrokerStub::handleUnsubscribe(QWebSocket *socket, const char *data, int length)
+{
+    Session &session = m_sessions[socket];
+    int position = 2;
+    while (position + 2 <= length) {
+        const int filterLength = readUint16(data + position);
+        position += 2;
+        const QByteArray topicFilter(data + position, qMin(filterLength, length - position));
+        position += filterLength;
+        for (int i = session.subscriptions.size() - 1; i >= 0; --i) {
+            if (session.subscriptions.at(i).first == topicFilter) {
+                session.subscriptions.remove(i);
+            }
+        }
+    }
+    sendPacket(socket, 0xB0, QByteArray(data, 2));
+}
+
+//see 4.7 Topic Names and Topic Filters
+bool MqttBrokerStub::matches(const QByteArray &topicFilter, const QByteArray &topicName)
+{
+    if (topicFilter == topicName) {
+        return true;
+    }
+    const QList<QByteArray> filterLevels = topicFilter.split('/');
+    const QList<QByteArray> topicLevels = topicName.split('/');
+    if (topicName.startsWith('$') && (topicFilter.startsWith('+') || topicFilter.startsWith('#'))) {
+        return false;
+    }
+    for (int i = 0; i < filterLevels.size(); ++i) {
+        if (filterLevels.at(i) == "#") {
+            return true;
+        }
+        if (i >= topicLevels.size()) {
+            return false;
+        }
+        if (filterLevels.at(i) != "+" && filterLevels.at(i) != topicLevels.at(i)) {
+            return false;
+        }
+    }
+    return filterLevels.size() == topicLevels.size();
+}
+
+void MqttBrokerStub::acknowledge(QWebSocket *socket, quint8 header, const QByteArray &body)
+{
+    if (m_holdAcknowledgements) {
+        m_sessions[socket].heldAcknowledgements.append(encodePacket(header, body));
+    } else {
+        sendPacket(socket, header, body);
+    }
+}
+
+QByteArray MqttBrokerStub::encodePacket(quint8 header, const QByteArray &body)
+{
+    QByteArray packet;
+    packet.reserve(5 + body.size());
+    packet.append(char(header));
+    int remainingLength = body.size();
+    do {
+        quint8 byte = remainingLength % 0x80;
+        remainingLength /= 0x80;
+        if (remainingLength > 0) {
+            byte |= 0x80;
+        }
+        packet.append(char(byte));
+    } while (remainingLength > 0);
+    packet.append(body);
+    return packet;
+}
+
+void MqttBrokerStub::sendPacket(QWebSocket *socket, quint8 header, const QByteArray &body)
+{
+    socket->sendBinaryMessage(encodePacket(header, body));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QObject>
+#include <QByteArray>
+#include <QHash>
+#include <QHostAddress>
+#include <QPair>
+#include <QSet>
+#include <QUrl>
+#include <QVector>
+#include <QWebSocketServer>
+
+class QWebSocket;
+
+//A minimal MQTT 3.1.1 server over WebSockets, for benchmarking clients on localhost.
+//It accepts every CONNECT, grants every subscription, acknowledges QoS 1 and QoS 2 publishes,
+//answers pings, and forwards published messages to the matching subscriptions.
+//It keeps no sessions or retained messages, does not check credentials or packet validity
+//beyond framing, and does not redeliver messages; it is not meant to be used as a broker.
+//The auto tests also use it to send packets to the client that a real server would not send.
+class MqttBrokerStub : public QObject
+{
+    Q_OBJECT
+    Q_DISABLE_COPY(MqttBrokerStub)
+
+public:
+    explicit MqttBrokerStub(QObject *parent = nullptr);
+    virtual ~MqttBrokerStub();
+
+    //listens on a free port if port is 0
+    bool listen(const QHostAddress &address = QHostAddress::LocalHost, quint16 port = 0);
+    QUrl url() const;
+    QString errorString() const;
+
+    quint64 publishesReceived() const;
+    quint64 publishesSent() const;
+    //the number of WebSocket messages received, i.e. of writes of the clients
+    quint64 framesReceived() const;
+    //the number of received packets of the given control packet type
+    quint64 packetsReceived(quint8 type) const;
+
+    //sends a packet with the given fixed header byte and body to all connected clients
+    void sendToClients(quint8 header, const QByteArray &body);
+    //the topic filters the connected clients are subscribed to
+    QVector<QByteArray> subscriptions() const;
+    //the remaining lengths of the received SUBSCRIBE packets
+    QVector<int> subscribeSizes() const;
+    //answers subscriptions to topicFilter with the failure return code 0x80
+    void refuseTopicFilter(const QByteArray &topicFilter);
+    //drops the connections to all clients, without a DISCONNECT packet
+    void closeConnections();
+    //holds back the PUBACK, PUBREC and SUBACK packets while hold is true; they are sent in order,
+    //in a single WebSocket message per client, when hold is set to false again
+    void setHoldAcknowledgements(bool hold);
+    //records the payloads of the received publishes while record is true; off by default, as
+    //benchmarks publish far too many messages to keep them
+    void setRecordMessages(bool record);
+    //the recorded payloads, in the order they were received
+    QVector<QByteArray> messagesReceived() const;
+
+private:
+    struct Session
+    {
+        Session() :
+            buffer(), subscriptions(), nextPacketIdentifier(1), releasing(), heldAcknowledgements()
+        {}
+
+        QByteArray buffer;      //bytes of an incomplete packet
+        QVector<QPair<QByteArray, quint8>> subscriptions;   //topic filter, granted QoS
+        quint16 nextPacketIdentifier;
+        QSet<quint16> releasing;    //identifiers of forwarded QoS 2 messages until PUBCOMP
+        QByteArray heldAcknowledgements;    //encoded packets
+    };
+
+    QWebSocketServer m_server;
+    QHash<QWebSocket *, Session> m_sessions;
+    quint64 m_publishesReceived;
+    quint64 m_publishesSent;
+    quint64 m_framesReceived;
+    quint64 m_packetsReceived[16];
+    bool m_holdAcknowledgements;
+    bool m_recordMessages;
+    QVector<int> m_subscribeSizes;
+    QSet<QByteArray> m_refusedTopicFilters;
+    QVector<QByteArray> m_messagesReceived;
+
+    void onNewConnection();
+    void onBinaryMessageReceived(QWebSocket *socket, const QByteArray &data);
+    void handlePacket(QWebSocket *socket, quint8 header, const char *data, int length);
+    void handlePublish(quint8 header, const char *data, int length, QWebSocket *socket);
+    void handleSubscribe(QWebSocket *socket, const char *data, int length);
+    void handleUnsubscribe(QWebSocket *socket, const char *data, int length);
+
+    static bool matches(const QByteArray &topicFilter, const QByteArray &topicName);
+    void acknowledge(QWebSocket *socket, quint8 header, const QByteArray &body);
+
+    static QByteArray encodePacket(quint8 header, const QByteArray &body);
+    static void sendPacket(QWebSocket *socket, quint8 header, const QByteArray &body);
+};
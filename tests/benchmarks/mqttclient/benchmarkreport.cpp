@@ -0,0 +1,85 @@
+#include "benchmarkreport.h"
+#include <QtTest/QtTest>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+//constant initialized, so that it can be used by allocations made before main()
+std::atomic<quint64> allocations(0);
+
+inline void countAllocation()
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+}
+}
+
+#if defined(__GLIBC__)
+//Qt containers allocate with malloc, so the C allocation functions are replaced; operator new
+//allocates with malloc as well, and is counted through it
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *pointer, size_t size);
+
+void *malloc(size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *pointer, size_t size)
+{
+    countAllocation();
+    return __libc_realloc(pointer, size);
+}
+}
+#else
+void *operator new(std::size_t size)
+{
+    countAllocation();
+    void * const pointer = std::malloc(size ? size : 1);
+    if (!pointer) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void operator delete(void *pointer) Q_DECL_NOEXCEPT
+{
+    std::free(pointer);
+}
+#endif
+
+quint64 allocationCount()
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+BenchmarkReport::BenchmarkReport() :
+    m_timer(),
+    m_allocations(allocationCount()),
+    m_iterations(0)
+{
+    m_timer.start();
+}
+
+BenchmarkReport::~BenchmarkReport()
+{
+    const qint64 elapsed = m_timer.nsecsElapsed();
+    const quint64 allocated = allocationCount() - m_allocations;
+    if (m_iterations == 0) {
+        return;
+    }
+    qInfo("%s(%s): %.1f ns/op, %.2f allocations/op",
+          QTest::currentTestFunction(),
+          QTest::currentDataTag() ? QTest::currentDataTag() : "",
+          double(elapsed) / double(m_iterations),
+          double(allocated) / double(m_iterations));
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QtGlobal>
+#include <QElapsedTimer>
+
+//Returns the number of heap allocations made by the process so far.
+//The count is maintained by benchmarkreport.cpp, which replaces the allocation functions; it
+//includes the allocations of QByteArray and QString on platforms with glibc, and only those
+//made through operator new elsewhere.
+quint64 allocationCount();
+
+//Reports the time and the number of heap allocations per iteration of a QBENCHMARK loop, in
+//addition to the results reported by QtTest. iteration() must be called once per iteration;
+//the report is printed when the object goes out of scope.
+//Allocations made by QtTest while it runs the loop are included, but are negligible compared
+//to the number of iterations.
+class BenchmarkReport
+{
+    Q_DISABLE_COPY(BenchmarkReport)
+
+public:
+    BenchmarkReport();
+    ~BenchmarkReport();
+
+    void iteration() { ++m_iterations; }
+
+private:
+    QElapsedTimer m_timer;
+    quint64 m_allocations;
+    quint64 m_iterations;
+};
@@ -0,0 +1,220 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "qmqttcontrolpacket_p.h"
+#include "qmqttwill.h"
+#include "benchmarkreport.h"
+
+typedef QMqttProtocol::PacketType PacketType;
+
+class tst_Bench_QMqttControlPacket: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_Bench_QMqttControlPacket();
+
+private Q_SLOTS:
+    void encodeConnect();
+    void encodePublish_data();
+    void encodePublish();
+    void encodePublishToTopic_data();
+    void encodePublishToTopic();
+    void encodeAcknowledgement_data();
+    void encodeAcknowledgement();
+    void encodeSubscribe_data();
+    void encodeSubscribe();
+    void encodeUnsubscribe_data();
+    void encodeUnsubscribe();
+    void encodeToBuffer_data();
+    void encodeToBuffer();
+};
+
+//columns shared by the benchmarks of packets with a topic and a payload
+static void addPayloadRows()
+{
+    QTest::addColumn<int>("topicLength");
+    QTest::addColumn<int>("payloadSize");
+
+    for (const int payloadSize : { 0, 16, 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 }) {
+        QTest::newRow(qPrintable(QStringLiteral("payload %1 B").arg(payloadSize)))
+                << 16 << payloadSize;
+    }
+    for (const int topicLength : { 1, 64, 1024, 65535 }) {
+        QTest::newRow(qPrintable(QStringLiteral("topic %1 chars").arg(topicLength)))
+                << topicLength << 64;
+    }
+}
+
+tst_Bench_QMqttControlPacket::tst_Bench_QMqttControlPacket() :
+    QObject()
+{}
+
+void tst_Bench_QMqttControlPacket::encodeConnect()
+{
+    const QMqttWill will(QStringLiteral("clients/benchmark/status"), QByteArrayLiteral("offline"),
+                         true, QMqttProtocol::QoS::AT_LEAST_ONCE);
+    BenchmarkReport report;
+    QBENCHMARK {
+        QMqttConnectControlPacket packet(QStringLiteral("benchmark-client"));
+        packet.setWill(will);
+        packet.setCredentials(QStringLiteral("user"), QByteArrayLiteral("password"));
+        const QByteArray encoded = packet.encode();
+        Q_UNUSED(encoded);
+        report.iteration();
+    }
+}
+
+void tst_Bench_QMqttControlPacket::encodePublish_data()
+{
+    addPayloadRows();
+}
+
+void tst_Bench_QMqttControlPacket::encodePublish()
+{
+    QFETCH(int, topicLength);
+    QFETCH(int, payloadSize);
+
+    const QString topic(topicLength, QLatin1Char('t'));
+    const QByteArray message(payloadSize, 'm');
+    BenchmarkReport report;
+    QBENCHMARK {
+        const QMqttPublishControlPacket packet(topic, message, QMqttProtocol::QoS::AT_LEAST_ONCE, false, 1);
+        const QByteArray encoded = packet.encode();
+        Q_UNUSED(encoded);
+        report.iteration();
+    }
+}
+
+void tst_Bench_QMqttControlPacket::encodePublishToTopic_data()
+{
+    addPayloadRows();
+}
+
+//as encodePublish(), with the topic name encoded once up front
+void tst_Bench_QMqttControlPacket::encodePublishToTopic()
+{
+    QFETCH(int, topicLength);
+    QFETCH(int, payloadSize);
+
+    const QMqttTopic topic(QString(topicLength, QLatin1Char('t')));
+    const QByteArray message(payloadSize, 'm');
+    BenchmarkReport report;
+    QBENCHMARK {
+        const QMqttPublishControlPacket packet(topic, message, QMqttProtocol::QoS::AT_LEAST_ONCE, false, 1);
+        const QByteArray encoded = packet.encode();
+        Q_UNUSED(encoded);
+        report.iteration();
+    }
+}
+
+void tst_Bench_QMqttControlPacket::encodeAcknowledgement_data()
+{
+    QTest::addColumn<int>("packetType");
+
+    QTest::newRow("PUBACK") << int(PacketType::PUBACK);
+    QTest::newRow("PUBREC") << int(PacketType::PUBREC);
+    QTest::newRow("PUBREL") << int(PacketType::PUBREL);
+    QTest::newRow("PUBCOMP") << int(PacketType::PUBCOMP);
+    QTest::newRow("PINGREQ") << int(PacketType::PINGREQ);
+    QTest::newRow("DISCONNECT") << int(PacketType::DISCONNECT);
+}
+
+void tst_Bench_QMqttControlPacket::encodeAcknowledgement()
+{
+    QFETCH(int, packetType);
+
+    BenchmarkReport report;
+    QBENCHMARK {
+        QByteArray encoded;
+        switch (PacketType(packetType)) {
+        case PacketType::PUBACK: encoded = QMqttPubAckControlPacket(1).encode(); break;
+        case PacketType::PUBREC: encoded = QMqttPubRecControlPacket(1).encode(); break;
+        case PacketType::PUBREL: encoded = QMqttPubRelControlPacket(1).encode(); break;
+        case PacketType::PUBCOMP: encoded = QMqttPubCompControlPacket(1).encode(); break;
+        case PacketType::PINGREQ: encoded = QMqttPingReqControlPacket().encode(); break;
+        default: encoded = QMqttDisconnectControlPacket().encode(); break;
+        }
+        report.iteration();
+    }
+}
+
+void tst_Bench_QMqttControlPacket::encodeSubscribe_data()
+{
+    QTest::addColumn<int>("topicFilterCount");
+
+    for (const int count : { 1, 10, 100, 1000 }) {
+        QTest::newRow(qPrintable(QStringLiteral("%1 filters").arg(count))) << count;
+    }
+}
+
+void tst_Bench_QMqttControlPacket::encodeSubscribe()
+{
+    QFETCH(int, topicFilterCount);
+
+    QVector<TopicFilter> topicFilters;
+    for (int i = 0; i < topicFilterCount; ++i) {
+        topicFilters.append({ QStringLiteral("sensors/%1/+/temperature").arg(i), QMqttProtocol::QoS::AT_LEAST_ONCE });
+    }
+    BenchmarkReport report;
+    QBENCHMARK {
+        const QByteArray encoded = QMqttSubscribeControlPacket(1, topicFilters).encode();
+        Q_UNUSED(encoded);
+        report.iteration();
+    }
+}
+
+void tst_Bench_QMqttControlPacket::encodeUnsubscribe_data()
+{
+    encodeSubscribe_data();
+}
+
+void tst_Bench_QMqttControlPacket::encodeUnsubscribe()
+{
+    QFETCH(int, topicFilterCount);
+
+    QVector<QString> topics;
+    for (int i = 0; i < topicFilterCount; ++i) {
+        topics.append(QStringLiteral("sensors/%1/+/temperature").arg(i));
+    }
+    BenchmarkReport report;
+    QBENCHMARK {
+        const QByteArray encoded = QMqttUnsubscribeControlPacket(1, topics).encode();
+        Q_UNUSED(encoded);
+        report.iteration();
+    }
+}
+
+void tst_Bench_QMqttControlPacket::encodeToBuffer_data()
+{
+    QTest::addColumn<int>("packetCount");
+
+    for (const int count : { 1, 10, 100, 1000 }) {
+        QTest::newRow(qPrintable(QStringLiteral("%1 packets").arg(count))) << count;
+    }
+}
+
+//encodes a batch of small publishes into one buffer, as a corked client does
+void tst_Bench_QMqttControlPacket::encodeToBuffer()
+{
+    QFETCH(int, packetCount);
+
+    const QString topic = QStringLiteral("sensors/42/temperature");
+    const QByteArray message(64, 'm');
+    BenchmarkReport report;
+    QBENCHMARK {
+        QByteArray buffer;
+        for (int i = 0; i < packetCount; ++i) {
+            QMqttPublishControlPacket(topic, message, QMqttProtocol::QoS::AT_LEAST_ONCE, false,
+                                      uint16_t(i + 1)).encodeTo(buffer);
+        }
+        report.iteration();
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_Bench_QMqttControlPacket)
+
+#include "tst_bench_qmqttcontrolpacket.moc"
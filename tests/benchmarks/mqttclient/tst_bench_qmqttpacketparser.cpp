@@ -0,0 +1,194 @@
+#include <QtTest/QtTest>
+#include <QtTest/qtestcase.h>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "qmqttcontrolpacket_p.h"
+#include "qmqttpacketparser_p.h"
+#include "benchmarkreport.h"
+
+typedef QMqttProtocol::PacketType PacketType;
+
+class tst_Bench_QMqttPacketParser: public QObject
+{
+    Q_OBJECT
+
+public:
+    tst_Bench_QMqttPacketParser();
+
+private Q_SLOTS:
+    void parsePublish_data();
+    void parsePublish();
+    void parseAcknowledgement_data();
+    void parseAcknowledgement();
+    void parseMultiPacketFrame_data();
+    void parseMultiPacketFrame();
+    void parseSplitPacket_data();
+    void parseSplitPacket();
+};
+
+//receivers are connected to all signals, so that the cost of delivering the parsed packets
+//is included, as it is in a client
+static void connectReceivers(QMqttPacketParser *parser, int *packets)
+{
+    QObject::connect(parser, &QMqttPacketParser::publish,
+                     [packets](uint16_t, const QMqttMessage &) { ++*packets; });
+    QObject::connect(parser, &QMqttPacketParser::connack,
+                     [packets](QMqttProtocol::Error, bool) { ++*packets; });
+    QObject::connect(parser, &QMqttPacketParser::puback, [packets](uint16_t) { ++*packets; });
+    QObject::connect(parser, &QMqttPacketParser::pubrec, [packets](uint16_t) { ++*packets; });
+    QObject::connect(parser, &QMqttPacketParser::pubrel, [packets](uint16_t) { ++*packets; });
+    QObject::connect(parser, &QMqttPacketParser::pubcomp, [packets](uint16_t) { ++*packets; });
+    QObject::connect(parser, &QMqttPacketParser::suback,
+                     [packets](uint16_t, QVector<QMqttProtocol::QoS>) { ++*packets; });
+    QObject::connect(parser, &QMqttPacketParser::unsuback, [packets](uint16_t) { ++*packets; });
+    QObject::connect(parser, &QMqttPacketParser::pong, [packets]() { ++*packets; });
+    QObject::connect(parser, &QMqttPacketParser::error, [](QMqttProtocol::Error, const QString &errorMessage) {
+        QFAIL(qPrintable(errorMessage));
+    });
+}
+
+static QByteArray encodedPublish(int topicLength, int payloadSize, uint16_t packetIdentifier = 1)
+{
+    return QMqttPublishControlPacket(QString(topicLength, QLatin1Char('t')), QByteArray(payloadSize, 'm'),
+                                     QMqttProtocol::QoS::AT_LEAST_ONCE, false, packetIdentifier).encode();
+}
+
+tst_Bench_QMqttPacketParser::tst_Bench_QMqttPacketParser() :
+    QObject()
+{}
+
+void tst_Bench_QMqttPacketParser::parsePublish_data()
+{
+    QTest::addColumn<int>("topicLength");
+    QTest::addColumn<int>("payloadSize");
+
+    for (const int payloadSize : { 0, 16, 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 }) {
+        QTest::newRow(qPrintable(QStringLiteral("payload %1 B").arg(payloadSize)))
+                << 16 << payloadSize;
+    }
+    for (const int topicLength : { 1, 64, 1024, 65535 }) {
+        QTest::newRow(qPrintable(QStringLiteral("topic %1 chars").arg(topicLength)))
+                << topicLength << 64;
+    }
+}
+
+void tst_Bench_QMqttPacketParser::parsePublish()
+{
+    QFETCH(int, topicLength);
+    QFETCH(int, payloadSize);
+
+    const QByteArray frame = encodedPublish(topicLength, payloadSize);
+    QMqttPacketParser parser;
+    int packets = 0;
+    connectReceivers(&parser, &packets);
+    BenchmarkReport report;
+    QBENCHMARK {
+        parser.parse(frame);
+        report.iteration();
+    }
+    QVERIFY(packets > 0);
+}
+
+void tst_Bench_QMqttPacketParser::parseAcknowledgement_data()
+{
+    QTest::addColumn<QByteArray>("frame");
+
+    QTest::newRow("CONNACK") << QByteArrayLiteral("\x20\x02\x01\x00");
+    QTest::newRow("PUBACK") << QMqttPubAckControlPacket(1).encode();
+    QTest::newRow("PUBREC") << QMqttPubRecControlPacket(1).encode();
+    QTest::newRow("PUBREL") << QMqttPubRelControlPacket(1).encode();
+    QTest::newRow("PUBCOMP") << QMqttPubCompControlPacket(1).encode();
+    QTest::newRow("SUBACK 1 filter") << QByteArrayLiteral("\x90\x03\x00\x01\x01");
+    QTest::newRow("SUBACK 100 filters")
+            << (QByteArrayLiteral("\x90\x66\x00\x01") + QByteArray(100, '\x01'));
+    QTest::newRow("UNSUBACK") << QByteArrayLiteral("\xB0\x02\x00\x01");
+    QTest::newRow("PINGRESP") << QByteArrayLiteral("\xD0\x00");
+}
+
+void tst_Bench_QMqttPacketParser::parseAcknowledgement()
+{
+    QFETCH(QByteArray, frame);
+
+    QMqttPacketParser parser;
+    int packets = 0;
+    connectReceivers(&parser, &packets);
+    BenchmarkReport report;
+    QBENCHMARK {
+        parser.parse(frame);
+        report.iteration();
+    }
+    QVERIFY(packets > 0);
+}
+
+void tst_Bench_QMqttPacketParser::parseMultiPacketFrame_data()
+{
+    QTest::addColumn<QByteArray>("frame");
+    QTest::addColumn<int>("packetCount");
+
+    for (const int count : { 1, 10, 100, 1000 }) {
+        QByteArray acknowledgements;
+        QByteArray publishes;
+        for (int i = 0; i < count; ++i) {
+            acknowledgements.append(QMqttPubAckControlPacket(uint16_t(i + 1)).encode());
+            publishes.append(encodedPublish(32, 64, uint16_t(i + 1)));
+        }
+        QTest::newRow(qPrintable(QStringLiteral("%1 PUBACK").arg(count))) << acknowledgements << count;
+        QTest::newRow(qPrintable(QStringLiteral("%1 PUBLISH").arg(count))) << publishes << count;
+    }
+}
+
+void tst_Bench_QMqttPacketParser::parseMultiPacketFrame()
+{
+    QFETCH(QByteArray, frame);
+    QFETCH(int, packetCount);
+
+    QMqttPacketParser parser;
+    int packets = 0;
+    connectReceivers(&parser, &packets);
+    BenchmarkReport report;
+    QBENCHMARK {
+        parser.parse(frame);
+        report.iteration();
+    }
+    QVERIFY(packets >= packetCount);
+}
+
+void tst_Bench_QMqttPacketParser::parseSplitPacket_data()
+{
+    QTest::addColumn<int>("payloadSize");
+    QTest::addColumn<int>("chunkSize");
+
+    //a large PUBLISH received in the chunks a socket typically delivers
+    QTest::newRow("64 KiB in 1 KiB chunks") << 64 * 1024 << 1024;
+    QTest::newRow("1 MiB in 16 KiB chunks") << 1024 * 1024 << 16 * 1024;
+    QTest::newRow("16 MiB in 64 KiB chunks") << 16 * 1024 * 1024 << 64 * 1024;
+}
+
+void tst_Bench_QMqttPacketParser::parseSplitPacket()
+{
+    QFETCH(int, payloadSize);
+    QFETCH(int, chunkSize);
+
+    const QByteArray packet = encodedPublish(16, payloadSize);
+    QVector<QByteArray> chunks;
+    for (int offset = 0; offset < packet.size(); offset += chunkSize) {
+        chunks.append(packet.mid(offset, chunkSize));
+    }
+    QMqttPacketParser parser;
+    int packets = 0;
+    connectReceivers(&parser, &packets);
+    BenchmarkReport report;
+    QBENCHMARK {
+        for (const QByteArray &chunk : chunks) {
+            parser.parse(chunk);
+        }
+        report.iteration();
+    }
+    QVERIFY(packets > 0);
+}
+
+QTEST_GUILESS_MAIN(tst_Bench_QMqttPacketParser)
+
+#include "tst_bench_qmqttpacketparser.moc"
@@ -18,3 +18,13 @@ macro(add_private_qt_test TEST_NAME SRCS)
     endif(DEFINED PRIVATE_TESTS_ENABLED)
 endmacro()
 
+
+# benchmarks are built, but not registered with CTest, as their run time is long and their
+# results are meant to be compared by hand; run them with -median <n> for stable results
+macro(add_qt_benchmark BENCHMARK_NAME SRCS)
+    find_package(Qt5Test REQUIRED)
+
+    add_executable(${BENCHMARK_NAME} ${SRCS} ${ARGN})
+
+    target_link_libraries(${BENCHMARK_NAME} PUBLIC Qt5::Test)
+endmacro()